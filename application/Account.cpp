@@ -10,11 +10,16 @@
 
 #include <stdio.h>
 
+#include <Autolock.h>
 #include <File.h>
 #include <Message.h>
 #include <Path.h>
 
 #include "Account.h"
+#include "ChatProtocolMessages.h"
+#include "EventRecorder.h"
+#include "EventTrace.h"
+#include "ProtocolInbox.h"
 #include "Utils.h"
 
 
@@ -26,6 +31,11 @@ Account::Account(bigtime_t instanceId, ChatProtocol* cayap,
 	fStatus(B_ERROR),
 	fProtocol(cayap),
 	fMessenger(target),
+	fInbox(NULL),
+	fPushing(0),
+	fDraining(false),
+	fDrained(create_sem(0, "inbox drained")),
+	fRecorder(NULL),
 	fSettings(new BMessage())
 {
 	fProtocol->Init(this);
@@ -53,6 +63,8 @@ Account::Account(bigtime_t instanceId, ChatProtocol* cayap,
 Account::~Account()
 {
 	delete fSettings;
+	delete fRecorder;
+	delete_sem(fDrained);
 }
 
 
@@ -80,6 +92,81 @@ Account::Name() const
 status_t
 Account::SendMessage(BMessage* message)
 {
+	if (message->what == IM_MESSAGE) {
+		BAutolock _(fRecorderLock);
+		if (fRecorder != NULL)
+			fRecorder->Record(message);
+	}
+
 	message->AddInt64("instance", fIdentifier);
+
+	if (message->what == IM_MESSAGE) {
+		EventTrace::Stamp(message, TRACE_ACCOUNT);
+
+		// Push() might wait for room, so the lock isn't held meanwhile: the
+		// looper sending its own messages would be stuck behind it, unable to
+		// make any. SetInbox() waits for those pushing to be through instead.
+		fInboxLock.Lock();
+		ProtocolInbox* inbox = fInbox;
+		if (inbox != NULL)
+			fPushing++;
+		fInboxLock.Unlock();
+
+		if (inbox != NULL) {
+			status_t ret = inbox->Push(message);
+
+			// The last one through wakes SetInbox(), if it's waiting
+			fInboxLock.Lock();
+			bool wake = --fPushing == 0 && fDraining == true;
+			if (wake == true)
+				fDraining = false;
+			fInboxLock.Unlock();
+			if (wake == true)
+				release_sem(fDrained);
+
+			if (ret == B_OK)
+				return B_OK;
+		}
+	}
 	return fMessenger.SendMessage(message);
 }
+
+
+bool
+Account::IsTracing()
+{
+	return EventTrace::IsEnabled();
+}
+
+
+void
+Account::SetInbox(ProtocolInbox* inbox)
+{
+	fInboxLock.Lock();
+	fInbox = inbox;
+	bool wait = fPushing > 0;
+	if (wait == true)
+		fDraining = true;
+	fInboxLock.Unlock();
+
+	// A closed inbox turns them away, so this is brief
+	if (wait == true)
+		acquire_sem(fDrained);
+}
+
+
+EventRecorder*
+Account::SetRecorder(EventRecorder* recorder)
+{
+	BAutolock _(fRecorderLock);
+	EventRecorder* previous = fRecorder;
+	fRecorder = recorder;
+	return previous;
+}
+
+
+BMessenger
+Account::Target() const
+{
+	return fMessenger;
+}
@@ -7,11 +7,15 @@
 #define _ACCOUNT_H
 
 #include <Handler.h>
+#include <Locker.h>
 #include <Messenger.h>
 #include <String.h>
 
 #include "ChatProtocol.h"
 
+class EventRecorder;
+class ProtocolInbox;
+
 class Account : public ChatProtocolMessengerInterface {
 public:
 							Account(bigtime_t instanceId, ChatProtocol* cayap,
@@ -25,6 +29,15 @@ public:
 			const char*		Name() const;
 
 	virtual	status_t		SendMessage(BMessage* message);
+	virtual	bool			IsTracing();
+
+			// IM_MESSAGEs go through inbox (see ProtocolInbox) if set; close
+			// the old one first, as this waits for any still pushing to it
+			void			SetInbox(ProtocolInbox* inbox);
+			BMessenger		Target() const;
+
+			// Records IM_MESSAGEs from now on, if not NULL; returns the last
+			EventRecorder*	SetRecorder(EventRecorder* recorder);
 
 private:
 			bigtime_t		fIdentifier;
@@ -32,6 +45,13 @@ private:
 			BString			fName;
 			status_t		fStatus;
 			BMessenger		fMessenger;
+			ProtocolInbox*	fInbox;
+			BLocker			fInboxLock;	// Guards fInbox, and the below
+			int32			fPushing;
+			bool			fDraining;	// SetInbox() is waiting on fDrained
+			sem_id			fDrained;
+			EventRecorder*	fRecorder;
+			BLocker			fRecorderLock;
 			BMessage*		fSettings;
 };
 
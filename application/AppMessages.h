@@ -59,6 +59,15 @@ const uint32 APP_ACCOUNT_FAILED = 'Axwx';
 //! Request a "help" message
 const uint32 APP_REQUEST_HELP = 'CYhm';
 
+//! Turn latency tracing on or off, or show its results (see EventTrace)
+const uint32 APP_TRACE = 'CYtr';
+
+//! Show or change how accounts' inboxes queue messages (see ProtocolInbox)
+const uint32 APP_QUEUE = 'CYqu';
+
+//! Record the account's messages to a file, or stop (see EventRecorder)
+const uint32 APP_RECORD = 'CYrc';
+
 //! Display a "user info" window
 const uint32 APP_USER_INFO = 'CYuw';
 
@@ -68,6 +77,21 @@ const uint32 APP_ROOM_INFO = 'CYrw';
 //! Open the room's logs with TextSearch
 const uint32 APP_ROOM_SEARCH = 'CYrs';
 
+//! Search every room's logs (see SearchIndex)
+const uint32 APP_SEARCH = 'CYse';
+
+//! A search's results, as sent back by the LogWriter
+const uint32 APP_SEARCH_RESULTS = 'CYsr';
+
+//! Display the search window
+const uint32 APP_SHOW_SEARCH = 'CYsw';
+
+//! Export a room's logs (see LogExporter)
+const uint32 APP_EXPORT = 'CYex';
+
+//! A room's logs have been exported, as sent back by the LogWriter
+const uint32 APP_EXPORT_DONE = 'CYed';
+
 //! Toggle a specific flag for a room
 const uint32 APP_ROOM_FLAG = 'Rlag';
 
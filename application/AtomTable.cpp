@@ -0,0 +1,163 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "AtomTable.h"
+
+#include <Autolock.h>
+#include <Message.h>
+
+
+// An atom's low bits are its slot (plus one, so none is kNoAtom), and the
+// rest count how often the slot's been reused
+const int32 kAtomSlotBits = 22;
+const atom_id kAtomSlotMask = (1 << kAtomSlotBits) - 1;
+
+static int32 sNextSerial = 1;
+
+
+AtomTable::AtomTable()
+	:
+	fLock("atoms"),
+	fSerial(atomic_add(&sNextSerial, 1))
+{
+}
+
+
+atom_id
+AtomTable::Acquire(const BString& string)
+{
+	if (string.IsEmpty() == true)
+		return kNoAtom;
+
+	BAutolock _(fLock);
+	atom_id atom = fAtoms.ValueFor(string);
+	if (atom != kNoAtom) {
+		fSlots.ItemAt(_SlotFor(atom)).references++;
+		return atom;
+	}
+
+	int32 slot;
+	if (fFree.IsEmpty() == false) {
+		slot = fFree.ItemAt(fFree.CountItems() - 1);
+		fFree.RemoveItemAt(fFree.CountItems() - 1);
+	} else {
+		slot = fSlots.CountItems();
+		if (slot >= kAtomSlotMask)
+			return kNoAtom;
+		atom_slot unused = { (atom_id)slot + 1, 0, 0 };
+		fSlots.AddItem(unused);
+	}
+
+	// The slot's next atom, wrapping before the sign bit
+	atom_slot& entry = fSlots.ItemAt(slot);
+	uint32 reuses = ((uint32)entry.atom >> kAtomSlotBits) + 1;
+	atom = (atom_id)(((reuses << kAtomSlotBits) & 0x7fffffff) | (slot + 1));
+	entry.atom = atom;
+	entry.references = 1;
+	entry.position = fAtoms.CountItems();
+	fAtoms.AddItem(string, atom);
+	return atom;
+}
+
+
+void
+AtomTable::Release(atom_id atom)
+{
+	BAutolock _(fLock);
+	int32 slot = _SlotFor(atom);
+	if (slot < 0)
+		return;
+
+	atom_slot& entry = fSlots.ItemAt(slot);
+	if (--entry.references > 0)
+		return;
+
+	// The last ID takes the place of the one removed
+	uint32 last = fAtoms.CountItems() - 1;
+	if (entry.position != last)
+		fSlots.ItemAt(_SlotFor(fAtoms.ValueAt(last))).position
+			= entry.position;
+	fAtoms.RemoveItemAt(entry.position);
+
+	entry.atom &= ~kAtomSlotMask;
+	fFree.AddItem(slot);
+}
+
+
+atom_id
+AtomTable::Find(const BString& string) const
+{
+	if (string.IsEmpty() == true)
+		return kNoAtom;
+	BAutolock _(fLock);
+	return fAtoms.ValueFor(string);
+}
+
+
+BString
+AtomTable::StringFor(atom_id atom) const
+{
+	BAutolock _(fLock);
+	int32 slot = _SlotFor(atom);
+	if (slot < 0)
+		return BString();
+	return fAtoms.KeyAt(fSlots.ItemAt(slot).position);
+}
+
+
+void
+AtomTable::Stamp(BMessage* msg, const char* idName, const char* atomName) const
+{
+	msg->RemoveName(atomName);
+	msg->RemoveName("atom_table");
+	msg->AddInt32("atom_table", fSerial);
+
+	BAutolock _(fLock);
+	const char* id = NULL;
+	for (int32 i = 0; msg->FindString(idName, i, &id) == B_OK; i++)
+		msg->AddInt32(atomName, fAtoms.ValueFor(id));
+}
+
+
+atom_id
+AtomTable::Find(const BMessage* msg, const char* idName, const char* atomName,
+	int32 index) const
+{
+	atom_id atom = kNoAtom;
+	if (msg->GetInt32("atom_table", 0) == fSerial
+			&& msg->FindInt32(atomName, index, &atom) == B_OK
+			&& atom != kNoAtom) {
+		BAutolock _(fLock);
+		if (_SlotFor(atom) >= 0)
+			return atom;
+	}
+
+	const char* id = NULL;
+	if (msg->FindString(idName, index, &id) != B_OK)
+		return kNoAtom;
+	return Find(BString(id));
+}
+
+
+int32
+AtomTable::CountAtoms() const
+{
+	BAutolock _(fLock);
+	return fAtoms.CountItems();
+}
+
+
+// The atom's slot, if it's still in use by that atom, or else -1
+int32
+AtomTable::_SlotFor(atom_id atom) const
+{
+	int32 slot = (atom & kAtomSlotMask) - 1;
+	if (atom <= kNoAtom || slot < 0 || slot >= (int32)fSlots.CountItems())
+		return -1;
+	const atom_slot& entry = fSlots.ItemAt(slot);
+	if (entry.atom != atom || entry.references <= 0)
+		return -1;
+	return slot;
+}
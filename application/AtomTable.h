@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _ATOM_TABLE_H
+#define _ATOM_TABLE_H
+
+#include <Locker.h>
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
+class BMessage;
+
+
+// Stand-in for a user or room ID, only meaningful within its account
+typedef int32 atom_id;
+
+const atom_id kNoAtom = 0;
+
+
+/* Interns an account's user and room IDs, so they can be stored and compared
+ * as integers after their first lookup.
+ *
+ * Atoms are counted: whoever keys something by one (a User, a Conversation,
+ * a role) acquires it, and releases it once done. Once none are left its ID is
+ * forgotten and its slot reused, so the table only grows with what's kept
+ * around, not with every ID that's passed by. A reused slot gets a new atom,
+ * so one read from an older message is never taken for another ID.
+ *
+ * The ProtocolInbox stamps incoming messages with their IDs' atoms on the
+ * account's thread, and the app's thread reads them back with Find(msg, …),
+ * skipping the string lookup. Thread-safe. */
+class AtomTable {
+public:
+							AtomTable();
+
+			atom_id			Acquire(const BString& string);
+			void			Release(atom_id atom);
+
+			atom_id			Find(const BString& string) const;
+			BString			StringFor(atom_id atom) const;
+
+			// Adds atomName's atom for each of idName's IDs (e.g., "user_atom"
+			// for "user_id"), kNoAtom for those without one
+			void			Stamp(BMessage* msg, const char* idName,
+								const char* atomName) const;
+			// The index-th ID's atom as stamped, if it's still that ID's, or
+			// else found by its string
+			atom_id			Find(const BMessage* msg, const char* idName,
+								const char* atomName, int32 index = 0) const;
+
+			int32			CountAtoms() const;
+
+private:
+	struct atom_slot {
+		atom_id		atom;		// kNoAtom while free
+		int32		references;
+		uint32		position;	// Of its ID in fAtoms
+	};
+
+			int32			_SlotFor(atom_id atom) const;
+
+	mutable	BLocker			fLock;
+			int32			fSerial; // Tells our stamps from other tables'
+
+			// The only copy of the IDs
+			KeyMap<BString, atom_id> fAtoms;
+			// Indexed by the atom's low kAtomSlotBits, less one
+			List<atom_slot>	fSlots;
+			List<int32>		fFree;
+};
+
+#endif // _ATOM_TABLE_H
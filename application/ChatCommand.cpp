@@ -10,8 +10,8 @@
 
 #include "Conversation.h"
 #include "MainWindow.h"
+#include "Platform.h"
 #include "ProtocolLooper.h"
-#include "TheApp.h"
 #include "User.h"
 
 
@@ -20,7 +20,7 @@
 
 
 ChatCommand::ChatCommand(const char* name, BMessage msg, bool toProtocol,
-						 List<int32> argTypes)
+						 const List<int32>& argTypes)
 	:
 	fName(name),
 	fMessage(msg),
@@ -111,7 +111,9 @@ ChatCommand::_ProcessArgs(BString args, BMessage* msg, BString* errorMsg,
 		{
 			case CMD_ROOM_PARTICIPANT:
 			{
-				User* user = _FindUser(arg, chat->Users());
+				User* user = chat->UserById(arg);
+				if (user == NULL)
+					user = chat->UserByName(arg);
 				if (user == NULL) {
 					errorMsg->SetTo(B_TRANSLATE("%user% isn't a member of this "
 						"room."));
@@ -123,7 +125,8 @@ ChatCommand::_ProcessArgs(BString args, BMessage* msg, BString* errorMsg,
 			}
 			case CMD_KNOWN_USER:
 			{
-				User* user = _FindUser(arg, chat->GetProtocolLooper()->Users());
+				ProtocolLooper* looper = chat->GetProtocolLooper();
+				User* user = _FindUser(arg, looper->Users(), looper->Atoms());
 				if (user == NULL) {
 					errorMsg->SetTo(B_TRANSLATE("You aren't contacts with and "
 						"have no chats in common with %user%. Shame."));
@@ -151,13 +154,14 @@ ChatCommand::_ProcessArgs(BString args, BMessage* msg, BString* errorMsg,
 
 
 User*
-ChatCommand::_FindUser(BString idOrName, UserMap users)
+ChatCommand::_FindUser(BString idOrName, const UserMap& users,
+	const AtomTable& atoms)
 {
 	if (idOrName.IsEmpty() == true)
 		return NULL;
 
 	bool idFound = false;
-	User* user = users.ValueFor(idOrName, &idFound);
+	User* user = users.ValueFor(atoms.Find(idOrName), &idFound);
 	if (idFound == false)
 		for (int i = 0; i < users.CountItems(); i++) {
 			User* check = users.ValueAt(i);
@@ -174,7 +178,7 @@ ChatCommand::_Send(BMessage* msg, Conversation* chat)
 	if (fToProto == true)
 		chat->GetProtocolLooper()->PostMessage(msg);
 	else
-		((TheApp*)be_app)->GetMainWindow()->PostMessage(msg);
+		AppMainWindow()->PostMessage(msg);
 	return true;
 }
 
@@ -32,7 +32,7 @@ enum cmd_arg_type
 class ChatCommand : public BArchivable {
 public:
 					ChatCommand(const char* name, BMessage msg, bool toProtocol,
-								List<int32> argTypes);
+								const List<int32>& argTypes);
 					ChatCommand(BMessage* data);
 
 	status_t		Archive(BMessage* data, bool deep=true);
@@ -50,7 +50,8 @@ private:
 	bool			_ProcessArgs(BString args, BMessage* msg, BString* errorMsg,
 								 Conversation* chat);
 
-	User*			_FindUser(BString idOrName, UserMap users);
+	User*			_FindUser(BString idOrName, const UserMap& users,
+						const AtomTable& atoms);
 
 	bool			_Send(BMessage* msg, Conversation* chat);
 
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ChatEvent.h"
+
+#include <string.h>
+
+#include <Message.h>
+
+#include "ChatProtocolMessages.h"
+
+
+const char* kChatEventField = "event";
+
+
+ChatEvent::ChatEvent()
+{
+	MakeEmpty();
+}
+
+
+ChatEvent::ChatEvent(const BMessage* msg)
+{
+	SetTo(msg);
+}
+
+
+status_t
+ChatEvent::SetTo(const BMessage* msg)
+{
+	MakeEmpty();
+	if (msg == NULL)
+		return B_BAD_VALUE;
+
+	const void* data = NULL;
+	ssize_t size = 0;
+	if (msg->FindData(kChatEventField, kChatEventType, &data, &size) == B_OK
+			&& Unflatten(data, size) == B_OK)
+		return B_OK;
+
+	_SetToFields(msg);
+	return B_OK;
+}
+
+
+void
+ChatEvent::MakeEmpty()
+{
+	fWhat = 0;
+	fWhen = 0;
+	fStatus = 0;
+	fFlags = 0;
+	fUserColor = make_color(0, 0, 0);
+	fChatId.Truncate(0);
+	fUserId.Truncate(0);
+	fUserName.Truncate(0);
+	fBody.Truncate(0);
+	fFaces.MakeEmpty();
+	fColors.MakeEmpty();
+}
+
+
+status_t
+ChatEvent::AddTo(BMessage* msg) const
+{
+	ssize_t size = FlattenedSize();
+	char* buffer = new char[size];
+	status_t ret = Flatten(buffer, size);
+	if (ret == B_OK) {
+		msg->RemoveName(kChatEventField);
+		ret = msg->AddData(kChatEventField, kChatEventType, buffer, size, false);
+	}
+	delete[] buffer;
+	return ret;
+}
+
+
+void
+ChatEvent::AddFieldsTo(BMessage* msg) const
+{
+	msg->AddInt32("im_what", fWhat);
+	if (fChatId.IsEmpty() == false)
+		msg->AddString("chat_id", fChatId);
+	if (fUserId.IsEmpty() == false)
+		msg->AddString("user_id", fUserId);
+	if (fUserName.IsEmpty() == false)
+		msg->AddString("user_name", fUserName);
+	if (fBody.IsEmpty() == false)
+		msg->AddString(fWhat == IM_USER_STATUS_SET ? "message" : "body", fBody);
+	if (fWhen != 0)
+		msg->AddInt64("when", fWhen);
+	if (fFlags & CHAT_EVENT_STATUS)
+		msg->AddInt32("status", fStatus);
+	if (fFlags & CHAT_EVENT_USER_COLOR)
+		msg->AddColor("user_color", fUserColor);
+
+	for (uint32 i = 0; i < fFaces.CountItems(); i++) {
+		const face_span& span = fFaces.ItemAt(i);
+		msg->AddInt32("face_start", span.start);
+		msg->AddInt32("face_length", span.length);
+		msg->AddUInt16("face", span.face);
+	}
+	for (uint32 i = 0; i < fColors.CountItems(); i++) {
+		const color_span& span = fColors.ItemAt(i);
+		msg->AddInt32("color_start", span.start);
+		msg->AddInt32("color_length", span.length);
+		msg->AddColor("color", span.color);
+	}
+}
+
+
+ssize_t
+ChatEvent::FlattenedSize() const
+{
+	return sizeof(chat_event_header)
+		+ fFaces.CountItems() * sizeof(face_span)
+		+ fColors.CountItems() * sizeof(color_span)
+		+ fChatId.Length() + fUserId.Length() + fUserName.Length()
+		+ fBody.Length();
+}
+
+
+status_t
+ChatEvent::Flatten(void* buffer, ssize_t size) const
+{
+	if (buffer == NULL || size < FlattenedSize())
+		return B_BAD_VALUE;
+
+	const BString* strings[4] = { &fChatId, &fUserId, &fUserName, &fBody };
+
+	chat_event_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kChatEventMagic;
+	header.version = kChatEventVersion;
+	header.flags = fFlags;
+	header.im_what = fWhat;
+	header.status = fStatus;
+	header.when = fWhen;
+	for (int i = 0; i < 4; i++)
+		header.string_sizes[i] = strings[i]->Length();
+	header.face_count = fFaces.CountItems();
+	header.color_count = fColors.CountItems();
+	header.user_color = fUserColor;
+
+	char* out = (char*)buffer;
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	for (uint32 i = 0; i < header.face_count; i++, out += sizeof(face_span))
+		memcpy(out, &fFaces.ItemAt(i), sizeof(face_span));
+	for (uint32 i = 0; i < header.color_count; i++, out += sizeof(color_span))
+		memcpy(out, &fColors.ItemAt(i), sizeof(color_span));
+
+	for (int i = 0; i < 4; i++) {
+		memcpy(out, strings[i]->String(), header.string_sizes[i]);
+		out += header.string_sizes[i];
+	}
+	return B_OK;
+}
+
+
+status_t
+ChatEvent::Unflatten(const void* buffer, ssize_t size)
+{
+	MakeEmpty();
+
+	chat_event_header header;
+	if (buffer == NULL || size < (ssize_t)sizeof(header))
+		return B_BAD_DATA;
+	memcpy(&header, buffer, sizeof(header));
+	if (header.magic != kChatEventMagic || header.version != kChatEventVersion)
+		return B_BAD_DATA;
+
+	uint64 needed = sizeof(header)
+		+ (uint64)header.face_count * sizeof(face_span)
+		+ (uint64)header.color_count * sizeof(color_span);
+	for (int i = 0; i < 4; i++)
+		needed += header.string_sizes[i];
+	if (needed > (uint64)size)
+		return B_BAD_DATA;
+
+	fWhat = header.im_what;
+	fStatus = header.status;
+	fWhen = header.when;
+	fFlags = header.flags;
+	fUserColor = header.user_color;
+
+	const char* in = (const char*)buffer + sizeof(header);
+	for (uint32 i = 0; i < header.face_count; i++, in += sizeof(face_span)) {
+		face_span span;
+		memcpy(&span, in, sizeof(span));
+		fFaces.AddItem(span);
+	}
+	for (uint32 i = 0; i < header.color_count; i++, in += sizeof(color_span)) {
+		color_span span;
+		memcpy(&span, in, sizeof(span));
+		fColors.AddItem(span);
+	}
+
+	BString* strings[4] = { &fChatId, &fUserId, &fUserName, &fBody };
+	for (int i = 0; i < 4; i++) {
+		strings[i]->SetTo(in, header.string_sizes[i]);
+		in += header.string_sizes[i];
+	}
+	return B_OK;
+}
+
+
+void
+ChatEvent::AddFace(int32 start, int32 length, uint16 face)
+{
+	face_span span = { start, length, face, 0 };
+	fFaces.AddItem(span);
+}
+
+
+void
+ChatEvent::AddColor(int32 start, int32 length, rgb_color color)
+{
+	color_span span = { start, length, color };
+	fColors.AddItem(span);
+}
+
+
+void
+ChatEvent::SetUserColor(rgb_color color)
+{
+	fUserColor = color;
+	fFlags |= CHAT_EVENT_USER_COLOR;
+}
+
+
+void
+ChatEvent::SetStatus(int32 status)
+{
+	fStatus = status;
+	fFlags |= CHAT_EVENT_STATUS;
+}
+
+
+void
+ChatEvent::_SetToFields(const BMessage* msg)
+{
+	fWhat = msg->GetInt32("im_what", 0);
+	fWhen = msg->GetInt64("when", 0);
+	fChatId = msg->FindString("chat_id");
+	fUserId = msg->FindString("user_id");
+	fUserName = msg->FindString("user_name");
+	if (fWhat == IM_USER_STATUS_SET)
+		fBody = msg->FindString("message");
+	else
+		fBody = msg->FindString("body");
+
+	int32 status;
+	if (msg->FindInt32("status", &status) == B_OK)
+		SetStatus(status);
+	rgb_color color;
+	if (msg->FindColor("user_color", &color) == B_OK)
+		SetUserColor(color);
+
+	int32 start, length;
+	uint16 face;
+	for (int32 i = 0; msg->FindInt32("face_start", i, &start) == B_OK; i++)
+		if (msg->FindInt32("face_length", i, &length) == B_OK
+				&& msg->FindUInt16("face", i, &face) == B_OK)
+			AddFace(start, length, face);
+
+	for (int32 i = 0; msg->FindInt32("color_start", i, &start) == B_OK; i++)
+		if (msg->FindInt32("color_length", i, &length) == B_OK
+				&& msg->FindColor("color", i, &color) == B_OK)
+			AddColor(start, length, color);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _CHAT_EVENT_H
+#define _CHAT_EVENT_H
+
+#include <GraphicsDefs.h>
+#include <String.h>
+
+#include <libsupport/List.h>
+
+class BMessage;
+
+
+// Type and field name of a ChatEvent flattened into an IM_MESSAGE
+const type_code kChatEventType = 'CHEV';
+extern const char* kChatEventField;
+
+const uint32 kChatEventMagic = 'ChEv';
+const uint16 kChatEventVersion = 1;
+
+
+struct face_span {
+	int32	start;
+	int32	length;
+	uint16	face;
+	uint16	_reserved;
+};
+
+
+struct color_span {
+	int32		start;
+	int32		length;
+	rgb_color	color;
+};
+
+
+// Fixed-size head of a flattened ChatEvent; followed by its face and color
+// spans, then its strings (chat_id, user_id, user_name, body), unterminated.
+struct chat_event_header {
+	uint32		magic;
+	uint16		version;
+	uint16		flags;
+	int32		im_what;
+	int32		status;
+	int64		when;
+	uint32		string_sizes[4];
+	uint32		face_count;
+	uint32		color_count;
+	rgb_color	user_color;
+	uint32		_reserved;
+};
+
+enum chat_event_flags {
+	CHAT_EVENT_USER_COLOR = 1 << 0,
+	CHAT_EVENT_STATUS = 1 << 1,
+	CHAT_EVENT_LOGGED = 1 << 2	// Already written to the room's ChatLog
+};
+
+
+// A message's place in its room's ChatLog, also the tail index's slots
+struct log_position {
+	uint32	segment;
+	uint32	offset;
+};
+
+
+/* A chat message or presence change (IM_MESSAGE_RECEIVED, IM_MESSAGE_SENT,
+ * IM_USER_STATUS_SET), parsed once from its BMessage and then passed along
+ * by reference. It can travel inside a BMessage as one flat kChatEventField,
+ * which is read back without any per-field lookups. */
+class ChatEvent {
+public:
+						ChatEvent();
+						ChatEvent(const BMessage* msg);
+
+			// From kChatEventField if there is one, or else the named fields
+			status_t	SetTo(const BMessage* msg);
+			void		MakeEmpty();
+
+			// Adds (or replaces) kChatEventField
+			status_t	AddTo(BMessage* msg) const;
+			// Adds the usual named fields, e.g., for logs
+			void		AddFieldsTo(BMessage* msg) const;
+
+			ssize_t		FlattenedSize() const;
+			status_t	Flatten(void* buffer, ssize_t size) const;
+			status_t	Unflatten(const void* buffer, ssize_t size);
+
+			void		AddFace(int32 start, int32 length, uint16 face);
+			void		AddColor(int32 start, int32 length, rgb_color color);
+			void		SetUserColor(rgb_color color);
+			void		SetStatus(int32 status);
+
+	int32				fWhat;
+	int64				fWhen;		// Seconds, as with time()
+	int32				fStatus;	// For presence, if fFlags has it
+	uint16				fFlags;
+	rgb_color			fUserColor;
+
+	BString				fChatId;
+	BString				fUserId;
+	BString				fUserName;
+	BString				fBody;		// Or personal status, for presence
+
+	List<face_span>		fFaces;
+	List<color_span>	fColors;
+
+private:
+			void		_SetToFields(const BMessage* msg);
+};
+
+#endif // _CHAT_EVENT_H
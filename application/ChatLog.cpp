@@ -0,0 +1,896 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ChatLog.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <Autolock.h>
+#include <DataIO.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <Message.h>
+
+#include <libsupport/KeyMap.h>
+
+#include "ChatProtocolMessages.h"
+#include "Flags.h"
+#include "StorageUtils.h"
+
+
+const uint32 kLogTailMagic = 'ChLt';
+const uint32 kLogTailVersion = 1;
+
+const uint32 kLogArchiveMagic = 'ChLz';
+const uint32 kLogArchiveVersion = 1;
+
+// How often archives past the retention period are looked for, in seconds
+const time_t kLogExpiryInterval = 60 * 60;
+
+// Each room's, kept for as long as the app runs― so a room's reader only ever
+// waits on that room's appender or archiver, never another's
+static KeyMap<BString, BLocker*> sRoomLocks;
+static BLocker sRoomLocksLock("chat log locks");
+
+
+static BLocker*
+room_lock(const char* directory)
+{
+	BAutolock _(sRoomLocksLock);
+	BLocker* lock = sRoomLocks.ValueFor(directory);
+	if (lock == NULL) {
+		lock = new BLocker("chat log");
+		sRoomLocks.AddItem(directory, lock);
+	}
+	return lock;
+}
+
+
+/* A segment file, mapped read-only― only the pages of records that are read
+ * are ever loaded. An archived segment's frames are inflated as they're first
+ * needed, into a buffer the size of the whole segment. */
+class MappedSegment {
+public:
+						MappedSegment();
+						~MappedSegment();
+
+			status_t	SetTo(const char* path, uint32 segment, bool archived);
+			void		Unset();
+
+			uint32		Segment() const { return fSegment; }
+			size_t		Size() const { return fSize; }
+
+			// The record at offset, or NULL if it runs past the end
+			const void*	RecordAt(uint32 offset, uint32* size);
+
+private:
+			status_t	_SetToArchive();
+			bool		_Inflate(uint32 offset, uint32 length);
+
+			uint8*		fMap;
+			size_t		fMapSize;
+
+			// The segment's records― the mapping itself, unless archived
+			uint8*		fData;
+			size_t		fSize;
+			uint32		fSegment;
+
+			bool		fArchived;
+			uint32		fFrameCount;
+			List<uint8>	fInflated;
+};
+
+
+MappedSegment::MappedSegment()
+	:
+	fMap(NULL),
+	fMapSize(0),
+	fData(NULL),
+	fSize(0),
+	fSegment(0),
+	fArchived(false),
+	fFrameCount(0)
+{
+}
+
+
+MappedSegment::~MappedSegment()
+{
+	Unset();
+}
+
+
+status_t
+MappedSegment::SetTo(const char* path, uint32 segment, bool archived)
+{
+	Unset();
+	fSegment = segment;
+	fArchived = archived;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return B_ENTRY_NOT_FOUND;
+
+	struct stat st;
+	status_t ret = B_OK;
+	if (fstat(fd, &st) != 0)
+		ret = B_IO_ERROR;
+	else if (st.st_size > 0) {
+		void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED)
+			ret = B_NO_MEMORY;
+		else {
+			fMap = (uint8*)data;
+			fMapSize = st.st_size;
+		}
+	}
+	close(fd);
+
+	if (ret != B_OK || fArchived == false) {
+		fData = fMap;
+		fSize = fMapSize;
+		return ret;
+	}
+	return _SetToArchive();
+}
+
+
+void
+MappedSegment::Unset()
+{
+	if (fData != fMap)
+		free(fData);
+	if (fMap != NULL)
+		munmap(fMap, fMapSize);
+	fMap = NULL;
+	fMapSize = 0;
+	fData = NULL;
+	fSize = 0;
+	fFrameCount = 0;
+	fInflated.MakeEmpty();
+}
+
+
+const void*
+MappedSegment::RecordAt(uint32 offset, uint32* size)
+{
+	if (fData == NULL || (uint64)offset + sizeof(uint32) > fSize
+			|| _Inflate(offset, sizeof(uint32)) == false)
+		return NULL;
+	memcpy(size, fData + offset, sizeof(uint32));
+	if ((uint64)offset + sizeof(uint32) + *size > fSize
+			|| _Inflate(offset + sizeof(uint32), *size) == false)
+		return NULL;
+	return fData + offset + sizeof(uint32);
+}
+
+
+status_t
+MappedSegment::_SetToArchive()
+{
+	log_archive_header header;
+	if (fMapSize < sizeof(header))
+		return B_BAD_DATA;
+	memcpy(&header, fMap, sizeof(header));
+
+	uint64 tableEnd = sizeof(header)
+		+ ((uint64)header.frame_count + 1) * sizeof(uint32);
+	if (header.magic != kLogArchiveMagic || header.version != kLogArchiveVersion
+			|| tableEnd > fMapSize
+			|| header.frame_count
+				!= (header.size + kLogFrameSize - 1) / kLogFrameSize)
+		return B_BAD_DATA;
+
+	if (header.size > 0) {
+		fData = (uint8*)malloc(header.size);
+		if (fData == NULL)
+			return B_NO_MEMORY;
+	}
+	fSize = header.size;
+	fFrameCount = header.frame_count;
+	for (uint32 i = 0; i < fFrameCount; i++)
+		fInflated.AddItem(0);
+	return B_OK;
+}
+
+
+bool
+MappedSegment::_Inflate(uint32 offset, uint32 length)
+{
+	if (fArchived == false || length == 0)
+		return true;
+
+	uint32 last = (offset + length - 1) / kLogFrameSize;
+	for (uint32 frame = offset / kLogFrameSize; frame <= last; frame++) {
+		if (frame >= fFrameCount)
+			return false;
+		if (fInflated.ItemAt(frame) != 0)
+			continue;
+
+		uint32 bounds[2];
+		memcpy(bounds, fMap + sizeof(log_archive_header)
+			+ frame * sizeof(uint32), sizeof(bounds));
+		if (bounds[0] > bounds[1] || bounds[1] > fMapSize)
+			return false;
+
+		uint32 start = frame * kLogFrameSize;
+		uLongf size = fSize - start;
+		if (size > kLogFrameSize)
+			size = kLogFrameSize;
+		if (uncompress(fData + start, &size, fMap + bounds[0],
+				bounds[1] - bounds[0]) != Z_OK)
+			return false;
+		fInflated.ItemAt(frame) = 1;
+	}
+	return true;
+}
+
+
+ChatLog::ChatLog(const char* accountName, const char* roomId)
+	:
+	fDirectory(RoomLogsPath(accountName, roomId)),
+	fRoomPath(RoomCachePath(accountName, roomId)),
+	fLock(room_lock(fDirectory.Path())),
+	fSegmentNumber(0),
+	fSegmentStart(0),
+	fScanned(false),
+	fExpired(0)
+{
+	memset(&fHeader, 0, sizeof(fHeader));
+}
+
+
+status_t
+ChatLog::Append(const ChatEvent& event)
+{
+	List<ChatEvent> events;
+	events.AddItem(event);
+	return Append(events);
+}
+
+
+status_t
+ChatLog::Append(const List<ChatEvent>& events, List<log_position>* positions)
+{
+	BAutolock _(fLock);
+	status_t ret = _OpenIndex();
+	for (uint32 i = 0; i < events.CountItems(); i++) {
+		log_position position;
+		if (ret == B_OK)
+			ret = _Write(events.ItemAt(i), &position);
+		if (ret == B_OK && positions != NULL)
+			positions->AddItem(position);
+	}
+	if (ret == B_OK)
+		ret = _WriteHeader();
+	return ret;
+}
+
+
+status_t
+ChatLog::Read(BMessage* logs, int32 count)
+{
+	BAutolock _(fLock);
+	status_t ret = _OpenIndex();
+	if (ret != B_OK)
+		return ret;
+
+	// More than the tail keeps track of
+	if (count > (int32)fHeader.count && fHeader.count == (uint32)kLogTailSize) {
+		log_position end = { fHeader.segment, fHeader.segment_size };
+		return _ReadBefore(logs, end, count);
+	}
+
+	// With a partly-filled tail, it holds everything there is
+	bool start = (count >= (int32)fHeader.count
+		&& fHeader.count < (uint32)kLogTailSize);
+	if (count > (int32)fHeader.count)
+		count = fHeader.count;
+	if (count <= 0)
+		return B_ENTRY_NOT_FOUND;
+
+	// Until the ring's first filled, the file ends with its last slot
+	log_position slots[kLogTailSize];
+	ssize_t filledSize = sizeof(log_position) * fHeader.count;
+	if (fIndex.ReadAt(sizeof(fHeader), slots, sizeof(slots)) < filledSize)
+		return B_IO_ERROR;
+
+	logs->what = IM_MESSAGE;
+	logs->AddInt32("im_what", IM_LOGS_RECEIVED);
+
+	MappedSegment segment;
+	int32 first = (fHeader.next + kLogTailSize - count) % kLogTailSize;
+	for (int32 i = 0; i < count; i++) {
+		log_position& slot = slots[(first + i) % kLogTailSize];
+		if (i == 0 || slot.segment != segment.Segment())
+			_Map(&segment, slot.segment);
+
+		uint32 size = 0;
+		const void* record = segment.RecordAt(slot.offset, &size);
+		if (record != NULL)
+			_AddEntry(logs, record, size);
+	}
+	_AddPosition(logs, slots[first], start);
+	return B_OK;
+}
+
+
+status_t
+ChatLog::ReadBefore(BMessage* logs, log_position before, int32 count)
+{
+	BAutolock _(fLock);
+	return _ReadBefore(logs, before, count);
+}
+
+
+status_t
+ChatLog::ReadEvent(log_position position, ChatEvent* event)
+{
+	BAutolock _(fLock);
+	MappedSegment segment;
+	status_t ret = _Map(&segment, position.segment);
+	if (ret != B_OK)
+		return ret;
+
+	uint32 size = 0;
+	const void* record = segment.RecordAt(position.offset, &size);
+	if (record == NULL)
+		return B_BAD_DATA;
+	return event->Unflatten(record, size);
+}
+
+
+status_t
+ChatLog::ReadSegment(uint32 segment, List<ChatEvent>* events,
+	List<log_position>* positions)
+{
+	BAutolock _(fLock);
+	return _ReadSegment(segment, events, positions);
+}
+
+
+uint32
+ChatLog::CountSegments()
+{
+	BAutolock _(fLock);
+	if (_OpenIndex() != B_OK)
+		return 0;
+	return fHeader.segment + 1;
+}
+
+
+status_t
+ChatLog::FindLatest(int32 count, log_position* position)
+{
+	BAutolock _(fLock);
+	status_t ret = _OpenIndex();
+	if (ret != B_OK)
+		return ret;
+
+	log_position end = { fHeader.segment, fHeader.segment_size };
+	if (count <= 0) {
+		*position = end;
+		return B_OK;
+	}
+
+	// Kept track of by the tail, then
+	if (count <= (int32)fHeader.count) {
+		uint32 slot = (fHeader.next + kLogTailSize - count) % kLogTailSize;
+		if (fIndex.ReadAt(sizeof(fHeader) + slot * sizeof(log_position),
+				position, sizeof(log_position)) != sizeof(log_position))
+			return B_IO_ERROR;
+		return B_OK;
+	}
+
+	List<log_position> newest;
+	bool start = false;
+	_FindBefore(end, count, &newest, &start);
+	if (newest.IsEmpty() == true)
+		return B_ENTRY_NOT_FOUND;
+	*position = newest.ItemAt(newest.CountItems() - 1);
+	return B_OK;
+}
+
+
+log_position
+ChatLog::End()
+{
+	BAutolock _(fLock);
+	log_position end = { 0, 0 };
+	if (_OpenIndex() == B_OK) {
+		end.segment = fHeader.segment;
+		end.offset = fHeader.segment_size;
+	}
+	return end;
+}
+
+
+/*static*/ status_t
+ChatLog::FindPosition(const BMessage* logs, log_position* position, bool* start)
+{
+	int32 segment, offset;
+	if (logs->FindInt32("log_segment", &segment) != B_OK
+			|| logs->FindInt32("log_offset", &offset) != B_OK)
+		return B_NAME_NOT_FOUND;
+
+	position->segment = segment;
+	position->offset = offset;
+	if (start != NULL)
+		*start = logs->GetBool("log_start", false);
+	return B_OK;
+}
+
+
+status_t
+ChatLog::Sync()
+{
+	BAutolock _(fLock);
+	if (fSegment.InitCheck() == B_OK)
+		fSegment.Sync();
+	if (fIndex.InitCheck() != B_OK)
+		return fIndex.InitCheck();
+	return fIndex.Sync();
+}
+
+
+status_t
+ChatLog::Archive(time_t retention)
+{
+	if (fScanned == false) {
+		BAutolock _(fLock);
+		if (_OpenIndex() != B_OK)
+			return B_ERROR;
+		_FindSealed();
+		fScanned = true;
+	}
+
+	// Sealed segments never change, so they're compressed unlocked
+	status_t ret = B_OK;
+	while (fSealed.IsEmpty() == false) {
+		uint32 last = fSealed.CountItems() - 1;
+		status_t compressed = _Compress(fSealed.ItemAt(last));
+		if (compressed != B_OK)
+			ret = compressed;
+		fSealed.RemoveItemAt(last);
+	}
+
+	time_t now = time(NULL);
+	if (retention > 0 && now - fExpired > kLogExpiryInterval) {
+		fExpired = now;
+		_Expire(now - retention);
+	}
+	return ret;
+}
+
+
+status_t
+ChatLog::_OpenIndex()
+{
+	if (fIndex.InitCheck() == B_OK)
+		return B_OK;
+
+	BPath path(fDirectory);
+	path.Append("tail");
+	status_t ret = fIndex.SetTo(path.Path(), B_READ_WRITE | B_CREATE_FILE);
+	if (ret != B_OK)
+		return ret;
+
+	if (fIndex.ReadAt(0, &fHeader, sizeof(fHeader)) == sizeof(fHeader)
+			&& fHeader.magic == kLogTailMagic
+			&& fHeader.version == kLogTailVersion)
+		return B_OK;
+
+	// A new log, then
+	memset(&fHeader, 0, sizeof(fHeader));
+	fHeader.magic = kLogTailMagic;
+	fHeader.version = kLogTailVersion;
+	if (_WriteHeader() != B_OK)
+		return B_IO_ERROR;
+
+	ret = _Import();
+	if (ret == B_OK)
+		ret = _WriteHeader();
+	return ret;
+}
+
+
+status_t
+ChatLog::_Write(const ChatEvent& event, log_position* position)
+{
+	uint32 size = event.FlattenedSize();
+	uint32 total = sizeof(size) + size;
+	if (fSegment.InitCheck() != B_OK || fSegmentNumber != fHeader.segment) {
+		fSegment.SetTo(_SegmentPath(fHeader.segment).Path(),
+			B_WRITE_ONLY | B_CREATE_FILE);
+		fSegmentNumber = fHeader.segment;
+		if (fSegment.GetCreationTime(&fSegmentStart) != B_OK)
+			fSegmentStart = time(NULL);
+	}
+
+	if (fHeader.segment_size > 0
+			&& (fHeader.segment_size + total > kLogSegmentSize
+				|| time(NULL) - fSegmentStart > kLogSegmentAge)) {
+		fSealed.AddItem(fHeader.segment);
+		fHeader.segment++;
+		fHeader.segment_size = 0;
+
+		fSegment.SetTo(_SegmentPath(fHeader.segment).Path(),
+			B_WRITE_ONLY | B_CREATE_FILE);
+		fSegmentNumber = fHeader.segment;
+		fSegmentStart = time(NULL);
+	}
+	if (fSegment.InitCheck() != B_OK)
+		return fSegment.InitCheck();
+
+	char* buffer = new char[total];
+	memcpy(buffer, &size, sizeof(size));
+	status_t ret = event.Flatten(buffer + sizeof(size), size);
+	if (ret == B_OK && fSegment.WriteAt(fHeader.segment_size, buffer, total)
+			!= (ssize_t)total)
+		ret = B_IO_ERROR;
+	delete[] buffer;
+	if (ret != B_OK)
+		return ret;
+
+	log_position slot = { fHeader.segment, fHeader.segment_size };
+	fIndex.WriteAt(sizeof(fHeader) + fHeader.next * sizeof(slot), &slot,
+		sizeof(slot));
+	if (position != NULL)
+		*position = slot;
+
+	fHeader.segment_size += total;
+	fHeader.next = (fHeader.next + 1) % kLogTailSize;
+	if (fHeader.count < (uint32)kLogTailSize)
+		fHeader.count++;
+	return B_OK;
+}
+
+
+status_t
+ChatLog::_WriteHeader()
+{
+	if (fIndex.WriteAt(0, &fHeader, sizeof(fHeader)) != sizeof(fHeader))
+		return B_IO_ERROR;
+	return B_OK;
+}
+
+
+status_t
+ChatLog::_Import()
+{
+	BFile roomFile(fRoomPath.Path(), B_READ_ONLY);
+	BMessage logs;
+	if (roomFile.InitCheck() != B_OK
+			|| ReadAttributeMessage(&roomFile, "Chat:logs", &logs) != B_OK)
+		return B_OK;
+
+	BMessage entry;
+	for (int32 i = 0; logs.FindMessage("message", i, &entry) == B_OK; i++)
+		_Write(ChatEvent(&entry));
+	return B_OK;
+}
+
+
+void
+ChatLog::_FindSealed()
+{
+	// Those left behind last time, e.g., by quitting mid-way, as well as any
+	// sealed since― so none's listed twice
+	fSealed.MakeEmpty();
+	BDirectory directory(fDirectory.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		uint32 number;
+		char extra;
+		if (entry.GetName(name) == B_OK
+				&& sscanf(name, "%" B_SCNu32 ".log%c", &number, &extra) == 1
+				&& number < fHeader.segment)
+			fSealed.AddItem(number);
+	}
+}
+
+
+status_t
+ChatLog::_Compress(uint32 segment)
+{
+	BFile in(_SegmentPath(segment).Path(), B_READ_ONLY);
+	off_t size = 0;
+	time_t modified = 0;
+	status_t ret = in.GetSize(&size);
+	if (ret != B_OK)
+		return ret;
+	in.GetModificationTime(&modified);
+
+	uint8* data = new uint8[size + 1];
+	if (in.ReadAt(0, data, size) != size) {
+		delete[] data;
+		return B_IO_ERROR;
+	}
+
+	log_archive_header header;
+	header.magic = kLogArchiveMagic;
+	header.version = kLogArchiveVersion;
+	header.size = size;
+	header.frame_count = (size + kLogFrameSize - 1) / kLogFrameSize;
+
+	uint32* offsets = new uint32[header.frame_count + 1];
+	uLongf bound = compressBound(kLogFrameSize);
+	Bytef* frame = new Bytef[bound];
+
+	// Any failure leaves the segment as it is, to be tried again next time
+	BMallocIO out;
+	size_t tableSize = (header.frame_count + 1) * sizeof(uint32);
+	if (out.Write(&header, sizeof(header)) != sizeof(header)
+			|| out.Write(offsets, tableSize) != (ssize_t)tableSize)
+		ret = B_NO_MEMORY;
+	for (uint32 i = 0; i < header.frame_count && ret == B_OK; i++) {
+		uint32 start = i * kLogFrameSize;
+		uLong length = size - start;
+		if (length > kLogFrameSize)
+			length = kLogFrameSize;
+
+		uLongf compressed = bound;
+		if (compress2(frame, &compressed, data + start, length,
+				Z_BEST_COMPRESSION) != Z_OK) {
+			ret = B_ERROR;
+			break;
+		}
+		offsets[i] = out.Position();
+		if (out.Write(frame, compressed) != (ssize_t)compressed)
+			ret = B_NO_MEMORY;
+	}
+	if (ret == B_OK) {
+		offsets[header.frame_count] = out.Position();
+		if (out.WriteAt(sizeof(header), offsets, tableSize)
+				!= (ssize_t)tableSize)
+			ret = B_NO_MEMORY;
+	}
+
+	delete[] frame;
+	delete[] offsets;
+	delete[] data;
+	if (ret != B_OK)
+		return ret;
+
+	// Written aside, then swapped in while no one's reading
+	BPath archivePath = _ArchivePath(segment);
+	BString tempPath(archivePath.Path());
+	tempPath << ".tmp";
+	BFile temp(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	ret = temp.InitCheck();
+	if (ret == B_OK && temp.Write(out.Buffer(), out.BufferLength())
+			!= (ssize_t)out.BufferLength())
+		ret = B_IO_ERROR;
+	if (ret == B_OK)
+		ret = temp.Sync();
+	if (ret != B_OK) {
+		temp.Unset();
+		BEntry(tempPath.String()).Remove();
+		return ret;
+	}
+	temp.SetModificationTime(modified);
+	temp.Unset();
+
+	BAutolock _(fLock);
+	BEntry tempEntry(tempPath.String());
+	ret = tempEntry.Rename(archivePath.Leaf(), true);
+	if (ret == B_OK)
+		ret = BEntry(_SegmentPath(segment).Path()).Remove();
+	else
+		tempEntry.Remove();
+	return ret;
+}
+
+
+void
+ChatLog::_Expire(time_t before)
+{
+	if (_KeepsLogs() == true)
+		return;
+
+	BAutolock _(fLock);
+	if (_OpenIndex() != B_OK)
+		return;
+
+	// Nor any the tail still points into, however old, so Read() always
+	// finds what it's told is there
+	uint32 oldestTail = fHeader.segment;
+	if (fHeader.count > 0) {
+		log_position oldest;
+		uint32 slot = (fHeader.next + kLogTailSize - fHeader.count)
+			% kLogTailSize;
+		if (fIndex.ReadAt(sizeof(fHeader) + slot * sizeof(oldest), &oldest,
+				sizeof(oldest)) != sizeof(oldest))
+			return;
+		oldestTail = oldest.segment;
+	}
+
+	BDirectory directory(fDirectory.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		time_t modified;
+		if (entry.GetName(name) != B_OK
+				|| entry.GetModificationTime(&modified) != B_OK
+				|| modified >= before)
+			continue;
+
+		// Only archives, never the segment being appended to
+		BString leaf(name);
+		uint32 number;
+		if (leaf.EndsWith(".logz")) {
+			if (sscanf(name, "%" B_SCNu32 ".logz", &number) == 1
+					&& number < oldestTail)
+				entry.Remove();
+		} else if (leaf.StartsWith("text-") && leaf.EndsWith(".gz"))
+			entry.Remove();
+	}
+}
+
+
+bool
+ChatLog::_KeepsLogs()
+{
+	BFile room(fRoomPath.Path(), B_READ_ONLY);
+	int32 flags = 0;
+	if (room.ReadAttr("Chat:flags", B_INT32_TYPE, 0, &flags, sizeof(flags))
+			!= sizeof(flags))
+		return false;
+	return (flags & ROOM_KEEP_LOGS) != 0;
+}
+
+
+status_t
+ChatLog::_ReadBefore(BMessage* logs, log_position before, int32 count)
+{
+	List<log_position> newest;
+	bool start = false;
+	_FindBefore(before, count, &newest, &start);
+
+	logs->what = IM_MESSAGE;
+	logs->AddInt32("im_what", IM_LOGS_RECEIVED);
+
+	MappedSegment segment;
+	for (int32 i = newest.CountItems() - 1; i >= 0; i--) {
+		const log_position& position = newest.ItemAt(i);
+		if (i == (int32)newest.CountItems() - 1
+				|| position.segment != segment.Segment())
+			_Map(&segment, position.segment);
+
+		uint32 size = 0;
+		const void* record = segment.RecordAt(position.offset, &size);
+		if (record != NULL)
+			_AddEntry(logs, record, size);
+	}
+
+	if (newest.IsEmpty() == false)
+		_AddPosition(logs, newest.ItemAt(newest.CountItems() - 1), start);
+	else
+		_AddPosition(logs, before, start);
+	return B_OK;
+}
+
+
+void
+ChatLog::_FindBefore(log_position before, int32 count,
+	List<log_position>* newest, bool* start)
+{
+	// Newest first, as each segment is taken from its end
+	MappedSegment segment;
+	uint32 number = before.segment;
+	uint32 limit = before.offset;
+	while (newest->CountItems() < (uint32)count) {
+		if (_Map(&segment, number) != B_OK) {
+			*start = true;
+			break;
+		}
+
+		List<uint32> offsets;
+		uint32 offset = 0;
+		uint32 size = 0;
+		while (offset < limit && segment.RecordAt(offset, &size) != NULL) {
+			offsets.AddItem(offset);
+			offset += sizeof(size) + size;
+		}
+
+		for (int32 i = offsets.CountItems() - 1;
+				i >= 0 && newest->CountItems() < (uint32)count; i--) {
+			log_position position = { number, offsets.ItemAt(i) };
+			newest->AddItem(position);
+		}
+
+		if (newest->CountItems() < (uint32)count) {
+			if (number == 0) {
+				*start = true;
+				break;
+			}
+			// Older segments are read whole
+			number--;
+			limit = UINT32_MAX;
+		}
+	}
+}
+
+
+status_t
+ChatLog::_ReadSegment(uint32 number, List<ChatEvent>* events,
+	List<log_position>* positions)
+{
+	MappedSegment segment;
+	status_t ret = _Map(&segment, number);
+	if (ret != B_OK)
+		return ret;
+
+	uint32 offset = 0;
+	uint32 size = 0;
+	const void* record;
+	while ((record = segment.RecordAt(offset, &size)) != NULL) {
+		ChatEvent event;
+		if (event.Unflatten(record, size) == B_OK) {
+			log_position position = { number, offset };
+			events->AddItem(event);
+			positions->AddItem(position);
+		}
+		offset += sizeof(size) + size;
+	}
+	return B_OK;
+}
+
+
+status_t
+ChatLog::_Map(MappedSegment* segment, uint32 number)
+{
+	status_t ret = segment->SetTo(_SegmentPath(number).Path(), number, false);
+	if (ret == B_ENTRY_NOT_FOUND)
+		ret = segment->SetTo(_ArchivePath(number).Path(), number, true);
+	return ret;
+}
+
+
+void
+ChatLog::_AddEntry(BMessage* logs, const void* record, uint32 size)
+{
+	logs->AddData(kChatEventField, kChatEventType, record, size, false);
+}
+
+
+void
+ChatLog::_AddPosition(BMessage* logs, log_position position, bool start)
+{
+	logs->AddInt32("log_segment", position.segment);
+	logs->AddInt32("log_offset", position.offset);
+	logs->AddBool("log_start", start);
+}
+
+
+BPath
+ChatLog::_SegmentPath(uint32 segment)
+{
+	BString leaf;
+	leaf.SetToFormat("%08" B_PRIu32 ".log", segment);
+	BPath path(fDirectory);
+	path.Append(leaf.String());
+	return path;
+}
+
+
+BPath
+ChatLog::_ArchivePath(uint32 segment)
+{
+	BString leaf;
+	leaf.SetToFormat("%08" B_PRIu32 ".logz", segment);
+	BPath path(fDirectory);
+	path.Append(leaf.String());
+	return path;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _CHAT_LOG_H
+#define _CHAT_LOG_H
+
+#include <File.h>
+#include <Path.h>
+
+#include <libsupport/List.h>
+
+#include "ChatEvent.h"
+
+class BLocker;
+class BMessage;
+class MappedSegment;
+
+
+// Segments roll over to a new file once past this size
+const off_t kLogSegmentSize = 1024 * 1024;
+
+// … or once they're this old (in seconds), so quiet rooms' are archived too
+const time_t kLogSegmentAge = 7 * 24 * 60 * 60;
+
+// Archived segments are compressed in frames of this much, each readable alone
+const uint32 kLogFrameSize = 64 * 1024;
+
+// Latest messages whose place is kept in the tail index
+const int32 kLogTailSize = 256;
+
+// Messages returned by Read(), by default
+const int32 kLogReadCount = 31;
+
+
+// Head of a room's tail index file, followed by kLogTailSize slots― a ring of
+// the latest messages' positions, with next being the one to fill.
+struct log_tail_header {
+	uint32	magic;
+	uint32	version;
+	uint32	segment;	// Being appended to
+	uint32	segment_size;
+	uint32	next;
+	uint32	count;		// Slots filled, at most kLogTailSize
+};
+
+
+// Head of an archived segment (".logz"), followed by frame_count + 1 offsets
+// of its frames, the last being the end of the file. Each frame is a zlib
+// stream of kLogFrameSize bytes of the segment, save the last.
+struct log_archive_header {
+	uint32	magic;
+	uint32	version;
+	uint32	size;		// Of the segment, uncompressed
+	uint32	frame_count;
+};
+
+
+/* A room's logs, in its own directory (see RoomLogsPath()): append-only
+ * segment files of length-prefixed, flattened ChatEvents, plus a tail index
+ * of the latest ones. Appending is a constant few small writes, and the tail
+ * can be read back without a scan. This is the only copy written as messages
+ * come; any other, like the plain-text one in the room's cache file, is made
+ * from it by a LogExporter.
+ *
+ * Segments are read through a read-only mapping, so only the pages of the
+ * records wanted are loaded. Read() and ReadBefore() add those records as
+ * they are, as kChatEventField items, leaving them to be unflattened once,
+ * by whoever shows them.
+ *
+ * Once a segment is sealed, Archive() compresses it frame-by-frame; archived
+ * segments are read the same way, inflating only the frames that are needed.
+ * Archives, and the gzipped plain-text ones, may be removed once past the
+ * retention period, save those the tail index points into. So segments older
+ * than the tail's might be missing, and reading back stops at the first that
+ * is, as though it were the start of the log.
+ *
+ * Logs kept the old way, in the cache file's "Chat:logs" attribute, are
+ * imported the first time a room's log is used.
+ *
+ * Reading is safe from any thread, but only one ChatLog should append to a
+ * room at a time, which is left to the LogWriter. Each room has a lock of its
+ * own, shared by its ChatLogs. */
+class ChatLog {
+public:
+						ChatLog(const char* accountName, const char* roomId);
+
+			status_t	Append(const ChatEvent& event);
+			// With a single index update; where each went is added to positions
+			status_t	Append(const List<ChatEvent>& events,
+							List<log_position>* positions = NULL);
+
+			// The latest messages, as an IM_LOGS_RECEIVED of kChatEventFields
+			status_t	Read(BMessage* logs, int32 count = kLogReadCount);
+			// Those just before the given place, found by scanning segments
+			status_t	ReadBefore(BMessage* logs, log_position before,
+							int32 count = kLogReadCount);
+
+			status_t	ReadEvent(log_position position, ChatEvent* event);
+			// All of one segment's messages, for those going through them all
+			status_t	ReadSegment(uint32 segment, List<ChatEvent>* events,
+							List<log_position>* positions);
+			uint32		CountSegments();
+			// Where the count-th latest message is, or End() for none
+			status_t	FindLatest(int32 count, log_position* position);
+			// Just past the latest message, where the next will go
+			log_position	End();
+
+			// Where the oldest message read is, and whether any are older
+	static	status_t	FindPosition(const BMessage* logs,
+							log_position* position, bool* start = NULL);
+
+			// Waits for what's been appended to reach the disk
+			status_t	Sync();
+
+			// Compresses sealed segments, then removes archives older than
+			// retention (in seconds, 0 to keep them), unless the room has
+			// ROOM_KEEP_LOGS. For the appender.
+			status_t	Archive(time_t retention);
+
+private:
+			status_t	_OpenIndex();
+			status_t	_Write(const ChatEvent& event,
+							log_position* position = NULL);
+			status_t	_WriteHeader();
+			status_t	_Import();
+
+			void		_FindSealed();
+			status_t	_Compress(uint32 segment);
+			void		_Expire(time_t before);
+			bool		_KeepsLogs();
+
+			status_t	_ReadBefore(BMessage* logs, log_position before,
+							int32 count);
+			// Adds positions newest first, with start set if the log's
+			// beginning was reached
+			void		_FindBefore(log_position before, int32 count,
+							List<log_position>* newest, bool* start);
+			status_t	_ReadSegment(uint32 number, List<ChatEvent>* events,
+							List<log_position>* positions);
+			status_t	_Map(MappedSegment* segment, uint32 number);
+			void		_AddEntry(BMessage* logs, const void* record,
+							uint32 size);
+			void		_AddPosition(BMessage* logs, log_position position,
+							bool start);
+
+			BPath		_SegmentPath(uint32 segment);
+			BPath		_ArchivePath(uint32 segment);
+
+	BPath				fDirectory;
+	BPath				fRoomPath;
+	BLocker*			fLock;		// The room's, not owned
+	BFile				fIndex;
+	log_tail_header		fHeader;
+
+	// Kept open between appends
+	BFile				fSegment;
+	uint32				fSegmentNumber;
+	time_t				fSegmentStart;
+
+	// Segments left to Archive()
+	List<uint32>		fSealed;
+	bool				fScanned;
+	time_t				fExpired;
+};
+
+#endif // _CHAT_LOG_H
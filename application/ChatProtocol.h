@@ -24,6 +24,12 @@ class BBitmap;
 class ChatProtocolMessengerInterface {
 public:
 	virtual status_t SendMessage(BMessage* message) = 0;
+
+	/*! Whether to add "trace_received" to messages, the system_time() their
+		data arrived at
+		New virtuals only ever go last, after this, so add-ons built against
+		an older interface keep their slots. */
+	virtual bool IsTracing() { return false; }
 };
 
 class ChatProtocol {
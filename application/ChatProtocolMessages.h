@@ -459,7 +459,16 @@ enum im_what_code {
 		This should be sent by the protocol after connection errors or a
 		disconnect, when the addon doesn't have anything left to do other
 		than yearn for the sweet hand of death. */
-	IM_PROTOCOL_DISABLE					= 1003
+	IM_PROTOCOL_DISABLE					= 1003,
+
+	/*! Several messages at once		→App
+		For bulk updates (e.g., a room's user-list, the roster, the room
+		directory), so they can be handled in one go rather than flooding the
+		app with a message apiece. Each sub-message is a complete IM_MESSAGE,
+		handled in order as if sent on its own; "instance" needn't be set in
+		them.
+		Requires:	Messages "message" */
+	IM_BATCH							= 1004
 };
 
 #endif	// _CHAT_PROTOCOL_MESSAGES_H
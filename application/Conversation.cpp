@@ -5,11 +5,9 @@
 
 #include "Conversation.h"
 
-#include <Beep.h>
 #include <Catalog.h>
 #include <DateTimeFormat.h>
 #include <Locale.h>
-#include <Notification.h>
 #include <StringFormat.h>
 
 #include "AppConstants.h"
@@ -17,29 +15,32 @@
 #include "ChatProtocolMessages.h"
 #include "RenderView.h"
 #include "ChatCommand.h"
+#include "ChatEvent.h"
 #include "ConversationItem.h"
 #include "ConversationView.h"
+#include "EventTrace.h"
 #include "Flags.h"
 #include "ImageCache.h"
+#include "LogWriter.h"
 #include "MainWindow.h"
 #include "NotifyMessage.h"
+#include "Platform.h"
 #include "ProtocolLooper.h"
 #include "ProtocolManager.h"
 #include "Role.h"
 #include "Server.h"
-#include "TheApp.h"
 #include "Utils.h"
 
 
 Conversation::Conversation(BString id, BMessenger msgn)
 	:
 	fID(id),
+	fAtom(kNoAtom),
 	fName(id),
 	fMessenger(msgn),
 	fChatView(NULL),
 	fLooper(NULL),
 	fIcon(ImageCache::Get()->GetImage("kOnePersonIcon")),
-	fDateFormatter(),
 	fRoomFlags(0),
 	fDisallowedFlags(0),
 	fNotifyMessageCount(0),
@@ -53,10 +54,20 @@ Conversation::Conversation(BString id, BMessenger msgn)
 
 Conversation::~Conversation()
 {
-	((TheApp*)be_app)->GetMainWindow()->RemoveConversation(this);
+	AppMainWindow()->RemoveConversation(this);
 
-	if (fLooper != NULL)
+	// Or a coalesced flush would still reach this
+	for (int32 i = 0; i < fUsers.CountMembers(); i++)
+		fUsers.Members().ValueAt(i)->UnregisterObserver(this);
+
+	if (fLooper != NULL) {
 		fLooper->RemoveConversation(this);
+		for (int32 i = 0; i < fRoles.CountItems(); i++)
+			fLooper->Atoms().Release(fRoles.KeyAt(i));
+		fLooper->Atoms().Release(fAtom);
+	}
+	for (int32 i = 0; i < fRoles.CountItems(); i++)
+		delete fRoles.ValueAt(i);
 
 	delete fChatView;
 	delete fConversationItem;
@@ -70,9 +81,17 @@ Conversation::GetId() const
 }
 
 
+atom_id
+Conversation::GetAtom() const
+{
+	return fAtom;
+}
+
+
 void
 Conversation::ImMessage(BMessage* msg)
 {
+	EventTrace::Stamp(msg, TRACE_CONVERSATION);
 	int32 im_what = msg->FindInt32("im_what");
 
 	switch(im_what)
@@ -82,11 +101,23 @@ Conversation::ImMessage(BMessage* msg)
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "Conversation ― Notifications"
 
-			_EnsureUser(msg);
-			_LogChatMessage(msg);
-			GetView()->MessageReceived(msg);
+			User* sender = _EnsureUser(msg);
+
+			// Parsed once here (if not already by ProtocolInbox), then handed
+			// on as-is
+			ChatEvent event(msg);
+			if (event.fWhen == 0)
+				event.fWhen = time(NULL);
+			if (event.fUserName.IsEmpty() == true && sender != NULL)
+				event.fUserName = sender->GetName();
+			if ((event.fFlags & CHAT_EVENT_LOGGED) == 0) {
+				_LogChatMessage(event);
+				EventTrace::Stamp(msg, TRACE_LOGGED);
+			}
+			if (GetView()->ImEvent(event) == true)
+				EventTrace::Stamp(msg, TRACE_APPENDED);
 
-			BString text = msg->FindString("body");
+			BString text = event.fBody;
 			Contact* contact = GetOwnContact();
 			BWindow* win = fChatView->Window();
 
@@ -100,11 +131,11 @@ Conversation::ImMessage(BMessage* msg)
 			if (winFocus == false) {
 				if (mentioned == true
 						&& AppPreferences::Get()->SoundOnMention == true)
-					system_beep(APP_MENTION_BEEP);
+					AppBeep(APP_MENTION_BEEP);
 				else if (AppPreferences::Get()->SoundOnMessageReceived == true
-						&& ((fUsers.CountItems() <=2 && (fRoomFlags & ROOM_NOTIFY_DM))
+						&& ((fUsers.CountMembers() <=2 && (fRoomFlags & ROOM_NOTIFY_DM))
 							|| (fRoomFlags & ROOM_NOTIFY_ALL)))
-					system_beep(APP_MESSAGE_BEEP);
+					AppBeep(APP_MESSAGE_BEEP);
 			}
 
 			// Send a notification, if appropriate
@@ -128,25 +159,20 @@ Conversation::ImMessage(BMessage* msg)
 
 				notifyText.ReplaceAll("%source%", GetName());
 
-				if ((fUsers.CountItems() <= 2 && (fRoomFlags & ROOM_NOTIFY_DM))
+				if ((fUsers.CountMembers() <= 2 && (fRoomFlags & ROOM_NOTIFY_DM))
 						|| (fRoomFlags & ROOM_NOTIFY_ALL) || mentioned == true)
 				{
 					BBitmap* icon = IconBitmap();
 					if (icon == NULL)
 						icon = ProtocolBitmap();
 
-					BNotification notification(B_INFORMATION_NOTIFICATION);
-					notification.SetGroup(BString(APP_NAME));
-					notification.SetTitle(notifyTitle);
-					notification.SetIcon(icon);
-					notification.SetContent(notifyText);
-					notification.SetMessageID(fID);
-					notification.Send();
+					AppNotify(APP_NOTIFY_INFORMATION, notifyTitle,
+						notifyText, fID, icon);
 				}
 			}
 
 			// Misc. features Caya contributors planned on adding 
-			BWindow* mainWin = ((TheApp*)be_app)->GetMainWindow();
+			BWindow* mainWin = AppMainWindow();
 			if (winFocus == false && AppPreferences::Get()->MarkUnreadWindow == true)
 				mainWin->SetTitle(BString(mainWin->Title()).Prepend("[!]"));
 
@@ -167,8 +193,15 @@ Conversation::ImMessage(BMessage* msg)
 		}
 		case IM_MESSAGE_SENT:
 		{
-			_LogChatMessage(msg);
-			GetView()->MessageReceived(msg);
+			ChatEvent event(msg);
+			if (event.fWhen == 0)
+				event.fWhen = time(NULL);
+			if ((event.fFlags & CHAT_EVENT_LOGGED) == 0) {
+				_LogChatMessage(event);
+				EventTrace::Stamp(msg, TRACE_LOGGED);
+			}
+			if (GetView()->ImEvent(event) == true)
+				EventTrace::Stamp(msg, TRACE_APPENDED);
 			break;
 		}
 		case IM_SEND_MESSAGE:
@@ -238,21 +271,19 @@ Conversation::ImMessage(BMessage* msg)
 			if (msg->FindStrings("user_id", &ids) != B_OK)
 				break;
 
-			for (int i = 0; i < ids.CountStrings(); i++) {
-				BMessage user;
-				user.AddString("user_name", names.StringAt(i));
-				user.AddString("user_id", ids.StringAt(i));
-				_EnsureUser(&user, false);
-			}
+			BObjectList<User> added(ids.CountStrings());
+			for (int i = 0; i < ids.CountStrings(); i++)
+				_EnsureUser(ids.StringAt(i), names.StringAt(i),
+					fLooper->UserAtom(msg, i), false, &added);
+			_UsersAdded(added);
 			break;
 		}
 		case IM_ROOM_PARTICIPANT_JOINED:
 		{
-			BString user_id;
-			if (msg->FindString("user_id", &user_id) != B_OK)
+			if (msg->HasString("user_id") == false)
 				break;
 
-			if (UserById(user_id) == NULL) {
+			if (UserByAtom(fLooper->UserAtom(msg)) == NULL) {
 				_EnsureUser(msg, false);
 				GetView()->MessageReceived(msg);
 			}
@@ -262,9 +293,8 @@ Conversation::ImMessage(BMessage* msg)
 		case IM_ROOM_PARTICIPANT_KICKED:
 		case IM_ROOM_PARTICIPANT_BANNED:
 		{
-			BString user_id = msg->FindString("user_id");
-			User* user;
-			if (user_id.IsEmpty() == true || (user = UserById(user_id)) == NULL)
+			User* user = UserByAtom(fLooper->UserAtom(msg));
+			if (user == NULL)
 				break;
 
 			GetView()->MessageReceived(msg);
@@ -296,10 +326,10 @@ Conversation::ImMessage(BMessage* msg)
 				else
 					text.ReplaceAll("%old%", user_id);
 
-				BMessage* notify = new BMessage(IM_MESSAGE);
-				notify->AddInt32("im_what", IM_MESSAGE_RECEIVED);
-				notify->AddString("body", text);
-				GetView()->MessageReceived(notify);
+				ChatEvent notify;
+				notify.fWhat = IM_MESSAGE_RECEIVED;
+				notify.fBody = text;
+				GetView()->ImEvent(notify);
 			}
 			break;
 		}
@@ -336,6 +366,26 @@ Conversation::ObservePointer(int32 what, void* ptr)
 }
 
 
+void
+Conversation::ObserveBatch(const NotifyBatch& changes)
+{
+	// Only redraw the members that actually changed
+	NotifyBatch others;
+	for (int32 i = 0; i < changes.CountItems(); i++) {
+		NotifyChange* change = changes.ItemAt(i);
+		User* user = dynamic_cast<User*>(change->source);
+		if (user != NULL && fUsers.Find(user->GetAtom()) == user) {
+			if (change->what == STR_CONTACT_NAME)
+				fUsers.Rename(user, user->GetName());
+			GetView()->InvalidateUser(user);
+		} else
+			others.AddItem(change);
+	}
+	if (others.IsEmpty() == false)
+		Observer::ObserveBatch(others);
+}
+
+
 void
 Conversation::SetNotifyName(const char* name)
 {
@@ -344,6 +394,7 @@ Conversation::SetNotifyName(const char* name)
 
 	fName = name;
 	NotifyString(STR_ROOM_NAME, fName.String());
+	_SortConversationList();
 }
 
 
@@ -394,7 +445,10 @@ Conversation::GetProtocolLooper() const
 void
 Conversation::SetProtocolLooper(ProtocolLooper* looper)
 {
+	if (fLooper != NULL)
+		fLooper->Atoms().Release(fAtom);
 	fLooper = looper;
+	fAtom = looper->Atoms().Acquire(fID);
 	_LoadRoomFlags();
 }
 
@@ -442,12 +496,7 @@ Conversation::GetView()
 	fChatView->RegisterObserver(this);
 	RegisterObserver(fChatView);
 
-	if (!(fRoomFlags & ROOM_POPULATE_LOGS))
-		return fChatView;
-
-	BMessage logMsg;
-	if (_GetChatLogs(&logMsg) == B_OK)
-		fChatView->MessageReceived(&logMsg);
+	// Its history is asked for once it's attached (see ConversationView)
 	return fChatView;
 }
 
@@ -455,7 +504,7 @@ Conversation::GetView()
 void
 Conversation::ShowView(bool typing, bool userAction)
 {
-	((TheApp*)be_app)->GetMainWindow()->SetConversation(this);
+	AppMainWindow()->SetConversation(this);
 }
 
 
@@ -466,18 +515,49 @@ Conversation::GetListItem()
 }
 
 
-UserMap
-Conversation::Users()
+void
+Conversation::ReadLogs(BMessenger target, const BMessage& reply,
+	const log_position* before, int32 skip)
+{
+	LogWriter::Get()->ReadLogs(fLooper->Protocol()->GetName(), fID.String(),
+		AppPreferences::Get()->HistoryPageSize, before, skip, target, reply);
+}
+
+
+const UserMap&
+Conversation::Users() const
 {
-	return fUsers;
+	return fUsers.Members();
 }
 
 
 User*
 Conversation::UserById(BString id)
 {
-	bool found = false;
-	return fUsers.ValueFor(id, &found);
+	if (fLooper == NULL)
+		return NULL;
+	return UserByAtom(fLooper->Atoms().Find(id));
+}
+
+
+User*
+Conversation::UserByAtom(atom_id atom)
+{
+	return fUsers.Find(atom);
+}
+
+
+User*
+Conversation::UserByName(BString name)
+{
+	return fUsers.FindByName(name);
+}
+
+
+const UserIndex&
+Conversation::UserNames() const
+{
+	return fUsers.Names();
 }
 
 
@@ -490,7 +570,6 @@ Conversation::AddUser(User* user)
 	msg.AddString("user_id", user->GetId());
 	msg.AddString("user_name", user->GetName());
 	_EnsureUser(&msg, false);
-	_SortConversationList();
 }
 
 
@@ -499,13 +578,13 @@ Conversation::RemoveUser(User* user)
 {
 	if (user == NULL)
 		return;
-	fUsers.RemoveItemFor(user->GetId());
+	fUsers.Remove(user->GetAtom());
 	user->UnregisterObserver(this);
-	GetView()->UpdateUserList(fUsers);
+	GetView()->RemoveUser(user);
 	_SortConversationList();
 
 	_UpdateIcon();
-	NotifyInteger(INT_ROOM_MEMBERS, fUsers.CountItems());
+	NotifyInteger(INT_ROOM_MEMBERS, fUsers.CountMembers());
 }
 
 
@@ -519,20 +598,31 @@ Conversation::GetOwnContact()
 void
 Conversation::SetRole(BString id, Role* role)
 {
-	Role* oldRole = fRoles.ValueFor(id);
+	if (fLooper == NULL) {
+		delete role;
+		return;
+	}
+
+	// Roles hold on to their user's atom, even if they're not (yet) here
+	AtomTable& atoms = fLooper->Atoms();
+	atom_id atom = atoms.Find(id);
+	Role* oldRole = fRoles.ValueFor(atom);
 	if (oldRole != NULL) {
-		fRoles.RemoveItemFor(id);
+		fRoles.RemoveItemFor(atom);
 		delete oldRole;
+		atoms.Release(atom);
 	}
 	if (role != NULL)
-		fRoles.AddItem(id, role);
+		fRoles.AddItem(atoms.Acquire(id), role);
 }
 
 
 Role*
 Conversation::GetRole(BString id)
 {
-	return fRoles.ValueFor(id);
+	if (fLooper == NULL)
+		return NULL;
+	return fRoles.ValueFor(fLooper->Atoms().Find(id));
 }
 
 
@@ -547,66 +637,18 @@ Conversation::SetFlags(int32 flags)
 void
 Conversation::_WarnUser(BString message)
 {
-	BMessage* warning = new BMessage(IM_MESSAGE);
-	warning->AddInt32("im_what", IM_MESSAGE_RECEIVED);
-	warning->AddString("body", message.Append('\n', 1).InsertChars("-- ", 0));
-	GetView()->MessageReceived(warning);
+	ChatEvent warning;
+	warning.fWhat = IM_MESSAGE_RECEIVED;
+	warning.fBody = message.Append('\n', 1).InsertChars("-- ", 0);
+	GetView()->ImEvent(warning);
 }
 
 
 void
-Conversation::_LogChatMessage(BMessage* msg)
+Conversation::_LogChatMessage(const ChatEvent& event)
 {
-	// Binary logs
-	// TODO: Don't hardcode 31, expose maximum as a setting
-	const int32 MAX = 31;
-
-	BMessage logMsg(IM_MESSAGE);
-	if (_GetChatLogs(&logMsg) != B_OK) {
-		logMsg.what = IM_MESSAGE;
-		logMsg.AddInt32("im_what", IM_LOGS_RECEIVED);
-	}
-
-	BMessage last;
-	if (logMsg.FindMessage("message", MAX, &last) == B_OK)
-		logMsg.RemoveData("message", 0);
-	msg->AddInt64("when", time(NULL));
-	logMsg.AddMessage("message", msg);
-
-	BFile logFile(fCachePath.Path(), B_READ_WRITE | B_OPEN_AT_END | B_CREATE_FILE);
-	WriteAttributeMessage(&logFile, "Chat:logs", &logMsg);
-
-	BString mime = BString("text/plain");
-	logFile.WriteAttr("BEOS:TYPE", B_MIME_STRING_TYPE, 0, mime.String(),
-		mime.CountChars() + 1);
-
-	// Plain-text logs
-	// Gotta make sure the formatting's pretty!
-	BString date;
-	fDateFormatter.Format(date, time(0), B_SHORT_DATE_FORMAT, B_MEDIUM_TIME_FORMAT);
-	BString id = msg->FindString("user_id");
-	BString name = msg->FindString("user_name");
-	BString body = msg->FindString("body");
-
-	if (id.IsEmpty() == true && name.IsEmpty() == true)
-		return;
-	else if (name.IsEmpty() == true) {
-		User* user = UserById(id);
-		name = user ? user->GetName() : id;
-	}
-
-	BString logLine("[");
-	logLine << date << "] <" << name << "> " << body << "\n";
-	logFile.Write(logLine.String(), logLine.Length());
-}
-
-
-status_t
-Conversation::_GetChatLogs(BMessage* msg)
-{
-	_EnsureCachePath();
-	BFile logFile(fCachePath.Path(), B_READ_WRITE | B_CREATE_FILE);
-	return ReadAttributeMessage(&logFile, "Chat:logs", msg);
+	LogWriter::Get()->Submit(fLooper->Protocol()->GetName(), fID.String(),
+		event);
 }
 
 
@@ -642,14 +684,23 @@ Conversation::_EnsureCachePath()
 
 
 User*
-Conversation::_EnsureUser(BMessage* msg, bool implicit)
+Conversation::_EnsureUser(BMessage* msg, bool implicit,
+	BObjectList<User>* added)
+{
+	return _EnsureUser(msg->FindString("user_id"),
+		msg->FindString("user_name"), fLooper->UserAtom(msg), implicit, added);
+}
+
+
+User*
+Conversation::_EnsureUser(const BString& id, const BString& name,
+	atom_id atom, bool implicit, BObjectList<User>* added)
 {
-	BString id = msg->FindString("user_id");
-	BString name = msg->FindString("user_name");
-	if (id.IsEmpty() == true) return NULL;
+	if (id.IsEmpty() == true)
+		return NULL;
 
-	User* user = UserById(id);
-	User* serverUser = fLooper->UserById(id);
+	User* user = UserByAtom(atom);
+	User* serverUser = fLooper->UserByAtom(atom);
 
 	// Not here, but found in server
 	if (user == NULL && serverUser != NULL)
@@ -660,9 +711,10 @@ Conversation::_EnsureUser(BMessage* msg, bool implicit)
 		user->SetProtocolLooper(fLooper);
 		fLooper->AddUser(user);
 	}
+	atom = user->GetAtom();
 
 	// It's been implicitly defined (rather than explicit join), shame!
-	if (UserById(id) == NULL && implicit == true) {
+	if (UserByAtom(atom) == NULL && implicit == true) {
 		fGuests.Add(id);
 		// The response to this will be used to determine if this guest stays
 		BMessage msg(IM_MESSAGE);
@@ -671,21 +723,44 @@ Conversation::_EnsureUser(BMessage* msg, bool implicit)
 		fLooper->MessageReceived(&msg);
 	}
 
-	if (UserById(id) == NULL) {
-		fUsers.AddItem(id, user);
-		fUsers.AddItem(id, user);
-		GetView()->UpdateUserList(fUsers);
-		_UpdateIcon(user);
-		NotifyInteger(INT_ROOM_MEMBERS, fUsers.CountItems());
+	if (UserByAtom(atom) == NULL) {
+		fUsers.Add(atom, user, user->GetId(), user->GetName());
+		if (added != NULL)
+			added->AddItem(user);
+		else {
+			BObjectList<User> single(1);
+			single.AddItem(user);
+			_UsersAdded(single);
+		}
 	}
 
 	if (name.IsEmpty() == false && user->GetName() != name)
 		user->SetNotifyName(name);
 	user->RegisterObserver(this);
+	fUsers.Rename(user, user->GetName());
 	return user;
 }
 
 
+void
+Conversation::_UsersAdded(const BObjectList<User>& added)
+{
+	if (added.CountItems() == 0)
+		return;
+
+	GetView()->AddUsers(added);
+
+	// In a one-on-one chat, the other user's avatar might serve as the icon
+	User* other = NULL;
+	for (int32 i = 0; i < added.CountItems() && other == NULL; i++)
+		if (added.ItemAt(i) != GetOwnContact())
+			other = added.ItemAt(i);
+	_UpdateIcon(other);
+	NotifyInteger(INT_ROOM_MEMBERS, fUsers.CountMembers());
+	_SortConversationList();
+}
+
+
 Role*
 Conversation::_GetRole(BMessage* msg)
 {
@@ -711,14 +786,14 @@ Conversation::_UpdateIcon(User* user)
 			return;
 
 	// If it's a one-on-one chat, try to use the other user's icon
-	if (user != NULL && fUsers.CountItems() == 2
+	if (user != NULL && fUsers.CountMembers() == 2
 			&& user->GetId() != GetOwnContact()->GetId()
 			&& _IsDefaultIcon(user->AvatarBitmap()) == false) {
 		fUserIcon = SetNotifyIconBitmap(user->AvatarBitmap());
 		return;
 	}
 
-	switch (fUsers.CountItems())
+	switch (fUsers.CountMembers())
 	{
 		case 0:
 		case 1:
@@ -757,6 +832,6 @@ Conversation::_IsDefaultIcon(BBitmap* icon)
 void
 Conversation::_SortConversationList()
 {
-	if (fUsers.CountItems() <= 2 || fUsers.CountItems() == 3)
-		((TheApp*)be_app)->GetMainWindow()->SortConversation(this);
+	// The list item caches its sort key, so this is cheap when nothing moved
+	AppMainWindow()->SortConversation(this);
 }
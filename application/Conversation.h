@@ -5,16 +5,18 @@
 #ifndef CONVERSATION_H
 #define CONVERSATION_H
 
-#include <DateTimeFormat.h>
 #include <Messenger.h>
+#include <ObjectList.h>
 #include <Path.h>
 #include <StringList.h>
 
 #include "Maps.h"
 #include "Notifier.h"
 #include "Observer.h"
+#include "RoomMembers.h"
 
 class BBitmap;
+class ChatEvent;
 class Contact;
 class ConversationItem;
 class ConversationView;
@@ -22,6 +24,7 @@ class ProtocolLooper;
 class Role;
 class Server;
 class User;
+struct log_position;
 
 
 class Conversation : public Notifier, public Observer {
@@ -30,6 +33,7 @@ public:
 						~Conversation();
 
 	BString				GetId() const;
+	atom_id				GetAtom() const;
 
 	void				ImMessage(BMessage* msg);
 
@@ -37,6 +41,7 @@ public:
 	void				ObserveString(int32 what, BString str);
 	void				ObserveInteger(int32 what, int32 value);
 	void				ObservePointer(int32 what, void* ptr);
+	void				ObserveBatch(const NotifyBatch& changes);
 
 	void				SetNotifyName(const char* name);
 	void				SetNotifySubject(const char* subject);
@@ -58,8 +63,20 @@ public:
 	void				ShowView(bool typing, bool userAction);
 	ConversationItem*	GetListItem();
 
-	UserMap				Users();
+	// Asks for a page of the room's logs, sent to target as reply (see
+	// LogWriter::ReadLogs()): the latest, those before a place given by a
+	// previous page (see ChatLog::FindPosition()), or those before the skip
+	// latest messages
+	void				ReadLogs(BMessenger target, const BMessage& reply,
+							const log_position* before = NULL,
+							int32 skip = 0);
+
+	const UserMap&		Users() const;
 	User*				UserById(BString id);
+	User*				UserByAtom(atom_id atom);
+	User*				UserByName(BString name);
+	// Members by both ID and name
+	const UserIndex&	UserNames() const;
 	Contact*			GetOwnContact();
 
 	void				AddUser(User* user);
@@ -75,18 +92,24 @@ public:
 	BPath				CachePath() { return fCachePath; }
 
 private:
-	typedef KeyMap<BString, Role*> RoleMap;
+	typedef KeyMap<atom_id, Role*> RoleMap;
 
 	void				_WarnUser(BString message);
 
-	void				_LogChatMessage(BMessage* msg);
-	status_t			_GetChatLogs(BMessage* msg);
+	void				_LogChatMessage(const ChatEvent& event);
 
 	void				_CacheRoomFlags();
 	void				_LoadRoomFlags();
 
 	void				_EnsureCachePath();
-	User*				_EnsureUser(BMessage* msg, bool implicit = true);
+	// If 'added' is given, new members are collected there rather than
+	// announced to the view one at a time
+	User*				_EnsureUser(BMessage* msg, bool implicit = true,
+							BObjectList<User>* added = NULL);
+	User*				_EnsureUser(const BString& id, const BString& name,
+							atom_id atom, bool implicit,
+							BObjectList<User>* added);
+	void				_UsersAdded(const BObjectList<User>& added);
 	Role*				_GetRole(BMessage* msg);
 
 	void				_UpdateIcon(User* user = NULL);
@@ -102,6 +125,7 @@ private:
 	int32 fNotifyMentionCount;
 
 	BString fID;
+	atom_id fAtom;
 	BString fName;
 	BString fSubject;
 
@@ -109,12 +133,11 @@ private:
 	bool fUserIcon;
 
 	BPath fCachePath;
-	BDateTimeFormat fDateFormatter;
 
 	int32 fRoomFlags;
 	int32 fDisallowedFlags;
 
-	UserMap fUsers; // For defined, certain members of the room
+	RoomMembers<User> fUsers; // For defined, certain members of the room
 	BStringList fGuests; // IDs of implicitly-defined users
 	RoleMap fRoles;
 };
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "EventRecorder.h"
+
+#include <string.h>
+
+#include <Autolock.h>
+#include <Message.h>
+
+
+EventRecorder::EventRecorder(const char* path)
+	:
+	fFile(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE),
+	fLock("event recorder"),
+	fStart(system_time()),
+	fStatus(fFile.InitCheck())
+{
+	if (fStatus != B_OK)
+		return;
+
+	event_record_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kEventRecordMagic;
+	header.version = kEventRecordVersion;
+	if (fFile.Write(&header, sizeof(header)) != sizeof(header))
+		fStatus = B_IO_ERROR;
+}
+
+
+status_t
+EventRecorder::InitCheck() const
+{
+	return fStatus;
+}
+
+
+status_t
+EventRecorder::Record(const BMessage* msg)
+{
+	ssize_t size = msg->FlattenedSize();
+	if (size < 0 || size > (ssize_t)kEventRecordMaxSize)
+		return B_BAD_VALUE;
+	ssize_t total = sizeof(event_record_entry) + size;
+	char* buffer = new char[total];
+
+	event_record_entry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.offset = system_time() - fStart;
+	entry.size = size;
+	memcpy(buffer, &entry, sizeof(entry));
+
+	status_t ret = msg->Flatten(buffer + sizeof(entry), size);
+	if (ret == B_OK) {
+		// One write per entry, so they don't interleave
+		BAutolock _(fLock);
+		if (fStatus != B_OK)
+			ret = fStatus;
+		else if (fFile.Write(buffer, total) != total)
+			ret = fStatus = B_IO_ERROR;
+	}
+	delete[] buffer;
+	return ret;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _EVENT_RECORDER_H
+#define _EVENT_RECORDER_H
+
+#include <File.h>
+#include <Locker.h>
+
+class BMessage;
+
+
+// A recording is an event_record_header, followed by any number of entries:
+// an event_record_entry, then its flattened IM_MESSAGE. The replay add-on
+// plays them back.
+const uint32 kEventRecordMagic = 'ChRc';
+const uint16 kEventRecordVersion = 1;
+
+// Larger messages aren't recorded, and are taken as corruption when replayed
+const uint32 kEventRecordMaxSize = 4 * 1024 * 1024;
+
+struct event_record_header {
+	uint32	magic;
+	uint16	version;
+	uint16	_reserved;
+};
+
+struct event_record_entry {
+	bigtime_t	offset;	// Since the recording began
+	uint32		size;	// Of the flattened message that follows
+	uint32		_reserved;
+};
+
+
+// Records the IM_MESSAGEs an account sends to the app, from any thread.
+class EventRecorder {
+public:
+						EventRecorder(const char* path);
+
+			status_t	InitCheck() const;
+			status_t	Record(const BMessage* msg);
+
+private:
+			BFile		fFile;
+			BLocker		fLock;
+			bigtime_t	fStart;
+			status_t	fStatus;
+};
+
+#endif // _EVENT_RECORDER_H
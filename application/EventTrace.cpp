@@ -0,0 +1,182 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "EventTrace.h"
+
+#include <string.h>
+
+#include <Autolock.h>
+#include <File.h>
+#include <Message.h>
+
+#include "ChatProtocolMessages.h"
+
+
+const char* kTraceField = "trace";
+
+static const char* kStageNames[TRACE_STAGE_COUNT] = {
+	"received", "account", "server", "conversation", "logged", "appended"
+};
+
+
+EventTrace* EventTrace::fInstance = NULL;
+bool EventTrace::fEnabled = false;
+
+
+EventTrace::EventTrace()
+	:
+	fLock("event trace")
+{
+}
+
+
+EventTrace*
+EventTrace::Get()
+{
+	if (fInstance == NULL)
+		fInstance = new EventTrace();
+	return fInstance;
+}
+
+
+void
+EventTrace::SetEnabled(bool enabled)
+{
+	fEnabled = enabled;
+}
+
+
+void
+EventTrace::Reset()
+{
+	BAutolock _(fLock);
+	for (uint32 i = 0; i < fHistograms.CountItems(); i++)
+		delete fHistograms.ValueAt(i);
+	fHistograms = HistogramMap();
+}
+
+
+void
+EventTrace::Dump(BString* out)
+{
+	BAutolock _(fLock);
+	*out << "Latency since first stamp, in µs (count: median/90th/99th "
+		"percentile upper bound, max)\n";
+	if (fHistograms.CountItems() == 0)
+		*out << "\tNothing traced yet.\n";
+
+	for (uint32 i = 0; i < fHistograms.CountItems(); i++) {
+		histogram* hist = fHistograms.ValueAt(i);
+		*out << "im_what " << fHistograms.KeyAt(i) << ":\n";
+
+		for (int32 stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+			int64 count = 0;
+			for (int32 j = 0; j < kTraceBuckets; j++)
+				count += hist->counts[stage][j];
+			if (count == 0)
+				continue;
+
+			BString line;
+			line.SetToFormat("\t%-13s %8" B_PRId64 ": %" B_PRId64 "/%" B_PRId64
+				"/%" B_PRId64 ", %" B_PRId64 "\n", kStageNames[stage], count,
+				_Percentile(hist->counts[stage], 0.5),
+				_Percentile(hist->counts[stage], 0.9),
+				_Percentile(hist->counts[stage], 0.99), hist->max[stage]);
+			*out << line;
+		}
+	}
+}
+
+
+status_t
+EventTrace::DumpTo(const char* path)
+{
+	BFile file(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t ret = file.InitCheck();
+	if (ret != B_OK)
+		return ret;
+
+	BString dump;
+	Dump(&dump);
+	ssize_t written = file.Write(dump.String(), dump.Length());
+	return written < 0 ? written : B_OK;
+}
+
+
+void
+EventTrace::_Stamp(BMessage* msg, trace_stage stage)
+{
+	bigtime_t now = system_time();
+	bigtime_t stamps[TRACE_STAGE_COUNT];
+
+	const void* data = NULL;
+	ssize_t size = 0;
+	bool found = msg->FindData(kTraceField, kTraceType, &data, &size) == B_OK
+		&& size == sizeof(stamps);
+	if (found == true)
+		memcpy(stamps, data, sizeof(stamps));
+	else {
+		memset(stamps, 0, sizeof(stamps));
+		stamps[TRACE_RECEIVED] = msg->GetInt64("trace_received", 0);
+	}
+	stamps[stage] = now;
+
+	if (found == true)
+		msg->ReplaceData(kTraceField, kTraceType, stamps, sizeof(stamps));
+	else
+		msg->AddData(kTraceField, kTraceType, stamps, sizeof(stamps), true);
+
+	bigtime_t first = now;
+	for (int32 i = 0; i < TRACE_STAGE_COUNT; i++)
+		if (stamps[i] > 0 && stamps[i] < first)
+			first = stamps[i];
+	if (first < now)
+		_Record(msg->GetInt32("im_what", -1), stage, now - first);
+
+	// Bulk messages are traced by their contents
+	BMessage sub;
+	if (stage == TRACE_ACCOUNT && msg->GetInt32("im_what", -1) == IM_BATCH)
+		for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK; i++) {
+			_Stamp(&sub, stage);
+			msg->ReplaceMessage("message", i, &sub);
+		}
+}
+
+
+void
+EventTrace::_Record(int32 im_what, trace_stage stage, bigtime_t latency)
+{
+	int32 bucket = 0;
+	while (bucket < kTraceBuckets - 1 && (1LL << bucket) <= latency)
+		bucket++;
+
+	BAutolock _(fLock);
+	histogram* hist = fHistograms.ValueFor(im_what);
+	if (hist == NULL) {
+		hist = new histogram;
+		memset(hist, 0, sizeof(histogram));
+		fHistograms.AddItem(im_what, hist);
+	}
+	hist->counts[stage][bucket]++;
+	if (latency > hist->max[stage])
+		hist->max[stage] = latency;
+}
+
+
+bigtime_t
+EventTrace::_Percentile(const int64* counts, float percent)
+{
+	int64 total = 0;
+	for (int32 i = 0; i < kTraceBuckets; i++)
+		total += counts[i];
+
+	int64 seen = 0;
+	for (int32 i = 0; i < kTraceBuckets; i++) {
+		seen += counts[i];
+		if (seen >= total * percent)
+			return 1LL << i;
+	}
+	return 1LL << (kTraceBuckets - 1);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _EVENT_TRACE_H
+#define _EVENT_TRACE_H
+
+#include <Locker.h>
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+
+class BMessage;
+
+
+// Points along an IM_MESSAGE's way to the screen
+enum trace_stage {
+	TRACE_RECEIVED = 0,	// By the protocol, if it added "trace_received"
+	TRACE_ACCOUNT,		// Account::SendMessage()
+	TRACE_SERVER,		// Server::ImMessage()
+	TRACE_CONVERSATION,	// Conversation::ImMessage()
+	TRACE_LOGGED,		// Written to the room's ChatLog
+	TRACE_APPENDED,		// Shown in its ConversationView
+	TRACE_STAGE_COUNT
+};
+
+// Type and field name of a message's stamps, a bigtime_t per trace_stage
+const type_code kTraceType = 'TRCE';
+extern const char* kTraceField;
+
+// Histogram buckets are powers of two, in microseconds
+const int32 kTraceBuckets = 24;
+
+
+/* Optional latency tracing: when enabled, messages are stamped with the
+ * system_time() at each trace_stage, and the time since their first stamp is
+ * counted into a histogram per im_what and stage. While disabled, Stamp()
+ * costs a single check.
+ *
+ * Made by the Server as it starts, before there are any threads to race to
+ * make it. */
+class EventTrace {
+public:
+	static	EventTrace*		Get();
+
+	static	bool			IsEnabled() { return fEnabled; }
+			void			SetEnabled(bool enabled);
+
+	static	void			Stamp(BMessage* msg, trace_stage stage)
+								{ if (fEnabled) Get()->_Stamp(msg, stage); }
+
+			void			Reset();
+			void			Dump(BString* out);
+			status_t		DumpTo(const char* path);
+
+private:
+	struct histogram {
+		int64		counts[TRACE_STAGE_COUNT][kTraceBuckets];
+		bigtime_t	max[TRACE_STAGE_COUNT];
+	};
+	typedef KeyMap<int32, histogram*> HistogramMap;
+
+							EventTrace();
+
+			void			_Stamp(BMessage* msg, trace_stage stage);
+			void			_Record(int32 im_what, trace_stage stage,
+								bigtime_t latency);
+
+	static	bigtime_t		_Percentile(const int64* counts, float percent);
+
+	static	EventTrace*		fInstance;
+	static	bool			fEnabled;
+
+			BLocker			fLock;
+			HistogramMap	fHistograms;
+};
+
+#endif // _EVENT_TRACE_H
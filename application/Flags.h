@@ -5,10 +5,10 @@
 #ifndef FLAGS_H
 #define FLAGS_H
 
-// AUTOJOIN, AUTOCREATE, LOG, POPULATE, NOTIFY
+// AUTOJOIN, AUTOCREATE, LOG, POPULATE, NOTIFY, KEEP
 // Auto-join on login, auto-create on login (non-persistent rooms), keep local
 // logs, populate chat with local logs on join, notify on direct message,
-// notify on all new messages…
+// notify on all new messages, keep logs past the retention period…
 
 // JCLP
 // 0000
@@ -19,6 +19,7 @@
 #define ROOM_POPULATE_LOGS	8
 #define ROOM_NOTIFY_DM		16
 #define ROOM_NOTIFY_ALL		32
+#define ROOM_KEEP_LOGS		64
 
 
 // NAME, SUBJECT, ROLECHANGE, BAN, KICK, DEAFEN, MUTE, NICK, READ, WRITE
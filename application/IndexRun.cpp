@@ -0,0 +1,401 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "IndexRun.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+#include <DataIO.h>
+
+
+// Shorter or longer words aren't indexed
+const int32 kMinTokenLength = 2;
+const int32 kMaxTokenLength = 64;
+
+// Run files are written out in chunks of about this size
+const size_t kRunWriteSize = 256 * 1024;
+
+
+static void
+append_varint(BMallocIO* out, uint32 value)
+{
+	uint8 byte;
+	while (value >= 0x80) {
+		byte = (value & 0x7f) | 0x80;
+		out->Write(&byte, 1);
+		value >>= 7;
+	}
+	byte = value;
+	out->Write(&byte, 1);
+}
+
+
+static bool
+read_varint(const uint8** in, const uint8* end, uint32* value)
+{
+	*value = 0;
+	for (int shift = 0; *in < end && shift < 35; shift += 7) {
+		uint8 byte = *(*in)++;
+		*value |= (uint32)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+IndexRun::IndexRun(BPositionIO* data, uint32 number)
+	:
+	fData(data),
+	fNumber(number),
+	fSize(0)
+{
+	memset(&fHeader, 0, sizeof(fHeader));
+	if (fData->ReadAt(0, &fHeader, sizeof(fHeader)) != sizeof(fHeader)
+			|| fHeader.magic != kIndexRunMagic
+			|| fHeader.version != kIndexRunVersion
+			|| fData->GetSize(&fSize) != B_OK
+			|| fHeader.table + (off_t)fHeader.term_count
+				* (off_t)sizeof(index_run_term) > fSize
+			|| fHeader.rooms + (off_t)fHeader.room_count
+				* (off_t)sizeof(log_position) > fSize) {
+		memset(&fHeader, 0, sizeof(fHeader));
+		fInit = B_BAD_DATA;
+	} else
+		fInit = B_OK;
+}
+
+
+IndexRun::~IndexRun()
+{
+	delete fData;
+}
+
+
+status_t
+IndexRun::TermAt(uint32 index, BString* term)
+{
+	index_run_term entry;
+	status_t ret = _Entry(index, &entry);
+	if (ret != B_OK)
+		return ret;
+
+	uint8 length = 0;
+	if (fData->ReadAt(entry.text, &length, 1) != 1)
+		return B_IO_ERROR;
+	char buffer[256];
+	if (fData->ReadAt(entry.text + 1, buffer, length) != length)
+		return B_IO_ERROR;
+	term->SetTo(buffer, length);
+	return B_OK;
+}
+
+
+status_t
+IndexRun::PostingsAt(uint32 index, List<index_posting>* postings)
+{
+	index_run_term entry, next;
+	status_t ret = _Entry(index, &entry);
+	if (ret != B_OK)
+		return ret;
+	uint32 end = fHeader.table;
+	if (index + 1 < fHeader.term_count && _Entry(index + 1, &next) == B_OK)
+		end = next.text;
+	if (end < entry.postings)
+		return B_BAD_DATA;
+
+	size_t size = end - entry.postings;
+	uint8* buffer = new uint8[size];
+	if (fData->ReadAt(entry.postings, buffer, size) != (ssize_t)size) {
+		delete[] buffer;
+		return B_IO_ERROR;
+	}
+
+	const uint8* in = buffer;
+	const uint8* bufferEnd = buffer + size;
+	uint32 count = 0;
+	index_posting posting = { 0, 0 };
+	read_varint(&in, bufferEnd, &count);
+	for (uint32 i = 0; i < count; i++) {
+		uint32 delta;
+		if (read_varint(&in, bufferEnd, &delta) == false
+				|| read_varint(&in, bufferEnd, &posting.frequency) == false)
+			break;
+		posting.doc += delta;
+		postings->AddItem(posting);
+	}
+	delete[] buffer;
+	return B_OK;
+}
+
+
+int32
+IndexRun::Find(const BString& term)
+{
+	int32 low = 0;
+	int32 high = (int32)fHeader.term_count - 1;
+	BString current;
+	while (low <= high) {
+		int32 middle = (low + high) / 2;
+		if (TermAt(middle, &current) != B_OK)
+			return -1;
+
+		int compare = strcmp(current.String(), term.String());
+		if (compare == 0)
+			return middle;
+		if (compare < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+	return -1;
+}
+
+
+status_t
+IndexRun::GetPositions(List<log_position>* positions)
+{
+	for (uint32 i = 0; i < fHeader.room_count; i++) {
+		log_position position;
+		if (fData->ReadAt(fHeader.rooms + (off_t)i * sizeof(log_position),
+				&position, sizeof(position)) != sizeof(position))
+			return B_IO_ERROR;
+		positions->AddItem(position);
+	}
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IndexRun::Write(BPositionIO* data, const List<IndexRun*>& runs,
+	const IndexPostingMap* buffer, const List<log_position>& positions)
+{
+	// Each source's terms are sorted, so they're merged in step
+	List<BString> bufferTerms;
+	if (buffer != NULL) {
+		for (uint32 i = 0; i < buffer->CountItems(); i++)
+			bufferTerms.AddItem(buffer->KeyAt(i));
+		std::sort(bufferTerms.begin(), bufferTerms.end(),
+			[](const BString& a, const BString& b) {
+				return strcmp(a.String(), b.String()) < 0;
+			});
+	}
+	uint32 bufferCursor = 0;
+
+	std::vector<uint32> cursors(runs.CountItems(), 0);
+	std::vector<BString> current(runs.CountItems());
+	for (uint32 i = 0; i < runs.CountItems(); i++)
+		runs.ItemAt(i)->TermAt(0, &current[i]);
+
+	List<index_run_term> table;
+	off_t offset = sizeof(index_run_header);
+	BMallocIO out;
+
+	while (true) {
+		const BString* term = NULL;
+		for (uint32 i = 0; i < runs.CountItems(); i++)
+			if (cursors[i] < runs.ItemAt(i)->CountTerms() && (term == NULL
+					|| strcmp(current[i].String(), term->String()) < 0))
+				term = &current[i];
+		if (bufferCursor < bufferTerms.CountItems() && (term == NULL
+				|| strcmp(bufferTerms.ItemAt(bufferCursor).String(),
+					term->String()) < 0))
+			term = &bufferTerms.ItemAt(bufferCursor);
+		if (term == NULL)
+			break;
+		BString text(*term);
+
+		// Older runs' documents come first
+		List<index_posting> postings;
+		for (uint32 i = 0; i < runs.CountItems(); i++) {
+			IndexRun* run = runs.ItemAt(i);
+			if (cursors[i] >= run->CountTerms() || current[i] != text)
+				continue;
+			status_t ret = run->PostingsAt(cursors[i], &postings);
+			if (ret != B_OK)
+				return ret;
+			if (++cursors[i] < run->CountTerms())
+				run->TermAt(cursors[i], &current[i]);
+		}
+		if (bufferCursor < bufferTerms.CountItems()
+				&& bufferTerms.ItemAt(bufferCursor) == text) {
+			postings.AddList(*buffer->ValueFor(text));
+			bufferCursor++;
+		}
+
+		index_run_term entry;
+		entry.text = offset + out.BufferLength();
+		uint8 length = text.Length();
+		out.Write(&length, 1);
+		out.Write(text.String(), length);
+
+		entry.postings = offset + out.BufferLength();
+		append_varint(&out, postings.CountItems());
+		uint32 last = 0;
+		for (uint32 i = 0; i < postings.CountItems(); i++) {
+			const index_posting& posting = postings.ItemAt(i);
+			append_varint(&out, posting.doc - last);
+			append_varint(&out, posting.frequency);
+			last = posting.doc;
+		}
+		table.AddItem(entry);
+
+		if (out.BufferLength() >= kRunWriteSize) {
+			if (data->WriteAt(offset, out.Buffer(), out.BufferLength())
+					!= (ssize_t)out.BufferLength())
+				return B_IO_ERROR;
+			offset += out.BufferLength();
+			out.SetSize(0);
+			out.Seek(0, SEEK_SET);
+		}
+	}
+
+	uint32 tableOffset = offset + out.BufferLength();
+	if (table.IsEmpty() == false)
+		out.Write(&table.ItemAt(0), table.CountItems() * sizeof(index_run_term));
+	uint32 roomsOffset = offset + out.BufferLength();
+	if (positions.IsEmpty() == false)
+		out.Write(&positions.ItemAt(0),
+			positions.CountItems() * sizeof(log_position));
+	if (data->WriteAt(offset, out.Buffer(), out.BufferLength())
+			!= (ssize_t)out.BufferLength())
+		return B_IO_ERROR;
+
+	// The header goes last, so a run that's cut short is never read
+	index_run_header header;
+	header.magic = kIndexRunMagic;
+	header.version = kIndexRunVersion;
+	header.term_count = table.CountItems();
+	header.table = tableOffset;
+	header.room_count = positions.CountItems();
+	header.rooms = roomsOffset;
+	if (data->WriteAt(0, &header, sizeof(header)) != sizeof(header))
+		return B_IO_ERROR;
+	return B_OK;
+}
+
+
+status_t
+IndexRun::_Entry(uint32 index, index_run_term* entry)
+{
+	if (index >= fHeader.term_count)
+		return B_BAD_INDEX;
+	off_t offset = fHeader.table + (off_t)index * sizeof(index_run_term);
+	if (fData->ReadAt(offset, entry, sizeof(index_run_term))
+			!= sizeof(index_run_term))
+		return B_IO_ERROR;
+	return B_OK;
+}
+
+
+void
+TokenizeIndexText(const BString& text, List<BString>* tokens)
+{
+	const char* string = text.String();
+	int32 length = text.Length();
+	int32 start = -1;
+
+	for (int32 i = 0; i <= length; i++) {
+		uint8 c = (i < length) ? string[i] : 0;
+		bool letter = (c >= 0x80 || isalnum(c));
+		if (letter == true && start < 0)
+			start = i;
+		else if (letter == false && start >= 0) {
+			int32 size = i - start;
+			if (size >= kMinTokenLength && size <= kMaxTokenLength) {
+				BString token;
+				token.SetTo(string + start, size);
+				tokens->AddItem(token.ToLower());
+			}
+			start = -1;
+		}
+	}
+}
+
+
+int32
+AddIndexPostings(IndexPostingMap* buffer, uint32 doc,
+	const List<BString>& tokens)
+{
+	KeyMap<BString, uint32> frequencies;
+	for (uint32 i = 0; i < tokens.CountItems(); i++) {
+		const BString& token = tokens.ItemAt(i);
+		frequencies.AddItem(token, frequencies.ValueFor(token) + 1);
+	}
+
+	for (uint32 i = 0; i < frequencies.CountItems(); i++) {
+		BString term = frequencies.KeyAt(i);
+		List<index_posting>* postings = buffer->ValueFor(term);
+		if (postings == NULL) {
+			postings = new List<index_posting>;
+			buffer->AddItem(term, postings);
+		}
+		index_posting posting = { doc, frequencies.ValueAt(i) };
+		postings->AddItem(posting);
+	}
+	return frequencies.CountItems();
+}
+
+
+void
+RankIndexPostings(std::vector<List<index_posting> >& postings,
+	uint32 docCount, int32 count, List<index_hit>* hits)
+{
+	for (size_t i = 0; i < postings.size(); i++)
+		if (postings[i].IsEmpty() == true)
+			return;
+	if (postings.empty() == true)
+		return;
+
+	// Rarest first
+	std::sort(postings.begin(), postings.end(),
+		[](const List<index_posting>& a, const List<index_posting>& b) {
+			return a.CountItems() < b.CountItems();
+		});
+
+	std::vector<double> weights(postings.size());
+	for (size_t i = 0; i < postings.size(); i++)
+		weights[i] = log(1.0 + (double)docCount / postings[i].CountItems());
+
+	// Documents with every word, walking each list alongside the rarest
+	std::vector<index_hit> scored;
+	std::vector<uint32> cursors(postings.size(), 0);
+	bool exhausted = false;
+	for (uint32 i = 0; i < postings[0].CountItems() && exhausted == false;
+			i++) {
+		const index_posting& candidate = postings[0].ItemAt(i);
+		double score = candidate.frequency * weights[0];
+		bool all = true;
+
+		for (size_t j = 1; j < postings.size() && all == true; j++) {
+			const List<index_posting>& list = postings[j];
+			uint32& k = cursors[j];
+			while (k < list.CountItems() && list.ItemAt(k).doc < candidate.doc)
+				k++;
+			exhausted = (k == list.CountItems());
+			if (exhausted == true || list.ItemAt(k).doc != candidate.doc)
+				all = false;
+			else
+				score += list.ItemAt(k).frequency * weights[j];
+		}
+		if (all == true) {
+			index_hit hit = { score, candidate.doc };
+			scored.push_back(hit);
+		}
+	}
+
+	size_t kept = std::min(scored.size(), (size_t)std::max(count, (int32)0));
+	std::partial_sort(scored.begin(), scored.begin() + kept, scored.end(),
+		[](const index_hit& a, const index_hit& b) {
+			if (a.score != b.score)
+				return a.score > b.score;
+			return a.doc > b.doc;
+		});
+	for (size_t i = 0; i < kept; i++)
+		hits->AddItem(scored[i]);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _INDEX_RUN_H
+#define _INDEX_RUN_H
+
+#include <vector>
+
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
+#include "ChatEvent.h"
+
+class BPositionIO;
+
+
+const uint32 kIndexRunMagic = 'ChIr';
+const uint32 kIndexRunVersion = 2;
+
+// Postings kept in memory before they're written out as a run
+const int32 kIndexBufferSize = 200000;
+
+// Runs of about the same size that are merged into one
+const int32 kIndexMergeFactor = 4;
+
+// Runs up to this size are of the smallest tier, each tier's kIndexMergeFactor
+// times the size of the last
+const off_t kIndexTierSize = 256 * 1024;
+
+
+struct index_posting {
+	uint32	doc;
+	uint32	frequency;
+};
+
+
+struct index_hit {
+	double	score;
+	uint32	doc;
+};
+
+
+// Head of a run file, followed by its terms' texts and postings, then its
+// table of terms― term_count index_run_terms, sorted by text― then where
+// indexing had got to in each room (see SearchIndex::CatchUp()) when it was
+// written, room_count log_positions.
+struct index_run_header {
+	uint32	magic;
+	uint32	version;
+	uint32	term_count;
+	uint32	table;		// Offset of the term table
+	uint32	room_count;
+	uint32	rooms;		// Offset of the rooms' positions
+};
+
+
+struct index_run_term {
+	uint32	text;		// Offset of its text, with a uint8 length before it
+	uint32	postings;	// Offset of its postings, up to the next term's text
+};
+
+
+// Postings not yet written out, by term, each list in document order
+typedef KeyMap<BString, List<index_posting>*> IndexPostingMap;
+
+
+/* One run of a SearchIndex, read in place: a sorted table of words, each with
+ * a varint count, then its documents as varint deltas, each with a varint
+ * frequency. Write() makes a new one from older runs and postings in memory,
+ * merging them in step.
+ *
+ * Needs nothing of Haiku's but BPositionIO, so it's part of libcore. */
+class IndexRun {
+public:
+						// Takes ownership of data
+						IndexRun(BPositionIO* data, uint32 number = 0);
+						~IndexRun();
+
+			status_t	InitCheck() const { return fInit; }
+			uint32		Number() const { return fNumber; }
+			uint32		CountTerms() const { return fHeader.term_count; }
+			off_t		Size() const { return fSize; }
+
+			status_t	TermAt(uint32 index, BString* term);
+			// Adds the term's postings to those given
+			status_t	PostingsAt(uint32 index, List<index_posting>* postings);
+			int32		Find(const BString& term);
+			// Where indexing had got to in each room
+			status_t	GetPositions(List<log_position>* positions);
+
+			// Merges the given runs' postings, then those in buffer (if any),
+			// into a new run, with rooms' positions. Documents must be in
+			// order: each run's before the next's, and all before buffer's.
+	static	status_t	Write(BPositionIO* data, const List<IndexRun*>& runs,
+							const IndexPostingMap* buffer,
+							const List<log_position>& positions);
+
+private:
+			status_t	_Entry(uint32 index, index_run_term* entry);
+
+	BPositionIO*		fData;
+	uint32				fNumber;
+	index_run_header	fHeader;
+	off_t				fSize;
+	status_t			fInit;
+};
+
+
+// Words are runs of letters and digits, counting any non-ASCII as letters,
+// lower-cased
+void	TokenizeIndexText(const BString& text, List<BString>* tokens);
+
+// Adds a document's words to buffer, once each with its frequency; returns
+// how many postings that was
+int32	AddIndexPostings(IndexPostingMap* buffer, uint32 doc,
+			const List<BString>& tokens);
+
+// The documents with every one of the words whose postings are given, the
+// best-scoring count of them, best first and of those the latest. Rarer
+// words count for more.
+void	RankIndexPostings(std::vector<List<index_posting> >& postings,
+			uint32 docCount, int32 count, List<index_hit>* hits);
+
+#endif // _INDEX_RUN_H
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LogExporter.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <File.h>
+#include <NodeInfo.h>
+
+#include <libsupport/List.h>
+
+#include "StorageUtils.h"
+
+
+static BString
+escape_html(const BString& text)
+{
+	BString escaped(text);
+	escaped.ReplaceAll("&", "&amp;");
+	escaped.ReplaceAll("<", "&lt;");
+	escaped.ReplaceAll(">", "&gt;");
+	escaped.ReplaceAll("\"", "&quot;");
+	escaped.ReplaceAll("\n", "<br>");
+	return escaped;
+}
+
+
+static BString
+escape_json(const BString& text)
+{
+	BString escaped("\"");
+	for (int32 i = 0; i < text.Length(); i++) {
+		unsigned char c = text.ByteAt(i);
+		if (c == '"' || c == '\\')
+			escaped << '\\' << (char)c;
+		else if (c == '\n')
+			escaped << "\\n";
+		else if (c == '\t')
+			escaped << "\\t";
+		else if (c < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			escaped << code;
+		} else
+			escaped << (char)c;
+	}
+	escaped << '"';
+	return escaped;
+}
+
+
+LogExporter::LogExporter(const char* accountName, const char* roomId)
+	:
+	fAccountName(accountName),
+	fRoomId(roomId),
+	fLog(accountName, roomId),
+	fDateFormatter()
+{
+}
+
+
+status_t
+LogExporter::Export(log_export_format format, const char* path)
+{
+	BFile file(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t ret = file.InitCheck();
+	if (ret != B_OK)
+		return ret;
+
+	const char* type = "text/plain";
+	if (format == LOG_EXPORT_HTML) {
+		type = "text/html";
+		BString head("<!DOCTYPE html>\n<html>\n<head>\n"
+			"<meta charset=\"utf-8\">\n<title>");
+		head << escape_html(fRoomId) << "</title>\n</head>\n<body>\n";
+		file.Write(head.String(), head.Length());
+	}
+	else if (format == LOG_EXPORT_JSON)
+		type = "application/json";
+
+	log_position start = { 0, 0 };
+	ret = _Write(&file, format, start, fLog.End());
+
+	if (format == LOG_EXPORT_HTML) {
+		BString tail("</body>\n</html>\n");
+		file.Write(tail.String(), tail.Length());
+	}
+	BNodeInfo(&file).SetType(type);
+	return ret;
+}
+
+
+status_t
+LogExporter::UpdateText()
+{
+	BPath path = RoomCachePath(fAccountName, fRoomId);
+	BFile text(path.Path(), B_READ_WRITE | B_CREATE_FILE | B_OPEN_AT_END);
+	status_t ret = text.InitCheck();
+	if (ret != B_OK)
+		return ret;
+
+	off_t size = 0;
+	text.GetSize(&size);
+
+	log_position end = fLog.End();
+	log_position from = { 0, 0 };
+	if (text.ReadAttr("Chat:exported", B_RAW_TYPE, 0, &from, sizeof(from))
+			!= sizeof(from) && size > 0)
+		// Written line-by-line as messages came, so it's already current
+		from = end;
+
+	if (size == 0) {
+		BString mime = BString("text/plain");
+		text.WriteAttr("BEOS:TYPE", B_MIME_STRING_TYPE, 0, mime.String(),
+			mime.CountChars() + 1);
+	}
+
+	ret = _Write(&text, LOG_EXPORT_TEXT, from, end);
+	if (ret != B_OK)
+		return ret;
+	text.WriteAttr("Chat:exported", B_RAW_TYPE, 0, &end, sizeof(end));
+
+	if (text.GetSize(&size) == B_OK && size > kLogTextSize)
+		ret = _ArchiveText(&text);
+	return ret;
+}
+
+
+/*static*/ const char*
+LogExporter::Extension(log_export_format format)
+{
+	switch (format) {
+		case LOG_EXPORT_HTML:
+			return "html";
+		case LOG_EXPORT_JSON:
+			return "jsonl";
+		default:
+			return "txt";
+	}
+}
+
+
+/*static*/ status_t
+LogExporter::FindFormat(const char* name, log_export_format* format)
+{
+	BString lower(name);
+	lower.ToLower();
+	if (lower == "text" || lower == "txt")
+		*format = LOG_EXPORT_TEXT;
+	else if (lower == "html")
+		*format = LOG_EXPORT_HTML;
+	else if (lower == "json" || lower == "jsonl")
+		*format = LOG_EXPORT_JSON;
+	else
+		return B_BAD_VALUE;
+	return B_OK;
+}
+
+
+status_t
+LogExporter::_Write(BFile* file, log_export_format format, log_position from,
+	log_position to)
+{
+	// A segment at a time, as that's how they're read
+	BString out;
+	for (uint32 segment = from.segment; segment <= to.segment; segment++) {
+		List<ChatEvent> events;
+		List<log_position> positions;
+		if (fLog.ReadSegment(segment, &events, &positions) != B_OK)
+			continue;
+
+		for (uint32 i = 0; i < events.CountItems(); i++) {
+			const log_position& position = positions.ItemAt(i);
+			if (segment == from.segment && position.offset < from.offset)
+				continue;
+			if (segment == to.segment && position.offset >= to.offset)
+				break;
+			_Add(format, events.ItemAt(i), &out);
+		}
+
+		if (out.IsEmpty() == false) {
+			if (file->Write(out.String(), out.Length()) != out.Length())
+				return B_IO_ERROR;
+			out.Truncate(0);
+		}
+	}
+	return B_OK;
+}
+
+
+void
+LogExporter::_Add(log_export_format format, const ChatEvent& event,
+	BString* out)
+{
+	if (format == LOG_EXPORT_JSON) {
+		*out << "{\"when\":" << event.fWhen << ",\"im_what\":" << event.fWhat
+			<< ",\"chat_id\":" << escape_json(event.fChatId)
+			<< ",\"user_id\":" << escape_json(event.fUserId)
+			<< ",\"user_name\":" << escape_json(event.fUserName)
+			<< ",\"body\":" << escape_json(event.fBody);
+		if (event.fFlags & CHAT_EVENT_STATUS)
+			*out << ",\"status\":" << event.fStatus;
+		*out << "}\n";
+		return;
+	}
+
+	// Gotta make sure the formatting's pretty!
+	BString name = event.fUserName;
+	if (name.IsEmpty() == true)
+		name = event.fUserId;
+	if (name.IsEmpty() == true)
+		return;
+
+	time_t when = event.fWhen;
+	if (when == 0)
+		when = time(NULL);
+	BString date;
+	fDateFormatter.Format(date, when, B_SHORT_DATE_FORMAT,
+		B_MEDIUM_TIME_FORMAT);
+
+	if (format == LOG_EXPORT_HTML)
+		*out << "<p><span class=\"date\">[" << escape_html(date)
+			<< "]</span> <b>&lt;" << escape_html(name) << "&gt;</b> "
+			<< escape_html(event.fBody) << "</p>\n";
+	else
+		*out << "[" << date << "] <" << name << "> " << event.fBody << "\n";
+}
+
+
+status_t
+LogExporter::_ArchiveText(BFile* text)
+{
+	off_t size = 0;
+	status_t ret = text->GetSize(&size);
+	if (ret != B_OK)
+		return ret;
+
+	char* data = new char[size + 1];
+	if (text->ReadAt(0, data, size) != size) {
+		delete[] data;
+		return B_IO_ERROR;
+	}
+
+	char date[32];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+	BString leaf;
+	leaf << "text-" << date << ".gz";
+	BPath path = RoomLogsPath(fAccountName, fRoomId);
+	path.Append(leaf);
+
+	gzFile archive = gzopen(path.Path(), "wb9");
+	if (archive == NULL)
+		ret = B_IO_ERROR;
+	else if (gzwrite(archive, data, size) != (int)size)
+		ret = B_IO_ERROR;
+	if (archive != NULL && gzclose(archive) != Z_OK)
+		ret = B_IO_ERROR;
+	delete[] data;
+
+	// The cache file itself is kept, for its attributes
+	if (ret == B_OK)
+		ret = text->SetSize(0);
+	return ret;
+}
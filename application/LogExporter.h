@@ -0,0 +1,64 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _LOG_EXPORTER_H
+#define _LOG_EXPORTER_H
+
+#include <DateTimeFormat.h>
+#include <Path.h>
+#include <String.h>
+
+#include "ChatEvent.h"
+#include "ChatLog.h"
+
+class BFile;
+
+
+enum log_export_format {
+	LOG_EXPORT_TEXT = 0,	// "[date] <nick> body" lines
+	LOG_EXPORT_HTML,
+	LOG_EXPORT_JSON			// One object per line
+};
+
+
+// The plain-text copy is archived once past this size
+const off_t kLogTextSize = 1024 * 1024;
+
+
+/* Writes a room's ChatLog out in other formats, formatting each message only
+ * then, rather than as it's logged.
+ *
+ * The room's plain-text copy, in its cache file, is brought up to date with
+ * UpdateText(): only messages logged since the last time are added, tracked
+ * by the file's "Chat:exported" attribute. The LogWriter does so a while
+ * after a room goes quiet. */
+class LogExporter {
+public:
+						LogExporter(const char* accountName,
+							const char* roomId);
+
+			// The whole log, to the given file
+			status_t	Export(log_export_format format, const char* path);
+
+			// Adds what's been logged since last time to the plain-text copy,
+			// then moves it into a gzip file if it's past kLogTextSize
+			status_t	UpdateText();
+
+	static	const char*	Extension(log_export_format format);
+	static	status_t	FindFormat(const char* name, log_export_format* format);
+
+private:
+			status_t	_Write(BFile* file, log_export_format format,
+							log_position from, log_position to);
+			void		_Add(log_export_format format, const ChatEvent& event,
+							BString* out);
+			status_t	_ArchiveText(BFile* text);
+
+	BString				fAccountName;
+	BString				fRoomId;
+	ChatLog				fLog;
+	BDateTimeFormat		fDateFormatter;
+};
+
+#endif // _LOG_EXPORTER_H
@@ -0,0 +1,592 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LogWriter.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <Message.h>
+#include <Path.h>
+
+#include <libsupport/List.h>
+
+#include "ChatLog.h"
+#include "SearchIndex.h"
+#include "StorageUtils.h"
+
+
+// Rooms whose files are kept open between commits
+const int32 kMaxOpenLogs = 64;
+
+// Idle time before rooms are archived, their plain-text copies updated, and
+// indexes' postings written
+const bigtime_t kIdleDelay = 10000000;
+// … but texts and postings are never left longer than this
+const bigtime_t kTextUpdateMaxDelay = 60000000;
+
+// Log segments an index catches up on at a time, between commits
+const int32 kIndexCatchUpSegments = 4;
+
+// Until it's set, as Server does from the AppPreferences
+const bigtime_t kDefaultFlushInterval = 250000;
+
+
+LogWriter* LogWriter::fInstance = NULL;
+
+
+LogWriter::log_request::log_request(request_kind kind)
+	:
+	next(NULL),
+	kind(kind),
+	done(-1),
+	result(B_OK),
+	count(0),
+	paging(false),
+	skip(0),
+	format(-1)
+{
+	before.segment = 0;
+	before.offset = 0;
+}
+
+
+LogWriter::LogWriter()
+	:
+	fPending(NULL),
+	fWake(create_sem(0, "log writer wake")),
+	fHurry(create_sem(0, "log writer hurry")),
+	fUrgent(0),
+	fWaitingOut(0),
+	fThread(-1),
+	fLateLock("log writer late"),
+	fQuitting(0),
+	fInterval(kDefaultFlushInterval),
+	fDurability(LOG_BUFFERED),
+	fRetention(0),
+	fTextsUpdated(system_time()),
+	fIndexesDirty(false),
+	fIndexesBehind(false)
+{
+	thread_id thread = spawn_thread(_ThreadEntry, "log writer", B_LOW_PRIORITY,
+		this);
+	if (thread >= 0 && resume_thread(thread) == B_OK)
+		fThread = thread;
+}
+
+
+LogWriter*
+LogWriter::Get()
+{
+	if (fInstance == NULL)
+		fInstance = new LogWriter();
+	return fInstance;
+}
+
+
+void
+LogWriter::Submit(const char* accountName, const char* roomId,
+	const ChatEvent& event)
+{
+	log_request* request = new log_request(LOG_APPEND);
+	request->account = accountName;
+	request->room = roomId;
+	request->event = event;
+
+	_Push(request);
+
+	// Without a writer (or once it's quit), it's better late than never
+	if (atomic_get(&fThread) < 0)
+		_CommitLate();
+}
+
+
+void
+LogWriter::Flush()
+{
+	if (fThread < 0 || find_thread(NULL) == fThread)
+		return;
+
+	log_request* request = new log_request(LOG_FLUSH);
+	request->done = create_sem(0, "log flush");
+
+	_PushUrgent(request);
+	acquire_sem(request->done);
+	delete_sem(request->done);
+	delete request;
+}
+
+
+void
+LogWriter::Quit()
+{
+	if (fThread < 0)
+		return;
+
+	Flush();
+	atomic_set(&fQuitting, 1);
+	release_sem(fWake);
+
+	status_t ret;
+	wait_for_thread(fThread, &ret);
+	atomic_set(&fThread, -1);
+
+	// Those submitted as it was quitting
+	_CommitLate();
+}
+
+
+void
+LogWriter::ReadLogs(const char* accountName, const char* roomId, int32 count,
+	const log_position* before, int32 skip, BMessenger target,
+	const BMessage& reply)
+{
+	log_request* request = new log_request(LOG_READ);
+	request->account = accountName;
+	request->room = roomId;
+	request->count = count;
+	request->paging = (before != NULL);
+	if (before != NULL)
+		request->before = *before;
+	request->skip = skip;
+	request->target = target;
+	request->reply = reply;
+
+	_PushUrgent(request);
+	if (atomic_get(&fThread) < 0)
+		_CommitLate();
+}
+
+
+void
+LogWriter::Search(const char* query, int32 count, BMessenger target,
+	const BMessage& reply)
+{
+	// Run by the writer, which owns the indexes
+	log_request* request = new log_request(LOG_SEARCH);
+	request->query = query;
+	request->count = count;
+	request->target = target;
+	request->reply = reply;
+
+	_PushUrgent(request);
+	if (atomic_get(&fThread) < 0)
+		_CommitLate();
+}
+
+
+void
+LogWriter::Export(const char* accountName, const char* roomId,
+	log_export_format format, const char* path, BMessenger target,
+	const BMessage& reply)
+{
+	// Run by the writer, so it's after whatever's waiting
+	log_request* request = new log_request(LOG_EXPORT);
+	request->account = accountName;
+	request->room = roomId;
+	request->format = format;
+	request->path = path;
+	request->target = target;
+	request->reply = reply;
+
+	_PushUrgent(request);
+	if (atomic_get(&fThread) < 0)
+		_CommitLate();
+}
+
+
+void
+LogWriter::SetFlushInterval(bigtime_t interval)
+{
+	atomic_set64(&fInterval, interval);
+}
+
+
+void
+LogWriter::SetDurability(log_durability durability)
+{
+	atomic_set(&fDurability, durability);
+}
+
+
+void
+LogWriter::SetRetention(int32 days)
+{
+	atomic_set64(&fRetention, (int64)days * 24 * 60 * 60);
+}
+
+
+void
+LogWriter::_PushUrgent(log_request* request)
+{
+	atomic_add(&fUrgent, 1);
+	_Push(request);
+
+	// Only released if the writer's waiting out the interval, and then once
+	if (atomic_test_and_set(&fWaitingOut, 0, 1) == 1)
+		release_sem(fHurry);
+}
+
+
+void
+LogWriter::_Push(log_request* request)
+{
+	log_request* head;
+	do {
+		head = atomic_pointer_get(&fPending);
+		request->next = head;
+	} while (atomic_pointer_test_and_set(&fPending, request, head) != head);
+
+	// Only the first of a batch needs to wake the writer
+	if (head == NULL)
+		release_sem_etc(fWake, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+LogWriter::log_request*
+LogWriter::_TakeAll()
+{
+	log_request* head = atomic_pointer_get_and_set(&fPending,
+		(log_request*)NULL);
+
+	// Pushed newest-first, so reversed into the order they came
+	log_request* ordered = NULL;
+	while (head != NULL) {
+		log_request* next = head->next;
+		head->next = ordered;
+		ordered = head;
+		head = next;
+	}
+	return ordered;
+}
+
+
+void
+LogWriter::_Commit(log_request* requests)
+{
+	if (fLogs.CountItems() > (uint32)kMaxOpenLogs) {
+		for (uint32 i = 0; i < fLogs.CountItems(); i++)
+			delete fLogs.ValueAt(i);
+		fLogs = LogMap();
+	}
+
+	// Grouped by room, in order, up to the next request that has to see
+	// them written
+	KeyMap<ChatLog*, log_batch*> batches;
+	while (requests != NULL) {
+		log_request* request = requests;
+		requests = request->next;
+
+		if (request->kind != LOG_APPEND) {
+			_Append(batches);
+			_Answer(request);
+			continue;
+		}
+
+		ChatLog* log = _Log(request->account, request->room);
+		log_batch* batch = batches.ValueFor(log);
+		if (batch == NULL) {
+			batch = new log_batch;
+			batch->account = request->account;
+			batch->room = request->room;
+			batches.AddItem(log, batch);
+		}
+		batch->events.AddItem(request->event);
+		delete request;
+	}
+	_Append(batches);
+}
+
+
+void
+LogWriter::_Append(KeyMap<ChatLog*, log_batch*>& batches)
+{
+	for (uint32 i = 0; i < batches.CountItems(); i++) {
+		ChatLog* log = batches.KeyAt(i);
+		log_batch* batch = batches.ValueAt(i);
+
+		List<log_position> positions;
+		log->Append(batch->events, &positions);
+		if (atomic_get(&fDurability) == LOG_SYNCED)
+			log->Sync();
+
+		// Rooms it's behind on are left to catch up from the log instead
+		_Index(batch->account)->Add(batch->room, batch->events, positions);
+		fIndexesDirty = true;
+
+		BString key(batch->account);
+		key << "\n" << batch->room;
+		log_room room = { batch->account, batch->room };
+		fUnexported.AddItem(key, room);
+		fUnarchived.AddItem(key, room);
+		delete batch;
+	}
+	batches = KeyMap<ChatLog*, log_batch*>();
+}
+
+
+void
+LogWriter::_Answer(log_request* request)
+{
+	atomic_add(&fUrgent, -1);
+	switch (request->kind) {
+		case LOG_READ:
+			request->result = _Read(request);
+			break;
+		case LOG_SEARCH:
+			request->result = _Search(request);
+			break;
+		case LOG_EXPORT:
+			request->result = _Export(request);
+			break;
+		default:
+			break;
+	}
+
+	// Those waiting delete their own
+	if (request->done >= 0) {
+		release_sem(request->done);
+		return;
+	}
+	request->reply.AddInt32("result", request->result);
+	request->target.SendMessage(&request->reply);
+	delete request;
+}
+
+
+void
+LogWriter::_CommitLate()
+{
+	// Submitters' own threads take turns, and close everything after, as no
+	// writer's left to
+	BAutolock _(fLateLock);
+	log_request* requests = _TakeAll();
+	if (requests == NULL)
+		return;
+	_Commit(requests);
+	_Close();
+}
+
+
+void
+LogWriter::_Close()
+{
+	_UpdateTexts();
+
+	for (uint32 i = 0; i < fLogs.CountItems(); i++)
+		delete fLogs.ValueAt(i);
+	fLogs = LogMap();
+
+	// Writing out what they hold
+	for (uint32 i = 0; i < fIndexes.CountItems(); i++)
+		delete fIndexes.ValueAt(i);
+	fIndexes = IndexMap();
+}
+
+
+ChatLog*
+LogWriter::_Log(const BString& account, const BString& room)
+{
+	BString key(account);
+	key << "\n" << room;
+
+	ChatLog* log = fLogs.ValueFor(key);
+	if (log == NULL) {
+		log = new ChatLog(account, room);
+		fLogs.AddItem(key, log);
+	}
+	return log;
+}
+
+
+SearchIndex*
+LogWriter::_Index(const BString& account)
+{
+	SearchIndex* index = fIndexes.ValueFor(account);
+	if (index == NULL) {
+		index = new SearchIndex(account);
+		fIndexes.AddItem(account, index);
+	}
+	return index;
+}
+
+
+status_t
+LogWriter::_Read(log_request* request)
+{
+	ChatLog* log = _Log(request->account, request->room);
+	BMessage logs;
+	status_t ret;
+	if (request->paging == true)
+		ret = log->ReadBefore(&logs, request->before, request->count);
+	else if (request->skip > 0) {
+		log_position before;
+		ret = log->FindLatest(request->skip, &before);
+		if (ret == B_OK)
+			ret = log->ReadBefore(&logs, before, request->count);
+	}
+	else
+		ret = log->Read(&logs, request->count);
+
+	if (ret == B_OK)
+		request->reply.AddMessage("logs", &logs);
+	return ret;
+}
+
+
+status_t
+LogWriter::_Search(log_request* request)
+{
+	// Every account with logs, whether it's in use or not
+	BPath accountsPath = CachePath();
+	accountsPath.Append("Accounts");
+	BDirectory accounts(accountsPath.Path());
+
+	std::vector<BMessage> hits;
+	status_t ret = B_OK;
+	BEntry entry;
+	while (accounts.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		BPath logsPath;
+		if (entry.GetName(name) != B_OK || entry.GetPath(&logsPath) != B_OK
+				|| logsPath.Append("Logs") != B_OK
+				|| BEntry(logsPath.Path()).Exists() == false)
+			continue;
+
+		// Whatever's still to be caught up on is found all the same
+		SearchIndex* index = _Index(name);
+		index->CatchUp();
+		fIndexesDirty = true;
+
+		BMessage accountHits;
+		ret = index->Search(request->query, &accountHits, request->count);
+		if (ret != B_OK)
+			break;
+
+		BMessage hit;
+		for (int32 i = 0; accountHits.FindMessage("hit", i, &hit) == B_OK; i++)
+			hits.push_back(hit);
+	}
+
+	std::stable_sort(hits.begin(), hits.end(),
+		[](const BMessage& a, const BMessage& b) {
+			return a.GetFloat("score", 0) > b.GetFloat("score", 0);
+		});
+	for (size_t i = 0; i < hits.size() && (int32)i < request->count; i++)
+		request->reply.AddMessage("hit", &hits[i]);
+	return ret;
+}
+
+
+status_t
+LogWriter::_Export(log_request* request)
+{
+	LogExporter exporter(request->account, request->room);
+	if (request->path.IsEmpty() == true)
+		return exporter.UpdateText();
+	return exporter.Export((log_export_format)request->format, request->path);
+}
+
+
+void
+LogWriter::_UpdateTexts()
+{
+	for (uint32 i = 0; i < fUnexported.CountItems(); i++) {
+		const log_room& room = fUnexported.ValueAt(i);
+		LogExporter(room.account, room.room).UpdateText();
+	}
+	fUnexported = RoomMap();
+	fTextsUpdated = system_time();
+}
+
+
+void
+LogWriter::_UpdateIndexes()
+{
+	fIndexesBehind = false;
+	for (uint32 i = 0; i < fIndexes.CountItems(); i++) {
+		SearchIndex* index = fIndexes.ValueAt(i);
+		if (index->CatchUp(kIndexCatchUpSegments) == false)
+			fIndexesBehind = true;
+		index->Flush();
+	}
+	fIndexesDirty = fIndexesBehind;
+}
+
+
+void
+LogWriter::_Archive()
+{
+	time_t retention = atomic_get64(&fRetention);
+	for (uint32 i = 0; i < fUnarchived.CountItems(); i++) {
+		const log_room& room = fUnarchived.ValueAt(i);
+		_Log(room.account, room.room)->Archive(retention);
+	}
+	fUnarchived = RoomMap();
+}
+
+
+status_t
+LogWriter::_ThreadEntry(void* data)
+{
+	((LogWriter*)data)->_Loop();
+	return B_OK;
+}
+
+
+void
+LogWriter::_Loop()
+{
+	while (true) {
+		// Plain-text copies wait for a lull, so busy rooms' aren't redone
+		// with every message
+		bigtime_t timeout = B_INFINITE_TIMEOUT;
+		if (fIndexesBehind)
+			// Caught up on a few segments at a time, between anything else
+			timeout = 0;
+		else if (fUnexported.CountItems() > 0 || fUnarchived.CountItems() > 0
+				|| fIndexesDirty)
+			timeout = kIdleDelay;
+
+		status_t ret = acquire_sem_etc(fWake, 1, B_RELATIVE_TIMEOUT, timeout);
+		if (ret == B_TIMED_OUT || ret == B_WOULD_BLOCK) {
+			_UpdateIndexes();
+			if (fIndexesBehind == false) {
+				_Archive();
+				_UpdateTexts();
+			}
+			continue;
+		}
+		if (ret != B_OK
+				|| (atomic_get(&fQuitting) == 1
+					&& atomic_pointer_get(&fPending) == NULL))
+			break;
+
+		// Others arriving meanwhile are committed along with it, unless
+		// someone's waiting
+		if (atomic_get(&fUrgent) == 0) {
+			atomic_set(&fWaitingOut, 1);
+			status_t waited = B_TIMED_OUT;
+			if (atomic_get(&fUrgent) == 0)
+				waited = acquire_sem_etc(fHurry, 1, B_RELATIVE_TIMEOUT,
+					atomic_get64(&fInterval));
+
+			// If the flag was taken, its release is too, so none pile up
+			if (atomic_get_and_set(&fWaitingOut, 0) == 0 && waited != B_OK)
+				acquire_sem(fHurry);
+		}
+		_Commit(_TakeAll());
+
+		if (system_time() - fTextsUpdated > kTextUpdateMaxDelay) {
+			_UpdateIndexes();
+			_UpdateTexts();
+		}
+	}
+
+	_Close();
+}
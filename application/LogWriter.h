@@ -0,0 +1,186 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _LOG_WRITER_H
+#define _LOG_WRITER_H
+
+#include <Locker.h>
+#include <Message.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
+#include "ChatEvent.h"
+#include "LogExporter.h"
+
+class ChatLog;
+class SearchIndex;
+
+
+enum log_durability {
+	LOG_BUFFERED = 0,	// Written, but left to the system to flush
+	LOG_SYNCED			// Synced to disk with every commit
+};
+
+
+/* Writes rooms' ChatLogs on its own thread, so no one else waits on the disk.
+ * Submitted messages are collected for the flush interval, then written
+ * room-by-room, each room's batch with one index update (a group commit).
+ * Each account's SearchIndex is kept up to date on the same thread; what it
+ * only holds in memory is written out when idle, and rooms it's behind on
+ * are caught up on from their logs a few segments at a time.
+ *
+ * Once the writer's been idle for a while, rooms' sealed segments are
+ * archived (see ChatLog::Archive()), and their plain-text copies brought up
+ * to date (see LogExporter::UpdateText())― never while anyone's waiting.
+ *
+ * Logs are read back through the writer too, so that what's read includes
+ * everything submitted before; the messages are sent back to whoever asked,
+ * rather than waited on.
+ *
+ * Submit() never blocks: requests are pushed onto a lock-free stack, which
+ * the writer takes whole. Those submitted once it's quit (by accounts still
+ * being shut down) are written by the submitter, one at a time. */
+class LogWriter {
+public:
+	static	LogWriter*		Get();
+
+			void			Submit(const char* accountName, const char* roomId,
+								const ChatEvent& event);
+
+			// Waits until everything submitted so far is written
+			void			Flush();
+
+			// Once everything submitted so far is written, sends reply to
+			// target with a page of the room's log in "logs", as an
+			// IM_LOGS_RECEIVED (see ChatLog::Read()), and the "result": those
+			// before before if given, or else the latest but the skip latest
+			void			ReadLogs(const char* accountName,
+								const char* roomId, int32 count,
+								const log_position* before, int32 skip,
+								BMessenger target, const BMessage& reply);
+			// Flushes, then stops the thread
+			void			Quit();
+
+			// Searches every account's logs, then sends reply to target with
+			// the best "hit"s first (see SearchIndex::Search()), and the
+			// "result"
+			void			Search(const char* query, int32 count,
+								BMessenger target, const BMessage& reply);
+
+			// Once everything submitted so far is written, exports the room's
+			// log to path, or without one, updates its plain-text copy; then
+			// sends reply to target with the "result"
+			void			Export(const char* accountName, const char* roomId,
+								log_export_format format, const char* path,
+								BMessenger target, const BMessage& reply);
+
+			void			SetFlushInterval(bigtime_t interval);
+			void			SetDurability(log_durability durability);
+			// Days archived logs are kept, or 0 for good
+			void			SetRetention(int32 days);
+
+private:
+	enum request_kind {
+		LOG_APPEND = 0,
+		LOG_FLUSH,
+		LOG_READ,
+		LOG_SEARCH,
+		LOG_EXPORT
+	};
+
+	struct log_request {
+						log_request(request_kind kind);
+
+		log_request*	next;
+		request_kind	kind;
+		BString			account;
+		BString			room;
+		ChatEvent		event;	// For appending
+		sem_id			done;	// For those waited on, otherwise -1
+		status_t		result;
+
+		// For those replied to, sent to target once filled in
+		BMessenger		target;
+		BMessage		reply;
+
+		// For reading, or searching
+		int32			count;
+		log_position	before;
+		bool			paging;	// Whether before is set
+		int32			skip;
+
+		BString			query;	// For searching
+
+		// For exporting
+		int32			format;
+		BString			path;
+	};
+	struct log_batch {
+		BString			account;
+		BString			room;
+		List<ChatEvent>	events;
+	};
+	struct log_room {
+		BString			account;
+		BString			room;
+	};
+	typedef KeyMap<BString, ChatLog*> LogMap;
+	typedef KeyMap<BString, SearchIndex*> IndexMap;
+	typedef KeyMap<BString, log_room> RoomMap;
+
+							LogWriter();
+
+			void			_Push(log_request* request);
+			// For those waiting on it, so the interval's cut short
+			void			_PushUrgent(log_request* request);
+			log_request*	_TakeAll();
+			void			_Commit(log_request* requests);
+			void			_Append(KeyMap<ChatLog*, log_batch*>& batches);
+			void			_Answer(log_request* request);
+			// For those submitted without a writer to take them
+			void			_CommitLate();
+			void			_Close();
+			ChatLog*		_Log(const BString& account, const BString& room);
+			SearchIndex*	_Index(const BString& account);
+			status_t		_Read(log_request* request);
+			status_t		_Search(log_request* request);
+			status_t		_Export(log_request* request);
+			void			_UpdateTexts();
+			void			_UpdateIndexes();
+			void			_Archive();
+
+	static	status_t		_ThreadEntry(void* data);
+			void			_Loop();
+
+	static	LogWriter*		fInstance;
+
+			log_request*	fPending;
+			sem_id			fWake;		// Released when fPending fills
+			sem_id			fHurry;		// Released to skip the interval
+			int32			fUrgent;	// Requests being waited on
+			int32			fWaitingOut; // Whether fHurry's waited on
+			thread_id		fThread;	// -1 once quit
+			BLocker			fLateLock;	// Taken instead, without one
+
+			// Atomically accessed, as they're set from other threads
+			int32			fQuitting;
+			int64			fInterval;
+			int32			fDurability;
+			int64			fRetention;
+
+			// Only touched by the writer's thread
+			LogMap			fLogs;
+			IndexMap		fIndexes;
+			RoomMap			fUnexported;	// Since their text was updated
+			RoomMap			fUnarchived;	// Since last archived
+			bigtime_t		fTextsUpdated;
+			bool			fIndexesDirty;	// Postings only in memory
+			bool			fIndexesBehind;	// Rooms left to catch up on
+};
+
+#endif // _LOG_WRITER_H
@@ -8,6 +8,9 @@
 #include <String.h>
 
 #include "libsupport/KeyMap.h"
+#include "libsupport/PrefixIndex.h"
+
+#include "AtomTable.h"
 
 class ChatCommand;
 class Command;
@@ -19,8 +22,12 @@ class User;
 // Defining some commonly-used KeyMaps
 typedef KeyMap<BString, bigtime_t> AccountInstances;
 typedef KeyMap<BString, ChatCommand*> CommandMap;
-typedef KeyMap<BString, Conversation*> ChatMap;
-typedef KeyMap<BString, Contact*> RosterMap;
-typedef KeyMap<BString, User*> UserMap;
+typedef KeyMap<atom_id, Conversation*> ChatMap;
+typedef KeyMap<atom_id, Contact*> RosterMap;
+typedef KeyMap<atom_id, User*> UserMap;
+
+// ... and prefix indices, for completion
+typedef PrefixIndex<ChatCommand*> CommandIndex;
+typedef PrefixIndex<User*> UserIndex;
 
 #endif // _MAPS_H
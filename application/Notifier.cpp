@@ -7,10 +7,194 @@
  */
 
 #include "Notifier.h"
+
+#include <Handler.h>
+#include <Looper.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
 #include "Observer.h"
 
 
-void	
+const uint32 kFlushNotifications = 'NTfl';
+
+
+// Collects the notifiers with pending changes in one looper, and hands those
+// changes to observers (one batch each) once that looper gets to the flush
+// message.
+class NotifyCoalescer : public BHandler {
+public:
+						NotifyCoalescer();
+
+	static	NotifyCoalescer* ForLooper(BLooper* looper);
+
+	virtual	void		MessageReceived(BMessage* msg);
+
+			void		AddDirty(Notifier* notifier);
+			void		RemoveNotifier(Notifier* notifier);
+			void		RemoveObserver(Notifier* notifier, Observer* obs);
+
+private:
+	typedef KeyMap<Observer*, NotifyBatch*> BatchMap;
+
+			void		_Flush();
+			void		_RemoveChanges(NotifyBatch* batch, Notifier* source);
+			void		_RemoveUnobserved(NotifyBatch* batch, Observer* obs);
+
+	BObjectList<Notifier> fDirty;
+	BatchMap			fBatches;	// Only populated while flushing
+	bool				fFlushPending;
+};
+
+
+NotifyCoalescer::NotifyCoalescer()
+	:
+	BHandler("NotifyCoalescer"),
+	fFlushPending(false)
+{
+}
+
+
+NotifyCoalescer*
+NotifyCoalescer::ForLooper(BLooper* looper)
+{
+	for (int32 i = 0; i < looper->CountHandlers(); i++) {
+		NotifyCoalescer* coalescer
+			= dynamic_cast<NotifyCoalescer*>(looper->HandlerAt(i));
+		if (coalescer != NULL)
+			return coalescer;
+	}
+
+	NotifyCoalescer* coalescer = new NotifyCoalescer();
+	looper->AddHandler(coalescer);
+	return coalescer;
+}
+
+
+void
+NotifyCoalescer::MessageReceived(BMessage* msg)
+{
+	if (msg->what == kFlushNotifications)
+		_Flush();
+	else
+		BHandler::MessageReceived(msg);
+}
+
+
+void
+NotifyCoalescer::AddDirty(Notifier* notifier)
+{
+	fDirty.AddItem(notifier);
+
+	if (fFlushPending == false && Looper() != NULL) {
+		fFlushPending = true;
+		Looper()->PostMessage(kFlushNotifications, this);
+	}
+}
+
+
+void
+NotifyCoalescer::RemoveNotifier(Notifier* notifier)
+{
+	fDirty.RemoveItem(notifier, false);
+	for (uint32 i = 0; i < fBatches.CountItems(); i++)
+		_RemoveChanges(fBatches.ValueAt(i), notifier);
+}
+
+
+void
+NotifyCoalescer::RemoveObserver(Notifier* notifier, Observer* obs)
+{
+	NotifyBatch* batch = fBatches.ValueFor(obs);
+	if (batch != NULL)
+		_RemoveChanges(batch, notifier);
+}
+
+
+void
+NotifyCoalescer::_Flush()
+{
+	fFlushPending = false;
+
+	// Anything notified while delivering lands in the next cycle
+	BObjectList<Notifier> dirty(fDirty);
+	fDirty.MakeEmpty(false);
+
+	// Observers in the order they were first found, as fBatches changes
+	// while delivering
+	List<Observer*> observers;
+	for (int32 i = 0; i < dirty.CountItems(); i++) {
+		Notifier* notifier = dirty.ItemAt(i);
+		BObjectList<Observer>& notified = notifier->fObserverList;
+
+		for (int32 j = 0; j < notified.CountItems(); j++) {
+			Observer* obs = notified.ItemAt(j);
+			NotifyBatch* batch = fBatches.ValueFor(obs);
+			if (batch == NULL) {
+				batch = new NotifyBatch(20, true);
+				fBatches.AddItem(obs, batch);
+				observers.AddItem(obs);
+			}
+			for (int32 k = 0; k < notifier->fPending.CountItems(); k++)
+				batch->AddItem(new NotifyChange(*notifier->fPending.ItemAt(k)));
+		}
+		notifier->fPending.MakeEmpty(true);
+	}
+
+	// Observers (or notifiers) removed by an earlier batch have their changes
+	// dropped from the remaining ones, see RemoveNotifier()/RemoveObserver().
+	// Each batch is taken out before it's delivered, so nothing an observer
+	// does meanwhile can touch it.
+	for (uint32 i = 0; i < observers.CountItems(); i++) {
+		Observer* obs = observers.ItemAt(i);
+		NotifyBatch* batch = fBatches.RemoveItemFor(obs);
+		if (batch == NULL)
+			continue;
+		_RemoveUnobserved(batch, obs);
+		if (batch->IsEmpty() == false)
+			obs->ObserveBatch(*batch);
+		delete batch;
+	}
+}
+
+
+void
+NotifyCoalescer::_RemoveChanges(NotifyBatch* batch, Notifier* source)
+{
+	for (int32 i = batch->CountItems() - 1; i >= 0; i--)
+		if (batch->ItemAt(i)->source == source)
+			delete batch->RemoveItemAt(i);
+}
+
+
+// Drops changes from notifiers the observer has since left, however it did;
+// their sources are all alive, see RemoveNotifier()
+void
+NotifyCoalescer::_RemoveUnobserved(NotifyBatch* batch, Observer* obs)
+{
+	for (int32 i = batch->CountItems() - 1; i >= 0; i--)
+		if (batch->ItemAt(i)->source->fObserverList.HasItem(obs) == false)
+			delete batch->RemoveItemAt(i);
+}
+
+
+Notifier::Notifier()
+	:
+	fPending(20, true),
+	fCoalescer(NULL)
+{
+}
+
+
+Notifier::~Notifier()
+{
+	if (fCoalescer != NULL)
+		fCoalescer->RemoveNotifier(this);
+}
+
+
+void
 Notifier::RegisterObserver(Observer* obs)
 {
 	if (!fObserverList.HasItem(obs))
@@ -23,28 +207,109 @@ Notifier::UnregisterObserver(Observer* obs)
 {
 	if (fObserverList.HasItem(obs))
 		fObserverList.RemoveItem(obs, false);
+	if (fCoalescer != NULL)
+		fCoalescer->RemoveObserver(this, obs);
 }
 
 
 void
 Notifier::NotifyString(int32 what, BString str)
 {
-	for (int i = 0; i < fObserverList.CountItems(); i++)
-		fObserverList.ItemAt(i)->ObserveString(what, str);
+	if (fCoalescer != NULL) {
+		NotifyChange* change = new NotifyChange;
+		change->type = NOTIFY_STRING;
+		change->what = what;
+		change->str = str;
+		_Enqueue(change);
+		return;
+	}
+
+	// Observers may unregister as they're told
+	BObjectList<Observer> observers(fObserverList);
+	for (int i = 0; i < observers.CountItems(); i++)
+		observers.ItemAt(i)->ObserveString(what, str);
 }
 
 
 void
 Notifier::NotifyInteger(int32 what, int32 value)
 {
-	for (int i = 0; i < fObserverList.CountItems(); i++)
-		fObserverList.ItemAt(i)->ObserveInteger(what, value);
+	if (fCoalescer != NULL) {
+		NotifyChange* change = new NotifyChange;
+		change->type = NOTIFY_INTEGER;
+		change->what = what;
+		change->value = value;
+		_Enqueue(change);
+		return;
+	}
+
+	// Observers may unregister as they're told
+	BObjectList<Observer> observers(fObserverList);
+	for (int i = 0; i < observers.CountItems(); i++)
+		observers.ItemAt(i)->ObserveInteger(what, value);
 }
 
 
 void
 Notifier::NotifyPointer(int32 what, void* ptr)
 {
-	for (int i = 0; i < fObserverList.CountItems(); i++)
-		fObserverList.ItemAt(i)->ObservePointer(what, ptr);
+	if (fCoalescer != NULL) {
+		NotifyChange* change = new NotifyChange;
+		change->type = NOTIFY_POINTER;
+		change->what = what;
+		change->ptr = ptr;
+		_Enqueue(change);
+		return;
+	}
+
+	// Observers may unregister as they're told
+	BObjectList<Observer> observers(fObserverList);
+	for (int i = 0; i < observers.CountItems(); i++)
+		observers.ItemAt(i)->ObservePointer(what, ptr);
+}
+
+
+void
+Notifier::SetCoalescing(BLooper* looper)
+{
+	NotifyCoalescer* coalescer = NULL;
+	if (looper != NULL)
+		coalescer = NotifyCoalescer::ForLooper(looper);
+	if (coalescer == fCoalescer)
+		return;
+
+	if (fCoalescer != NULL)
+		fCoalescer->RemoveNotifier(this);
+	fCoalescer = coalescer;
+
+	if (fPending.IsEmpty() == true)
+		return;
+	if (fCoalescer != NULL)
+		fCoalescer->AddDirty(this);
+	else {
+		// Hand over whatever was still waiting, then go synchronous
+		BObjectList<Observer> observers(fObserverList);
+		for (int i = 0; i < observers.CountItems(); i++)
+			observers.ItemAt(i)->ObserveBatch(fPending);
+		fPending.MakeEmpty(true);
+	}
+}
+
+
+void
+Notifier::_Enqueue(NotifyChange* change)
+{
+	change->source = this;
+	bool wasDirty = (fPending.IsEmpty() == false);
+
+	// Supersede any pending change of the same kind
+	for (int32 i = 0; i < fPending.CountItems(); i++)
+		if (fPending.ItemAt(i)->what == change->what) {
+			delete fPending.RemoveItemAt(i);
+			break;
+		}
+
+	fPending.AddItem(change);
+	if (wasDirty == false)
+		fCoalescer->AddDirty(this);
 }
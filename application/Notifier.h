@@ -10,21 +10,38 @@
 
 #include "Observer.h"
 
+class BLooper;
+class NotifyCoalescer;
+
 
 class Notifier
 {
 	public:
+				Notifier();
+		virtual	~Notifier();
+
 		void	RegisterObserver(Observer*);
 		void	UnregisterObserver(Observer*);
 		
 		void NotifyString(int32 what, BString str);
 		void NotifyInteger(int32 what, int32 value);
 		void NotifyPointer(int32 what, void* ptr);
+
+		// When coalescing, notifications are deduplicated by 'what' (the
+		// latest value wins) and handed to observers' ObserveBatch() from
+		// the given looper's next cycle. Pass NULL to notify synchronously.
+		void	SetCoalescing(BLooper* looper);
+		bool	IsCoalescing() const { return fCoalescer != NULL; }
 		
 	private:
+		friend class NotifyCoalescer;
+
+		void	_Enqueue(NotifyChange* change);
+
 		BObjectList<Observer>	fObserverList;	
+		NotifyBatch				fPending;
+		NotifyCoalescer*		fCoalescer;
 };
 
 
 #endif // NOTIFIER_H
-
@@ -5,15 +5,57 @@
 #ifndef Observer_h_
 #define Observer_h_
 
+#include <ObjectList.h>
 #include <String.h>
 
 class Notifier;
 
+
+enum notify_type {
+	NOTIFY_STRING,
+	NOTIFY_INTEGER,
+	NOTIFY_POINTER
+};
+
+
+// A single (coalesced) notification, as delivered by ObserveBatch()
+struct NotifyChange {
+	Notifier*	source;
+	int32		what;
+	notify_type	type;
+	BString		str;
+	int32		value;
+	void*		ptr;
+};
+
+typedef BObjectList<NotifyChange> NotifyBatch;
+
+
 class Observer
 {
 	public:
 	virtual void ObserveString(int32 what, BString str) {};
 	virtual void ObserveInteger(int32 what, int32 value) {};
 	virtual void ObservePointer(int32 what, void* ptr) {};
+
+	// Changes from coalescing notifiers, once per looper cycle. By default
+	// they're replayed one-by-one through the hooks above.
+	virtual void ObserveBatch(const NotifyBatch& changes)
+	{
+		for (int32 i = 0; i < changes.CountItems(); i++) {
+			NotifyChange* change = changes.ItemAt(i);
+			switch (change->type) {
+				case NOTIFY_STRING:
+					ObserveString(change->what, change->str);
+					break;
+				case NOTIFY_INTEGER:
+					ObserveInteger(change->what, change->value);
+					break;
+				case NOTIFY_POINTER:
+					ObservePointer(change->what, change->ptr);
+					break;
+			}
+		}
+	};
 };
 #endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "Platform.h"
+
+#include <Alert.h>
+#include <Beep.h>
+#include <Catalog.h>
+#include <Notification.h>
+
+#include "TheApp.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Platform"
+
+
+MainWindow*
+AppMainWindow()
+{
+	TheApp* app = (TheApp*)be_app;
+	if (app == NULL)
+		return NULL;
+	return app->GetMainWindow();
+}
+
+
+void
+AppBeep(const char* event)
+{
+	system_beep(event);
+}
+
+
+static notification_type
+notification_type_for(app_notification type)
+{
+	switch (type) {
+		case APP_NOTIFY_IMPORTANT:
+			return B_IMPORTANT_NOTIFICATION;
+		case APP_NOTIFY_ERROR:
+			return B_ERROR_NOTIFICATION;
+		case APP_NOTIFY_PROGRESS:
+			return B_PROGRESS_NOTIFICATION;
+		default:
+			return B_INFORMATION_NOTIFICATION;
+	}
+}
+
+
+void
+AppNotify(app_notification type, const char* title, const char* content,
+	const char* id, BBitmap* icon, float progress)
+{
+	BNotification notification(notification_type_for(type));
+	notification.SetGroup(BString(APP_NAME));
+	notification.SetTitle(title);
+	if (content != NULL && content[0] != '\0')
+		notification.SetContent(content);
+	if (id != NULL && id[0] != '\0')
+		notification.SetMessageID(id);
+	if (icon != NULL)
+		notification.SetIcon(icon);
+	if (type == APP_NOTIFY_PROGRESS)
+		notification.SetProgress(progress);
+	notification.Send();
+}
+
+
+void
+AppAlert(const char* title, const char* text)
+{
+	BAlert* alert = new BAlert(title, text, B_TRANSLATE("OK"), NULL, NULL,
+		B_WIDTH_AS_USUAL, B_STOP_ALERT);
+	alert->Go();
+}
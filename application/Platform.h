@@ -0,0 +1,40 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _APP_PLATFORM_H
+#define _APP_PLATFORM_H
+
+#include <SupportDefs.h>
+
+class BBitmap;
+class MainWindow;
+
+
+// The desktop calls made by the model (Server, Conversation, ChatCommand,
+// ProtocolLooper…) go through here rather than be_app, so they can be swapped
+// out in one place: Platform.cpp is the desktop's, PlatformHeadless.cpp that
+// of builds without the interface, like libcore's.
+
+// Same values as notification_type, which protocols send in IM_NOTIFICATION,
+// without needing the Interface Kit
+enum app_notification {
+	APP_NOTIFY_INFORMATION = 0,
+	APP_NOTIFY_IMPORTANT,
+	APP_NOTIFY_ERROR,
+	APP_NOTIFY_PROGRESS
+};
+
+MainWindow*	AppMainWindow();
+
+// Plays one of the APP_*_BEEP system sounds
+void		AppBeep(const char* event);
+
+// Progress is only used with APP_NOTIFY_PROGRESS
+void		AppNotify(app_notification type, const char* title,
+				const char* content, const char* id = NULL,
+				BBitmap* icon = NULL, float progress = 0);
+
+void		AppAlert(const char* title, const char* text);
+
+#endif // _APP_PLATFORM_H
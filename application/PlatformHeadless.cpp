@@ -0,0 +1,44 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+// Platform.h for builds without the interface, like libcore's: there's no
+// window, and what would've been shown is printed instead.
+
+#include "Platform.h"
+
+#include <stdio.h>
+
+
+MainWindow*
+AppMainWindow()
+{
+	return NULL;
+}
+
+
+void
+AppBeep(const char* event)
+{
+}
+
+
+void
+AppNotify(app_notification type, const char* title, const char* content,
+	const char* id, BBitmap* icon, float progress)
+{
+	if (content == NULL)
+		content = "";
+	if (type == APP_NOTIFY_PROGRESS)
+		fprintf(stderr, "%s: %s (%.0f%%)\n", title, content, progress * 100);
+	else
+		fprintf(stderr, "%s: %s\n", title, content);
+}
+
+
+void
+AppAlert(const char* title, const char* text)
+{
+	fprintf(stderr, "%s: %s\n", title, text);
+}
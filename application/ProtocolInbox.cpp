@@ -0,0 +1,553 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ProtocolInbox.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <Autolock.h>
+#include <Catalog.h>
+#include <Looper.h>
+
+#include "AtomTable.h"
+#include "ChatEvent.h"
+#include "ChatProtocolMessages.h"
+#include "EventTrace.h"
+#include "LogWriter.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ProtocolInbox"
+
+
+const uint32 kInboxWake = 'IBwk';
+
+// Most messages passed to the window in one IM_BATCH
+const int32 kInboxBatchLimit = 100;
+
+
+ProtocolInbox::ProtocolInbox(const char* accountName, int64 instance,
+	BMessenger target)
+	:
+	BHandler("inbox"),
+	fAccountName(accountName),
+	fInstance(instance),
+	fTarget(target),
+	fLock("inbox"),
+	fLimit(kInboxDefaultLimit),
+	fSequence(0),
+	fWakePending(false),
+	fClosed(false),
+	fSpace(create_sem(0, "inbox space")),
+	fWaiting(0),
+	fAtoms(NULL)
+{
+	fPolicies[INBOX_CHAT_LANE] = QUEUE_BLOCK;
+	fPolicies[INBOX_MEMBERSHIP_LANE] = QUEUE_BLOCK;
+	fPolicies[INBOX_PRESENCE_LANE] = QUEUE_MERGE;
+
+	for (int32 i = 0; i < INBOX_LANE_COUNT; i++) {
+		fMerged[i] = 0;
+		fDropped[i] = 0;
+		fReportedFull[i] = false;
+	}
+}
+
+
+ProtocolInbox::~ProtocolInbox()
+{
+	Close();
+	delete_sem(fSpace);
+
+	for (int32 i = 0; i < INBOX_LANE_COUNT; i++)
+		while (fLanes[i].empty() == false) {
+			Lane taken;
+			_Take(&taken);
+			_Deliver(taken);
+		}
+}
+
+
+void
+ProtocolInbox::MessageReceived(BMessage* msg)
+{
+	if (msg->what != kInboxWake) {
+		BHandler::MessageReceived(msg);
+		return;
+	}
+
+	Lane taken;
+	fLock.Lock();
+	fWakePending = false;
+	_Take(&taken);
+
+	if (fWaiting > 0) {
+		release_sem_etc(fSpace, fWaiting, 0);
+		fWaiting = 0;
+	}
+	for (int32 i = 0; i < INBOX_LANE_COUNT; i++) {
+		if (fLanes[i].empty() == false)
+			_Wake();
+		if ((int32)fLanes[i].size() < fLimit / 2)
+			fReportedFull[i] = false;
+	}
+	fLock.Unlock();
+
+	_Deliver(taken);
+}
+
+
+status_t
+ProtocolInbox::Push(BMessage* msg)
+{
+	// Loopers (this one included) can't wait on the inbox without risking a
+	// deadlock, so they're let past a full lane
+	bool canBlock = BLooper::LooperForThread(find_thread(NULL)) == NULL;
+
+	Item item;
+	item.barrier = _IsBarrier(msg);
+	inbox_lane lane = INBOX_CHAT_LANE;
+	if (item.barrier == false)
+		lane = _LaneFor(msg->GetInt32("im_what", -1));
+	if (lane == INBOX_PRESENCE_LANE)
+		item.key = _SupersedeKey(msg);
+
+	BAutolock _(fLock);
+	if (fClosed == true)
+		return B_CANCELED;
+
+	// Keeps its place, but takes the newer values
+	if (lane == INBOX_PRESENCE_LANE && fPolicies[lane] == QUEUE_MERGE) {
+		BMessage* queued = fLatest.ValueFor(item.key);
+		if (queued != NULL) {
+			BString personal;
+			bool keepPersonal = msg->HasString("message") == false
+				&& queued->FindString("message", &personal) == B_OK;
+			*queued = *msg;
+			if (keepPersonal == true)
+				queued->AddString("message", personal);
+			fMerged[lane]++;
+			return B_OK;
+		}
+	}
+
+	while (_IsFull(lane) == true && fClosed == false) {
+		_ReportFull(lane);
+		if (fPolicies[lane] != QUEUE_BLOCK) {
+			if (_DropOldest(lane) == true)
+				continue;
+			break;
+		}
+		if (canBlock == false)
+			break;
+
+		fWaiting++;
+		fLock.Unlock();
+		acquire_sem(fSpace);
+		fLock.Lock();
+	}
+	if (fClosed == true)
+		return B_CANCELED;
+
+	item.message = new BMessage(*msg);
+	item.sequence = fSequence++;
+	fLanes[lane].push_back(item);
+	if (lane == INBOX_PRESENCE_LANE && fPolicies[lane] == QUEUE_MERGE)
+		fLatest.AddItem(item.key, item.message);
+	else if (lane == INBOX_MEMBERSHIP_LANE) {
+		BStringList keys;
+		_MemberKeys(msg, &keys);
+		for (int32 i = 0; i < keys.CountStrings(); i++) {
+			const BString& key = keys.StringAt(i);
+			fMembership.AddItem(key, fMembership.ValueFor(key) + 1);
+		}
+	}
+
+	_Wake();
+	return B_OK;
+}
+
+
+void
+ProtocolInbox::Close()
+{
+	BAutolock _(fLock);
+	fClosed = true;
+	if (fWaiting > 0) {
+		release_sem_etc(fSpace, fWaiting, 0);
+		fWaiting = 0;
+	}
+}
+
+
+void
+ProtocolInbox::SetPolicy(inbox_lane lane, queue_policy policy)
+{
+	BAutolock _(fLock);
+	fPolicies[lane] = policy;
+
+	// Only presence is merged, so only its queued messages are kept track of
+	if (lane == INBOX_PRESENCE_LANE && policy != QUEUE_MERGE)
+		fLatest = MessageMap();
+}
+
+
+void
+ProtocolInbox::SetLimit(int32 limit)
+{
+	BAutolock _(fLock);
+	fLimit = limit;
+
+	// Any waiting for room might have it now
+	if (fWaiting > 0) {
+		release_sem_etc(fSpace, fWaiting, 0);
+		fWaiting = 0;
+	}
+}
+
+
+void
+ProtocolInbox::SetAtoms(AtomTable* atoms)
+{
+	fAtoms = atoms;
+}
+
+
+int32
+ProtocolInbox::Depth(inbox_lane lane)
+{
+	BAutolock _(fLock);
+	return fLanes[lane].size();
+}
+
+
+int32
+ProtocolInbox::MergedCount(inbox_lane lane)
+{
+	BAutolock _(fLock);
+	return fMerged[lane];
+}
+
+
+int32
+ProtocolInbox::DroppedCount(inbox_lane lane)
+{
+	BAutolock _(fLock);
+	return fDropped[lane];
+}
+
+
+bool
+ProtocolInbox::_IsFull(inbox_lane lane) const
+{
+	return fLimit > 0 && (int32)fLanes[lane].size() >= fLimit;
+}
+
+
+bool
+ProtocolInbox::_DropOldest(inbox_lane lane)
+{
+	// Barriers (e.g., leaving a room) are kept
+	Lane& queue = fLanes[lane];
+	for (Lane::iterator it = queue.begin(); it != queue.end(); it++) {
+		if (it->barrier == true)
+			continue;
+		_Unqueue(lane, *it);
+		delete it->message;
+		queue.erase(it);
+		fDropped[lane]++;
+		return true;
+	}
+	return false;
+}
+
+
+void
+ProtocolInbox::_Take(Lane* taken)
+{
+	while ((int32)taken->size() < kInboxBatchLimit) {
+		// Nothing queued after a barrier can be sent before it
+		int64 barrier = INT64_MAX;
+		Lane& chat = fLanes[INBOX_CHAT_LANE];
+		for (size_t i = 0; i < chat.size(); i++)
+			if (chat[i].barrier == true) {
+				barrier = chat[i].sequence;
+				break;
+			}
+
+		_TakeChatBefore(barrier, taken);
+		_TakeBefore(INBOX_MEMBERSHIP_LANE, barrier, taken);
+
+		// Presence waits its turn, unless it's holding something else up
+		if (barrier != INT64_MAX || _IsFull(INBOX_PRESENCE_LANE) == true
+				|| (chat.empty() && fLanes[INBOX_MEMBERSHIP_LANE].empty()))
+			_TakeBefore(INBOX_PRESENCE_LANE, barrier, taken);
+
+		if (barrier == INT64_MAX || (int32)taken->size() >= kInboxBatchLimit)
+			return;
+		for (int32 i = 0; i < INBOX_LANE_COUNT; i++)
+			if (fLanes[i].empty() == false
+					&& fLanes[i].front().sequence < barrier)
+				return;
+
+		taken->push_back(chat.front());
+		chat.pop_front();
+	}
+}
+
+
+void
+ProtocolInbox::_TakeChatBefore(int64 sequence, Lane* taken)
+{
+	Lane& queue = fLanes[INBOX_CHAT_LANE];
+	while (queue.empty() == false && queue.front().sequence < sequence
+			&& (int32)taken->size() < kInboxBatchLimit) {
+		int64 next = queue.front().sequence;
+
+		// If the author's membership of the room is changing, whatever
+		// membership changes came before go first, in order
+		if (fMembership.CountItems() > 0) {
+			BStringList keys;
+			_MemberKeys(queue.front().message, &keys);
+			if (keys.IsEmpty() == false
+					&& fMembership.ValueFor(keys.First()) > 0) {
+				Lane& membership = fLanes[INBOX_MEMBERSHIP_LANE];
+				_TakeBefore(INBOX_MEMBERSHIP_LANE, next, taken);
+				if (membership.empty() == false
+						&& membership.front().sequence < next)
+					return;
+			}
+		}
+		_TakeBefore(INBOX_CHAT_LANE, next + 1, taken);
+	}
+}
+
+
+void
+ProtocolInbox::_TakeBefore(inbox_lane lane, int64 sequence, Lane* taken)
+{
+	Lane& queue = fLanes[lane];
+	while (queue.empty() == false && queue.front().sequence < sequence
+			&& (int32)taken->size() < kInboxBatchLimit) {
+		Item& item = queue.front();
+		_Unqueue(lane, item);
+		taken->push_back(item);
+		queue.pop_front();
+	}
+}
+
+
+// Forgets what's kept about a queued message that's leaving its lane
+void
+ProtocolInbox::_Unqueue(inbox_lane lane, const Item& item)
+{
+	if (item.key.IsEmpty() == false
+			&& fLatest.ValueFor(item.key) == item.message)
+		fLatest.RemoveItemFor(item.key);
+
+	if (lane != INBOX_MEMBERSHIP_LANE)
+		return;
+	BStringList keys;
+	_MemberKeys(item.message, &keys);
+	for (int32 i = 0; i < keys.CountStrings(); i++) {
+		const BString& key = keys.StringAt(i);
+		int32 count = fMembership.ValueFor(key);
+		if (count > 1)
+			fMembership.AddItem(key, count - 1);
+		else
+			fMembership.RemoveItemFor(key);
+	}
+}
+
+
+void
+ProtocolInbox::_Wake()
+{
+	if (fWakePending == true || Looper() == NULL)
+		return;
+	fWakePending = Looper()->PostMessage(kInboxWake, this) == B_OK;
+}
+
+
+void
+ProtocolInbox::_Prepare(BMessage* msg)
+{
+	if (fAtoms != NULL) {
+		fAtoms->Stamp(msg, "user_id", "user_atom");
+		fAtoms->Stamp(msg, "chat_id", "chat_atom");
+	}
+
+	BString id, name;
+	for (int32 i = 0; msg->FindString("user_id", i, &id) == B_OK; i++)
+		if (msg->FindString("user_name", i, &name) == B_OK
+				&& name.IsEmpty() == false)
+			fUserNames.AddItem(id, name);
+
+	int32 im_what = msg->GetInt32("im_what", -1);
+	BString chat_id;
+	if ((im_what != IM_MESSAGE_RECEIVED && im_what != IM_MESSAGE_SENT)
+			|| msg->FindString("chat_id", &chat_id) != B_OK)
+		return;
+
+	ChatEvent event(msg);
+	if (event.fWhen == 0)
+		event.fWhen = time(NULL);
+	if (event.fUserName.IsEmpty() == true)
+		event.fUserName = fUserNames.ValueFor(event.fUserId);
+
+	LogWriter::Get()->Submit(fAccountName, chat_id, event);
+	event.fFlags |= CHAT_EVENT_LOGGED;
+	event.AddTo(msg);
+	EventTrace::Stamp(msg, TRACE_LOGGED);
+}
+
+
+void
+ProtocolInbox::_Deliver(Lane& taken)
+{
+	BMessage batch(IM_MESSAGE);
+	int32 count = 0;
+	BMessage* last = NULL;
+
+	for (size_t i = 0; i <= taken.size(); i++) {
+		bool end = (i == taken.size());
+
+		// Barriers go alone, after everything before them
+		if (end == true || taken[i].barrier == true) {
+			if (count == 1)
+				fTarget.SendMessage(last);
+			else if (count > 1)
+				fTarget.SendMessage(&batch);
+			count = 0;
+			if (end == false)
+				fTarget.SendMessage(taken[i].message);
+			continue;
+		}
+
+		if (count == 0) {
+			batch.MakeEmpty();
+			batch.AddInt32("im_what", IM_BATCH);
+			batch.AddInt64("instance", fInstance);
+		}
+		last = taken[i].message;
+		_Prepare(last);
+		batch.AddMessage("message", last);
+		count++;
+	}
+
+	for (size_t i = 0; i < taken.size(); i++)
+		delete taken[i].message;
+}
+
+
+void
+ProtocolInbox::_ReportFull(inbox_lane lane)
+{
+	if (fReportedFull[lane] == true)
+		return;
+	fReportedFull[lane] = true;
+
+	const char* names[INBOX_LANE_COUNT] = { "chat", "membership", "presence" };
+	printf("%s: %s queue full (%" B_PRId32 " waiting, %" B_PRId32 " dropped, "
+		"%" B_PRId32 " merged)\n", fAccountName.String(), names[lane],
+		(int32)fLanes[lane].size(), fDropped[lane], fMerged[lane]);
+
+	BString body;
+	switch (lane) {
+		case INBOX_CHAT_LANE:
+			body = B_TRANSLATE("Messages are arriving faster than they can be "
+				"shown; %count% are waiting.");
+			break;
+		case INBOX_MEMBERSHIP_LANE:
+			body = B_TRANSLATE("Room members are changing faster than can be "
+				"shown; %count% changes are waiting.");
+			break;
+		default:
+			body = B_TRANSLATE("Statuses are changing faster than can be "
+				"shown; %count% are waiting.");
+	}
+	BString count;
+	count << (int32)fLanes[lane].size();
+	body.ReplaceAll("%count%", count);
+
+	// To the account's own view, ahead of the queue
+	BMessage warning(IM_MESSAGE);
+	warning.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+	warning.AddInt64("instance", fInstance);
+	warning.AddString("body", body.Prepend("-- ").Append("\n"));
+	fTarget.SendMessage(&warning, (BHandler*)NULL, 0);
+}
+
+
+inbox_lane
+ProtocolInbox::_LaneFor(int32 im_what)
+{
+	switch (im_what) {
+		case IM_ROOM_PARTICIPANTS:
+		case IM_ROOM_PARTICIPANT_JOINED:
+		case IM_ROOM_PARTICIPANT_LEFT:
+		case IM_ROOM_PARTICIPANT_KICKED:
+		case IM_ROOM_PARTICIPANT_BANNED:
+		case IM_ROOM_ROLECHANGED:
+			return INBOX_MEMBERSHIP_LANE;
+		case IM_USER_STATUS_SET:
+		case IM_ROOM_PARTICIPANT_STARTED_TYPING:
+		case IM_ROOM_PARTICIPANT_STOPPED_TYPING:
+			return INBOX_PRESENCE_LANE;
+		default:
+			return INBOX_CHAT_LANE;
+	}
+}
+
+
+BString
+ProtocolInbox::_SupersedeKey(BMessage* msg)
+{
+	// Starting and stopping typing supersede each other
+	BString key;
+	if (msg->GetInt32("im_what", -1) == IM_USER_STATUS_SET)
+		key << "status";
+	else
+		key << "typing " << msg->GetString("chat_id", "");
+	key << " " << msg->GetString("user_id", "");
+	return key;
+}
+
+
+// One per user a message is about, with its room
+void
+ProtocolInbox::_MemberKeys(BMessage* msg, BStringList* keys)
+{
+	const char* chat_id = msg->GetString("chat_id", NULL);
+	if (chat_id == NULL)
+		return;
+
+	BString user_id;
+	for (int32 i = 0; msg->FindString("user_id", i, &user_id) == B_OK; i++) {
+		BString key(chat_id);
+		key << " " << user_id;
+		keys->Add(key);
+	}
+}
+
+
+bool
+ProtocolInbox::_IsBarrier(BMessage* msg)
+{
+	if (msg->what != IM_MESSAGE)
+		return true;
+
+	switch (msg->GetInt32("im_what", -1)) {
+		// Others in the batch might depend on the room still existing, or
+		// the account being up
+		case IM_BATCH:
+		case IM_ROOM_LEFT:
+		case IM_PROTOCOL_READY:
+		case IM_PROTOCOL_DISABLE:
+			return true;
+	}
+	return false;
+}
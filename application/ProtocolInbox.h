@@ -0,0 +1,138 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _PROTOCOL_INBOX_H
+#define _PROTOCOL_INBOX_H
+
+#include <deque>
+
+#include <Handler.h>
+#include <Locker.h>
+#include <Messenger.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <libsupport/KeyMap.h>
+
+class AtomTable;
+
+
+// Order messages held back by the inbox are delivered in
+enum inbox_lane {
+	INBOX_CHAT_LANE = 0,	// Chat messages, and anything uncategorized
+	INBOX_MEMBERSHIP_LANE,	// Room participants joining, leaving, etc.
+	INBOX_PRESENCE_LANE,	// Statuses and typing
+	INBOX_LANE_COUNT
+};
+
+
+// Messages a lane holds by default, before its policy applies
+const int32 kInboxDefaultLimit = 2000;
+
+
+// What's done with a message for a full lane
+enum queue_policy {
+	QUEUE_BLOCK = 0,	// The protocol's thread waits for room
+	QUEUE_DROP_OLDEST,
+	QUEUE_MERGE			// A superseded status or typing state is replaced,
+						// or else the oldest is dropped
+};
+
+
+/* Receives an account's messages from its protocol, and passes them on to
+ * the main window from the ProtocolLooper's thread. On the way, it does the
+ * work that needn't touch the interface (parsing and logging chat messages).
+ *
+ * Messages wait in one bounded queue ("lane") per kind, each with its own
+ * policy for when it's full. When they pile up, chat messages jump ahead of
+ * room membership changes, which jump ahead of presence; and presence is
+ * held back until the rest is through, with only a user's latest status
+ * (or typing state) kept meanwhile. A chat message never overtakes a change
+ * to its author's membership of its room, though, so e.g. someone's first
+ * message isn't shown before they've joined. Those that get through are sent
+ * on in IM_BATCHes. */
+class ProtocolInbox : public BHandler {
+public:
+							ProtocolInbox(const char* accountName,
+								int64 instance, BMessenger target);
+							~ProtocolInbox();
+
+	virtual	void			MessageReceived(BMessage* msg);
+
+			// Queues a copy of msg; called from the protocol's threads
+			status_t		Push(BMessage* msg);
+			// Wakes and turns away any blocked or later Push()
+			void			Close();
+
+			// By default, chat and membership block, and presence merges;
+			// the ProtocolLooper sets them from the AppPreferences
+			void			SetPolicy(inbox_lane lane, queue_policy policy);
+			// Per lane, or 0 for none
+			void			SetLimit(int32 limit);
+			// Messages' IDs are stamped with their atoms from these, if set
+			void			SetAtoms(AtomTable* atoms);
+
+			// Thread-safe counters, for debugging
+			int32			Depth(inbox_lane lane);
+			int32			MergedCount(inbox_lane lane);
+			int32			DroppedCount(inbox_lane lane);
+
+private:
+	typedef KeyMap<BString, BString> StringMap;
+	typedef KeyMap<BString, BMessage*> MessageMap;
+	typedef KeyMap<BString, int32> CountMap;
+
+	struct Item {
+		BMessage*	message;
+		int64		sequence;
+		bool		barrier;
+		BString		key;	// For merging presence
+	};
+	typedef std::deque<Item> Lane;
+
+			bool			_IsFull(inbox_lane lane) const;
+			bool			_DropOldest(inbox_lane lane);
+			void			_Take(Lane* taken);
+			void			_TakeChatBefore(int64 sequence, Lane* taken);
+			void			_TakeBefore(inbox_lane lane, int64 sequence,
+								Lane* taken);
+			void			_Unqueue(inbox_lane lane, const Item& item);
+			void			_Wake();
+
+			void			_Prepare(BMessage* msg);
+			void			_Deliver(Lane& taken);
+			void			_ReportFull(inbox_lane lane);
+
+	static	inbox_lane		_LaneFor(int32 im_what);
+	static	BString			_SupersedeKey(BMessage* msg);
+	static	void			_MemberKeys(BMessage* msg, BStringList* keys);
+	static	bool			_IsBarrier(BMessage* msg);
+
+			BString			fAccountName;
+			int64			fInstance;
+			BMessenger		fTarget;
+
+			BLocker			fLock; // Guards all below, bar fUserNames
+			Lane			fLanes[INBOX_LANE_COUNT];
+			queue_policy	fPolicies[INBOX_LANE_COUNT];
+			int32			fLimit;
+			MessageMap		fLatest; // Queued presence, by _SupersedeKey()
+			CountMap		fMembership; // Queued membership changes,
+										 // by _MemberKeys()
+			int64			fSequence;
+			bool			fWakePending;
+			bool			fClosed;
+
+			sem_id			fSpace; // Released as lanes drain
+			int32			fWaiting;
+
+			int32			fMerged[INBOX_LANE_COUNT];
+			int32			fDropped[INBOX_LANE_COUNT];
+			bool			fReportedFull[INBOX_LANE_COUNT];
+
+			StringMap		fUserNames; // As seen in passing, for the logs
+			AtomTable*		fAtoms;
+};
+
+#endif // _PROTOCOL_INBOX_H
@@ -18,6 +18,7 @@
 
 #include "Account.h"
 #include "AppMessages.h"
+#include "AppPreferences.h"
 #include "ChatProtocolMessages.h"
 #include "Contact.h"
 #include "Conversation.h"
@@ -25,7 +26,9 @@
 #include "ConversationView.h"
 #include "MainWindow.h"
 #include "NotifyMessage.h"
-#include "TheApp.h"
+#include "Platform.h"
+#include "ProtocolInbox.h"
+#include "Server.h"
 
 
 ProtocolLooper::ProtocolLooper(ChatProtocol* protocol, int64 instance)
@@ -47,12 +50,24 @@ ProtocolLooper::ProtocolLooper(ChatProtocol* protocol, int64 instance)
 
 	_InitChatView();
 
+	// Incoming messages are prepared here before the window gets them
+	fInbox = new ProtocolInbox(account->Name(), instance, account->Target());
+	fInbox->SetAtoms(&fAtoms);
+	UpdateInbox();
+	AddHandler(fInbox);
+	account->SetInbox(fInbox);
+
 	Run();
 }
 
 
 ProtocolLooper::~ProtocolLooper()
 {
+	fInbox->Close();
+	reinterpret_cast<Account*>(fProtocol->MessengerInterface())->SetInbox(NULL);
+	RemoveHandler(fInbox);
+	delete fInbox;
+
 	BMessage* msg = new BMessage(APP_ACCOUNT_DISABLED);
 	BBitmap* icon = fProtocol->Icon();
 
@@ -84,7 +99,7 @@ ProtocolLooper::GetView()
 void
 ProtocolLooper::ShowView()
 {
-	MainWindow* win = ((TheApp*)be_app)->GetMainWindow();
+	MainWindow* win = AppMainWindow();
 	win->SetConversation(NULL);
 	win->SetConversationView(fSystemChatView);
 }
@@ -97,7 +112,27 @@ ProtocolLooper::Protocol()
 }
 
 
-ChatMap
+ProtocolInbox*
+ProtocolLooper::Inbox()
+{
+	return fInbox;
+}
+
+
+void
+ProtocolLooper::UpdateInbox()
+{
+	AppPreferences* prefs = AppPreferences::Get();
+	fInbox->SetLimit(prefs->EventQueueLimit);
+	fInbox->SetPolicy(INBOX_CHAT_LANE, (queue_policy)prefs->ChatQueuePolicy);
+	fInbox->SetPolicy(INBOX_MEMBERSHIP_LANE,
+		(queue_policy)prefs->MembershipQueuePolicy);
+	fInbox->SetPolicy(INBOX_PRESENCE_LANE,
+		(queue_policy)prefs->PresenceQueuePolicy);
+}
+
+
+const ChatMap&
 ProtocolLooper::Conversations() const
 {
 	return fChatMap;
@@ -106,9 +141,16 @@ ProtocolLooper::Conversations() const
 
 Conversation*
 ProtocolLooper::ConversationById(BString id)
+{
+	return ConversationByAtom(fAtoms.Find(id));
+}
+
+
+Conversation*
+ProtocolLooper::ConversationByAtom(atom_id atom)
 {
 	bool found = false;
-	return fChatMap.ValueFor(id, &found);
+	return fChatMap.ValueFor(atom, &found);
 }
 
 
@@ -116,7 +158,7 @@ void
 ProtocolLooper::AddConversation(Conversation* chat)
 {
 	if (chat != NULL)
-		fChatMap.AddItem(chat->GetId(), chat);
+		fChatMap.AddItem(chat->GetAtom(), chat);
 }
 
 
@@ -124,11 +166,11 @@ void
 ProtocolLooper::RemoveConversation(Conversation* chat)
 {
 	if (chat != NULL)
-		fChatMap.RemoveItemFor(chat->GetId());
+		fChatMap.RemoveItemFor(chat->GetAtom());
 }
 
 
-RosterMap
+const RosterMap&
 ProtocolLooper::Contacts() const
 {
 	return fRosterMap;
@@ -137,17 +179,26 @@ ProtocolLooper::Contacts() const
 
 Contact*
 ProtocolLooper::ContactById(BString id)
+{
+	return ContactByAtom(fAtoms.Find(id));
+}
+
+
+Contact*
+ProtocolLooper::ContactByAtom(atom_id atom)
 {
 	bool found = false;
-	return fRosterMap.ValueFor(id, &found);
+	return fRosterMap.ValueFor(atom, &found);
 }
 
 
 void
 ProtocolLooper::AddContact(Contact* contact)
 {
-	if (contact != NULL)
-		fRosterMap.AddItem(contact->GetId(), contact);
+	if (contact == NULL)
+		return;
+	fRosterMap.AddItem(contact->GetAtom(), contact);
+	fUserMap.AddItem(contact->GetAtom(), (User*)contact);
 }
 
 
@@ -156,34 +207,29 @@ ProtocolLooper::RemoveContact(Contact* contact)
 {
 	if (contact == NULL)
 		return;
-	fRosterMap.RemoveItemFor(contact->GetId());
-	fUserMap.AddItem(contact->GetId(), (User*)contact);
+	fRosterMap.RemoveItemFor(contact->GetAtom());
 }
 
 
-UserMap
+const UserMap&
 ProtocolLooper::Users() const
 {
-	UserMap users = fUserMap;
+	return fUserMap;
+}
 
-	for (int i = 0; i < fRosterMap.CountItems(); i++) {
-		User* user = (User*)fRosterMap.ValueAt(i);
-		users.AddItem(user->GetId(), user);
-	}
 
-	return users;
+User*
+ProtocolLooper::UserById(BString id)
+{
+	return UserByAtom(fAtoms.Find(id));
 }
 
 
 User*
-ProtocolLooper::UserById(BString id)
+ProtocolLooper::UserByAtom(atom_id atom)
 {
 	bool found = false;
-	User* user = ContactById(id);
-	if (user == NULL)
-		user = fUserMap.ValueFor(id, &found);
-
-	return user;
+	return fUserMap.ValueFor(atom, &found);
 }
 
 
@@ -191,11 +237,11 @@ void
 ProtocolLooper::AddUser(User* user)
 {
 	if (user != NULL)
-		fUserMap.AddItem(user->GetId(), user);
+		fUserMap.AddItem(user->GetAtom(), user);
 }
 
 
-CommandMap
+const CommandMap&
 ProtocolLooper::Commands() const
 {
 	return fCommands;
@@ -209,6 +255,44 @@ ProtocolLooper::CommandById(BString id)
 }
 
 
+const CommandIndex&
+ProtocolLooper::CommandNames()
+{
+	if (fCommandNames.CountItems() > 0)
+		return fCommandNames;
+
+	for (int i = 0; i < fCommands.CountItems(); i++)
+		fCommandNames.AddItem(fCommands.KeyAt(i), fCommands.ValueAt(i));
+
+	const CommandMap& global = Server::Get()->Commands();
+	for (int i = 0; i < global.CountItems(); i++)
+		if (fCommands.ValueFor(global.KeyAt(i)) == NULL)
+			fCommandNames.AddItem(global.KeyAt(i), global.ValueAt(i));
+	return fCommandNames;
+}
+
+
+AtomTable&
+ProtocolLooper::Atoms()
+{
+	return fAtoms;
+}
+
+
+atom_id
+ProtocolLooper::UserAtom(const BMessage* msg, int32 index) const
+{
+	return fAtoms.Find(msg, "user_id", "user_atom", index);
+}
+
+
+atom_id
+ProtocolLooper::ChatAtom(const BMessage* msg) const
+{
+	return fAtoms.Find(msg, "chat_id", "chat_atom");
+}
+
+
 Contact*
 ProtocolLooper::GetOwnContact()
 {
@@ -247,11 +331,13 @@ void
 ProtocolLooper::LoadCommands()
 {
 	fCommands = CommandMap();
+	fCommandNames.MakeEmpty();
 	BObjectList<BMessage> commands = fProtocol->Commands();
 	for (int i = 0; i < commands.CountItems(); i++) {
 		ChatCommand* cmd = new ChatCommand(commands.ItemAt(i));
 		fCommands.AddItem(cmd->GetName(), cmd);
 	}
+	fCommands.SortByKey();
 }
 
 
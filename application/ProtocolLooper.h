@@ -16,6 +16,7 @@
 #include "Maps.h"
 
 class Contact;
+class ProtocolInbox;
 class Conversation;
 class ConversationAccountItem;
 class ConversationView;
@@ -34,23 +35,38 @@ public:
 			void			ShowView();
 
 			ChatProtocol*	Protocol();
+			ProtocolInbox*	Inbox();
+			// Sets its limit and policies from the AppPreferences
+			void			UpdateInbox();
 
-			ChatMap			Conversations() const;
+	const	ChatMap&		Conversations() const;
 			Conversation*	ConversationById(BString id);
+			Conversation*	ConversationByAtom(atom_id atom);
 			void			AddConversation(Conversation* chat);
 			void			RemoveConversation(Conversation* chat);
 
-			RosterMap		Contacts() const;
+	const	RosterMap&		Contacts() const;
 			Contact*		ContactById(BString id);
+			Contact*		ContactByAtom(atom_id atom);
 			void			AddContact(Contact* contact);
 			void			RemoveContact(Contact* contact);
 
-			UserMap			Users() const;
+	const	UserMap&		Users() const;
 			User*			UserById(BString id);
+			User*			UserByAtom(atom_id atom);
 			void			AddUser(User* user);
 
-			CommandMap		Commands() const;
+	const	CommandMap&		Commands() const;
 			ChatCommand*	CommandById(BString id);
+			// Protocol and global commands, by name
+	const	CommandIndex&	CommandNames();
+
+			AtomTable&		Atoms();
+			// Atoms of a message's "user_id"s/"chat_id", as stamped by the
+			// inbox, or kNoAtom if unknown
+			atom_id			UserAtom(const BMessage* msg,
+								int32 index = 0) const;
+			atom_id			ChatAtom(const BMessage* msg) const;
 
 			Contact*		GetOwnContact();
 			void			SetOwnContact(Contact* contact);
@@ -67,13 +83,16 @@ private:
 
 			ChatProtocol*	fProtocol;
 			int64			fInstance;
+			ProtocolInbox*	fInbox;
 
 			Contact*		fMySelf;
 
+			AtomTable		fAtoms; // User and room IDs
 			ChatMap			fChatMap;
 			RosterMap		fRosterMap;
-			UserMap			fUserMap;
+			UserMap			fUserMap; // All users, contacts included
 			CommandMap		fCommands;
+			CommandIndex	fCommandNames; // Built on first use
 
 			ConversationView*
 							fSystemChatView;
@@ -23,8 +23,8 @@
 #include "ProtocolSettings.h"
 #include "ChatProtocol.h"
 #include "MainWindow.h"
+#include "Platform.h"
 #include "Server.h"
-#include "TheApp.h"
 #include "Utils.h"
 
 static ProtocolManager*	fInstance = NULL;
@@ -74,6 +74,8 @@ ProtocolManager::Init(BDirectory dir, BHandler* target)
 			delete proto;
 		}
 	}
+	// Listed in menus by signature
+	fAddOnMap.SortByKey();
 	return ret;
 }
 
@@ -278,5 +280,5 @@ ProtocolManager::_LoadAccount(ChatProtocolAddOn* addOn, BEntry accountEntry,
 MainWindow*
 ProtocolManager::_MainWin()
 {
-	return ((TheApp*)be_app)->GetMainWindow();
+	return AppMainWindow();
 }
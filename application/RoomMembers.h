@@ -0,0 +1,162 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _ROOM_MEMBERS_H
+#define _ROOM_MEMBERS_H
+
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/PrefixIndex.h>
+
+#include "AtomTable.h"
+
+
+// A room's members, by atom, and by ID and name for completion, as
+// Conversation keeps its Users. Members are indexed under their ID, and their
+// name as well if it's different. The members aren't owned.
+template<class TYPE>
+class RoomMembers {
+public:
+	int32		CountMembers() const;
+	const KeyMap<atom_id, TYPE*>& Members() const;
+	const PrefixIndex<TYPE*>& Names() const;
+
+	TYPE*		Find(atom_id atom) const;
+	// Prefers an exact match, but nicks are often case-insensitive
+	TYPE*		FindByName(const BString& name) const;
+
+	// False if there's already a member with the atom
+	bool		Add(atom_id atom, TYPE* member, const BString& id,
+					const BString& name);
+	TYPE*		Remove(atom_id atom);
+	// Indexes the member under its new name
+	void		Rename(TYPE* member, const BString& name);
+
+private:
+	struct member_names {
+		BString	id;
+		BString	name;
+	};
+
+	KeyMap<atom_id, TYPE*>		fMembers;
+	PrefixIndex<TYPE*>			fNames;
+	// Names each member is indexed under
+	KeyMap<TYPE*, member_names>	fIndexed;
+};
+
+
+template<class TYPE>
+inline int32
+RoomMembers<TYPE>::CountMembers() const
+{
+	return fMembers.CountItems();
+}
+
+
+template<class TYPE>
+inline const KeyMap<atom_id, TYPE*>&
+RoomMembers<TYPE>::Members() const
+{
+	return fMembers;
+}
+
+
+template<class TYPE>
+inline const PrefixIndex<TYPE*>&
+RoomMembers<TYPE>::Names() const
+{
+	return fNames;
+}
+
+
+template<class TYPE>
+inline TYPE*
+RoomMembers<TYPE>::Find(atom_id atom) const
+{
+	bool found = false;
+	return fMembers.ValueFor(atom, &found);
+}
+
+
+template<class TYPE>
+inline TYPE*
+RoomMembers<TYPE>::FindByName(const BString& name) const
+{
+	TYPE* match = NULL;
+	for (int32 i = fNames.FirstMatch(name); i < fNames.CountItems()
+			&& fNames.KeyAt(i).ICompare(name) == 0; i++) {
+		TYPE* member = fNames.ValueAt(i);
+		BString indexed = fIndexed.ValueFor(member).name;
+		if (indexed == name)
+			return member;
+		if (match == NULL && indexed.ICompare(name) == 0)
+			match = member;
+	}
+	return match;
+}
+
+
+template<class TYPE>
+inline bool
+RoomMembers<TYPE>::Add(atom_id atom, TYPE* member, const BString& id,
+	const BString& name)
+{
+	bool found = false;
+	fMembers.ValueFor(atom, &found);
+	if (found == true)
+		return false;
+	fMembers.AddItem(atom, member);
+
+	member_names names;
+	names.id = id;
+	names.name = name;
+	fIndexed.AddItem(member, names);
+	fNames.AddItem(id, member);
+	if (name != id)
+		fNames.AddItem(name, member);
+	return true;
+}
+
+
+template<class TYPE>
+inline TYPE*
+RoomMembers<TYPE>::Remove(atom_id atom)
+{
+	bool found = false;
+	TYPE* member = fMembers.ValueFor(atom, &found);
+	if (found == false)
+		return NULL;
+	fMembers.RemoveItemFor(atom);
+
+	member_names names = fIndexed.ValueFor(member, &found);
+	if (found == false)
+		return member;
+	fNames.RemoveItem(names.id, member);
+	if (names.name != names.id)
+		fNames.RemoveItem(names.name, member);
+	fIndexed.RemoveItemFor(member);
+	return member;
+}
+
+
+template<class TYPE>
+inline void
+RoomMembers<TYPE>::Rename(TYPE* member, const BString& name)
+{
+	bool found = false;
+	member_names names = fIndexed.ValueFor(member, &found);
+	if (found == false || names.name == name)
+		return;
+
+	if (names.name != names.id)
+		fNames.RemoveItem(names.name, member);
+	if (name != names.id)
+		fNames.AddItem(name, member);
+	names.name = name;
+	fIndexed.AddItem(member, names);
+}
+
+
+#endif	// _ROOM_MEMBERS_H
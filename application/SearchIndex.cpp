@@ -0,0 +1,468 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "SearchIndex.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Message.h>
+
+#include "ChatProtocolMessages.h"
+#include "StorageUtils.h"
+
+
+static inline bool
+is_before(const log_position& a, const log_position& b)
+{
+	return a.segment < b.segment
+		|| (a.segment == b.segment && a.offset < b.offset);
+}
+
+
+SearchIndex::SearchIndex(const char* accountName)
+	:
+	fAccountName(accountName),
+	fDocCount(0),
+	fNextRun(0),
+	fBufferSize(0)
+{
+	_Open();
+}
+
+
+SearchIndex::~SearchIndex()
+{
+	// Merging's left for next time
+	_WriteBuffer();
+	for (uint32 i = 0; i < fRuns.CountItems(); i++)
+		delete fRuns.ItemAt(i);
+	for (uint32 i = 0; i < fBuffer.CountItems(); i++)
+		delete fBuffer.ValueAt(i);
+}
+
+
+void
+SearchIndex::Add(const char* roomId, const List<ChatEvent>& events,
+	const List<log_position>& positions)
+{
+	uint32 room = _Room(roomId);
+	if (fCurrent.ItemAt(room) == false)
+		return;
+
+	_Add(room, events, positions);
+	if (fBufferSize >= kIndexBufferSize)
+		_WriteBuffer();
+}
+
+
+bool
+SearchIndex::CatchUp(int32 segments)
+{
+	for (uint32 room = 0; room < fRooms.CountItems(); room++) {
+		if (fCurrent.ItemAt(room) == true)
+			continue;
+
+		ChatLog log(fAccountName, fRooms.ItemAt(room));
+		uint32 count = log.CountSegments();
+		for (uint32 segment = fIndexed.ItemAt(room).segment; segment < count;
+				segment++) {
+			if (segments == 0)
+				return false;
+			if (segments > 0)
+				segments--;
+
+			// Those of the segment not yet indexed
+			List<ChatEvent> events;
+			List<log_position> positions;
+			if (log.ReadSegment(segment, &events, &positions) != B_OK)
+				continue;
+			log_position from = fIndexed.ItemAt(room);
+			List<ChatEvent> missing;
+			List<log_position> missingPositions;
+			for (uint32 i = 0; i < events.CountItems(); i++)
+				if (is_before(positions.ItemAt(i), from) == false) {
+					missing.AddItem(events.ItemAt(i));
+					missingPositions.AddItem(positions.ItemAt(i));
+				}
+			_Add(room, missing, missingPositions);
+
+			if (fBufferSize >= kIndexBufferSize)
+				_WriteBuffer();
+		}
+		fCurrent.ItemAt(room) = true;
+	}
+	return true;
+}
+
+
+status_t
+SearchIndex::Flush()
+{
+	status_t ret = _WriteBuffer();
+	if (ret != B_OK)
+		return ret;
+	return _Merge();
+}
+
+
+status_t
+SearchIndex::Search(const char* query, BMessage* hits, int32 count)
+{
+	List<BString> tokens;
+	TokenizeIndexText(query, &tokens);
+
+	List<BString> terms;
+	for (uint32 i = 0; i < tokens.CountItems(); i++) {
+		bool repeated = false;
+		for (uint32 j = 0; j < terms.CountItems() && repeated == false; j++)
+			repeated = (terms.ItemAt(j) == tokens.ItemAt(i));
+		if (repeated == false)
+			terms.AddItem(tokens.ItemAt(i));
+	}
+	if (terms.IsEmpty() == true)
+		return B_BAD_VALUE;
+
+	std::vector<List<index_posting> > postings(terms.CountItems());
+	for (uint32 i = 0; i < terms.CountItems(); i++)
+		if (_Postings(terms.ItemAt(i), &postings[i]) != B_OK)
+			return B_OK;
+
+	List<index_hit> scored;
+	RankIndexPostings(postings, fDocCount + fNewDocs.CountItems(), count,
+		&scored);
+
+	for (uint32 i = 0; i < scored.CountItems(); i++) {
+		index_doc doc;
+		if (_Doc(scored.ItemAt(i).doc, &doc) != B_OK
+				|| doc.room >= fRooms.CountItems())
+			continue;
+
+		const BString& room = fRooms.ItemAt(doc.room);
+		log_position position = { doc.segment, doc.offset };
+		ChatEvent event;
+		if (ChatLog(fAccountName, room).ReadEvent(position, &event) != B_OK)
+			continue;
+
+		BMessage hit(IM_MESSAGE);
+		event.AddFieldsTo(&hit);
+		if (event.fChatId.IsEmpty() == true)
+			hit.AddString("chat_id", room);
+		hit.AddString("account", fAccountName);
+		hit.AddFloat("score", scored.ItemAt(i).score);
+		hit.AddInt32("log_segment", doc.segment);
+		hit.AddInt32("log_offset", doc.offset);
+		hits->AddMessage("hit", &hit);
+	}
+	return B_OK;
+}
+
+
+void
+SearchIndex::_Open()
+{
+	fDirectory = AccountCachePath(fAccountName);
+	fDirectory.Append("Index");
+	create_directory(fDirectory.Path(), 0755);
+
+	BPath roomsPath(fDirectory);
+	roomsPath.Append("rooms");
+	BFile rooms(roomsPath.Path(), B_READ_ONLY);
+	off_t size = 0;
+	if (rooms.InitCheck() == B_OK && rooms.GetSize(&size) == B_OK) {
+		BString text;
+		char* buffer = text.LockBuffer(size + 1);
+		ssize_t read = rooms.ReadAt(0, buffer, size);
+		text.UnlockBuffer(read > 0 ? read : 0);
+
+		int32 start = 0;
+		for (int32 end = text.FindFirst('\n'); end >= 0;
+				end = text.FindFirst('\n', start)) {
+			BString room;
+			text.CopyInto(room, start, end - start);
+			fRoomIds.AddItem(room, fRooms.CountItems());
+			fRooms.AddItem(room);
+			start = end + 1;
+		}
+	}
+
+	BPath docsPath(fDirectory);
+	docsPath.Append("docs");
+	BEntry docs(docsPath.Path());
+	if (docs.GetSize(&size) == B_OK)
+		fDocCount = size / sizeof(index_doc);
+
+	// Runs, in order
+	List<uint32> numbers;
+	BDirectory directory(fDirectory.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		uint32 number;
+		if (entry.GetName(name) == B_OK
+				&& sscanf(name, "run-%" B_SCNu32, &number) == 1)
+			numbers.AddItem(number);
+	}
+	std::sort(numbers.begin(), numbers.end());
+
+	for (uint32 i = 0; i < numbers.CountItems(); i++) {
+		uint32 number = numbers.ItemAt(i);
+		fNextRun = number + 1;
+
+		// A run cut short (or of an older version), its postings are gone
+		IndexRun* run = _OpenRun(number);
+		if (run->InitCheck() != B_OK) {
+			_RemoveRun(run);
+			continue;
+		}
+		fRuns.AddItem(run);
+	}
+
+	// Carried on from where the latest run had got to; everything's left to
+	// CatchUp() till then
+	if (fRuns.IsEmpty() == false)
+		fRuns.ItemAt(fRuns.CountItems() - 1)->GetPositions(&fIndexed);
+	log_position start = { 0, 0 };
+	while (fIndexed.CountItems() < fRooms.CountItems())
+		fIndexed.AddItem(start);
+	while (fCurrent.CountItems() < fRooms.CountItems())
+		fCurrent.AddItem(false);
+
+	// Including rooms logged before there was an index
+	BPath logsPath = AccountCachePath(fAccountName);
+	logsPath.Append("Logs");
+	BDirectory logs(logsPath.Path());
+	while (logs.GetNextEntry(&entry) == B_OK) {
+		char room[B_FILE_NAME_LENGTH];
+		if (entry.IsDirectory() == true && entry.GetName(room) == B_OK)
+			_Room(room);
+	}
+}
+
+
+void
+SearchIndex::_Add(uint32 room, const List<ChatEvent>& events,
+	const List<log_position>& positions)
+{
+	for (uint32 i = 0; i < events.CountItems() && i < positions.CountItems();
+			i++) {
+		const ChatEvent& event = events.ItemAt(i);
+		const log_position& position = positions.ItemAt(i);
+
+		uint32 doc = fDocCount + fNewDocs.CountItems();
+		index_doc indexDoc = { room, position.segment, position.offset };
+		fNewDocs.AddItem(indexDoc);
+
+		// Carried on from just past it
+		log_position next = { position.segment, position.offset + 1 };
+		fIndexed.ItemAt(room) = next;
+
+		// Senders' names are searchable too
+		List<BString> tokens;
+		TokenizeIndexText(event.fBody, &tokens);
+		TokenizeIndexText(event.fUserName, &tokens);
+		fBufferSize += AddIndexPostings(&fBuffer, doc, tokens);
+	}
+}
+
+
+status_t
+SearchIndex::_WriteBuffer()
+{
+	if (fNewDocs.IsEmpty() == true)
+		return B_OK;
+
+	// Documents first, so that a run never names missing ones
+	BPath docsPath(fDirectory);
+	docsPath.Append("docs");
+	BFile docs(docsPath.Path(), B_WRITE_ONLY | B_CREATE_FILE);
+	ssize_t size = fNewDocs.CountItems() * sizeof(index_doc);
+	if (docs.WriteAt(fDocCount * sizeof(index_doc), &fNewDocs.ItemAt(0), size)
+			!= size)
+		return B_IO_ERROR;
+	fDocCount += fNewDocs.CountItems();
+	fNewDocs.MakeEmpty();
+
+	List<IndexRun*> noRuns;
+	status_t ret = _WriteRun(fNextRun, noRuns, true, fIndexed);
+	for (uint32 i = 0; i < fBuffer.CountItems(); i++)
+		delete fBuffer.ValueAt(i);
+	fBuffer = IndexPostingMap();
+	fBufferSize = 0;
+	if (ret != B_OK)
+		return ret;
+
+	IndexRun* run = _OpenRun(fNextRun++);
+	if (run->InitCheck() != B_OK) {
+		delete run;
+		return B_ERROR;
+	}
+	fRuns.AddItem(run);
+	return B_OK;
+}
+
+
+uint32
+SearchIndex::_Room(const char* roomId)
+{
+	bool found = false;
+	uint32 room = fRoomIds.ValueFor(roomId, &found);
+	if (found == true)
+		return room;
+
+	room = fRooms.CountItems();
+	fRooms.AddItem(roomId);
+	fRoomIds.AddItem(roomId, room);
+	log_position start = { 0, 0 };
+	fIndexed.AddItem(start);
+	fCurrent.AddItem(false);
+
+	BPath roomsPath(fDirectory);
+	roomsPath.Append("rooms");
+	BFile rooms(roomsPath.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_OPEN_AT_END);
+	BString line(roomId);
+	line << "\n";
+	rooms.Write(line.String(), line.Length());
+	return room;
+}
+
+
+status_t
+SearchIndex::_Doc(uint32 doc, index_doc* indexDoc)
+{
+	if (doc >= fDocCount) {
+		if (doc - fDocCount >= fNewDocs.CountItems())
+			return B_BAD_INDEX;
+		*indexDoc = fNewDocs.ItemAt(doc - fDocCount);
+		return B_OK;
+	}
+
+	BPath docsPath(fDirectory);
+	docsPath.Append("docs");
+	BFile docs(docsPath.Path(), B_READ_ONLY);
+	if (docs.ReadAt((off_t)doc * sizeof(index_doc), indexDoc,
+			sizeof(index_doc)) != sizeof(index_doc))
+		return B_IO_ERROR;
+	return B_OK;
+}
+
+
+status_t
+SearchIndex::_Postings(const BString& term, List<index_posting>* postings)
+{
+	for (uint32 i = 0; i < fRuns.CountItems(); i++) {
+		IndexRun* run = fRuns.ItemAt(i);
+		int32 index = run->Find(term);
+		if (index >= 0)
+			run->PostingsAt(index, postings);
+	}
+
+	List<index_posting>* buffered = fBuffer.ValueFor(term);
+	if (buffered != NULL)
+		postings->AddList(*buffered);
+	return B_OK;
+}
+
+
+status_t
+SearchIndex::_WriteRun(uint32 number, const List<IndexRun*>& runs,
+	bool buffer, const List<log_position>& positions)
+{
+	BFile file(_RunPath(number).Path(),
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t ret = file.InitCheck();
+	if (ret != B_OK)
+		return ret;
+
+	return IndexRun::Write(&file, runs, buffer == true ? &fBuffer : NULL,
+		positions);
+}
+
+
+status_t
+SearchIndex::_Merge()
+{
+	while (fRuns.CountItems() >= (uint32)kIndexMergeFactor) {
+		// The latest runs, of the last one's tier or below― only ever those
+		// at the end, so documents stay in order
+		uint32 count = fRuns.CountItems();
+		int32 tier = _Tier(fRuns.ItemAt(count - 1));
+		uint32 first = count - 1;
+		while (first > 0 && _Tier(fRuns.ItemAt(first - 1)) <= tier)
+			first--;
+		if (count - first < (uint32)kIndexMergeFactor)
+			return B_OK;
+
+		List<IndexRun*> runs;
+		for (uint32 i = first; i < count; i++)
+			runs.AddItem(fRuns.ItemAt(i));
+
+		// The latest of them knows how far indexing had got
+		List<log_position> positions;
+		runs.ItemAt(runs.CountItems() - 1)->GetPositions(&positions);
+
+		uint32 number = fNextRun++;
+		status_t ret = _WriteRun(number, runs, false, positions);
+		if (ret != B_OK)
+			return ret;
+
+		IndexRun* merged = _OpenRun(number);
+		if (merged->InitCheck() != B_OK) {
+			_RemoveRun(merged);
+			return B_ERROR;
+		}
+
+		for (uint32 i = 0; i < runs.CountItems(); i++)
+			_RemoveRun(runs.ItemAt(i));
+		while (fRuns.CountItems() > first)
+			fRuns.RemoveItemAt(fRuns.CountItems() - 1);
+		fRuns.AddItem(merged);
+	}
+	return B_OK;
+}
+
+
+int32
+SearchIndex::_Tier(IndexRun* run)
+{
+	int32 tier = 0;
+	for (off_t size = kIndexTierSize; run->Size() > size && tier < 16;
+			size *= kIndexMergeFactor)
+		tier++;
+	return tier;
+}
+
+
+IndexRun*
+SearchIndex::_OpenRun(uint32 number)
+{
+	return new IndexRun(new BFile(_RunPath(number).Path(), B_READ_ONLY),
+		number);
+}
+
+
+// Deletes the run, and its file with it
+void
+SearchIndex::_RemoveRun(IndexRun* run)
+{
+	BPath path = _RunPath(run->Number());
+	delete run;
+	BEntry(path.Path()).Remove();
+}
+
+
+BPath
+SearchIndex::_RunPath(uint32 number)
+{
+	BString leaf;
+	leaf.SetToFormat("run-%08" B_PRIu32, number);
+	BPath path(fDirectory);
+	path.Append(leaf);
+	return path;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _SEARCH_INDEX_H
+#define _SEARCH_INDEX_H
+
+#include <Path.h>
+#include <String.h>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
+#include "ChatEvent.h"
+#include "ChatLog.h"
+#include "IndexRun.h"
+
+class BMessage;
+
+
+// Hits returned by Search(), by default
+const int32 kSearchHitCount = 50;
+
+
+// Where each of the account's messages (documents) is, in the "docs" file
+struct index_doc {
+	uint32	room;		// Line of the "rooms" file
+	uint32	segment;
+	uint32	offset;
+};
+
+
+/* An account's inverted index of its rooms' ChatLogs, mapping each word to the
+ * messages with it. Kept in the account's cache, under Index/.
+ *
+ * New messages' postings are collected in memory, then written out as an
+ * IndexRun. Runs only grow, so a word's postings are those of every run, in
+ * order. Once there are kIndexMergeFactor runs of about the same size at the
+ * end, they're merged into one, so each message is only rewritten once per
+ * tier.
+ *
+ * Each run also says how far each room's log had been indexed. When the
+ * index is opened, those of the latest run are where CatchUp() carries on
+ * from: postings lost with a crash (or logs written before there was an
+ * index) are read back from the logs. Until a room's caught up, messages
+ * added to it are left for CatchUp() to read.
+ *
+ * Only used by the LogWriter's thread. */
+class SearchIndex {
+public:
+						SearchIndex(const char* accountName);
+						~SearchIndex();
+
+			// Messages just appended to the room's ChatLog
+			void		Add(const char* roomId, const List<ChatEvent>& events,
+							const List<log_position>& positions);
+
+			// Indexes what's missing from rooms' logs, reading at most the
+			// given number of segments (or all, if negative); true once every
+			// room's caught up
+			bool		CatchUp(int32 segments = -1);
+
+			// Writes out postings kept in memory, then merges runs if due
+			status_t	Flush();
+
+			// Adds the best-scoring messages with all of the query's words as
+			// "hit" messages, each scored with "score"
+			status_t	Search(const char* query, BMessage* hits,
+							int32 count = kSearchHitCount);
+
+private:
+			void		_Open();
+
+			void		_Add(uint32 room, const List<ChatEvent>& events,
+							const List<log_position>& positions);
+			status_t	_WriteBuffer();
+
+			uint32		_Room(const char* roomId);
+			status_t	_Doc(uint32 doc, index_doc* indexDoc);
+			status_t	_Postings(const BString& term,
+							List<index_posting>* postings);
+
+			// Merges the given runs' postings, and those in memory if
+			// buffer is set, into a new run, with rooms' positions
+			status_t	_WriteRun(uint32 number, const List<IndexRun*>& runs,
+							bool buffer, const List<log_position>& positions);
+			status_t	_Merge();
+			int32		_Tier(IndexRun* run);
+			IndexRun*	_OpenRun(uint32 number);
+			void		_RemoveRun(IndexRun* run);
+			BPath		_RunPath(uint32 number);
+
+	BString				fAccountName;
+	BPath				fDirectory;
+
+	List<BString>		fRooms;
+	KeyMap<BString, uint32>	fRoomIds;
+	// By room, where indexing carries on from, and whether it's caught up
+	List<log_position>	fIndexed;
+	List<uint8>			fCurrent;
+
+	uint32				fDocCount;	// Written to "docs"
+	List<index_doc>		fNewDocs;	// … and not yet
+
+	List<IndexRun*>		fRuns;		// Oldest first
+	uint32				fNextRun;
+
+	IndexPostingMap		fBuffer;
+	int32				fBufferSize;
+};
+
+#endif // _SEARCH_INDEX_H
@@ -15,6 +15,8 @@
 
 #include "Server.h"
 
+#include <stdlib.h>
+
 #include <Application.h>
 #include <Catalog.h>
 #include <Debug.h>
@@ -32,13 +34,19 @@
 #include "ConversationInfoWindow.h"
 #include "ConversationView.h"
 #include "ChatProtocolMessages.h"
+#include "EventRecorder.h"
+#include "EventTrace.h"
 #include "Flags.h"
 #include "ImageCache.h"
 #include "InviteDialogue.h"
+#include "LogWriter.h"
 #include "NotifyMessage.h"
+#include "Platform.h"
+#include "ProtocolInbox.h"
 #include "ProtocolLooper.h"
 #include "ProtocolManager.h"
 #include "RosterItem.h"
+#include "SearchWindow.h"
 #include "StatusManager.h"
 #include "UserInfoWindow.h"
 #include "Utils.h"
@@ -48,6 +56,9 @@
 #define B_TRANSLATION_CONTEXT "Server"
 
 
+// Matches listed by /search, the search window shows more
+const int32 kSearchCommandHits = 10;
+
 Server* Server::fInstance = NULL;
 
 
@@ -55,6 +66,14 @@ Server::Server()
 	:
 	BMessageFilter(B_ANY_DELIVERY, B_ANY_SOURCE)
 {
+	// Started here, before any account can submit to or stamp with them
+	LogWriter* writer = LogWriter::Get();
+	AppPreferences* prefs = AppPreferences::Get();
+	writer->SetFlushInterval((bigtime_t)prefs->LogFlushInterval * 1000);
+	writer->SetDurability((log_durability)prefs->LogDurability);
+	writer->SetRetention(prefs->LogRetentionDays);
+	EventTrace::Get();
+
 	if (fUserItems.IsEmpty() == false || fCommands.CountItems() > 0)
 		return;
 
@@ -72,7 +91,7 @@ Server::Server()
 	}
 
 	// Loading default chat commands
-	for (int i = 0; i < 9; i++) {
+	for (int i = 0; i < 14; i++) {
 		size_t size;
 		BMessage temp;
 		const void* buff = res.LoadResource(B_MESSAGE_TYPE, 1140 + i, &size);
@@ -80,6 +99,8 @@ Server::Server()
 		ChatCommand* cmd = new ChatCommand(&temp);
 		fCommands.AddItem(cmd->GetName(), cmd);
 	}
+	// Listed by /help in this order
+	fCommands.SortByKey();
 
 	fStarted = false;
 }
@@ -97,8 +118,9 @@ Server::Get()
 void
 Server::Quit()
 {
-	for (int i = 0; i < fLoopers.CountItems(); i++)
+	for (int i = fLoopers.CountItems() - 1; i >= 0; i--)
 		RemoveProtocolLooper(fLoopers.KeyAt(i));
+	LogWriter::Get()->Quit();
 }
 
 
@@ -229,16 +251,21 @@ Server::Filter(BMessage* message, BHandler **target)
 				}
 			}
 			else {
-				CommandMap combinedCmds;
-				combinedCmds.AddList(fCommands);
-				combinedCmds.AddList(chat->GetProtocolLooper()->Commands());
+				const CommandMap& protoCmds
+					= chat->GetProtocolLooper()->Commands();
 
 				body << B_TRANSLATE("** Commands: ");
-				for (int i = 0; i < combinedCmds.CountItems(); i++) {
-					ChatCommand* cmd = combinedCmds.ValueAt(i);
+				for (int i = 0; i < fCommands.CountItems(); i++) {
+					ChatCommand* cmd = fCommands.ValueAt(i);
 					if (i > 0)	body << ", ";
 					body << cmd->GetName();
 				}
+				for (int i = 0; i < protoCmds.CountItems(); i++) {
+					ChatCommand* cmd = protoCmds.ValueAt(i);
+					if (fCommands.ValueFor(cmd->GetName()) != NULL)
+						continue;
+					body << ", " << cmd->GetName();
+				}
 				body << "\n";
 			}
 			BMessage* help = new BMessage(IM_MESSAGE);
@@ -248,6 +275,280 @@ Server::Filter(BMessage* message, BHandler **target)
 			chat->ImMessage(help);
 			break;
 		}
+		case APP_TRACE:
+		{
+			Conversation* chat = _EnsureConversation(message);
+			if (chat == NULL)
+				break;
+
+			BString args = message->FindString("misc_str");
+			args.Trim();
+			BString action = args, path;
+			int32 space = args.FindFirst(" ");
+			if (space > 0) {
+				args.CopyInto(action, 0, space);
+				args.CopyInto(path, space + 1, args.Length() - space - 1);
+			}
+
+			EventTrace* trace = EventTrace::Get();
+			BString body;
+			if (action == "on") {
+				trace->SetEnabled(true);
+				body = B_TRANSLATE("-- Tracing is on.\n");
+			}
+			else if (action == "off") {
+				trace->SetEnabled(false);
+				body = B_TRANSLATE("-- Tracing is off.\n");
+			}
+			else if (action == "reset") {
+				trace->Reset();
+				body = B_TRANSLATE("-- Traces have been cleared.\n");
+			}
+			else if (action == "dump" && path.IsEmpty() == false) {
+				if (trace->DumpTo(path) == B_OK)
+					body = B_TRANSLATE("-- Traces saved to %path%.\n");
+				else
+					body = B_TRANSLATE("-- Traces couldn't be saved to "
+						"%path%.\n");
+				body.ReplaceAll("%path%", path);
+			}
+			else {
+				body = "** ";
+				trace->Dump(&body);
+				_InboxCounts(chat->GetProtocolLooper(), &body);
+			}
+
+			BMessage* reply = new BMessage(IM_MESSAGE);
+			reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			reply->AddString("body", body);
+			reply->AddInt64("when", 0);
+			chat->ImMessage(reply);
+			break;
+		}
+		case APP_QUEUE:
+		{
+			Conversation* chat = _EnsureConversation(message);
+			if (chat == NULL)
+				break;
+
+			BString args = message->FindString("misc_str");
+			args.Trim();
+			BString name = args, value;
+			int32 space = args.FindFirst(" ");
+			if (space > 0) {
+				args.CopyInto(name, 0, space);
+				args.CopyInto(value, space + 1, args.Length() - space - 1);
+				value.Trim();
+			}
+
+			AppPreferences* prefs = AppPreferences::Get();
+			int32* policy = NULL;
+			if (name == "chat")
+				policy = &prefs->ChatQueuePolicy;
+			else if (name == "membership")
+				policy = &prefs->MembershipQueuePolicy;
+			else if (name == "presence")
+				policy = &prefs->PresenceQueuePolicy;
+
+			BString body;
+			if (name == "limit" && value.IsEmpty() == false
+					&& atoi(value.String()) >= 0)
+				prefs->EventQueueLimit = atoi(value.String());
+			else if (policy != NULL && value == "block")
+				*policy = QUEUE_BLOCK;
+			else if (policy != NULL && value == "drop")
+				*policy = QUEUE_DROP_OLDEST;
+			else if (policy != NULL && value == "merge")
+				*policy = QUEUE_MERGE;
+			else if (args.IsEmpty() == false)
+				body = B_TRANSLATE("-- Give 'limit' and a count, or 'chat', "
+					"'membership' or 'presence' and 'block', 'drop' or "
+					"'merge'.\n");
+
+			// Every account's, as they're the app's preferences
+			if (args.IsEmpty() == false && body.IsEmpty() == true)
+				for (int32 i = 0; i < fLoopers.CountItems(); i++)
+					fLoopers.ValueAt(i)->UpdateInbox();
+
+			if (body.IsEmpty() == true) {
+				const char* policies[] = { "block", "drop", "merge" };
+				body << "** Limit: " << prefs->EventQueueLimit
+					<< "\n\tchat: " << policies[prefs->ChatQueuePolicy % 3]
+					<< "\n\tmembership: "
+					<< policies[prefs->MembershipQueuePolicy % 3]
+					<< "\n\tpresence: "
+					<< policies[prefs->PresenceQueuePolicy % 3] << "\n";
+				_InboxCounts(chat->GetProtocolLooper(), &body);
+			}
+
+			BMessage* reply = new BMessage(IM_MESSAGE);
+			reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			reply->AddString("body", body);
+			reply->AddInt64("when", 0);
+			chat->ImMessage(reply);
+			break;
+		}
+		case APP_RECORD:
+		{
+			Conversation* chat = _EnsureConversation(message);
+			if (chat == NULL)
+				break;
+			Account* account = reinterpret_cast<Account*>(
+				chat->GetProtocolLooper()->Protocol()->MessengerInterface());
+
+			BString path = message->FindString("misc_str");
+			path.Trim();
+			BString body;
+			EventRecorder* recorder = NULL;
+			if (path.IsEmpty() == false) {
+				recorder = new EventRecorder(path);
+				if (recorder->InitCheck() == B_OK)
+					body = B_TRANSLATE("-- Recording to %path%.\n");
+				else {
+					body = B_TRANSLATE("-- %path% couldn't be opened for "
+						"recording.\n");
+					delete recorder;
+					recorder = NULL;
+				}
+				body.ReplaceAll("%path%", path);
+			}
+			else
+				body = B_TRANSLATE("-- Recording stopped.\n");
+			delete account->SetRecorder(recorder);
+
+			BMessage* reply = new BMessage(IM_MESSAGE);
+			reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			reply->AddString("body", body);
+			reply->AddInt64("when", 0);
+			chat->ImMessage(reply);
+			break;
+		}
+		case APP_SEARCH:
+		{
+			Conversation* chat = _EnsureConversation(message);
+			BString query = message->FindString("misc_str");
+			query.Trim();
+			if (chat == NULL || query.IsEmpty() == true) {
+				SearchWindow::Get()->Show();
+				break;
+			}
+
+			// Shown once they're found
+			BMessage reply(APP_SEARCH_RESULTS);
+			reply.AddInt64("instance", message->GetInt64("instance", -1));
+			reply.AddString("chat_id", chat->GetId());
+			LogWriter::Get()->Search(query, kSearchCommandHits,
+				BMessenger(NULL, Looper()), reply);
+			break;
+		}
+		case APP_SEARCH_RESULTS:
+		{
+			ProtocolLooper* looper = _LooperFromMessage(message);
+			Conversation* chat = NULL;
+			if (looper != NULL)
+				chat = looper->ConversationById(message->FindString("chat_id"));
+			if (chat == NULL)
+				break;
+
+			BString body;
+			if (message->GetInt32("result", B_OK) != B_OK)
+				body = B_TRANSLATE("-- No words to search for were given.\n");
+			else if (message->HasMessage("hit") == false)
+				body = B_TRANSLATE("-- No messages were found.\n");
+			else {
+				body = "** ";
+				BMessage hit;
+				for (int32 i = 0; message->FindMessage("hit", i, &hit) == B_OK;
+						i++) {
+					BString user = hit.FindString("user_name");
+					if (user.IsEmpty() == true)
+						user = hit.FindString("user_id");
+					body << "[" << hit.FindString("chat_id") << "] <" << user
+						<< "> " << hit.FindString("body") << "\n";
+				}
+			}
+
+			BMessage* reply = new BMessage(IM_MESSAGE);
+			reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			reply->AddString("body", body);
+			reply->AddInt64("when", 0);
+			chat->ImMessage(reply);
+			break;
+		}
+		case APP_EXPORT:
+		{
+			Conversation* chat = _EnsureConversation(message);
+			if (chat == NULL)
+				break;
+			const char* accountName
+				= chat->GetProtocolLooper()->Protocol()->GetName();
+			BString id = chat->GetId();
+
+			// The format, then the file
+			BString args = message->FindString("misc_str");
+			args.Trim();
+			BString name(args);
+			BString path;
+			int32 space = args.FindFirst(' ');
+			if (space >= 0) {
+				name.Truncate(space);
+				args.CopyInto(path, space + 1, args.Length() - space - 1);
+				path.Trim();
+			}
+
+			log_export_format format = LOG_EXPORT_TEXT;
+			if (name.IsEmpty() == false
+					&& LogExporter::FindFormat(name, &format) != B_OK) {
+				BMessage* reply = new BMessage(IM_MESSAGE);
+				reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+				reply->AddString("body", B_TRANSLATE("-- Logs can be exported "
+					"as 'text', 'html', or 'json'.\n"));
+				reply->AddInt64("when", 0);
+				chat->ImMessage(reply);
+				break;
+			}
+
+			if (path.IsEmpty() == true) {
+				BPath exportPath = RoomLogsPath(accountName, id.String());
+				BString leaf("export.");
+				leaf << LogExporter::Extension(format);
+				exportPath.Append(leaf);
+				path = exportPath.Path();
+			}
+
+			// Said so once it's written
+			BMessage reply(APP_EXPORT_DONE);
+			reply.AddInt64("instance", message->GetInt64("instance", -1));
+			reply.AddString("chat_id", id);
+			reply.AddString("path", path);
+			LogWriter::Get()->Export(accountName, id.String(), format,
+				path.String(), BMessenger(NULL, Looper()), reply);
+			break;
+		}
+		case APP_EXPORT_DONE:
+		{
+			ProtocolLooper* looper = _LooperFromMessage(message);
+			Conversation* chat = NULL;
+			if (looper != NULL)
+				chat = looper->ConversationById(message->FindString("chat_id"));
+			if (chat == NULL)
+				break;
+
+			BString body;
+			if (message->GetInt32("result", B_ERROR) == B_OK)
+				body = B_TRANSLATE("-- Logs exported to %path%.\n");
+			else
+				body = B_TRANSLATE("-- Logs couldn't be exported to "
+					"%path%.\n");
+			body.ReplaceAll("%path%", message->FindString("path"));
+
+			BMessage* reply = new BMessage(IM_MESSAGE);
+			reply->AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			reply->AddString("body", body);
+			reply->AddInt64("when", 0);
+			chat->ImMessage(reply);
+			break;
+		}
 		default:
 			// Dispatch not handled messages to main window
 			break;
@@ -259,19 +560,24 @@ Server::Filter(BMessage* message, BHandler **target)
 filter_result
 Server::ImMessage(BMessage* msg)
 {
+	EventTrace::Stamp(msg, TRACE_SERVER);
+
 	filter_result result = B_DISPATCH_MESSAGE;
 	int32 im_what = msg->FindInt32("im_what");
 
 	switch (im_what) {
 		case IM_ROSTER:
 		{
-			int i = 0;
+			ProtocolLooper* looper = _LooperFromMessage(msg);
 			BString id;
-			while (msg->FindString("user_id", i++, &id) == B_OK)
-				_EnsureContact(msg);
+			for (int i = 0; msg->FindString("user_id", i, &id) == B_OK; i++)
+				_EnsureContact(id, looper);
 			result = B_SKIP_MESSAGE;
 			break;
 		}
+		case IM_BATCH:
+			result = _ImBatch(msg);
+			break;
 		case IM_ROSTER_CONTACT_REMOVED:
 		{
 			Contact* contact = _EnsureContact(msg);
@@ -351,7 +657,7 @@ Server::ImMessage(BMessage* msg)
 			if (user == NULL)
 				break;
 
-			ChatMap conv = user->Conversations();
+			const ChatMap& conv = user->Conversations();
 			for (int i = 0; i < conv.CountItems(); i++)
 				conv.ValueAt(i)->ImMessage(msg);
 
@@ -601,13 +907,8 @@ Server::ImMessage(BMessage* msg)
 			if (!AppPreferences::Get()->NotifyProtocolStatus)
 				break;
 
-			BNotification notification(B_PROGRESS_NOTIFICATION);
-			notification.SetGroup(BString(APP_NAME));
-			notification.SetTitle(title);
-			notification.SetIcon(looper->Protocol()->Icon());
-			notification.SetContent(message);
-			notification.SetProgress(progress);
-			notification.Send();
+			AppNotify(APP_NOTIFY_PROGRESS, title, message, NULL,
+				looper->Protocol()->Icon(), progress);
 			break;
 		}
 		case IM_NOTIFICATION: {
@@ -703,9 +1004,7 @@ Server::ImError(BMessage* msg)
 	if (detail)
 		errMsg << "\n\n" << detail;
 
-	BAlert* alert = new BAlert(B_TRANSLATE("Error"), errMsg.String(),
-		B_TRANSLATE("OK"), NULL, NULL, B_WIDTH_AS_USUAL, B_STOP_ALERT);
-	alert->Go();
+	AppAlert(B_TRANSLATE("Error"), errMsg.String());
 }
 
 
@@ -715,6 +1014,8 @@ Server::AddProtocolLooper(bigtime_t instanceId, ChatProtocol* cayap)
 	ProtocolLooper* looper = new ProtocolLooper(cayap, instanceId);
 	fLoopers.AddItem(instanceId, looper);
 	fAccounts.AddItem(cayap->GetName(), instanceId);
+	// Accounts menus list them by name
+	fAccounts.SortByKey();
 	fAccountEnabled.AddItem(cayap->GetName(), false);
 
 	if (AppPreferences::Get()->NotifyProtocolStatus == true)
@@ -733,16 +1034,19 @@ Server::RemoveProtocolLooper(bigtime_t instanceId)
 	if (looper == NULL)
 		return;
 
-	ChatMap chats = looper->Conversations();
-	for (int i = 0; i < chats.CountItems(); i++)
+	// Conversations remove themselves from the looper as they're deleted
+	const ChatMap& chats = looper->Conversations();
+	for (int i = chats.CountItems() - 1; i >= 0; i--)
 		delete chats.ValueAt(i);
 
-	UserMap users = looper->Users();
+	const UserMap& users = looper->Users();
 	for (int i = 0; i < users.CountItems(); i++)
 		delete users.ValueAt(i);
 
 	fLoopers.RemoveItemFor(instanceId);
+	fLoopers.SortByKey();
 	fAccounts.RemoveItemFor(looper->Protocol()->GetName());
+	fAccounts.SortByKey();
 	fAccountEnabled.AddItem(looper->Protocol()->GetName(), false);
 	looper->Lock();
 	looper->Quit();
@@ -757,8 +1061,8 @@ Server::GetProtocolLooper(bigtime_t instanceId)
 }
 
 
-AccountInstances
-Server::GetAccounts()
+const AccountInstances&
+Server::GetAccounts() const
 {
 	return fAccounts;
 }
@@ -810,18 +1114,10 @@ Server::SendAllProtocolMessage(BMessage* msg)
 }
 
 
-RosterMap
-Server::Contacts() const
+const Server::ProtocolLoopers&
+Server::Loopers() const
 {
-	RosterMap contacts;
-
-	for (int i = 0; i < fAccounts.CountItems(); i++) {
-		ProtocolLooper* fruitLoop = fLoopers.ValueFor(fAccounts.ValueAt(i));
-		if (fruitLoop == NULL)	continue;
-		contacts.AddList(fruitLoop->Contacts());
-	}
-
-	return contacts;
+	return fLoopers;
 }
 
 
@@ -845,20 +1141,6 @@ Server::AddContact(Contact* contact, int64 instance)
 }
 
 
-UserMap
-Server::Users() const
-{
-	UserMap users;
-	for (int i = 0; i < fAccounts.CountItems(); i++) {
-		ProtocolLooper* fruitLoop = fLoopers.ValueFor(fAccounts.ValueAt(i));
-		if (fruitLoop == NULL)	continue;
-		users.AddList(fruitLoop->Users());
-	}
-
-	return users;
-}
-
-
 User*
 Server::UserById(BString id, int64 instance)
 {
@@ -879,21 +1161,6 @@ Server::AddUser(User* user, int64 instance)
 }
 
 
-ChatMap
-Server::Conversations() const
-{
-	ChatMap chats;
-
-	for (int i = 0; i < fAccounts.CountItems(); i++) {
-		ProtocolLooper* fruitLoop = fLoopers.ValueFor(fAccounts.ValueAt(i));
-		if (fruitLoop == NULL)	continue;
-		chats.AddList(fruitLoop->Conversations());
-	}
-
-	return chats;
-}
-
-
 Conversation*
 Server::ConversationById(BString id, int64 instance)
 {
@@ -914,14 +1181,10 @@ Server::AddConversation(Conversation* chat, int64 instance)
 }
 
 
-CommandMap
-Server::Commands(int64 instance)
+const CommandMap&
+Server::Commands() const
 {
-	ProtocolLooper* looper = fLoopers.ValueFor(instance);
-	CommandMap cmds = fCommands;
-	if (looper != NULL)
-		cmds.AddList(looper->Commands());
-	return cmds;
+	return fCommands;
 }
 
 
@@ -965,16 +1228,103 @@ Server::_LooperFromMessage(BMessage* message)
 }
 
 
+void
+Server::_InboxCounts(ProtocolLooper* looper, BString* out)
+{
+	if (looper == NULL || looper->Inbox() == NULL)
+		return;
+
+	const char* names[INBOX_LANE_COUNT] = { "chat", "membership", "presence" };
+	ProtocolInbox* inbox = looper->Inbox();
+	*out << "Inbox (waiting, merged, dropped):\n";
+	for (int32 i = 0; i < INBOX_LANE_COUNT; i++) {
+		inbox_lane lane = (inbox_lane)i;
+		*out << "\t" << names[i] << ": " << inbox->Depth(lane) << ", "
+			<< inbox->MergedCount(lane) << ", " << inbox->DroppedCount(lane)
+			<< "\n";
+	}
+}
+
+
+filter_result
+Server::_ImBatch(BMessage* msg)
+{
+	int64 instance = msg->FindInt64("instance");
+
+	// Room members sent piecemeal (e.g., one per IRC WHO reply) are merged, so
+	// each room's user-list is updated once
+	BObjectList<BMessage> subs(20, true);
+	KeyMap<BString, BMessage*> participants;
+
+	BMessage sub;
+	for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK; i++) {
+		if (sub.HasInt64("instance") == false)
+			sub.AddInt64("instance", instance);
+
+		if (sub.GetInt32("im_what", -1) != IM_ROOM_PARTICIPANTS) {
+			// Later members shouldn't be merged ahead of this
+			participants.RemoveItemFor(sub.GetString("chat_id", ""));
+			subs.AddItem(new BMessage(sub));
+			continue;
+		}
+
+		BString chat_id = sub.FindString("chat_id");
+		BMessage* merged = participants.ValueFor(chat_id);
+		if (merged == NULL) {
+			merged = new BMessage(IM_MESSAGE);
+			merged->AddInt32("im_what", IM_ROOM_PARTICIPANTS);
+			merged->AddString("chat_id", chat_id);
+			merged->AddInt64("instance", sub.FindInt64("instance"));
+			// From the same inbox, so stamped from the same AtomTable
+			merged->AddInt32("atom_table", sub.GetInt32("atom_table", 0));
+			participants.AddItem(chat_id, merged);
+			subs.AddItem(merged);
+		}
+
+		BString id;
+		for (int32 j = 0; sub.FindString("user_id", j, &id) == B_OK; j++) {
+			merged->AddString("user_id", id);
+			merged->AddString("user_name", sub.GetString("user_name", j, ""));
+			merged->AddInt32("user_atom", sub.GetInt32("user_atom", j, kNoAtom));
+		}
+	}
+
+	// Whatever the windows need to see is passed on in one message, too
+	BMessage dispatch(IM_MESSAGE);
+	dispatch.AddInt32("im_what", IM_BATCH);
+	dispatch.AddInt64("instance", instance);
+	for (int32 i = 0; i < subs.CountItems(); i++)
+		if (ImMessage(subs.ItemAt(i)) == B_DISPATCH_MESSAGE)
+			dispatch.AddMessage("message", subs.ItemAt(i));
+
+	if (dispatch.HasMessage("message") == false)
+		return B_SKIP_MESSAGE;
+	*msg = dispatch;
+	return B_DISPATCH_MESSAGE;
+}
+
+
 Contact*
 Server::_EnsureContact(BMessage* message)
 {
-	BString id = message->FindString("user_id");
 	ProtocolLooper* looper = _LooperFromMessage(message);
 	if (looper == NULL) return NULL;
 
+	Contact* contact = looper->ContactByAtom(looper->UserAtom(message));
+	if (contact != NULL)
+		return contact;
+	return _EnsureContact(message->FindString("user_id"), looper);
+}
+
+
+Contact*
+Server::_EnsureContact(BString id, ProtocolLooper* looper)
+{
+	if (looper == NULL) return NULL;
+
 	Contact* contact = looper->ContactById(id);
 
-	if (contact == NULL && id.IsEmpty() == false && looper != NULL) {
+	if (contact == NULL && id.IsEmpty() == false) {
 		contact = new Contact(id, Looper());
 		contact->SetProtocolLooper(looper);
 		looper->AddContact(contact);
@@ -987,8 +1337,14 @@ Server::_EnsureContact(BMessage* message)
 User*
 Server::_EnsureUser(BMessage* message)
 {
-	BString id = message->FindString("user_id");
-	return _EnsureUser(id, _LooperFromMessage(message));
+	ProtocolLooper* looper = _LooperFromMessage(message);
+	if (looper == NULL)
+		return NULL;
+
+	User* user = looper->UserByAtom(looper->UserAtom(message));
+	if (user != NULL)
+		return user;
+	return _EnsureUser(message->FindString("user_id"), looper);
 }
 
 
@@ -1018,7 +1374,7 @@ Server::_EnsureConversation(BMessage* message)
 	Conversation* item = NULL;
 
 	if (chat_id.IsEmpty() == false) {
-		item = looper->ConversationById(chat_id);
+		item = looper->ConversationByAtom(looper->ChatAtom(message));
 
 		if (item == NULL) {
 			item = new Conversation(chat_id, Looper());
@@ -1059,14 +1415,6 @@ void
 Server::_SendNotification(BString title, BString content, BString id,
 	BBitmap* icon, notification_type type)
 {
-	BNotification notification(type);
-	notification.SetGroup(BString(APP_NAME));
-	notification.SetTitle(title);
-	if (content.IsEmpty() == false)
-		notification.SetContent(content);
-	if (id.IsEmpty() == false)
-		notification.SetMessageID(id);
-	if (icon != NULL)
-		notification.SetIcon(icon);
-	notification.Send();
+	// The same values
+	AppNotify((app_notification)type, title, content, id, icon);
 }
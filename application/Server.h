@@ -28,6 +28,8 @@ class ProtocolLooper;
 
 class Server: public BMessageFilter, public Notifier {
 public:
+	typedef KeyMap<bigtime_t, ProtocolLooper*> ProtocolLoopers;
+
 							Server();
 	 static	Server*			Get();
 			void			Quit();
@@ -43,36 +45,38 @@ public:
 			void			RemoveProtocolLooper(bigtime_t instanceId);
 			ProtocolLooper*	GetProtocolLooper(bigtime_t instanceId);
 
-			AccountInstances GetAccounts();
+	const	AccountInstances& GetAccounts() const;
 			AccountInstances GetActiveAccounts();
 
 			void			SendProtocolMessage(BMessage* msg);
 			void			SendAllProtocolMessage(BMessage* msg);
 
-			RosterMap		Contacts() const;
+	const	ProtocolLoopers& Loopers() const;
+
 			Contact*		ContactById(BString id, int64 instance);
 			void			AddContact(Contact* contact, int64 instance);
 
-			UserMap			Users() const;
 			User*			UserById(BString id, int64 instance);
 			void			AddUser(User* user, int64 instance);
 
-			ChatMap			Conversations() const;
 			Conversation*	ConversationById(BString id, int64 instance);
 			void			AddConversation(Conversation* chat, int64 instance);
 
-			CommandMap		Commands(int64 instance);
+	const	CommandMap&		Commands() const;
 			ChatCommand*	CommandById(BString id, int64 instance);
 
 			BObjectList<BMessage> UserPopUpItems();
 
 private:
 	typedef KeyMap<BString, bool> BoolMap;
-	typedef KeyMap<bigtime_t, ProtocolLooper*> ProtocolLoopers;
 
 			ProtocolLooper*	_LooperFromMessage(BMessage* message);
+			void			_InboxCounts(ProtocolLooper* looper, BString* out);
+
+			filter_result	_ImBatch(BMessage* msg);
 
 			Contact*		_EnsureContact(BMessage* message);
+			Contact*		_EnsureContact(BString id, ProtocolLooper* looper);
 			User*			_EnsureUser(BMessage* message);
 			User*			_EnsureUser(BString id, ProtocolLooper* protoLooper);
 			Contact*		_GetOwnContact(BMessage* message);
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2009-2011, Pier Luigi Fiorini. All rights reserved.
+ * Copyright 2014, Funky Idea Software
+ * Copyright 2021, Jaidyn Levesque
+ * Distributed under the terms of the MIT License.
+ */
+#include <stdlib.h>
+
+#include <DataIO.h>
+#include <Directory.h>
+#include <FindDirectory.h>
+#include <Message.h>
+#include <Node.h>
+
+#include <kernel/fs_attr.h>
+
+#include "StorageUtils.h"
+
+
+const char*
+SettingsPath()
+{
+	// Kept, so what's returned stays valid
+	static BPath path;
+	if (path.InitCheck() == B_OK)
+		return path.Path();
+
+	BPath settings;
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &settings) != B_OK)
+		return NULL;
+
+	settings.Append(APP_NAME);
+	if (create_directory(settings.Path(), 0755) != B_OK)
+		return NULL;
+	path = settings;
+	return path.Path();
+}
+
+
+BPath
+CachePath()
+{
+	BPath path = SettingsPath();
+	path.Append("Cache/");
+	create_directory(path.Path(), 0755);
+	return path;
+}
+
+
+BPath
+AccountCachePath(const char* accountName)
+{
+	BPath path = CachePath();
+	path.Append("Accounts/");
+	path.Append(accountName);
+	create_directory(path.Path(), 0755);
+	return path;
+}
+
+
+BPath
+RoomsCachePath(const char* accountName)
+{
+	return RoomsCachePath(AccountCachePath(accountName));
+}
+
+
+BPath
+RoomsCachePath(BPath accPath)
+{
+	accPath.Append("Rooms/");
+	create_directory(accPath.Path(), 0755);
+	return accPath;
+}
+
+
+BPath
+RoomCachePath(const char* accountName, const char* roomIdentifier)
+{
+	return RoomCachePath(AccountCachePath(accountName), roomIdentifier);
+}
+
+
+BPath
+RoomCachePath(BPath accPath, const char* roomIdentifier)
+{
+	BPath path = RoomsCachePath(accPath);
+	path.Append(roomIdentifier);
+	return path;
+}
+
+
+BPath
+RoomLogsPath(const char* accountName, const char* roomIdentifier)
+{
+	BPath path = AccountCachePath(accountName);
+	path.Append("Logs/");
+	create_directory(path.Path(), 0755);
+	path.Append(roomIdentifier);
+	create_directory(path.Path(), 0755);
+	return path;
+}
+
+
+BPath
+UserCachePath(const char* accountName, const char* userIdentifier)
+{
+	return UserCachePath(AccountCachePath(accountName), userIdentifier);
+}
+
+
+BPath
+UserCachePath(BPath accPath, const char* userIdentifier)
+{
+	accPath.Append("Users/");
+	create_directory(accPath.Path(), 0755);
+
+	accPath.Append(userIdentifier);
+	return accPath;
+}
+
+
+BPath
+ContactCachePath(const char* accountName, const char* userIdentifier)
+{
+	return ContactCachePath(AccountCachePath(accountName), userIdentifier);
+}
+
+
+BPath
+ContactCachePath(BPath accPath, const char* userIdentifier)
+{
+	accPath.Append("Contacts/");
+	create_directory(accPath.Path(), 0755);
+
+	accPath.Append(userIdentifier);
+	return accPath;
+}
+
+
+BPath
+AddOnCachePath(const char* signature)
+{
+	BPath path = CachePath();
+	path.Append("Add-Ons/");
+	path.Append(signature);
+
+	create_directory(path.Path(), 0755);
+	return path;
+}
+
+
+status_t
+ReadAttributeData(BNode* node, const char* name, char** buffer, int32 *size) {
+		attr_info info;
+		status_t ret = node->GetAttrInfo(name, &info);
+
+		if (ret == B_OK) {
+			*buffer = (char *)calloc(info.size, sizeof(char));
+			ret = node->ReadAttr(name, info.type, 0, *buffer, info.size);
+
+			if (ret > B_OK) {
+				*size = ret;
+				ret = B_OK;
+			}
+			else
+				free(*buffer);
+		}
+
+	return ret;
+}
+
+
+status_t
+WriteAttributeMessage(BNode* node, const char* name, BMessage* data)
+{
+	BMallocIO	malloc;
+	status_t ret=data->Flatten(&malloc);
+
+	if(	ret == B_OK)	{
+		ret = node->WriteAttr(name,B_ANY_TYPE,0,malloc.Buffer(),malloc.BufferLength());
+
+		if(ret > B_OK)
+			ret=B_OK;
+	}
+
+	return ret;
+}
+
+
+status_t
+ReadAttributeMessage(BNode* node, const char* name, BMessage* data)
+{
+	char *buffer = NULL;
+	int32 size = 0;
+
+	status_t ret = ReadAttributeData(node,name,&buffer,&size);
+
+	if(size>0 && buffer!=NULL) {
+		BMemoryIO mem(buffer,size);
+		ret = data->Unflatten(&mem);
+		free(buffer);
+	}
+
+	return ret;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2009-2011, Pier Luigi Fiorini. All rights reserved.
+ * Copyright 2014, Funky Idea Software
+ * Copyright 2021, Jaidyn Levesque
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _STORAGE_UTILS_H
+#define _STORAGE_UTILS_H
+
+// The parts of Utils that need only the Storage Kit, so that libcore has them
+// too: where settings and caches are kept, and messages kept in attributes.
+
+#include <Path.h>
+
+class BMessage;
+class BNode;
+
+
+const char*	SettingsPath();
+
+BPath		CachePath();
+BPath		AccountCachePath(const char* accountName);
+BPath		RoomsCachePath(const char* accountName);
+BPath		RoomsCachePath(BPath accPath);
+BPath		RoomCachePath(const char* accountName, const char* roomIdentifier);
+BPath		RoomCachePath(BPath accPath, const char* roomIdentifier);
+BPath		RoomLogsPath(const char* accountName, const char* roomIdentifier);
+BPath		UserCachePath(const char* accountName, const char* userIdentifier);
+BPath		UserCachePath(BPath accPath, const char* userIdentifier);
+BPath		ContactCachePath(const char* accountName, const char* userIdentifier);
+BPath		ContactCachePath(BPath accPath, const char* userIdentifier);
+BPath		AddOnCachePath(const char* signature);
+
+// Borrowed from BePodder's own libfunky. Groovy B)
+status_t	ReadAttributeData(BNode* node, const char* name, char** buffer, int32 *size);
+status_t	WriteAttributeMessage(BNode* node, const char* name, BMessage* data);
+status_t	ReadAttributeMessage(BNode* node, const char* name, BMessage* data);
+
+#endif	// _STORAGE_UTILS_H
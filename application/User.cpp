@@ -12,6 +12,7 @@
 
 #include <Bitmap.h>
 #include <BitmapStream.h>
+#include <Looper.h>
 #include <TranslationUtils.h>
 #include <TranslatorRoster.h>
 
@@ -29,6 +30,7 @@
 User::User(BString id, BMessenger msgn)
 	:
 	fID(id),
+	fAtom(kNoAtom),
 	fName(id),
 	fMessenger(msgn),
 	fLooper(NULL),
@@ -37,6 +39,17 @@ User::User(BString id, BMessenger msgn)
 	fAvatarBitmap(NULL),
 	fPopUp(NULL)
 {
+	// Status and nick storms (e.g., netsplits) are delivered in batches
+	BLooper* looper = NULL;
+	msgn.Target(&looper);
+	SetCoalescing(looper);
+}
+
+
+User::~User()
+{
+	if (fLooper != NULL)
+		fLooper->Atoms().Release(fAtom);
 }
 
 
@@ -44,7 +57,7 @@ void
 User::RegisterObserver(Conversation* chat)
 {
 	Notifier::RegisterObserver(chat);
-	fConversations.AddItem(chat->GetId(), chat);
+	fConversations.AddItem(chat->GetAtom(), chat);
 }
 
 
@@ -52,7 +65,7 @@ void
 User::UnregisterObserver(Conversation* chat)
 {
 	Notifier::UnregisterObserver(chat);
-	fConversations.RemoveItemFor(chat->GetId());
+	fConversations.RemoveItemFor(chat->GetAtom());
 }
 
 
@@ -98,6 +111,13 @@ User::GetId() const
 }
 
 
+atom_id
+User::GetAtom() const
+{
+	return fAtom;
+}
+
+
 BMessenger
 User::Messenger() const
 {
@@ -164,7 +184,10 @@ void
 User::SetProtocolLooper(ProtocolLooper* looper)
 {
 	if (looper != NULL) {
+		if (fLooper != NULL)
+			fLooper->Atoms().Release(fAtom);
 		fLooper = looper;
+		fAtom = looper->Atoms().Acquire(fID);
 		BBitmap* avatar = _GetCachedAvatar();
 		if (avatar != NULL && avatar->IsValid()) {
 			fAvatarBitmap = avatar;
@@ -215,8 +238,8 @@ User::SetNotifyPersonalStatus(BString personalStatus)
 }
 
 
-ChatMap
-User::Conversations()
+const ChatMap&
+User::Conversations() const
 {
 	return fConversations;
 }
@@ -28,6 +28,7 @@ class UserPopUp;
 class User : public Notifier {
 public:
 					User(BString id, BMessenger msgn);
+	virtual			~User();
 
 	void			RegisterObserver(Conversation* chat);
 	void			RegisterObserver(Observer* obs) { Notifier::RegisterObserver(obs); }
@@ -39,6 +40,7 @@ public:
 	void			HidePopUp();
 
 	BString			GetId() const;
+	atom_id			GetAtom() const;
 
 	BMessenger		Messenger() const;
 	void			SetMessenger(BMessenger messenger);
@@ -57,7 +59,7 @@ public:
 	void			SetNotifyStatus(UserStatus status);
 	void			SetNotifyPersonalStatus(BString personalStatus);
 
-	ChatMap			Conversations();
+	const ChatMap&	Conversations() const;
 
 	rgb_color		fItemColor;
 
@@ -71,6 +73,7 @@ protected:
 	ProtocolLooper*	fLooper;
 
 	BString			fID;
+	atom_id			fAtom;
 	BString			fName;
 	BString			fPersonalStatus;
 	BBitmap*		fAvatarBitmap;
@@ -10,15 +10,12 @@
 #include <Catalog.h>
 #include <InterfaceDefs.h>
 #include <Directory.h>
-#include <FindDirectory.h>
 #include <IconUtils.h>
 #include <Menu.h>
 #include <MenuItem.h>
 #include <Path.h>
 #include <StringList.h>
 
-#include <kernel/fs_attr.h>
-
 #include "Utils.h"
 
 
@@ -104,20 +101,6 @@ ChatResources()
 }
 
 
-const char*
-SettingsPath()
-{
-	BPath path;
-	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) != B_OK)
-		return NULL;
-
-	path.Append(APP_NAME);
-	if (create_directory(path.Path(), 0755) != B_OK)
-		return NULL;
-	return path.Path();
-}
-
-
 const char*
 AccountsPath()
 {
@@ -150,107 +133,6 @@ AccountPath(const char* signature, const char* subsignature)
 }
 
 
-BPath
-CachePath()
-{
-	BPath path = SettingsPath();
-	path.Append("Cache/");
-	create_directory(path.Path(), 0755);
-	return path;
-}
-
-
-BPath
-AccountCachePath(const char* accountName)
-{
-	BPath path = CachePath();
-	path.Append("Accounts/");
-	path.Append(accountName);
-	create_directory(path.Path(), 0755);
-	return path;
-}
-
-
-BPath
-RoomsCachePath(const char* accountName)
-{
-	return RoomsCachePath(AccountCachePath(accountName));
-}
-
-
-BPath
-RoomsCachePath(BPath accPath)
-{
-	accPath.Append("Rooms/");
-	create_directory(accPath.Path(), 0755);
-	return accPath;
-}
-
-
-BPath
-RoomCachePath(const char* accountName, const char* roomIdentifier)
-{
-	return RoomCachePath(AccountCachePath(accountName), roomIdentifier);
-}
-
-
-BPath
-RoomCachePath(BPath accPath, const char* roomIdentifier)
-{
-	BPath path = RoomsCachePath(accPath);
-	path.Append(roomIdentifier);
-	return path;
-}
-
-
-BPath
-UserCachePath(const char* accountName, const char* userIdentifier)
-{
-	return UserCachePath(AccountCachePath(accountName), userIdentifier);
-}
-
-
-BPath
-UserCachePath(BPath accPath, const char* userIdentifier)
-{
-	accPath.Append("Users/");
-	create_directory(accPath.Path(), 0755);
-
-	accPath.Append(userIdentifier);
-	return accPath;
-}
-
-
-BPath
-ContactCachePath(const char* accountName, const char* userIdentifier)
-{
-	return ContactCachePath(AccountCachePath(accountName), userIdentifier);
-}
-
-
-BPath
-ContactCachePath(BPath accPath, const char* userIdentifier)
-{
-	accPath.Append("Contacts/");
-	create_directory(accPath.Path(), 0755);
-
-	accPath.Append(userIdentifier);
-	return accPath;
-}
-
-
-BPath
-AddOnCachePath(const char* signature)
-{
-	BPath path = CachePath();
-	path.Append("Add-Ons/");
-	path.Append(signature);
-
-	create_directory(path.Path(), 0755);
-	return path;
-}
-
-
 rgb_color
 TintColor(rgb_color color, int severity)
 {
@@ -306,62 +188,6 @@ ForegroundColor(rgb_color background)
 }
 
 
-status_t
-ReadAttributeData(BNode* node, const char* name, char** buffer, int32 *size) {
-		attr_info info;
-		status_t ret = node->GetAttrInfo(name, &info);
-
-		if (ret == B_OK) {
-			*buffer = (char *)calloc(info.size, sizeof(char));
-			ret = node->ReadAttr(name, info.type, 0, *buffer, info.size);
-
-			if (ret > B_OK) {
-				*size = ret;
-				ret = B_OK;
-			}
-			else
-				free(*buffer);
-		}
-
-	return ret;
-}
-
-
-status_t
-WriteAttributeMessage(BNode* node, const char* name, BMessage* data)
-{
-	BMallocIO	malloc;
-	status_t ret=data->Flatten(&malloc);
-
-	if(	ret == B_OK)	{
-		ret = node->WriteAttr(name,B_ANY_TYPE,0,malloc.Buffer(),malloc.BufferLength());
-
-		if(ret > B_OK)
-			ret=B_OK;
-	}
-
-	return ret;
-}
-
-
-status_t
-ReadAttributeMessage(BNode* node, const char* name, BMessage* data)
-{
-	char *buffer = NULL;
-	int32 size = 0;
-
-	status_t ret = ReadAttributeData(node,name,&buffer,&size);
-
-	if(size>0 && buffer!=NULL) {
-		BMemoryIO mem(buffer,size);
-		ret = data->Unflatten(&mem);
-		free(buffer);
-	}
-
-	return ret;
-}
-
-
 extern "C" {
 
 status_t
@@ -14,6 +14,7 @@
 #include <Resources.h>
 
 #include "AppConstants.h"
+#include "StorageUtils.h"
 #include "UserStatus.h"
 
 class BMenu;
@@ -31,31 +32,12 @@ BString		CommandArgs(BString line);
 
 BResources ChatResources();
 
-const char*	SettingsPath();
-
 const char*	AccountsPath();
 const char*	AccountPath(const char* signature, const char* subsignature);
 
-BPath		CachePath();
-BPath		AccountCachePath(const char* accountName);
-BPath		RoomsCachePath(const char* accountName);
-BPath		RoomsCachePath(BPath accPath);
-BPath		RoomCachePath(const char* accountName, const char* roomIdentifier);
-BPath		RoomCachePath(BPath accPath, const char* roomIdentifier);
-BPath		UserCachePath(const char* accountName, const char* userIdentifier);
-BPath		UserCachePath(BPath accPath, const char* userIdentifier);
-BPath		ContactCachePath(const char* accountName, const char* userIdentifier);
-BPath		ContactCachePath(BPath accPath, const char* userIdentifier);
-BPath		AddOnCachePath(const char* signature);
-
 rgb_color	TintColor(rgb_color color, int severity);
 rgb_color	ForegroundColor(rgb_color background);
 
-// Borrowed from BePodder's own libfunky. Groovy B)
-status_t	ReadAttributeData(BNode* node, const char* name, char** buffer, int32 *size);
-status_t	WriteAttributeMessage(BNode* node, const char* name, BMessage* data);
-status_t	ReadAttributeMessage(BNode* node, const char* name, BMessage* data);
-
 extern "C" status_t our_image(image_info& image);
 
 
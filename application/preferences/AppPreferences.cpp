@@ -8,6 +8,8 @@
 
 #include <Path.h>
 
+#include "LogWriter.h"
+#include "ProtocolInbox.h"
 #include "Utils.h"
 
 
@@ -50,6 +52,20 @@ AppPreferences::Load()
 	IgnoreEmoticons = settings.GetBool("IgnoreEmoticons", true);
 	HideOffline = settings.GetBool("HideOffline", false);
 
+	EventQueueLimit = settings.GetInt32("EventQueueLimit",
+		kInboxDefaultLimit);
+	ChatQueuePolicy = settings.GetInt32("ChatQueuePolicy", QUEUE_BLOCK);
+	MembershipQueuePolicy = settings.GetInt32("MembershipQueuePolicy",
+		QUEUE_BLOCK);
+	PresenceQueuePolicy = settings.GetInt32("PresenceQueuePolicy", QUEUE_MERGE);
+
+	LogFlushInterval = settings.GetInt32("LogFlushInterval", 250);
+	LogDurability = settings.GetInt32("LogDurability", LOG_BUFFERED);
+	LogRetentionDays = settings.GetInt32("LogRetentionDays", 0);
+
+	HistoryPageSize = settings.GetInt32("HistoryPageSize", 50);
+	HistoryLimit = settings.GetInt32("HistoryLimit", 1000);
+
 	MainWindowListWeight = settings.GetFloat("MainWindowListWeight", 1);
 	MainWindowChatWeight = settings.GetFloat("MainWindowChatWeight", 5);
 
@@ -60,6 +76,7 @@ AppPreferences::Load()
 
 	MainWindowRect = settings.GetRect("MainWindowRect", BRect(0, 0, 600, 400));
 	RoomDirectoryRect = settings.GetRect("RoomDirectoryRect", BRect(0, 0, 630, 330));
+	SearchWindowRect = settings.GetRect("SearchWindowRect", BRect(0, 0, 700, 400));
 }
 
 
@@ -85,6 +102,18 @@ AppPreferences::Save()
 	settings.AddBool("MembershipUpdates", MembershipUpdates);
 	settings.AddBool("HideOffline", HideOffline);
 
+	settings.AddInt32("EventQueueLimit", EventQueueLimit);
+	settings.AddInt32("ChatQueuePolicy", ChatQueuePolicy);
+	settings.AddInt32("MembershipQueuePolicy", MembershipQueuePolicy);
+	settings.AddInt32("PresenceQueuePolicy", PresenceQueuePolicy);
+
+	settings.AddInt32("LogFlushInterval", LogFlushInterval);
+	settings.AddInt32("LogDurability", LogDurability);
+	settings.AddInt32("LogRetentionDays", LogRetentionDays);
+
+	settings.AddInt32("HistoryPageSize", HistoryPageSize);
+	settings.AddInt32("HistoryLimit", HistoryLimit);
+
 	settings.AddFloat("MainWindowListWeight", MainWindowListWeight);
 	settings.AddFloat("MainWindowChatWeight", MainWindowChatWeight);
 
@@ -95,6 +124,7 @@ AppPreferences::Save()
 
 	settings.AddRect("MainWindowRect", MainWindowRect);
 	settings.AddRect("RoomDirectoryRect", RoomDirectoryRect);
+	settings.AddRect("SearchWindowRect", SearchWindowRect);
 
 	if (file.InitCheck() == B_OK)
 		settings.Flatten(&file);
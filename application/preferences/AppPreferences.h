@@ -37,6 +37,23 @@ public:
 			
 			bool	HideOffline;
 
+			// Per account, see ProtocolInbox
+			int32	EventQueueLimit;
+			int32	ChatQueuePolicy;
+			int32	MembershipQueuePolicy;
+			int32	PresenceQueuePolicy;
+
+			// See LogWriter
+			int32	LogFlushInterval;
+			int32	LogDurability;
+			// Days archived logs are kept, or 0 for good
+			int32	LogRetentionDays;
+
+			// Messages per page of a conversation's history, and at most how
+			// many stay loaded (its scrollback), whether from history or not
+			int32	HistoryPageSize;
+			int32	HistoryLimit;
+
 			float	MainWindowListWeight;
 			float	MainWindowChatWeight;
 
@@ -47,6 +64,7 @@ public:
 
 			BRect	MainWindowRect;
 			BRect	RoomDirectoryRect;
+			BRect	SearchWindowRect;
 
 private:
 	 const char*	_PreferencesPath();
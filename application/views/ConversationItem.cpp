@@ -21,8 +21,10 @@ ConversationItem::ConversationItem(const char* name, Conversation* chat)
 	:
 	BStringItem(name),
 	fChat(chat),
-	fStatus(0)
+	fStatus(0),
+	fIsRoom(false)
 {
+	UpdateSortKey();
 }
 
 
@@ -48,6 +50,30 @@ ConversationItem::GetConversation()
 }
 
 
+int
+ConversationItem::Compare(const ConversationItem* other) const
+{
+	if (fIsRoom != other->fIsRoom)
+		return fIsRoom ? 1 : -1;
+	return fSortName.Compare(other->fSortName);
+}
+
+
+bool
+ConversationItem::UpdateSortKey()
+{
+	bool isRoom = fChat->Users().CountItems() > 2;
+	BString sortName = fChat->GetName();
+	sortName.ToLower();
+
+	if (isRoom == fIsRoom && sortName == fSortName)
+		return false;
+	fIsRoom = isRoom;
+	fSortName = sortName;
+	return true;
+}
+
+
 void 
 ConversationItem::ObserveString(int32 what, BString str)
 {
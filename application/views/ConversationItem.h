@@ -20,12 +20,21 @@ public:
 
 	Conversation*	GetConversation();
 
+			// Ordering among an account's conversations: one-on-one chats
+			// before rooms, then by case-folded name.
+			int		Compare(const ConversationItem* other) const;
+			// Recompute the cached sort key, true if it changed
+			bool	UpdateSortKey();
+
 			void	ObserveString(int32 what, BString str);
 			void	ObserveInteger(int32 what, int32 num);
 
 private:
 	Conversation* fChat;
 	int8 fStatus;
+
+	bool fIsRoom;
+	BString fSortName;
 };
 
 #endif // _CONVERSATION_ITEM_H
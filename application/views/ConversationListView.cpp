@@ -29,42 +29,9 @@ const uint32 kOpenSelectedChat = 'CVos';
 const uint32 kLeaveSelectedChat = 'CVcs';
 
 
-static int
-compare_by_name(const BListItem* _item1, const BListItem* _item2)
-{
-	ConversationItem* item1 = (ConversationItem*)_item1;
-	ConversationItem* item2 = (ConversationItem*)_item2;
-
-	return strcasecmp(item1->GetConversation()->GetName().String(),
-		item2->GetConversation()->GetName().String());
-}
-
-
-static int
-compare_conversations(const BListItem* _item1, const BListItem* _item2)
-{
-	ConversationItem* item1 = (ConversationItem*)_item1;
-	ConversationItem* item2 = (ConversationItem*)_item2;
-
-	int32 userCount1 = item1->GetConversation()->Users().CountItems();
-	int32 userCount2 = item2->GetConversation()->Users().CountItems();
-
-	// Sort by name among chats/rooms
-	if ((userCount1 <= 2 && userCount2 <= 2) 
-			|| (userCount1 > 2 && userCount2 > 2))
-		return compare_by_name(item1, item2);
-
-	// One-on-one chats should sort above rooms
-	if (userCount1 <=2 && userCount2 > 2)
-		return -1;
-	if (userCount1 > 2 && userCount2 <= 2)
-		return 1;
-	return 0;
-}
-
-
 ConversationListView::ConversationListView(const char* name)
-	: BOutlineListView(name)
+	: BOutlineListView(name),
+	fMovingItem(false)
 {
 }
 
@@ -126,6 +93,9 @@ ConversationListView::MouseDown(BPoint where)
 void
 ConversationListView::SelectionChanged()
 {
+	// An item being repositioned is only briefly out of the list
+	if (fMovingItem == true)
+		return;
 	MessageReceived(new BMessage(kOpenSelectedChat));
 }
 
@@ -152,8 +122,8 @@ ConversationListView::AddConversation(Conversation* chat)
 	if (superItem == NULL || item == NULL)
 		return;
 
-	AddUnder(item, superItem);
-	SortItemsUnder(superItem, true, compare_conversations);
+	item->UpdateSortKey();
+	_InsertSorted(item, superItem);
 }
 
 
@@ -197,7 +167,28 @@ void
 ConversationListView::SortConversation(Conversation* chat)
 {
 	ConversationAccountItem* superItem = _EnsureAccountItem(chat);
-	SortItemsUnder(superItem, true, compare_conversations);
+	ConversationItem* item = chat->GetListItem();
+	if (superItem == NULL || item == NULL || item->UpdateSortKey() == false)
+		return;
+
+	int32 index = FullListIndexOf(item);
+	if (index < 0)
+		return;
+
+	// Only move the item if it's fallen out of order with its neighbours
+	ConversationItem* prev = _SiblingAt(superItem, index - 1);
+	ConversationItem* next = _SiblingAt(superItem, index + 1);
+	if ((prev == NULL || prev->Compare(item) <= 0)
+			&& (next == NULL || item->Compare(next) <= 0))
+		return;
+
+	bool selected = item->IsSelected();
+	fMovingItem = true;
+	RemoveItem(item);
+	_InsertSorted(item, superItem);
+	if (selected == true)
+		Select(IndexOf(item));
+	fMovingItem = false;
 }
 
 
@@ -280,6 +271,7 @@ ConversationListView::_AddDefaultItems(BPopUpMenu* menu,
 	BMenuItem* item;
 	add_flag_item(B_TRANSLATE("Auto-join room"), ROOM_AUTOJOIN);
 	add_flag_item(B_TRANSLATE("Log messages"), ROOM_LOG_LOCALLY);
+	add_flag_item(B_TRANSLATE("Keep all logs"), ROOM_KEEP_LOGS);
 	add_flag_item(B_TRANSLATE("Notify on every message"), ROOM_NOTIFY_ALL);
 	add_flag_item(B_TRANSLATE("Notify on direct-messages"), ROOM_NOTIFY_DM);
 
@@ -315,6 +307,42 @@ ConversationListView::_BlankPopUp()
 }
 
 
+void
+ConversationListView::_InsertSorted(ConversationItem* item,
+	ConversationAccountItem* superItem)
+{
+	// An account's conversations are its only sub-items, so they sit
+	// contiguously right after it in the full list
+	int32 first = FullListIndexOf(superItem) + 1;
+	int32 low = 0;
+	int32 high = CountItemsUnder(superItem, true);
+
+	while (low < high) {
+		int32 mid = (low + high) / 2;
+		ConversationItem* check = (ConversationItem*)FullListItemAt(first + mid);
+		if (check->Compare(item) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	item->SetOutlineLevel(superItem->OutlineLevel() + 1);
+	AddItem(item, first + low);
+}
+
+
+ConversationItem*
+ConversationListView::_SiblingAt(ConversationAccountItem* superItem,
+	int32 fullListIndex)
+{
+	BListItem* item = FullListItemAt(fullListIndex);
+	if (item == NULL || item == superItem
+			|| item->OutlineLevel() != superItem->OutlineLevel() + 1)
+		return NULL;
+	return dynamic_cast<ConversationItem*>(item);
+}
+
+
 ConversationAccountItem*
 ConversationListView::_EnsureAccountItem(Conversation* chat)
 {
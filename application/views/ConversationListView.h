@@ -10,6 +10,7 @@
 class BPopUpMenu;
 class Conversation;
 class ConversationAccountItem;
+class ConversationItem;
 
 
 class ConversationListView : public BOutlineListView {
@@ -36,6 +37,15 @@ private:
 
 	ConversationAccountItem*
 					_EnsureAccountItem(Conversation* chat);
+
+			// Binary-search insertion among the account's conversations
+			void	_InsertSorted(ConversationItem* item,
+						ConversationAccountItem* superItem);
+	ConversationItem*
+					_SiblingAt(ConversationAccountItem* superItem,
+						int32 fullListIndex);
+
+			bool	fMovingItem;
 };
 
 #endif // _CONVERSATION_LIST_H
@@ -26,6 +26,7 @@
 #include "ChatProtocolMessages.h"
 #include "Contact.h"
 #include "Conversation.h"
+#include "Flags.h"
 #include "NotifyMessage.h"
 #include "ProtocolLooper.h"
 #include "ProtocolManager.h"
@@ -40,11 +41,24 @@
 #define B_TRANSLATION_CONTEXT "ConversationView"
 
 
+const uint32 kHistoryRead = 'CVhr';
+const uint32 kQueuedEvent = 'CVqe';
+
+
 ConversationView::ConversationView(Conversation* chat)
 	:
 	BGroupView("chatView", B_VERTICAL, B_USE_DEFAULT_SPACING),
 	fMessageQueue(),
-	fConversation(chat)
+	fEventQueue(20, true),
+	fConversation(chat),
+	fHistoryCount(0),
+	fHistoryStart(true),
+	fHistoryRead(false),
+	fHistoryRequest(0),
+	fHistoryPending(false),
+	fLinesFirst(0),
+	fLinesLogged(0),
+	fLinesTrimmed(false)
 {
 	_InitInterface();
 	if (chat != NULL) {
@@ -59,6 +73,14 @@ ConversationView::ConversationView(Conversation* chat)
 void
 ConversationView::AttachedToWindow()
 {
+	// Just the latest page, older ones are read as the view scrolls up. Any
+	// reply sent while detached was lost, so it's asked for again.
+	if (fConversation != NULL && fHistoryRead == false
+			&& (fConversation->GetFlags() & ROOM_POPULATE_LOGS))
+		_RequestHistory();
+	else
+		fHistoryPending = false;
+
 	while (fMessageQueue.IsEmpty() == false) {
 		BMessage* msg = fMessageQueue.RemoveItemAt(0);
 		MessageReceived(msg);
@@ -108,6 +130,23 @@ ConversationView::MessageReceived(BMessage* message)
 		case kClearText:
 			_AppendOrEnqueueMessage(message);
 			break;
+		case kQueuedEvent:
+		{
+			ChatEvent* event = fEventQueue.RemoveItemAt(0);
+			if (event != NULL)
+				ImEvent(*event);
+			delete event;
+			break;
+		}
+		case kRenderReachedTop:
+			_LoadOlderHistory();
+			break;
+		case kHistoryRead:
+			_HistoryRead(message);
+			break;
+		case kRenderReachedBottom:
+			_TrimScrollback();
+			break;
 		case IM_MESSAGE:
 			ImMessage(message);
 			break;
@@ -132,17 +171,15 @@ ConversationView::ImMessage(BMessage* msg)
 			break;
 		}
 		case IM_MESSAGE_RECEIVED:
+		case IM_MESSAGE_SENT:
 		{
-			_AppendOrEnqueueMessage(msg);
-			_ScrollToBottom();
+			ImEvent(ChatEvent(msg));
 			break;
 		}
-		case IM_MESSAGE_SENT:
 		case IM_LOGS_RECEIVED:
 		{
+			// The protocol's own, as ours come with a kHistoryRead
 			_AppendOrEnqueueMessage(msg);
-			if (im_what == IM_MESSAGE_SENT)
-				_ScrollToBottom();
 			break;
 		}
 		case IM_ROOM_PARTICIPANT_JOINED:
@@ -177,6 +214,7 @@ ConversationView::ImMessage(BMessage* msg)
 		case IM_ROOM_ROLECHANGED:
 		{
 			BString user_id = msg->FindString("user_id");
+			fUserList->UpdateUser(fConversation->UserById(user_id));
 
 			if (user_id == fConversation->GetOwnContact()->GetId()) {
 				Role* role = fConversation->GetRole(user_id);
@@ -207,6 +245,15 @@ ConversationView::ImMessage(BMessage* msg)
 }
 
 
+bool
+ConversationView::ImEvent(const ChatEvent& event)
+{
+	bool appended = _AppendOrEnqueueEvent(event);
+	_ScrollToBottom();
+	return appended;
+}
+
+
 Conversation*
 ConversationView::GetConversation()
 {
@@ -240,16 +287,30 @@ ConversationView::SetConversation(Conversation* chat)
 
 
 void
-ConversationView::UpdateUserList(UserMap users)
-{
-	fUserList->MakeEmpty();
-	for (int i = 0; i < users.CountItems(); i++) {
-		User* user = users.ValueAt(i);
-		if (fUserList->HasUser(user) == false) {
-			fUserList->AddUser(user);
-			fUserList->Sort();
-		}
-	}
+ConversationView::AddUser(User* user)
+{
+	fUserList->AddUser(user);
+}
+
+
+void
+ConversationView::AddUsers(const BObjectList<User>& users)
+{
+	fUserList->AddUsers(users);
+}
+
+
+void
+ConversationView::RemoveUser(User* user)
+{
+	fUserList->RemoveUser(user);
+}
+
+
+void
+ConversationView::InvalidateUser(User* user)
+{
+	fUserList->InvalidateUser(user);
 }
 
 
@@ -278,9 +339,9 @@ ConversationView::ObserveString(int32 what, BString str)
 			BString body = B_TRANSLATE("** The subject is now: %subject%");
 			body.ReplaceAll("%subject%", str);
 
-			BMessage topic(IM_MESSAGE);
-			topic.AddString("body", body);
-			_AppendOrEnqueueMessage(&topic);
+			ChatEvent topic;
+			topic.fBody = body;
+			_AppendOrEnqueueEvent(topic);
 			break;
 		}
 	}
@@ -328,6 +389,7 @@ void
 ConversationView::_InitInterface()
 {
 	fReceiveView = new RenderView("receiveView");
+	fReceiveView->SetEdgeTarget(this);
 	BScrollView* scrollViewReceive = new BScrollView("receiveScrollView",
 		fReceiveView, B_WILL_DRAW, false, true, B_NO_BORDER);
 
@@ -384,26 +446,6 @@ ConversationView::_InitInterface()
 bool
 ConversationView::_AppendOrEnqueueMessage(BMessage* msg)
 {
-	// Fill the message with user information not provided by protocol
-	BString user_id = msg->FindString("user_id");
-	if (msg->FindString("user_id", &user_id) == B_OK) {
-		User* user = NULL;
-		if (fConversation != NULL)
-			user = fConversation->UserById(user_id);
-		if (user != NULL) {
-			if (msg->HasString("user_name") == false)
-				if (user->GetName().IsEmpty() == false)
-					msg->AddString("user_name", user->GetName());
-			msg->AddColor("user_color", user->fItemColor);
-		}
-		if (msg->HasString("user_name") == false)
-			msg->AddString("user_name", user_id);
-	}
-
-	// Fill the message with receive time if not provided
-	if (msg->HasInt64("when") == false)
-		msg->AddInt64("when", (int64)time(NULL));
-
 	// If not attached to a chat window, then re-handle this message
 	// later [AttachedToWindow()], since you can't edit an unattached 
 	// RenderView.
@@ -421,28 +463,102 @@ ConversationView::_AppendOrEnqueueMessage(BMessage* msg)
 		return false;
 	}
 
-	// Alright, we're good to append!
-	_AppendMessage(msg);
-	return true;
+	// If ordered to clear buffer… well, I guess we can't refuse
+	if (msg->what == kClearText) {
+		fReceiveView->SetText("");
+		fHistory.MakeEmpty();
+		fHistoryCount = 0;
+		fHistoryStart = true;
+		fHistoryRead = true;
+		fHistoryPending = false;
+		fHistoryLive.MakeEmpty();
+		fLines.MakeEmpty();
+		fLinesFirst = 0;
+		fLinesLogged = 0;
+		fLinesTrimmed = false;
+		return true;
+	}
+
+	return _AppendOrEnqueueEvent(ChatEvent(msg));
 }
 
 
-void
-ConversationView::_AppendMessage(BMessage* msg)
+bool
+ConversationView::_AppendOrEnqueueEvent(const ChatEvent& event)
 {
-	// If ordered to clear buffer… well, I guess we can't refuse
-	if (msg->what == kClearText) {
-		fReceiveView->SetText("");
-		return;
+	// Fill in user information not provided by protocol
+	BString user_name = event.fUserName;
+	rgb_color userColor = ui_color(B_PANEL_TEXT_COLOR);
+	if (event.fFlags & CHAT_EVENT_USER_COLOR)
+		userColor = event.fUserColor;
+
+	if (event.fUserId.IsEmpty() == false) {
+		User* user = NULL;
+		if (fConversation != NULL)
+			user = fConversation->UserById(event.fUserId);
+		if (user != NULL) {
+			if (user_name.IsEmpty() == true)
+				user_name = user->GetName();
+			userColor = user->fItemColor;
+		}
+		if (user_name.IsEmpty() == true)
+			user_name = event.fUserId;
 	}
 
-	// Otherwise, it's message time!
-	int64 timeInt = msg->GetInt64("when", time(NULL));
-	BString user_name = msg->FindString("user_name");
-	rgb_color userColor = msg->GetColor("user_color", ui_color(B_PANEL_TEXT_COLOR));
-	BString body;
+	int64 when = event.fWhen;
+	if (when == 0)
+		when = (int64)time(NULL);
 
-	if (msg->FindString("body", &body) != B_OK)
+	// Queued as it is, and shown in its turn among the queued messages
+	if (Window() == NULL) {
+		ChatEvent* queued = new ChatEvent(event);
+		queued->fUserName = user_name;
+		queued->fWhen = when;
+		if (event.fUserId.IsEmpty() == false)
+			queued->SetUserColor(userColor);
+
+		fEventQueue.AddItem(queued);
+		fMessageQueue.AddItem(new BMessage(kQueuedEvent));
+		return false;
+	}
+
+	if (fReceiveView->IsPrepending() == true) {
+		_AppendEvent(event, user_name, userColor, when);
+		return true;
+	}
+
+	bool following = fReceiveView->IsAtBottom();
+	int32 length = fReceiveView->TextLength();
+	_AppendEvent(event, user_name, userColor, when);
+
+	// Kept track of even if nothing was shown, as it's still in the log
+	scrollback_line line;
+	line.length = fReceiveView->TextLength() - length;
+	line.logged = (event.fWhat == IM_MESSAGE_RECEIVED
+		|| event.fWhat == IM_MESSAGE_SENT);
+	fLines.AddItem(line);
+	if (line.logged == true)
+		fLinesLogged++;
+	if (line.logged == true && fHistoryRead == false
+			&& (int32)fHistoryLive.CountItems()
+				< AppPreferences::Get()->HistoryPageSize)
+		fHistoryLive.AddItem(event);
+
+	// Left be while scrolled up, unless it's really getting out of hand
+	int32 shown = fHistoryCount + fLines.CountItems() - fLinesFirst;
+	if (following == true
+			|| shown > AppPreferences::Get()->HistoryLimit * 2)
+		_TrimScrollback();
+	return true;
+}
+
+
+void
+ConversationView::_AppendEvent(const ChatEvent& event, const BString& user_name,
+	rgb_color userColor, int64 timeInt)
+{
+	BString body = event.fBody;
+	if (body.IsEmpty() == true)
 		return;
 
 	if (user_name.IsEmpty() == true) {
@@ -470,9 +586,9 @@ ConversationView::_AppendMessage(BMessage* msg)
 
 	BFont font;
 	for (int i = 0; i < body.CountChars(); i++) {
-		_DisableEndingFaces(msg, i, &face, &face_indices);
-		_EnableStartingFaces(msg, i, &face, &face_indices, &next);
-		_EnableStartingColor(msg, i, &color, &colorIndice, &next);
+		_DisableEndingFaces(i, &face, &face_indices);
+		_EnableStartingFaces(event, i, &face, &face_indices, &next);
+		_EnableStartingColor(event, i, &color, &colorIndice, &next);
 
 		if (face == B_REGULAR_FACE) {
 			font = BFont();
@@ -524,30 +640,175 @@ ConversationView::_ScrollToBottom()
 
 
 void
-ConversationView::_EnableStartingFaces(BMessage* msg, int32 index, uint16* face,
-	UInt16IntMap* indices, int32* next)
+ConversationView::_RequestHistory(const log_position* before, int32 skip)
+{
+	BMessage reply(kHistoryRead);
+	reply.AddInt32("request", ++fHistoryRequest);
+	reply.AddBool("latest", before == NULL && skip == 0);
+	fHistoryPending = true;
+	if (fHistoryRead == false)
+		fHistoryLive.MakeEmpty();
+	fConversation->ReadLogs(BMessenger(this), reply, before, skip);
+}
+
+
+void
+ConversationView::_HistoryRead(BMessage* reply)
 {
-	int32 face_start;
-	int32 face_length;
-	uint16 newFace;
+	// One asked for before the view was trimmed or cleared is out of place
+	if (reply->GetInt32("request", -1) != fHistoryRequest
+			|| fHistoryPending == false)
+		return;
+	fHistoryPending = false;
+
+	bool latest = reply->GetBool("latest", false);
+	BMessage logs;
+	if (reply->FindMessage("logs", &logs) == B_OK)
+		_PrependHistory(&logs, latest);
+	if (latest == true) {
+		fHistoryRead = true;
+		fHistoryLive.MakeEmpty();
+	}
+}
+
+
+void
+ConversationView::_PrependHistory(BMessage* logs, bool latest)
+{
+	history_page page;
+	bool start = true;
+	if (ChatLog::FindPosition(logs, &page.first, &start) != B_OK)
+		return;
+
+	// Each is still as it was in the log, and only unflattened here
+	List<ChatEvent> events;
+	const void* data = NULL;
+	ssize_t size = 0;
+	for (int32 i = 0; logs->FindData(kChatEventField, kChatEventType, i,
+			&data, &size) == B_OK; i++) {
+		ChatEvent event;
+		if (event.Unflatten(data, size) == B_OK)
+			events.AddItem(event);
+	}
+
+	// The latest page ends with those shown since it was asked for, if any
+	// were logged before it was read
+	uint32 count = events.CountItems();
+	if (latest == true) {
+		uint32 overlap = min_c(count, fHistoryLive.CountItems());
+		for (; overlap > 0; overlap--) {
+			bool same = true;
+			for (uint32 i = 0; i < overlap && same == true; i++) {
+				const ChatEvent& logged = events.ItemAt(count - overlap + i);
+				const ChatEvent& shown = fHistoryLive.ItemAt(i);
+				same = logged.fWhen == shown.fWhen
+					&& logged.fUserId == shown.fUserId
+					&& logged.fBody == shown.fBody;
+			}
+			if (same == true)
+				break;
+		}
+		count -= overlap;
+	}
+
+	fReceiveView->BeginHistory();
+	for (page.count = 0; page.count < (int32)count; page.count++)
+		_AppendOrEnqueueEvent(events.ItemAt(page.count));
+	page.length = fReceiveView->EndHistory();
+
+	fHistory.AddItem(page);
+	fHistoryCount += page.count;
+	fHistoryStart = start;
+}
+
+
+void
+ConversationView::_LoadOlderHistory()
+{
+	if (fConversation == NULL || fHistoryStart == true
+			|| fHistoryPending == true)
+		return;
+
+	// Paged back from the oldest page, or else the oldest message shown
+	if (fHistory.IsEmpty() == false)
+		_RequestHistory(&fHistory.ItemAt(fHistory.CountItems() - 1).first);
+	else if (fLinesTrimmed == true)
+		_RequestHistory(NULL, fLinesLogged);
+}
+
+
+void
+ConversationView::_TrimScrollback()
+{
+	int32 limit = AppPreferences::Get()->HistoryLimit;
+	int32 shown = fHistoryCount + fLines.CountItems() - fLinesFirst;
+
+	// A chunk at a time, rather than a message with every new one
+	if (shown <= limit + limit / 4)
+		return;
+
+	int32 length = 0;
+	while (shown > limit) {
+		// The last page is kept if it's all there is, to page back from
+		if (fHistory.IsEmpty() == false && (fHistory.CountItems() > 1
+				|| fLinesFirst < fLines.CountItems())) {
+			uint32 oldest = fHistory.CountItems() - 1;
+			length += fHistory.ItemAt(oldest).length;
+			shown -= fHistory.ItemAt(oldest).count;
+			fHistoryCount -= fHistory.ItemAt(oldest).count;
+			fHistory.RemoveItemAt(oldest);
+		}
+		else if (fHistory.IsEmpty() == true
+				&& fLinesFirst < fLines.CountItems()) {
+			const scrollback_line& line = fLines.ItemAt(fLinesFirst++);
+			length += line.length;
+			if (line.logged == true)
+				fLinesLogged--;
+			fLinesTrimmed = true;
+			shown--;
+		}
+		else
+			break;
+		fHistoryStart = false;
+
+		// A page on its way would no longer fit, nor would the latest
+		if (fHistoryPending == true) {
+			fHistoryPending = false;
+			fHistoryRequest++;
+		}
+		fHistoryRead = true;
+		fHistoryLive.MakeEmpty();
+	}
+
+	// The ring's front is let go of once it's half the list
+	if (fLinesFirst > fLines.CountItems() / 2) {
+		List<scrollback_line> lines;
+		for (uint32 i = fLinesFirst; i < fLines.CountItems(); i++)
+			lines.AddItem(fLines.ItemAt(i));
+		fLines = lines;
+		fLinesFirst = 0;
+	}
+
+	fReceiveView->DeleteFirst(length);
+}
+
+
+void
+ConversationView::_EnableStartingFaces(const ChatEvent& event, int32 index,
+	uint16* face, UInt16IntMap* indices, int32* next)
+{
+	for (uint32 i = 0; i < event.fFaces.CountItems(); i++) {
+		const face_span& span = event.fFaces.ItemAt(i);
 
-	int32 i = 0;
-	while (msg->FindInt32("face_start", i, &face_start) == B_OK) {
 		// Change 'next' value for new fonts
-		if (face_start > index && face_start < *next)
-			*next = face_start;
+		if (span.start > index && span.start < *next)
+			*next = span.start;
 
 		// Set face normally
-		if (face_start == index) {
-			if (msg->FindInt32("face_length", i, &face_length) != B_OK)
-				continue;
-			if (msg->FindUInt16("face", i, &newFace) != B_OK)
-				continue;
-
-			*face |= newFace;
-			indices->AddItem(newFace, index + face_length);
+		if (span.start == index) {
+			*face |= span.face;
+			indices->AddItem(span.face, index + span.length);
 		}
-		i++;
 	}
 
 	// Change 'next' for ending old fonts
@@ -560,7 +821,7 @@ ConversationView::_EnableStartingFaces(BMessage* msg, int32 index, uint16* face,
 
 
 void
-ConversationView::_DisableEndingFaces(BMessage* msg, int32 index, uint16* face,
+ConversationView::_DisableEndingFaces(int32 index, uint16* face,
 	UInt16IntMap* indices)
 {
 	for (int32 i = 0; i < indices->CountItems(); i++) {
@@ -578,26 +839,21 @@ ConversationView::_DisableEndingFaces(BMessage* msg, int32 index, uint16* face,
 
 
 void
-ConversationView::_EnableStartingColor(BMessage* msg, int32 index,
+ConversationView::_EnableStartingColor(const ChatEvent& event, int32 index,
 	rgb_color* color, int32* indice, int32* next)
 {
-	rgb_color newColor;
-	int32 color_start, color_length, i = 0;
-	while (msg->FindInt32("color_start", i, &color_start) == B_OK) {
-		if (color_start > index && color_start < *next)
-			*next = color_start - 1;
-
-		if (color_start == index
-				&& msg->FindInt32("color_length", i, &color_length) == B_OK
-				&& msg->FindColor("color", i, &newColor) == B_OK)
-		{
-			*indice = color_length + index;
-			*color = newColor;
+	for (uint32 i = 0; i < event.fColors.CountItems(); i++) {
+		const color_span& span = event.fColors.ItemAt(i);
+		if (span.start > index && span.start < *next)
+			*next = span.start - 1;
+
+		if (span.start == index) {
+			*indice = span.length + index;
+			*color = span.color;
 			if (*indice > index && (*indice < *next || *next < index))
 				*next = *indice;
 			break;
 		}
-		i++;
 	}
 }
 
@@ -624,9 +880,9 @@ ConversationView::_UserMessage(const char* format, const char* bodyFormat,
 	}
 	newBody.ReplaceAll("%user%", user_name.String());
 
-	BMessage newMsg;
-	newMsg.AddString("body", newBody);
-	_AppendOrEnqueueMessage(&newMsg);
+	ChatEvent event;
+	event.fBody = newBody;
+	_AppendOrEnqueueEvent(event);
 	_ScrollToBottom();
 }
 
@@ -643,11 +899,11 @@ ConversationView::_FakeChat()
 	fNameTextView->SetText(name);
 	fSubjectTextView->SetText(B_TRANSLATE("No accounts enabled, no joy."));
 
-	BMessage obsv(IM_MESSAGE);
-	obsv.AddInt32("im_what", IM_MESSAGE_RECEIVED);
-	obsv.AddString("user_name", B_TRANSLATE("Master Foo"));
-	obsv.AddString("body", B_TRANSLATE("It looks like you don't have any accounts enabled."));
-	_AppendOrEnqueueMessage(&obsv);
+	ChatEvent obsv;
+	obsv.fWhat = IM_MESSAGE_RECEIVED;
+	obsv.fUserName = B_TRANSLATE("Master Foo");
+	obsv.fBody = B_TRANSLATE("It looks like you don't have any accounts enabled.");
+	_AppendOrEnqueueEvent(obsv);
 
 	BString body = B_TRANSLATE("Manage accounts through the %menu% menu to get started.");
 	BString menu = B_TRANSLATE("Accounts");
@@ -655,14 +911,12 @@ ConversationView::_FakeChat()
 	int32 boldLength = menu.CountChars();
 	body.ReplaceAll("%menu%", menu);
 
-	BMessage add(IM_MESSAGE);
-	add.AddInt32("im_what", IM_MESSAGE_RECEIVED);
-	add.AddString("user_name", B_TRANSLATE("Master Foo"));
-	add.AddString("body", body);
-	add.AddInt32("face_start", boldStart);
-	add.AddInt32("face_length", boldLength);
-	add.AddUInt16("face", B_BOLD_FACE);
-	_AppendOrEnqueueMessage(&add);
+	ChatEvent add;
+	add.fWhat = IM_MESSAGE_RECEIVED;
+	add.fUserName = B_TRANSLATE("Master Foo");
+	add.fBody = body;
+	add.AddFace(boldStart, boldLength, B_BOLD_FACE);
+	_AppendOrEnqueueEvent(add);
 
 	body = B_TRANSLATE("Afterward, you can join a room or start a chat through the %menu% menu. :-)");
 	menu = B_TRANSLATE("Chat");
@@ -670,12 +924,10 @@ ConversationView::_FakeChat()
 	boldLength = menu.CountChars();
 	body.ReplaceAll("%menu%", menu);
 
-	BMessage welcome(IM_MESSAGE);
-	welcome.AddInt32("im_what", IM_MESSAGE_RECEIVED);
-	welcome.AddString("user_name", B_TRANSLATE("Master Foo"));
-	welcome.AddString("body", body);
-	welcome.AddInt32("face_start", boldStart);
-	welcome.AddInt32("face_length", boldLength);
-	welcome.AddUInt16("face", B_BOLD_FACE);
-	_AppendOrEnqueueMessage(&welcome);
+	ChatEvent welcome;
+	welcome.fWhat = IM_MESSAGE_RECEIVED;
+	welcome.fUserName = B_TRANSLATE("Master Foo");
+	welcome.fBody = body;
+	welcome.AddFace(boldStart, boldLength, B_BOLD_FACE);
+	_AppendOrEnqueueEvent(welcome);
 }
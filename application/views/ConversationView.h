@@ -10,6 +10,8 @@
 #include <ObjectList.h>
 
 #include "AppConstants.h"
+#include "ChatEvent.h"
+#include "ChatLog.h"
 #include "Conversation.h"
 #include "Observer.h"
 
@@ -36,11 +38,17 @@ public:
 
 	virtual	void		MessageReceived(BMessage* message);
 			void		ImMessage(BMessage* msg);
+			// Chat messages, already parsed; false if held until attached
+			bool		ImEvent(const ChatEvent& event);
 
 			Conversation* GetConversation();
 			void		SetConversation(Conversation* chat);
 
-			void		UpdateUserList(UserMap users);
+			// User list deltas
+			void		AddUser(User* user);
+			void		AddUsers(const BObjectList<User>& users);
+			void		RemoveUser(User* user);
+			void		InvalidateUser(User* user);
 			void		InvalidateUserList();
 
 			void		ObserveString(int32 what, BString str);
@@ -54,20 +62,49 @@ public:
 private:
 	typedef KeyMap<uint16, int32> UInt16IntMap;
 
+	// A page of history read from the room's ChatLog
+	struct history_page {
+		int32			length;		// Of its text
+		int32			count;
+		log_position	first;
+	};
+
+	// A message appended as it came, rather than from the log
+	struct scrollback_line {
+		int32			length;		// Of its text
+		bool			logged;
+	};
+
 			void		_InitInterface();
 
 			bool		_AppendOrEnqueueMessage(BMessage* msg);
-			void		_AppendMessage(BMessage* msg);
+			bool		_AppendOrEnqueueEvent(const ChatEvent& event);
+			void		_AppendEvent(const ChatEvent& event,
+							const BString& user_name, rgb_color userColor,
+							int64 timeInt);
 
 			void		_ScrollToBottom();
 
-			// Helper functions for _AppendFormattedMessage()
-			void		_EnableStartingFaces(BMessage* msg, int32 index,
-							uint16* face, UInt16IntMap* indices, int32* next);
-			void		_DisableEndingFaces(BMessage* msg, int32 index,
-							uint16* face, UInt16IntMap* indices);
-			void		_EnableStartingColor(BMessage* msg, int32 index,
-							rgb_color* color, int32* indice, int32* next);
+			// Asks the LogWriter for a page, replied to with a kHistoryRead
+			void		_RequestHistory(const log_position* before = NULL,
+							int32 skip = 0);
+			void		_HistoryRead(BMessage* reply);
+			// Older messages, put above the rest
+			void		_PrependHistory(BMessage* logs, bool latest);
+			void		_LoadOlderHistory();
+			// Drops the oldest pages, then messages, once well past
+			// AppPreferences::HistoryLimit
+			void		_TrimScrollback();
+
+			// Helper functions for _AppendEvent()
+			void		_EnableStartingFaces(const ChatEvent& event,
+							int32 index, uint16* face, UInt16IntMap* indices,
+							int32* next);
+			void		_DisableEndingFaces(int32 index, uint16* face,
+							UInt16IntMap* indices);
+			void		_EnableStartingColor(const ChatEvent& event,
+							int32 index, rgb_color* color, int32* indice,
+							int32* next);
 
 			void		_UserMessage(const char* format, const char* bodyFormat,
 									 BMessage* msg);
@@ -77,6 +114,26 @@ private:
 
 		Conversation* fConversation;
 		BObjectList<BMessage> fMessageQueue;
+		// Chat messages held until attached, each in its turn among
+		// fMessageQueue's as a kQueuedEvent
+		BObjectList<ChatEvent> fEventQueue;
+
+		List<history_page> fHistory;	// Newest first
+		int32 fHistoryCount;
+		bool fHistoryStart;		// Whether the oldest page starts the log
+		bool fHistoryRead;		// Whether the latest page has been
+		int32 fHistoryRequest;	// The last one asked for
+		bool fHistoryPending;	// … if not yet replied to
+		// Logged messages shown while the latest page is asked for, as it
+		// might have them too
+		List<ChatEvent> fHistoryLive;
+
+		// Newer than any page, oldest first from fLinesFirst― a ring,
+		// trimmed from the front
+		List<scrollback_line> fLines;
+		uint32 fLinesFirst;
+		int32 fLinesLogged;
+		bool fLinesTrimmed;
 
 		EnterTextView* fNameTextView;
 		EnterTextView* fSubjectTextView;
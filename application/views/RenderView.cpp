@@ -6,14 +6,56 @@
 #include "RenderView.h"
 
 #include <InterfaceDefs.h>
+#include <Window.h>
+
+
+const int kNoDay = 364;
+const int kNoYear = 64;
 
 
 RenderView::RenderView(const char* name)
 	:
 	RunView(name),
-	fLastDay(364),
-	fLastYear(64)
+	fLastDay(kNoDay),
+	fLastYear(kNoYear),
+	fHistoryDay(kNoDay),
+	fHistoryYear(kNoYear),
+	fEdgeTarget(NULL),
+	fAtTop(true),
+	fAtBottom(true),
+	fTrimming(false)
+{
+}
+
+
+void
+RenderView::ScrollTo(BPoint where)
+{
+	RunView::ScrollTo(where);
+	if (fEdgeTarget == NULL || Window() == NULL)
+		return;
+
+	BRect bounds = Bounds();
+	bool atTop = bounds.top <= 0;
+	bool atBottom = IsAtBottom();
+
+	// Only once per arrival, and not when brought there by trimming, lest what
+	// was just trimmed is loaded back
+	if (atTop == true && fAtTop == false && fTrimming == false)
+		Window()->PostMessage(kRenderReachedTop, fEdgeTarget);
+	if (atBottom == true && fAtBottom == false && fTrimming == false)
+		Window()->PostMessage(kRenderReachedBottom, fEdgeTarget);
+	fAtTop = atTop;
+	fAtBottom = atBottom;
+}
+
+
+void
+RenderView::DeleteFirst(int32 length)
 {
+	fTrimming = true;
+	RunView::DeleteFirst(length);
+	fTrimming = false;
 }
 
 
@@ -63,3 +105,36 @@ RenderView::AppendTimestamp(time_t time)
 	strftime(timestamp, 8, "[%H:%M] ", tm);
 	Append(timestamp, ui_color(B_LINK_ACTIVE_COLOR), B_BOLD_FACE);
 }
+
+
+void
+RenderView::BeginHistory()
+{
+	// Dividers are drawn for history's dates as if it were the start
+	fHistoryDay = fLastDay;
+	fHistoryYear = fLastYear;
+	fLastDay = kNoDay;
+	fLastYear = kNoYear;
+	BeginPrepend();
+}
+
+
+int32
+RenderView::EndHistory()
+{
+	int32 length = EndPrepend();
+
+	// … unless history's all there is, the newest messages' date still counts
+	if (length == 0 || TextLength() > length) {
+		fLastDay = fHistoryDay;
+		fLastYear = fHistoryYear;
+	}
+	return length;
+}
+
+
+void
+RenderView::SetEdgeTarget(BHandler* target)
+{
+	fEdgeTarget = target;
+}
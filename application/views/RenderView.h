@@ -8,17 +8,40 @@
 #include <librunview/RunView.h>
 
 
+// Sent to the edge target when scrolled to the top or bottom
+const uint32 kRenderReachedTop = 'RVtp';
+const uint32 kRenderReachedBottom = 'RVbt';
+
+
 class RenderView : public RunView {
 public:
 				RenderView(const char* name);
 
+	virtual void	ScrollTo(BPoint where);
+
+		// Without telling the edge target of where it's scrolled to meanwhile
+		void	DeleteFirst(int32 length);
+
 		void	AppendGeneric(const char* message, int64 when);
 		void	AppendUserstamp(const char* nick, rgb_color nameColor);
 		void	AppendTimestamp(time_t time = 0);
 
+		// Like Begin/EndPrepend(), for older messages with their own dates
+		void	BeginHistory();
+		int32	EndHistory();
+
+		void	SetEdgeTarget(BHandler* target);
+
 private:
 		int fLastDay;
 		int fLastYear;
+		int fHistoryDay;
+		int fHistoryYear;
+
+		BHandler* fEdgeTarget;
+		bool fAtTop;
+		bool fAtBottom;
+		bool fTrimming;
 };
 
 #endif // _RENDER_VIEW_H
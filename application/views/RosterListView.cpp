@@ -77,7 +77,9 @@ RosterListView::RosterListView(const char* name)
 	: BOutlineListView(name, B_SINGLE_SELECTION_LIST,
 		B_WILL_DRAW | B_FRAME_EVENTS |
 		B_NAVIGABLE | B_FULL_UPDATE_ON_RESIZE),
-	fPrevItem(NULL)
+	fPrevItem(NULL),
+	fDeferSort(false),
+	fNeedsSort(false)
 {
 	// Context menu
 	fPopUp = new BPopUpMenu("contextMenu", false, false);
@@ -242,7 +244,10 @@ RosterListView::AddItem(BListItem* item)
 	bool ret = false;
 	if (HasItem(item) == false)
 		ret = BListView::AddItem(item);
-	Sort();
+	if (fDeferSort == true)
+		fNeedsSort = true;
+	else
+		Sort();
 	return ret;
 }
 
@@ -269,6 +274,17 @@ RosterListView::Sort()
 }
 
 
+void
+RosterListView::SetDeferSorting(bool defer)
+{
+	fDeferSort = defer;
+	if (defer == false && fNeedsSort == true) {
+		fNeedsSort = false;
+		Sort();
+	}
+}
+
+
 void
 RosterListView::_InfoWindow(Contact* linker)
 {
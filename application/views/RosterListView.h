@@ -28,6 +28,8 @@ public:
 		RosterItem*	RosterItemAt(int32 index);
 
 			void	Sort();
+			// While deferred, AddItem() leaves sorting until it's turned off
+			void	SetDeferSorting(bool defer);
 
 private:
 
@@ -35,6 +37,8 @@ private:
 
 	BPopUpMenu*		fPopUp;
 	RosterItem*		fPrevItem;
+	bool			fDeferSort;
+	bool			fNeedsSort;
 };
 
 #endif	// _ROSTER_LIST_VIEW_H
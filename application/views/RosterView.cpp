@@ -66,21 +66,28 @@ RosterView::MessageReceived(BMessage* message)
 	switch (message->what) {
 		case kSearchContact:
 		{
-			RosterMap map = _RosterMap();
-			for (uint32 i = 0; i < map.CountItems(); i++) {
-				Contact* linker = map.ValueAt(i);
-				RosterItem* item = linker->GetRosterItem();
-
-				// If the search filter has been deleted show all the items,
-				// otherwise remove the item in order to show only items
-				// that matches the search criteria
-				if (strcmp(fSearchBox->Text(), "") == 0)
-					fListView->AddItem(item);
-				else if (linker->GetName().IFindFirst(fSearchBox->Text()) == B_ERROR)
-					fListView->RemoveItem(item);
-				else
-					fListView->AddItem(item);
-				UpdateListItem(item);
+			const Server::ProtocolLoopers& loopers = Server::Get()->Loopers();
+			for (uint32 i = 0; i < loopers.CountItems(); i++) {
+				if (_IsListed(loopers.ValueAt(i)) == false)
+					continue;
+
+				const RosterMap& map = loopers.ValueAt(i)->Contacts();
+				for (uint32 j = 0; j < map.CountItems(); j++) {
+					Contact* linker = map.ValueAt(j);
+					RosterItem* item = linker->GetRosterItem();
+
+					// If the search filter has been deleted show all the
+					// items, otherwise remove the item in order to show only
+					// items that matches the search criteria
+					if (strcmp(fSearchBox->Text(), "") == 0)
+						fListView->AddItem(item);
+					else if (linker->GetName().IFindFirst(fSearchBox->Text())
+							== B_ERROR)
+						fListView->RemoveItem(item);
+					else
+						fListView->AddItem(item);
+					UpdateListItem(item);
+				}
 			}
 
 			// If view has specific account selected, we want the user to be
@@ -111,6 +118,16 @@ RosterView::ImMessage(BMessage* msg)
 {
 	int32 im_what = msg->FindInt32("im_what");
 	switch (im_what) {
+		case IM_BATCH:
+		{
+			fListView->SetDeferSorting(true);
+			BMessage sub;
+			for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK;
+					i++)
+				ImMessage(&sub);
+			fListView->SetDeferSorting(false);
+			break;
+		}
 		case IM_USER_STATUS_SET:
 		{
 			int32 status;
@@ -240,11 +257,17 @@ void
 RosterView::SetAccount(bigtime_t instance_id)
 {
 	fAccount = instance_id;
-	RosterMap contacts = _RosterMap();
-
 	fListView->MakeEmpty();
-	for (int i = 0; i < contacts.CountItems(); i++)
-		fListView->AddItem(contacts.ValueAt(i)->GetRosterItem());
+
+	const Server::ProtocolLoopers& loopers = Server::Get()->Loopers();
+	for (uint32 i = 0; i < loopers.CountItems(); i++) {
+		if (_IsListed(loopers.ValueAt(i)) == false)
+			continue;
+
+		const RosterMap& contacts = loopers.ValueAt(i)->Contacts();
+		for (uint32 j = 0; j < contacts.CountItems(); j++)
+			fListView->AddItem(contacts.ValueAt(j)->GetRosterItem());
+	}
 }
 
 
@@ -263,15 +286,8 @@ RosterView::ListView()
 }
 
 
-RosterMap
-RosterView::_RosterMap()
+bool
+RosterView::_IsListed(ProtocolLooper* looper)
 {
-	RosterMap contacts;
-	if (fAccount < 0)
-		contacts = Server::Get()->Contacts();
-	else {
-		ProtocolLooper* looper = Server::Get()->GetProtocolLooper(fAccount);
-		contacts = looper->Contacts();
-	}
-	return contacts;
+	return (fAccount < 0 || looper->GetInstance() == fAccount);
 }
@@ -18,6 +18,7 @@
 
 class BStringItem;
 class BTextControl;
+class ProtocolLooper;
 class RosterItem;
 class RosterListView;
 
@@ -43,7 +44,7 @@ public:
 		RosterListView*	ListView();
 
 private:
-			RosterMap	_RosterMap();
+			bool		_IsListed(ProtocolLooper* looper);
 
 	RosterListView*		fListView;
 	BTextControl*		fSearchBox;
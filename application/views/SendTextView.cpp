@@ -9,7 +9,8 @@
 #include <Window.h>
 
 #include "AppMessages.h"
-#include "Server.h"
+#include "Conversation.h"
+#include "ProtocolLooper.h"
 
 
 SendTextView::SendTextView(const char* name, ConversationView* convView)
@@ -77,20 +78,24 @@ SendTextView::_AutoComplete()
 		fCurrentWord = lastWord;
 
 	// Now to find the substitutes
+	Conversation* chat = fChatView->GetConversation();
 	BString substitution;
 	if (fCurrentWord.StartsWith("/") == true) {
-		substitution =
-			_NextMatch(_CommandNames(), BString(fCurrentWord).RemoveFirst("/"));
+		const CommandIndex& commands
+			= chat->GetProtocolLooper()->CommandNames();
+		substitution = commands.MatchAt(
+			BString(fCurrentWord).RemoveFirst("/"), fCurrentIndex);
 		if (substitution.IsEmpty() == false)
 			substitution.Prepend("/");
 	}
 	else
-		substitution = _NextMatch(_UserNames(), fCurrentWord);
+		substitution = chat->UserNames().MatchAt(fCurrentWord, fCurrentIndex);
 
 	// Apply the substitution or jet off
 	if (substitution.IsEmpty() == true)
 		fCurrentIndex = 0;
 	else {
+		fCurrentIndex++;
 		int32 index = text.FindLast(lastWord);
 		int32 newindex = index + substitution.Length();
 
@@ -101,56 +106,6 @@ SendTextView::_AutoComplete()
 }
 
 
-BString
-SendTextView::_NextMatch(BStringList list, BString current)
-{
-	BString match;
-	for (int i = 0, j = 0; i < list.CountStrings(); i++)
-		if (list.StringAt(i).StartsWith(current)) {
-			if (j == fCurrentIndex) {
-				match = list.StringAt(i);
-				fCurrentIndex++;
-				break;
-			}
-			j++;
-		}
-	return match;
-}
-
-
-BStringList
-SendTextView::_CommandNames()
-{
-	if (fCurrentIndex == 0) {
-		int64 instance = fChatView->GetConversation()->GetProtocolLooper()->GetInstance();
-		BStringList cmdNames;
-		CommandMap cmds = Server::Get()->Commands(instance);
-
-		for (int i = 0; i < cmds.CountItems(); i++)
-			cmdNames.Add(cmds.KeyAt(i));
-		fCurrentList = cmdNames;
-	}
-	return fCurrentList;
-}
-
-
-BStringList
-SendTextView::_UserNames()
-{
-	if (fCurrentIndex == 0) {
-		BStringList nameAndId;
-		UserMap users = fChatView->GetConversation()->Users();
-
-		for (int i = 0; i < users.CountItems(); i++) {
-			nameAndId.Add(users.KeyAt(i));
-			nameAndId.Add(users.ValueAt(i)->GetName());
-		}
-		fCurrentList = nameAndId;
-	}
-	return fCurrentList;
-}
-
-
 void
 SendTextView::_AppendHistory()
 {
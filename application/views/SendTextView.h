@@ -19,10 +19,6 @@ public:
 
 private:
 			void	_AutoComplete();
-		 BString	_NextMatch(BStringList list, BString current);
-
-	  BStringList	_CommandNames();
-	  BStringList	_UserNames();
 
 			void	_AppendHistory();
 			void	_UpHistory();
@@ -33,7 +29,6 @@ private:
 	// Used for auto-completion
 	int32 fCurrentIndex;
 	BString fCurrentWord;
-	BStringList fCurrentList;
 
 	// Used for history
 	BStringList fHistory;
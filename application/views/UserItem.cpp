@@ -11,6 +11,7 @@
 #include "AppConstants.h"
 #include "NotifyMessage.h"
 #include "User.h"
+#include "UserListView.h"
 #include "Utils.h"
 
 
@@ -18,8 +19,12 @@ UserItem::UserItem(User* user)
 	:
 	BStringItem(user->GetName()),
 	fUser(user),
-	fStatus(user->GetNotifyStatus())
+	fStatus(user->GetNotifyStatus()),
+	fPriority(0),
+	fSortName(user->GetName()),
+	fListView(NULL)
 {
+	fSortName.ToLower();
 	user->RegisterObserver(this);
 }
 
@@ -48,6 +53,10 @@ UserItem::ObserveString(int32 what, BString str)
 	switch (what) {
 		case STR_CONTACT_NAME:
 			SetText(str);
+			fSortName = str;
+			fSortName.ToLower();
+			if (fListView != NULL)
+				fListView->UpdateUser(fUser);
 			break;
 	}
 }
@@ -73,6 +82,15 @@ UserItem::GetUser()
 }
 
 
+int
+UserItem::Compare(const UserItem* other) const
+{
+	if (fPriority != other->fPriority)
+		return (fPriority > other->fPriority) ? -1 : 1;
+	return fSortName.Compare(other->fSortName);
+}
+
+
 rgb_color
 UserItem::_GetTextColor(rgb_color highColor)
 {
@@ -11,6 +11,7 @@
 #include "Observer.h"
 
 class User;
+class UserListView;
 
 
 class UserItem : public BStringItem, public Observer {
@@ -25,12 +26,23 @@ public:
 
 			User*	GetUser();
 
+			// Ordering within the user list: by role priority (highest
+			// first), then by case-folded name
+			int		Compare(const UserItem* other) const;
+			void	SetPriority(int32 priority) { fPriority = priority; }
+
+			void	SetListView(UserListView* list) { fListView = list; }
+
 protected:
 		rgb_color	_GetTextColor(rgb_color highColor);
 
 private:
 	User* fUser;
 	int fStatus;
+
+	int32 fPriority;
+	BString fSortName;
+	UserListView* fListView;
 };
 
 #endif // USERITEM_H
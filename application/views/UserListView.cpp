@@ -26,12 +26,12 @@
 
 
 static int
-compare_by_name(const void* _item1, const void* _item2)
+compare_users(const void* _item1, const void* _item2)
 {
 	UserItem* item1 = *(UserItem**)_item1;
 	UserItem* item2 = *(UserItem**)_item2;
 
-	return item1->GetUser()->GetName().ICompare(item2->GetUser()->GetName());
+	return item1->Compare(item2);
 }
 
 
@@ -63,33 +63,154 @@ UserListView::MouseDown(BPoint where)
 void
 UserListView::Sort()
 {
-	SortItems(compare_by_name);
+	SortItems(compare_users);
 }
 
 
 bool
 UserListView::HasUser(User* user)
 {
-	for (int i = 0; i < CountItems(); i++)
-		if (user == ((UserItem*)ItemAt(i))->GetUser())
-			return true;
-	return false;
+	bool found = false;
+	fUserItems.ValueFor(user, &found);
+	return found;
 }
 
 
 void
 UserListView::AddUser(User* user)
 {
-	AddItem(new UserItem(user));
+	if (user == NULL || HasUser(user) == true)
+		return;
+	_InsertSorted(_NewItem(user));
+}
+
+
+void
+UserListView::AddUsers(const BObjectList<User>& users)
+{
+	// Few enough to insert one-by-one
+	if (users.CountItems() < 8) {
+		for (int32 i = 0; i < users.CountItems(); i++)
+			AddUser(users.ItemAt(i));
+		return;
+	}
+
+	BList items(users.CountItems());
+	for (int32 i = 0; i < users.CountItems(); i++) {
+		User* user = users.ItemAt(i);
+		if (user != NULL && HasUser(user) == false)
+			items.AddItem(_NewItem(user));
+	}
+	AddList(&items);
+	Sort();
 }
 
 
 void
 UserListView::RemoveUser(User* user)
 {
-	for (int i = 0; i < CountItems(); i++)
-		if (user == ((UserItem*)ItemAt(i))->GetUser())
-			RemoveItem(i);
+	UserItem* item = fUserItems.RemoveItemFor(user);
+	if (item == NULL)
+		return;
+	RemoveItem(item);
+	delete item;
+}
+
+
+void
+UserListView::UpdateUser(User* user)
+{
+	UserItem* item = fUserItems.ValueFor(user);
+	if (item == NULL)
+		return;
+
+	item->SetPriority(_Priority(user));
+	int32 index = IndexOf(item);
+	UserItem* prev = (UserItem*)ItemAt(index - 1);
+	UserItem* next = (UserItem*)ItemAt(index + 1);
+	if ((prev == NULL || prev->Compare(item) <= 0)
+			&& (next == NULL || item->Compare(next) <= 0)) {
+		InvalidateItem(index);
+		return;
+	}
+
+	bool selected = item->IsSelected();
+	RemoveItem(index);
+	_InsertSorted(item);
+	if (selected == true)
+		Select(IndexOf(item));
+}
+
+
+void
+UserListView::InvalidateUser(User* user)
+{
+	UserItem* item = fUserItems.ValueFor(user);
+	if (item != NULL)
+		InvalidateItem(_IndexOf(item));
+}
+
+
+UserItem*
+UserListView::_NewItem(User* user)
+{
+	UserItem* item = new UserItem(user);
+	item->SetPriority(_Priority(user));
+	item->SetListView(this);
+	fUserItems.AddItem(user, item);
+	return item;
+}
+
+
+void
+UserListView::_InsertSorted(UserItem* item)
+{
+	int32 low = 0;
+	int32 high = CountItems();
+	while (low < high) {
+		int32 mid = (low + high) / 2;
+		if (((UserItem*)ItemAt(mid))->Compare(item) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	AddItem(item, low);
+}
+
+
+int32
+UserListView::_IndexOf(UserItem* item)
+{
+	// Binary search for the item's sort key, then past any equal neighbours
+	int32 low = 0;
+	int32 high = CountItems();
+	while (low < high) {
+		int32 mid = (low + high) / 2;
+		if (((UserItem*)ItemAt(mid))->Compare(item) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	for (int32 i = low; i < CountItems(); i++) {
+		UserItem* check = (UserItem*)ItemAt(i);
+		if (check == item)
+			return i;
+		if (check->Compare(item) != 0)
+			break;
+	}
+
+	// The item's key changed since it was placed (e.g., a pending rename)
+	return IndexOf(item);
+}
+
+
+int32
+UserListView::_Priority(User* user)
+{
+	Role* role = NULL;
+	if (fChat != NULL)
+		role = fChat->GetRole(user->GetId());
+	return (role != NULL) ? role->fPriority : 0;
 }
 
 
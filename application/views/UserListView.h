@@ -6,6 +6,9 @@
 #define CONVERSATIONLIST_H
 
 #include <ListView.h>
+#include <ObjectList.h>
+
+#include <libsupport/KeyMap.h>
 
 #include "Role.h"
 
@@ -13,6 +16,7 @@ class BPopUpMenu;
 
 class Conversation;
 class User;
+class UserItem;
 
 
 enum
@@ -35,9 +39,15 @@ public:
 
 			void	Sort();
 
+			// The list is kept ordered, so each of these only touches the
+			// given users' items.
 			bool	HasUser(User* user);
 			void	AddUser(User* user);
+			void	AddUsers(const BObjectList<User>& users);
 			void	RemoveUser(User* user);
+			// Reposition after a user's name or role changes
+			void	UpdateUser(User* user);
+			void	InvalidateUser(User* user);
 
 			void	SetConversation(Conversation* chat) { fChat = chat; }
 
@@ -45,11 +55,17 @@ private:
 	 BPopUpMenu*	_UserPopUp();
 	 BPopUpMenu*	_BlankPopUp();
 
+			UserItem*	_NewItem(User* user);
+			void	_InsertSorted(UserItem* item);
+			int32	_IndexOf(UserItem* item);
+			int32	_Priority(User* user);
+
 			void	_ModerationAction(int32 im_what);
 			void	_ProcessItem(BMessage* itemMsg, BPopUpMenu* menu,
 						Role* user, Role* target, BString target_id);
 
 	Conversation* fChat;
+	KeyMap<User*, UserItem*> fUserItems;
 };
 
 #endif // CONVERSATIONLIST_H
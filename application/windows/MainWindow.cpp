@@ -32,6 +32,7 @@
 #include "ConversationItem.h"
 #include "ConversationListView.h"
 #include "ConversationView.h"
+#include "LogWriter.h"
 #include "MainWindow.h"
 #include "NotifyMessage.h"
 #include "PreferencesWindow.h"
@@ -39,6 +40,7 @@
 #include "ProtocolSettings.h"
 #include "ReplicantStatusView.h"
 #include "RoomListWindow.h"
+#include "SearchWindow.h"
 #include "RosterEditWindow.h"
 #include "RosterWindow.h"
 #include "Server.h"
@@ -52,6 +54,7 @@
 
 
 const uint32 kLogin			= 'LOGI';
+const uint32 kRoomTextUpdated	= 'MWtu';
 
 
 MainWindow::MainWindow()
@@ -231,18 +234,35 @@ MainWindow::MessageReceived(BMessage* message)
 		case APP_ROOM_SEARCH:
 		{
 			if (fConversation != NULL) {
-				entry_ref ref;
-				BEntry entry(fConversation->CachePath().Path());
-				if (entry.GetRef(&ref) != B_OK)
-					break;
-
-				BMessage msg(B_REFS_RECEIVED);
-				msg.AddRef("refs", &ref);
-				BRoster roster;
-				roster.Launch("application/x-vnd.Haiku.TextSearch", &msg);
+				// Only written out every so often, so brought up to date
+				// first, then opened
+				BMessage reply(kRoomTextUpdated);
+				reply.AddString("path", fConversation->CachePath().Path());
+				LogWriter::Get()->Export(
+					fConversation->GetProtocolLooper()->Protocol()->GetName(),
+					fConversation->GetId().String(), LOG_EXPORT_TEXT, NULL,
+					BMessenger(this), reply);
 			}
 			break;
 		}
+		case kRoomTextUpdated:
+		{
+			entry_ref ref;
+			BEntry entry(message->FindString("path"));
+			if (entry.GetRef(&ref) != B_OK)
+				break;
+
+			BMessage msg(B_REFS_RECEIVED);
+			msg.AddRef("refs", &ref);
+			BRoster roster;
+			roster.Launch("application/x-vnd.Haiku.TextSearch", &msg);
+			break;
+		}
+		case APP_SHOW_SEARCH:
+		{
+			SearchWindow::Get()->Show();
+			break;
+		}
 		case APP_EDIT_ROSTER:
 		{
 			RosterEditWindow::Get()->Show();
@@ -393,6 +413,36 @@ MainWindow::ImMessage(BMessage* msg)
 		case IM_PROTOCOL_DISABLE:
 			fStatusView->MessageReceived(msg);
 			break;
+		case IM_BATCH:
+		{
+			// Roster and directory windows get the whole batch in one go
+			bool roster = false, directory = false;
+			BMessage sub;
+			for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK;
+					i++)
+				switch (sub.GetInt32("im_what", -1)) {
+					case IM_USER_AVATAR_SET:
+					case IM_USER_STATUS_SET:
+					case IM_CONTACT_INFO:
+					case IM_EXTENDED_CONTACT_INFO:
+					case IM_ROSTER_CONTACT_REMOVED:
+						roster = true;
+						break;
+					case IM_ROOM_DIRECTORY:
+						directory = true;
+						break;
+					default:
+						ImMessage(&sub);
+				}
+
+			if (roster == true && fRosterWindow != NULL)
+				fRosterWindow->PostMessage(msg);
+			if (roster == true && RosterEditWindow::Check() == true)
+				RosterEditWindow::Get()->PostMessage(msg);
+			if (directory == true && RoomListWindow::Check() == true)
+				RoomListWindow::Get()->PostMessage(msg);
+			break;
+		}
 	}
 }
 
@@ -556,6 +606,8 @@ MainWindow::_CreateMenuBar()
 	chatMenu->AddSeparatorItem();
 	chatMenu->AddItem(new BMenuItem(B_TRANSLATE("Find" B_UTF8_ELLIPSIS),
 		new BMessage(APP_ROOM_SEARCH), 'F', B_COMMAND_KEY));
+	chatMenu->AddItem(new BMenuItem(B_TRANSLATE("Search all logs" B_UTF8_ELLIPSIS),
+		new BMessage(APP_SHOW_SEARCH), 'F', B_COMMAND_KEY | B_SHIFT_KEY));
 
 	// Roster
 	BMenu* rosterMenu = new BMenu(B_TRANSLATE("Roster"));
@@ -81,6 +81,13 @@ RoomListWindow::MessageReceived(BMessage* msg)
 	switch (msg->what) {
 		case IM_MESSAGE:
 		{
+			if (msg->GetInt32("im_what", -1) == IM_BATCH) {
+				BMessage sub;
+				for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK;
+						i++)
+					MessageReceived(&sub);
+				break;
+			}
 			if (msg->GetInt32("im_what", -1) != IM_ROOM_DIRECTORY)
 				break;
 
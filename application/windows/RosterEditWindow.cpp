@@ -213,6 +213,14 @@ RosterEditWindow::MessageReceived(BMessage* message)
 			if (message->GetInt32("im_what", 0) == IM_EXTENDED_CONTACT_INFO)
 				if (message->GetString("user_id", "") == fEditingUser)
 					fEditingWindow->PostMessage(message);
+			if (message->GetInt32("im_what", 0) == IM_BATCH) {
+				BMessage sub;
+				for (int32 i = 0; message->FindMessage("message", i, &sub)
+						== B_OK; i++)
+					if (sub.GetInt32("im_what", 0) == IM_EXTENDED_CONTACT_INFO
+							&& sub.GetString("user_id", "") == fEditingUser)
+						fEditingWindow->PostMessage(&sub);
+			}
 			fRosterView->MessageReceived(message);
 			break;
 		}
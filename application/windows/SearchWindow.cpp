@@ -0,0 +1,200 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "SearchWindow.h"
+
+#include <Button.h>
+#include <Catalog.h>
+#include <ColumnListView.h>
+#include <ColumnTypes.h>
+#include <LayoutBuilder.h>
+#include <StringView.h>
+#include <TextControl.h>
+
+#include "AppPreferences.h"
+#include "LogWriter.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Search window"
+
+
+const uint32 kSearch = 'swse';
+const uint32 kSearchResults = 'swsr';
+
+// Matches listed at most
+const int32 kSearchWindowHits = 500;
+
+enum {
+	kDateColumn,
+	kRoomColumn,
+	kUserColumn,
+	kBodyColumn,
+	kAccountColumn
+};
+
+SearchWindow* SearchWindow::fInstance = NULL;
+
+
+SearchWindow::SearchWindow()
+	:
+	BWindow(AppPreferences::Get()->SearchWindowRect,
+		B_TRANSLATE("Search all logs"), B_TITLED_WINDOW,
+		B_AUTO_UPDATE_SIZE_LIMITS),
+	fSearch(0)
+{
+	_InitInterface();
+	CenterOnScreen();
+}
+
+
+SearchWindow::~SearchWindow()
+{
+	fInstance = NULL;
+	AppPreferences::Get()->SearchWindowRect = Bounds();
+	_EmptyList();
+}
+
+
+SearchWindow*
+SearchWindow::Get()
+{
+	if (fInstance == NULL)
+		fInstance = new SearchWindow();
+	return fInstance;
+}
+
+
+bool
+SearchWindow::Check()
+{
+	return (fInstance != NULL);
+}
+
+
+void
+SearchWindow::MessageReceived(BMessage* msg)
+{
+	switch (msg->what) {
+		case kSearch:
+			Search(fQueryControl->Text());
+			break;
+		case kSearchResults:
+			_ShowResults(msg);
+			break;
+		default:
+			BWindow::MessageReceived(msg);
+	}
+}
+
+
+void
+SearchWindow::Search(const char* query)
+{
+	_EmptyList();
+	fStatusView->SetText(B_TRANSLATE("Searching" B_UTF8_ELLIPSIS));
+
+	// Only the latest search's are shown
+	BMessage reply(kSearchResults);
+	reply.AddInt32("search", ++fSearch);
+	reply.AddInt64("start", system_time());
+	LogWriter::Get()->Search(query, kSearchWindowHits, BMessenger(this),
+		reply);
+}
+
+
+void
+SearchWindow::_ShowResults(BMessage* hits)
+{
+	if (hits->GetInt32("search", -1) != fSearch)
+		return;
+	if (hits->GetInt32("result", B_OK) != B_OK) {
+		fStatusView->SetText(B_TRANSLATE("Type some words to search for."));
+		return;
+	}
+	bigtime_t took = system_time() - hits->GetInt64("start", system_time());
+
+	int32 count = 0;
+	BMessage hit;
+	for (; hits->FindMessage("hit", count, &hit) == B_OK; count++) {
+		BString user = hit.FindString("user_name");
+		if (user.IsEmpty() == true)
+			user = hit.FindString("user_id");
+
+		time_t when = hit.GetInt64("when", 0);
+		BRow* row = new BRow();
+		row->SetField(new BDateField(&when), kDateColumn);
+		row->SetField(new BStringField(hit.FindString("chat_id")),
+			kRoomColumn);
+		row->SetField(new BStringField(user), kUserColumn);
+		row->SetField(new BStringField(hit.FindString("body")), kBodyColumn);
+		row->SetField(new BStringField(hit.FindString("account")),
+			kAccountColumn);
+		fListView->AddRow(row);
+	}
+
+	BString status(B_TRANSLATE("%count% messages found in %ms% ms."));
+	status.ReplaceAll("%count%", BString() << count);
+	status.ReplaceAll("%ms%", BString() << took / 1000);
+	fStatusView->SetText(status);
+}
+
+
+void
+SearchWindow::_InitInterface()
+{
+	fQueryControl = new BTextControl("query", NULL, NULL,
+		new BMessage(kSearch));
+	BButton* searchButton = new BButton("search", B_TRANSLATE("Search"),
+		new BMessage(kSearch));
+
+	BDateColumn* date = new BDateColumn(B_TRANSLATE("Date"), 110, 50, 300,
+		B_ALIGN_LEFT);
+	BStringColumn* room = new BStringColumn(B_TRANSLATE("Room"), 100, 50, 300,
+		B_TRUNCATE_END);
+	BStringColumn* user = new BStringColumn(B_TRANSLATE("User"), 90, 50, 300,
+		B_TRUNCATE_END);
+	BStringColumn* body = new BStringColumn(B_TRANSLATE("Message"), 300, 50,
+		5000, B_TRUNCATE_END);
+	BStringColumn* account = new BStringColumn(B_TRANSLATE("Account"), 90, 50,
+		300, B_TRUNCATE_END);
+
+	// Listed best-first, so not sorted by any column
+	fListView = new BColumnListView("hitList", B_NAVIGABLE, B_PLAIN_BORDER);
+	fListView->SetSelectionMode(B_SINGLE_SELECTION_LIST);
+	fListView->SetSortingEnabled(false);
+	fListView->AddColumn(date, kDateColumn);
+	fListView->AddColumn(room, kRoomColumn);
+	fListView->AddColumn(user, kUserColumn);
+	fListView->AddColumn(body, kBodyColumn);
+	fListView->AddColumn(account, kAccountColumn);
+
+	fStatusView = new BStringView("status", "");
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL)
+		.SetInsets(B_USE_DEFAULT_SPACING)
+		.AddGroup(B_HORIZONTAL)
+			.Add(fQueryControl)
+			.Add(searchButton)
+		.End()
+		.Add(fListView)
+		.Add(fStatusView)
+	.End();
+
+	fQueryControl->MakeFocus(true);
+	searchButton->MakeDefault(true);
+}
+
+
+void
+SearchWindow::_EmptyList()
+{
+	BRow* row = fListView->RowAt((int32)0, NULL);
+	while (row != NULL) {
+		fListView->RemoveRow(row);
+		delete row;
+		row = fListView->RowAt((int32)0, NULL);
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _SEARCH_WINDOW_H
+#define _SEARCH_WINDOW_H
+
+#include <Window.h>
+
+class BColumnListView;
+class BStringView;
+class BTextControl;
+
+
+/* Searches every room's logs through their accounts' SearchIndexes, listing
+ * the matching messages best-first. */
+class SearchWindow : public BWindow {
+public:
+							SearchWindow();
+							~SearchWindow();
+
+	static SearchWindow*	Get();
+	static bool				Check();
+
+	virtual void			MessageReceived(BMessage* msg);
+
+			// Listed once the LogWriter replies
+			void			Search(const char* query);
+
+private:
+			void			_ShowResults(BMessage* hits);
+			void			_InitInterface();
+			void			_EmptyList();
+
+	BTextControl* fQueryControl;
+	BColumnListView* fListView;
+	BStringView* fStatusView;
+	int32 fSearch;
+
+	static SearchWindow* fInstance;
+};
+
+#endif // _SEARCH_WINDOW_H
@@ -0,0 +1,25 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _AUTOLOCK_H
+#define _AUTOLOCK_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <Locker.h>
+
+
+class BAutolock {
+public:
+				BAutolock(BLocker& locker) : fLocker(locker)
+					{ fLocker.Lock(); }
+				BAutolock(BLocker* locker) : fLocker(*locker)
+					{ fLocker.Lock(); }
+				~BAutolock() { fLocker.Unlock(); }
+
+private:
+	BLocker&	fLocker;
+};
+
+#endif // _AUTOLOCK_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _DATA_IO_H
+#define _DATA_IO_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include <SupportDefs.h>
+
+
+class BDataIO {
+public:
+	virtual				~BDataIO() {}
+
+	virtual	ssize_t		Read(void* buffer, size_t size) = 0;
+	virtual	ssize_t		Write(const void* buffer, size_t size) = 0;
+};
+
+
+class BPositionIO : public BDataIO {
+public:
+	virtual	ssize_t		ReadAt(off_t position, void* buffer, size_t size) = 0;
+	virtual	ssize_t		WriteAt(off_t position, const void* buffer,
+							size_t size) = 0;
+	virtual	off_t		Seek(off_t position, uint32 seekMode) = 0;
+	virtual	status_t	SetSize(off_t size) = 0;
+	virtual	status_t	GetSize(off_t* size) const = 0;
+
+	virtual	ssize_t		Read(void* buffer, size_t size)
+						{
+							ssize_t read = ReadAt(fPosition, buffer, size);
+							if (read > 0)
+								fPosition += read;
+							return read;
+						}
+	virtual	ssize_t		Write(const void* buffer, size_t size)
+						{
+							ssize_t written = WriteAt(fPosition, buffer, size);
+							if (written > 0)
+								fPosition += written;
+							return written;
+						}
+	virtual	off_t		Position() const { return fPosition; }
+
+protected:
+			off_t		fPosition = 0;
+};
+
+
+class BMallocIO : public BPositionIO {
+public:
+	virtual	ssize_t		ReadAt(off_t position, void* buffer, size_t size)
+						{
+							if (position < 0)
+								return B_BAD_VALUE;
+							if ((size_t)position >= fData.size())
+								return 0;
+							size_t read = fData.size() - position;
+							if (read > size)
+								read = size;
+							memcpy(buffer, fData.data() + position, read);
+							return read;
+						}
+	virtual	ssize_t		WriteAt(off_t position, const void* buffer,
+							size_t size)
+						{
+							if (position < 0)
+								return B_BAD_VALUE;
+							if (position + size > fData.size())
+								fData.resize(position + size);
+							memcpy(&fData[position], buffer, size);
+							return size;
+						}
+	virtual	off_t		Seek(off_t position, uint32 seekMode)
+						{
+							if (seekMode == SEEK_CUR)
+								position += fPosition;
+							else if (seekMode == SEEK_END)
+								position += fData.size();
+							if (position < 0)
+								return B_BAD_VALUE;
+							return fPosition = position;
+						}
+	virtual	status_t	SetSize(off_t size)
+							{ fData.resize(size); return B_OK; }
+	virtual	status_t	GetSize(off_t* size) const
+							{ *size = fData.size(); return B_OK; }
+
+			const void*	Buffer() const { return fData.data(); }
+			size_t		BufferLength() const { return fData.size(); }
+
+private:
+			std::string	fData;
+};
+
+
+// Reads (and writes within) a buffer it doesn't own
+class BMemoryIO : public BPositionIO {
+public:
+						BMemoryIO(void* data, size_t size)
+							: fData((char*)data), fSize(size), fReadOnly(false)
+							{}
+						BMemoryIO(const void* data, size_t size)
+							: fData((char*)data), fSize(size), fReadOnly(true)
+							{}
+
+	virtual	ssize_t		ReadAt(off_t position, void* buffer, size_t size)
+						{
+							if (position < 0)
+								return B_BAD_VALUE;
+							if ((size_t)position >= fSize)
+								return 0;
+							if (size > fSize - position)
+								size = fSize - position;
+							memcpy(buffer, fData + position, size);
+							return size;
+						}
+	virtual	ssize_t		WriteAt(off_t position, const void* buffer,
+							size_t size)
+						{
+							if (fReadOnly)
+								return B_NOT_ALLOWED;
+							if (position < 0)
+								return B_BAD_VALUE;
+							if ((size_t)position >= fSize)
+								return 0;
+							if (size > fSize - position)
+								size = fSize - position;
+							memcpy(fData + position, buffer, size);
+							return size;
+						}
+	virtual	off_t		Seek(off_t position, uint32 seekMode)
+						{
+							if (seekMode == SEEK_CUR)
+								position += fPosition;
+							else if (seekMode == SEEK_END)
+								position += fSize;
+							if (position < 0)
+								return B_BAD_VALUE;
+							return fPosition = position;
+						}
+	virtual	status_t	SetSize(off_t size) { return B_NOT_ALLOWED; }
+	virtual	status_t	GetSize(off_t* size) const
+							{ *size = fSize; return B_OK; }
+
+private:
+			char*		fData;
+			size_t		fSize;
+			bool		fReadOnly;
+};
+
+#endif // _DATA_IO_H
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _B_DATE_TIME_FORMAT_H
+#define _B_DATE_TIME_FORMAT_H
+
+// Only what libcore uses, so it can be built off Haiku. Every style's the C
+// locale's, in local time.
+
+#include <time.h>
+
+#include <String.h>
+
+
+enum BDateFormatStyle {
+	B_FULL_DATE_FORMAT = 0,
+	B_LONG_DATE_FORMAT,
+	B_MEDIUM_DATE_FORMAT,
+	B_SHORT_DATE_FORMAT
+};
+
+enum BTimeFormatStyle {
+	B_FULL_TIME_FORMAT = 0,
+	B_LONG_TIME_FORMAT,
+	B_MEDIUM_TIME_FORMAT,
+	B_SHORT_TIME_FORMAT
+};
+
+
+class BDateTimeFormat {
+public:
+	status_t	Format(BString& string, time_t time,
+					BDateFormatStyle dateStyle,
+					BTimeFormatStyle timeStyle) const
+				{
+					struct tm local;
+					char buffer[64];
+					if (localtime_r(&time, &local) == NULL
+							|| strftime(buffer, sizeof(buffer), "%x %X",
+								&local) == 0)
+						return B_ERROR;
+					string = buffer;
+					return B_OK;
+				}
+};
+
+#endif // _B_DATE_TIME_FORMAT_H
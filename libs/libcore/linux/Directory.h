@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _DIRECTORY_H
+#define _DIRECTORY_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <dirent.h>
+
+#include <Entry.h>
+
+
+class BDirectory {
+public:
+						BDirectory(const char* path)
+							: fPath(path), fDir(NULL)
+						{
+							if (path != NULL)
+								fDir = opendir(path);
+						}
+						~BDirectory()
+						{
+							if (fDir != NULL)
+								closedir(fDir);
+						}
+
+			status_t	InitCheck() const
+							{ return fDir != NULL ? B_OK : B_ENTRY_NOT_FOUND; }
+
+			status_t	GetNextEntry(BEntry* entry)
+						{
+							if (fDir == NULL)
+								return B_ENTRY_NOT_FOUND;
+							struct dirent* dirent;
+							while ((dirent = readdir(fDir)) != NULL) {
+								if (strcmp(dirent->d_name, ".") == 0
+										|| strcmp(dirent->d_name, "..") == 0)
+									continue;
+								return entry->SetTo(BPath(fPath.Path(),
+									dirent->d_name).Path());
+							}
+							return B_ENTRY_NOT_FOUND;
+						}
+			void		Rewind()
+						{
+							if (fDir != NULL)
+								rewinddir(fDir);
+						}
+
+private:
+			BPath		fPath;
+			DIR*		fDir;
+};
+
+
+// Makes any of the path's directories that are missing
+inline status_t
+create_directory(const char* path, mode_t mode)
+{
+	if (path == NULL)
+		return B_BAD_VALUE;
+	std::string partial(path);
+	for (std::string::size_type slash = partial.find('/', 1);;
+			slash = partial.find('/', slash + 1)) {
+		std::string parent = partial.substr(0, slash);
+		if (mkdir(parent.c_str(), mode) != 0 && errno != EEXIST)
+			return B_IO_ERROR;
+		if (slash == std::string::npos)
+			break;
+	}
+	return BEntry(path).IsDirectory() ? B_OK : B_FILE_EXISTS;
+}
+
+#endif // _DIRECTORY_H
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _ENTRY_H
+#define _ENTRY_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Path.h>
+
+#define B_FILE_NAME_LENGTH	256
+#define B_PATH_NAME_LENGTH	1024
+
+
+class BEntry {
+public:
+						BEntry() : fInit(B_NO_INIT) {}
+						BEntry(const char* path) { SetTo(path); }
+
+			status_t	SetTo(const char* path)
+						{
+							fInit = fPath.SetTo(path);
+							return fInit;
+						}
+			void		Unset() { fPath.Unset(); fInit = B_NO_INIT; }
+			status_t	InitCheck() const { return fInit; }
+
+			bool		Exists() const
+						{
+							struct stat st;
+							return fInit == B_OK
+								&& lstat(fPath.Path(), &st) == 0;
+						}
+			bool		IsDirectory() const
+						{
+							struct stat st;
+							return fInit == B_OK
+								&& stat(fPath.Path(), &st) == 0
+								&& S_ISDIR(st.st_mode);
+						}
+
+			status_t	GetName(char* buffer) const
+						{
+							if (fInit != B_OK)
+								return fInit;
+							snprintf(buffer, B_FILE_NAME_LENGTH, "%s",
+								fPath.Leaf());
+							return B_OK;
+						}
+			status_t	GetPath(BPath* path) const
+						{
+							if (fInit != B_OK)
+								return fInit;
+							*path = fPath;
+							return B_OK;
+						}
+			status_t	GetSize(off_t* size) const
+						{
+							struct stat st;
+							status_t ret = _Stat(&st);
+							if (ret == B_OK)
+								*size = st.st_size;
+							return ret;
+						}
+			status_t	GetModificationTime(time_t* modified) const
+						{
+							struct stat st;
+							status_t ret = _Stat(&st);
+							if (ret == B_OK)
+								*modified = st.st_mtime;
+							return ret;
+						}
+
+			status_t	Remove()
+						{
+							if (fInit != B_OK)
+								return fInit;
+							if (remove(fPath.Path()) != 0)
+								return errno == ENOENT
+									? B_ENTRY_NOT_FOUND : B_IO_ERROR;
+							return B_OK;
+						}
+			// A relative path is taken from the entry's directory
+			status_t	Rename(const char* path, bool clobber = false)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							std::string to(path);
+							if (to[0] != '/') {
+								std::string from(fPath.Path());
+								to.insert(0, from, 0, from.rfind('/') + 1);
+							}
+							struct stat st;
+							if (clobber == false && lstat(to.c_str(), &st) == 0)
+								return B_FILE_EXISTS;
+							if (rename(fPath.Path(), to.c_str()) != 0)
+								return errno == ENOENT
+									? B_ENTRY_NOT_FOUND : B_IO_ERROR;
+							return fPath.SetTo(to.c_str());
+						}
+
+private:
+			status_t	_Stat(struct stat* st) const
+						{
+							if (fInit != B_OK)
+								return fInit;
+							if (stat(fPath.Path(), st) != 0)
+								return errno == ENOENT
+									? B_ENTRY_NOT_FOUND : B_IO_ERROR;
+							return B_OK;
+						}
+
+			BPath		fPath;
+			status_t	fInit;
+};
+
+#endif // _ENTRY_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _FILE_H
+#define _FILE_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <DataIO.h>
+#include <Node.h>
+
+
+enum {
+	B_READ_ONLY		= O_RDONLY,
+	B_WRITE_ONLY	= O_WRONLY,
+	B_READ_WRITE	= O_RDWR,
+	B_FAIL_IF_EXISTS = O_EXCL,
+	B_CREATE_FILE	= O_CREAT,
+	B_ERASE_FILE	= O_TRUNC,
+	B_OPEN_AT_END	= O_APPEND
+};
+
+
+class BFile : public BNode, public BPositionIO {
+public:
+						BFile() {}
+						BFile(const char* path, uint32 openMode)
+							{ SetTo(path, openMode); }
+
+			status_t	SetTo(const char* path, uint32 openMode)
+						{
+							fPosition = 0;
+							return _Open(path, openMode);
+						}
+
+	virtual	ssize_t		ReadAt(off_t position, void* buffer, size_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							ssize_t read = pread(fFd, buffer, size, position);
+							return read < 0 ? _Error(errno) : read;
+						}
+	virtual	ssize_t		WriteAt(off_t position, const void* buffer,
+							size_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							ssize_t written = pwrite(fFd, buffer, size,
+								position);
+							return written < 0 ? _Error(errno) : written;
+						}
+	virtual	ssize_t		Read(void* buffer, size_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							ssize_t bytes = read(fFd, buffer, size);
+							return bytes < 0 ? _Error(errno) : bytes;
+						}
+	virtual	ssize_t		Write(const void* buffer, size_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							ssize_t bytes = write(fFd, buffer, size);
+							return bytes < 0 ? _Error(errno) : bytes;
+						}
+	virtual	off_t		Seek(off_t position, uint32 seekMode)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							off_t result = lseek(fFd, position, seekMode);
+							return result < 0 ? _Error(errno) : result;
+						}
+	virtual	off_t		Position() const
+						{
+							if (fInit != B_OK)
+								return fInit;
+							return lseek(fFd, 0, SEEK_CUR);
+						}
+	virtual	status_t	SetSize(off_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							return ftruncate(fFd, size) != 0
+								? _Error(errno) : B_OK;
+						}
+	virtual	status_t	GetSize(off_t* size) const
+						{
+							struct stat st;
+							if (fInit != B_OK)
+								return fInit;
+							if (fstat(fFd, &st) != 0)
+								return _Error(errno);
+							*size = st.st_size;
+							return B_OK;
+						}
+
+			status_t	Sync()
+						{
+							if (fInit != B_OK)
+								return fInit;
+							return fsync(fFd) != 0 ? _Error(errno) : B_OK;
+						}
+};
+
+#endif // _FILE_H
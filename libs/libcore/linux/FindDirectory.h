@@ -0,0 +1,33 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _FIND_DIRECTORY_H
+#define _FIND_DIRECTORY_H
+
+// Only what libcore uses, so it can be built off Haiku: settings go in
+// $HOME/config/settings, as they do on Haiku
+
+#include <stdlib.h>
+
+#include <Directory.h>
+
+
+typedef enum {
+	B_USER_SETTINGS_DIRECTORY = 3009
+} directory_which;
+
+
+inline status_t
+find_directory(directory_which which, BPath* path, bool createIt = false)
+{
+	const char* home = getenv("HOME");
+	if (which != B_USER_SETTINGS_DIRECTORY || home == NULL)
+		return B_BAD_VALUE;
+	status_t ret = path->SetTo(home, "config/settings");
+	if (ret == B_OK && createIt)
+		ret = create_directory(path->Path(), 0755);
+	return ret;
+}
+
+#endif // _FIND_DIRECTORY_H
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _GRAPHICS_DEFS_H
+#define _GRAPHICS_DEFS_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <SupportDefs.h>
+
+
+struct rgb_color {
+	uint8	red;
+	uint8	green;
+	uint8	blue;
+	uint8	alpha;
+
+	bool	operator==(const rgb_color& other) const
+			{
+				return red == other.red && green == other.green
+					&& blue == other.blue && alpha == other.alpha;
+			}
+	bool	operator!=(const rgb_color& other) const
+				{ return !(*this == other); }
+};
+
+
+inline rgb_color
+make_color(uint8 red, uint8 green, uint8 blue, uint8 alpha = 255)
+{
+	rgb_color color = { red, green, blue, alpha };
+	return color;
+}
+
+#endif // _GRAPHICS_DEFS_H
@@ -0,0 +1,26 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _LOCKER_H
+#define _LOCKER_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <mutex>
+
+#include <SupportDefs.h>
+
+
+class BLocker {
+public:
+				BLocker(const char* name = NULL) {}
+
+	bool		Lock() { fMutex.lock(); return true; }
+	void		Unlock() { fMutex.unlock(); }
+
+private:
+	std::recursive_mutex	fMutex;
+};
+
+#endif // _LOCKER_H
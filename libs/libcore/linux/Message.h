@@ -0,0 +1,294 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _MESSAGE_H
+#define _MESSAGE_H
+
+// Only what libcore uses, so it can be built off Haiku. Fields are kept in a
+// plain vector, and flattened in a format of its own, which Haiku's can't read;
+// it's no stand-in for BMessage's speed.
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <DataIO.h>
+#include <GraphicsDefs.h>
+#include <String.h>
+#include <TypeConstants.h>
+
+
+class BMessage {
+public:
+				BMessage(uint32 what = 0) : what(what) {}
+
+	status_t	AddData(const char* name, type_code type, const void* data,
+					ssize_t size, bool isFixedSize = true, int32 count = 1)
+				{
+					Field* field = _Field(name);
+					if (field == NULL) {
+						fFields.push_back(Field());
+						field = &fFields.back();
+						field->name = name;
+						field->type = type;
+					} else if (field->type != type)
+						return B_BAD_TYPE;
+					field->items.push_back(
+						std::string((const char*)data, size));
+					return B_OK;
+				}
+	status_t	FindData(const char* name, type_code type, int32 index,
+					const void** data, ssize_t* size) const
+				{
+					const Field* field = _Field(name);
+					if (field == NULL)
+						return B_NAME_NOT_FOUND;
+					if (field->type != type)
+						return B_BAD_TYPE;
+					if (index < 0 || index >= (int32)field->items.size())
+						return B_BAD_INDEX;
+					*data = field->items[index].data();
+					*size = field->items[index].size();
+					return B_OK;
+				}
+	status_t	FindData(const char* name, type_code type, const void** data,
+					ssize_t* size) const
+					{ return FindData(name, type, 0, data, size); }
+
+	status_t	RemoveName(const char* name)
+				{
+					for (size_t i = 0; i < fFields.size(); i++)
+						if (fFields[i].name == name) {
+							fFields.erase(fFields.begin() + i);
+							return B_OK;
+						}
+					return B_NAME_NOT_FOUND;
+				}
+	bool		HasName(const char* name) const
+					{ return _Field(name) != NULL; }
+	void		MakeEmpty() { fFields.clear(); }
+
+	status_t	AddBool(const char* name, bool value)
+					{ return _Add(name, B_BOOL_TYPE, value); }
+	status_t	AddInt32(const char* name, int32 value)
+					{ return _Add(name, B_INT32_TYPE, value); }
+	status_t	AddInt64(const char* name, int64 value)
+					{ return _Add(name, B_INT64_TYPE, value); }
+	status_t	AddFloat(const char* name, float value)
+					{ return _Add(name, B_FLOAT_TYPE, value); }
+	status_t	AddUInt16(const char* name, uint16 value)
+					{ return _Add(name, B_UINT16_TYPE, value); }
+	status_t	AddColor(const char* name, rgb_color value)
+					{ return _Add(name, B_RGB_COLOR_TYPE, value); }
+	status_t	AddString(const char* name, const char* string)
+					{ return AddData(name, B_STRING_TYPE, string,
+						strlen(string) + 1, false); }
+	status_t	AddString(const char* name, const BString& string)
+					{ return AddString(name, string.String()); }
+	status_t	AddMessage(const char* name, const BMessage* message)
+				{
+					BMallocIO flat;
+					status_t ret = message->Flatten(&flat);
+					if (ret != B_OK)
+						return ret;
+					return AddData(name, B_MESSAGE_TYPE, flat.Buffer(),
+						flat.BufferLength(), false);
+				}
+
+	status_t	FindBool(const char* name, int32 index, bool* value) const
+					{ return _Find(name, B_BOOL_TYPE, index, value); }
+	status_t	FindBool(const char* name, bool* value) const
+					{ return FindBool(name, 0, value); }
+	status_t	FindInt32(const char* name, int32 index, int32* value) const
+					{ return _Find(name, B_INT32_TYPE, index, value); }
+	status_t	FindInt32(const char* name, int32* value) const
+					{ return FindInt32(name, 0, value); }
+	status_t	FindInt64(const char* name, int32 index, int64* value) const
+					{ return _Find(name, B_INT64_TYPE, index, value); }
+	status_t	FindInt64(const char* name, int64* value) const
+					{ return FindInt64(name, 0, value); }
+	status_t	FindFloat(const char* name, int32 index, float* value) const
+					{ return _Find(name, B_FLOAT_TYPE, index, value); }
+	status_t	FindFloat(const char* name, float* value) const
+					{ return FindFloat(name, 0, value); }
+	status_t	FindUInt16(const char* name, int32 index, uint16* value) const
+					{ return _Find(name, B_UINT16_TYPE, index, value); }
+	status_t	FindUInt16(const char* name, uint16* value) const
+					{ return FindUInt16(name, 0, value); }
+	status_t	FindColor(const char* name, int32 index, rgb_color* value) const
+					{ return _Find(name, B_RGB_COLOR_TYPE, index, value); }
+	status_t	FindColor(const char* name, rgb_color* value) const
+					{ return FindColor(name, 0, value); }
+
+	status_t	FindString(const char* name, int32 index,
+					const char** string) const
+				{
+					ssize_t size;
+					return FindData(name, B_STRING_TYPE, index,
+						(const void**)string, &size);
+				}
+	status_t	FindString(const char* name, int32 index,
+					BString* string) const
+				{
+					const char* found = NULL;
+					status_t ret = FindString(name, index, &found);
+					if (ret == B_OK)
+						*string = found;
+					return ret;
+				}
+	status_t	FindString(const char* name, BString* string) const
+					{ return FindString(name, 0, string); }
+	const char*	FindString(const char* name, int32 index = 0) const
+				{
+					const char* found = NULL;
+					FindString(name, index, &found);
+					return found;
+				}
+
+	status_t	FindMessage(const char* name, int32 index,
+					BMessage* message) const
+				{
+					const void* data = NULL;
+					ssize_t size = 0;
+					status_t ret = FindData(name, B_MESSAGE_TYPE, index, &data,
+						&size);
+					if (ret != B_OK)
+						return ret;
+					BMemoryIO flat(data, size);
+					return message->Unflatten(&flat);
+				}
+	status_t	FindMessage(const char* name, BMessage* message) const
+					{ return FindMessage(name, 0, message); }
+
+	bool		GetBool(const char* name, bool defaultValue) const
+					{ return _Get(name, B_BOOL_TYPE, defaultValue); }
+	int32		GetInt32(const char* name, int32 defaultValue) const
+					{ return _Get(name, B_INT32_TYPE, defaultValue); }
+	int64		GetInt64(const char* name, int64 defaultValue) const
+					{ return _Get(name, B_INT64_TYPE, defaultValue); }
+	float		GetFloat(const char* name, float defaultValue) const
+					{ return _Get(name, B_FLOAT_TYPE, defaultValue); }
+
+	// what, the field count, then each field's name, type, item count and
+	// items, each preceded by its size
+	status_t	Flatten(BDataIO* stream, ssize_t* size = NULL) const
+				{
+					std::string flat;
+					_Append(&flat, what);
+					_Append(&flat, (uint32)fFields.size());
+					for (size_t i = 0; i < fFields.size(); i++) {
+						const Field& field = fFields[i];
+						_Append(&flat, (uint32)field.name.size());
+						flat += field.name;
+						_Append(&flat, field.type);
+						_Append(&flat, (uint32)field.items.size());
+						for (size_t j = 0; j < field.items.size(); j++) {
+							_Append(&flat, (uint32)field.items[j].size());
+							flat += field.items[j];
+						}
+					}
+					ssize_t written = stream->Write(flat.data(), flat.size());
+					if (written < 0)
+						return written;
+					if (written != (ssize_t)flat.size())
+						return B_IO_ERROR;
+					if (size != NULL)
+						*size = written;
+					return B_OK;
+				}
+	status_t	Unflatten(BDataIO* stream)
+				{
+					MakeEmpty();
+					uint32 count;
+					if (_Read(stream, &what) != B_OK
+							|| _Read(stream, &count) != B_OK)
+						return B_BAD_DATA;
+					for (uint32 i = 0; i < count; i++) {
+						Field field;
+						uint32 items;
+						if (_Read(stream, &field.name) != B_OK
+								|| _Read(stream, &field.type) != B_OK
+								|| _Read(stream, &items) != B_OK)
+							return B_BAD_DATA;
+						field.items.resize(items);
+						for (uint32 j = 0; j < items; j++)
+							if (_Read(stream, &field.items[j]) != B_OK)
+								return B_BAD_DATA;
+						fFields.push_back(field);
+					}
+					return B_OK;
+				}
+
+	uint32		what;
+
+private:
+	struct Field {
+		std::string					name;
+		type_code					type;
+		std::vector<std::string>	items;
+	};
+
+	template<typename T>
+	status_t	_Add(const char* name, type_code type, const T& value)
+					{ return AddData(name, type, &value, sizeof(T)); }
+	template<typename T>
+	status_t	_Find(const char* name, type_code type, int32 index,
+					T* value) const
+				{
+					const void* data = NULL;
+					ssize_t size = 0;
+					status_t ret = FindData(name, type, index, &data, &size);
+					if (ret == B_OK && size == sizeof(T))
+						memcpy(value, data, sizeof(T));
+					return ret == B_OK && size != sizeof(T) ? B_BAD_DATA : ret;
+				}
+	template<typename T>
+	T			_Get(const char* name, type_code type, T defaultValue) const
+				{
+					T value;
+					return _Find(name, type, 0, &value) == B_OK
+						? value : defaultValue;
+				}
+
+	template<typename T>
+	static void	_Append(std::string* flat, const T& value)
+					{ flat->append((const char*)&value, sizeof(T)); }
+	template<typename T>
+	static status_t _Read(BDataIO* stream, T* value)
+				{
+					return stream->Read(value, sizeof(T)) == sizeof(T)
+						? B_OK : B_BAD_DATA;
+				}
+	static status_t _Read(BDataIO* stream, std::string* value)
+				{
+					uint32 size;
+					if (_Read(stream, &size) != B_OK)
+						return B_BAD_DATA;
+					value->resize(size);
+					if (size > 0 && stream->Read(&(*value)[0], size)
+							!= (ssize_t)size)
+						return B_BAD_DATA;
+					return B_OK;
+				}
+
+	const Field* _Field(const char* name) const
+				{
+					for (size_t i = 0; i < fFields.size(); i++)
+						if (fFields[i].name == name)
+							return &fFields[i];
+					return NULL;
+				}
+	Field*		_Field(const char* name)
+				{
+					for (size_t i = 0; i < fFields.size(); i++)
+						if (fFields[i].name == name)
+							return &fFields[i];
+					return NULL;
+				}
+
+	std::vector<Field>	fFields;
+};
+
+#endif // _MESSAGE_H
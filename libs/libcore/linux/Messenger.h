@@ -0,0 +1,21 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _MESSENGER_H
+#define _MESSENGER_H
+
+// Only what libcore uses, so it can be built off Haiku. There are no loopers
+// to send to, so no messenger's ever valid.
+
+#include <Message.h>
+
+
+class BMessenger {
+public:
+	bool		IsValid() const { return false; }
+	status_t	SendMessage(BMessage* message) const { return B_BAD_PORT_ID; }
+	status_t	SendMessage(uint32 what) const { return B_BAD_PORT_ID; }
+};
+
+#endif // _MESSENGER_H
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _NODE_H
+#define _NODE_H
+
+// Only what libcore uses, so it can be built off Haiku. Attributes are kept
+// as "user." extended attributes, their type before their data.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <SupportDefs.h>
+#include <TypeConstants.h>
+
+#include <kernel/fs_attr.h>
+
+
+class BNode {
+public:
+						BNode() : fFd(-1), fInit(B_NO_INIT) {}
+						BNode(const char* path) : fFd(-1), fInit(B_NO_INIT)
+							{ SetTo(path); }
+	virtual				~BNode() { Unset(); }
+
+			status_t	SetTo(const char* path)
+							{ return _Open(path, O_RDONLY); }
+			void		Unset()
+						{
+							if (fFd >= 0)
+								close(fFd);
+							fFd = -1;
+							fInit = B_NO_INIT;
+						}
+			status_t	InitCheck() const { return fInit; }
+
+			status_t	GetAttrInfo(const char* name, attr_info* info) const
+						{
+							std::string attr;
+							status_t ret = _ReadAttr(name, &attr);
+							if (ret != B_OK)
+								return ret;
+							memcpy(&info->type, attr.data(), sizeof(uint32));
+							info->size = attr.size() - sizeof(uint32);
+							return B_OK;
+						}
+			ssize_t		ReadAttr(const char* name, type_code type,
+							off_t position, void* buffer, size_t size) const
+						{
+							std::string attr;
+							status_t ret = _ReadAttr(name, &attr);
+							if (ret != B_OK)
+								return ret;
+							size_t length = attr.size() - sizeof(uint32);
+							if (position < 0 || (size_t)position >= length)
+								return 0;
+							if (size > length - position)
+								size = length - position;
+							memcpy(buffer, attr.data() + sizeof(uint32)
+								+ position, size);
+							return size;
+						}
+			// Written from position 0, it replaces what was there
+			ssize_t		WriteAttr(const char* name, type_code type,
+							off_t position, const void* buffer, size_t size)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							std::string attr;
+							if (position > 0
+									&& _ReadAttr(name, &attr) == B_OK)
+								attr.erase(0, sizeof(uint32));
+							else
+								attr.clear();
+							if (attr.size() < position + size)
+								attr.resize(position + size);
+							attr.replace(position, size, (const char*)buffer,
+								size);
+							attr.insert(0, (const char*)&type, sizeof(type));
+							if (fsetxattr(fFd, _AttrName(name).c_str(),
+									attr.data(), attr.size(), 0) != 0)
+								return _Error(errno);
+							return size;
+						}
+			status_t	RemoveAttr(const char* name)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							if (fremovexattr(fFd, _AttrName(name).c_str())
+									!= 0)
+								return _Error(errno);
+							return B_OK;
+						}
+
+			status_t	GetModificationTime(time_t* modified) const
+						{
+							struct stat st;
+							if (fInit != B_OK || fstat(fFd, &st) != 0)
+								return B_FILE_ERROR;
+							*modified = st.st_mtime;
+							return B_OK;
+						}
+			status_t	SetModificationTime(time_t modified)
+						{
+							struct timespec times[2];
+							times[0].tv_nsec = UTIME_OMIT;
+							times[1].tv_sec = modified;
+							times[1].tv_nsec = 0;
+							if (fInit != B_OK || futimens(fFd, times) != 0)
+								return B_FILE_ERROR;
+							return B_OK;
+						}
+			// Where the file system doesn't keep it, the modification time
+			status_t	GetCreationTime(time_t* created) const
+						{
+							struct statx st;
+							if (fInit != B_OK)
+								return fInit;
+							if (statx(fFd, "", AT_EMPTY_PATH, STATX_BTIME, &st)
+									== 0 && (st.stx_mask & STATX_BTIME) != 0) {
+								*created = st.stx_btime.tv_sec;
+								return B_OK;
+							}
+							return GetModificationTime(created);
+						}
+
+protected:
+			status_t	_Open(const char* path, int mode)
+						{
+							Unset();
+							fFd = open(path, mode | O_CLOEXEC, 0644);
+							fInit = fFd < 0 ? _Error(errno) : B_OK;
+							return fInit;
+						}
+
+	static	status_t	_Error(int error)
+						{
+							switch (error) {
+								case ENOENT:
+									return B_ENTRY_NOT_FOUND;
+								case ENODATA:
+									return B_ENTRY_NOT_FOUND;
+								case EEXIST:
+									return B_FILE_EXISTS;
+								case ENOMEM:
+									return B_NO_MEMORY;
+								case EACCES:
+								case EPERM:
+									return B_NOT_ALLOWED;
+								case EINVAL:
+									return B_BAD_VALUE;
+								default:
+									return B_IO_ERROR;
+							}
+						}
+
+			int			fFd;
+			status_t	fInit;
+
+private:
+	static	std::string	_AttrName(const char* name)
+							{ return std::string("user.") + name; }
+
+			status_t	_ReadAttr(const char* name, std::string* attr) const
+						{
+							if (fInit != B_OK)
+								return fInit;
+							std::string attrName = _AttrName(name);
+							ssize_t size = fgetxattr(fFd, attrName.c_str(),
+								NULL, 0);
+							if (size >= 0) {
+								attr->resize(size);
+								size = fgetxattr(fFd, attrName.c_str(),
+									&(*attr)[0], size);
+							}
+							if (size < 0)
+								return _Error(errno);
+							if ((size_t)size < sizeof(uint32))
+								return B_BAD_DATA;
+							attr->resize(size);
+							return B_OK;
+						}
+};
+
+#endif // _NODE_H
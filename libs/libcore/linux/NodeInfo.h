@@ -0,0 +1,30 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _NODE_INFO_H
+#define _NODE_INFO_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <string.h>
+
+#include <Node.h>
+
+
+class BNodeInfo {
+public:
+				BNodeInfo(BNode* node) : fNode(node) {}
+
+	status_t	SetType(const char* type)
+				{
+					ssize_t written = fNode->WriteAttr("BEOS:TYPE",
+						B_MIME_STRING_TYPE, 0, type, strlen(type) + 1);
+					return written < 0 ? (status_t)written : B_OK;
+				}
+
+private:
+	BNode*		fNode;
+};
+
+#endif // _NODE_INFO_H
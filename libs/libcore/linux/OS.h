@@ -0,0 +1,266 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _OS_H
+#define _OS_H
+
+// Only what libcore uses, so it can be built off Haiku: semaphores and
+// threads, kept in tables of their own by ID
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <SupportDefs.h>
+
+
+typedef int32 sem_id;
+typedef int32 thread_id;
+typedef status_t (*thread_func)(void*);
+
+#define B_INFINITE_TIMEOUT	(9223372036854775807LL)
+
+enum {
+	B_CAN_INTERRUPT		= 0x01,
+	B_DO_NOT_RESCHEDULE	= 0x02,
+	B_RELATIVE_TIMEOUT	= 0x08,
+	B_ABSOLUTE_TIMEOUT	= 0x10
+};
+
+#define B_LOW_PRIORITY		5
+#define B_NORMAL_PRIORITY	10
+
+
+inline bigtime_t
+system_time()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+namespace os_stand_in {
+
+struct semaphore {
+	std::mutex				lock;
+	std::condition_variable	released;
+	int32					count;
+	bool					deleted;
+};
+
+
+struct thread {
+	std::thread				thread;
+	thread_func				function;
+	void*					data;
+	status_t				result;
+};
+
+
+template<typename Type>
+struct table {
+	std::mutex								lock;
+	std::map<int32, std::shared_ptr<Type> >	items;
+	int32									next = 1;
+
+	int32	Add(std::shared_ptr<Type> item)
+			{
+				std::lock_guard<std::mutex> _(lock);
+				items[next] = item;
+				return next++;
+			}
+	std::shared_ptr<Type> Find(int32 id)
+			{
+				std::lock_guard<std::mutex> _(lock);
+				typename std::map<int32, std::shared_ptr<Type> >::iterator
+					found = items.find(id);
+				return found != items.end()
+					? found->second : std::shared_ptr<Type>();
+			}
+	std::shared_ptr<Type> Remove(int32 id)
+			{
+				std::lock_guard<std::mutex> _(lock);
+				std::shared_ptr<Type> item;
+				typename std::map<int32, std::shared_ptr<Type> >::iterator
+					found = items.find(id);
+				if (found != items.end()) {
+					item = found->second;
+					items.erase(found);
+				}
+				return item;
+			}
+};
+
+
+inline table<semaphore>&
+semaphores()
+{
+	static table<semaphore> sSemaphores;
+	return sSemaphores;
+}
+
+
+inline table<thread>&
+threads()
+{
+	static table<thread> sThreads;
+	return sThreads;
+}
+
+
+// Those not spawned, like the main thread, get theirs when first asked
+inline thread_id&
+current_thread()
+{
+	static thread_local thread_id sCurrent = -1;
+	return sCurrent;
+}
+
+} // namespace os_stand_in
+
+
+inline sem_id
+create_sem(int32 count, const char* name)
+{
+	std::shared_ptr<os_stand_in::semaphore> semaphore(
+		new os_stand_in::semaphore);
+	semaphore->count = count;
+	semaphore->deleted = false;
+	return os_stand_in::semaphores().Add(semaphore);
+}
+
+
+// Wakes any waiting, with B_BAD_SEM_ID
+inline status_t
+delete_sem(sem_id id)
+{
+	std::shared_ptr<os_stand_in::semaphore> semaphore
+		= os_stand_in::semaphores().Remove(id);
+	if (!semaphore)
+		return B_BAD_SEM_ID;
+	std::lock_guard<std::mutex> _(semaphore->lock);
+	semaphore->deleted = true;
+	semaphore->released.notify_all();
+	return B_OK;
+}
+
+
+inline status_t
+acquire_sem_etc(sem_id id, int32 count, uint32 flags, bigtime_t timeout)
+{
+	std::shared_ptr<os_stand_in::semaphore> semaphore
+		= os_stand_in::semaphores().Find(id);
+	if (!semaphore)
+		return B_BAD_SEM_ID;
+
+	std::unique_lock<std::mutex> lock(semaphore->lock);
+	bool timed = (flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) != 0
+		&& timeout != B_INFINITE_TIMEOUT;
+	if (timed && (flags & B_ABSOLUTE_TIMEOUT) != 0)
+		timeout -= system_time();
+	if (timed && timeout <= 0) {
+		if (semaphore->count < count)
+			return B_WOULD_BLOCK;
+	} else if (timed) {
+		if (semaphore->released.wait_for(lock,
+				std::chrono::microseconds(timeout), [&] {
+					return semaphore->deleted || semaphore->count >= count;
+				}) == false)
+			return B_TIMED_OUT;
+	} else {
+		semaphore->released.wait(lock, [&] {
+			return semaphore->deleted || semaphore->count >= count;
+		});
+	}
+	if (semaphore->deleted)
+		return B_BAD_SEM_ID;
+	semaphore->count -= count;
+	return B_OK;
+}
+
+
+inline status_t
+acquire_sem(sem_id id)
+{
+	return acquire_sem_etc(id, 1, 0, 0);
+}
+
+
+inline status_t
+release_sem_etc(sem_id id, int32 count, uint32 flags)
+{
+	std::shared_ptr<os_stand_in::semaphore> semaphore
+		= os_stand_in::semaphores().Find(id);
+	if (!semaphore)
+		return B_BAD_SEM_ID;
+	std::lock_guard<std::mutex> _(semaphore->lock);
+	semaphore->count += count;
+	semaphore->released.notify_all();
+	return B_OK;
+}
+
+
+inline status_t
+release_sem(sem_id id)
+{
+	return release_sem_etc(id, 1, 0);
+}
+
+
+inline thread_id
+find_thread(const char* name)
+{
+	thread_id& current = os_stand_in::current_thread();
+	if (current < 0)
+		current = os_stand_in::threads().Add(
+			std::shared_ptr<os_stand_in::thread>(new os_stand_in::thread));
+	return current;
+}
+
+
+// Made suspended, as on Haiku, until resume_thread()
+inline thread_id
+spawn_thread(thread_func function, const char* name, int32 priority,
+	void* data)
+{
+	std::shared_ptr<os_stand_in::thread> thread(new os_stand_in::thread);
+	thread->function = function;
+	thread->data = data;
+	thread->result = B_OK;
+	return os_stand_in::threads().Add(thread);
+}
+
+
+inline status_t
+resume_thread(thread_id id)
+{
+	std::shared_ptr<os_stand_in::thread> thread
+		= os_stand_in::threads().Find(id);
+	if (!thread || thread->function == NULL || thread->thread.joinable())
+		return B_BAD_THREAD_ID;
+	os_stand_in::thread* running = thread.get();
+	thread->thread = std::thread([running, id] {
+		os_stand_in::current_thread() = id;
+		running->result = running->function(running->data);
+	});
+	return B_OK;
+}
+
+
+inline status_t
+wait_for_thread(thread_id id, status_t* result)
+{
+	std::shared_ptr<os_stand_in::thread> thread
+		= os_stand_in::threads().Remove(id);
+	if (!thread || thread->thread.joinable() == false)
+		return B_BAD_THREAD_ID;
+	thread->thread.join();
+	*result = thread->result;
+	return B_OK;
+}
+
+#endif // _OS_H
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _PATH_H
+#define _PATH_H
+
+// Only what libcore uses, so it can be built off Haiku. Paths are only tidied
+// of doubled and trailing slashes, never resolved.
+
+#include <string>
+
+#include <SupportDefs.h>
+
+
+class BPath {
+public:
+						BPath() : fInit(B_NO_INIT) {}
+						BPath(const char* path, const char* leaf = NULL)
+							: fInit(B_NO_INIT) { SetTo(path, leaf); }
+
+			status_t	InitCheck() const { return fInit; }
+			status_t	SetTo(const char* path, const char* leaf = NULL)
+						{
+							fPath.clear();
+							fInit = B_BAD_VALUE;
+							if (path == NULL || path[0] == '\0')
+								return fInit;
+							fPath = path;
+							fInit = B_OK;
+							_Tidy();
+							return leaf != NULL ? Append(leaf) : B_OK;
+						}
+			void		Unset() { fPath.clear(); fInit = B_NO_INIT; }
+
+			status_t	Append(const char* path)
+						{
+							if (fInit != B_OK)
+								return fInit;
+							if (path == NULL || path[0] == '\0')
+								return B_OK;
+							if (path[0] == '/')
+								return B_BAD_VALUE;
+							if (fPath != "/")
+								fPath += '/';
+							fPath += path;
+							_Tidy();
+							return B_OK;
+						}
+
+			const char*	Path() const
+							{ return fInit == B_OK ? fPath.c_str() : NULL; }
+			const char*	Leaf() const
+						{
+							if (fInit != B_OK)
+								return NULL;
+							std::string::size_type slash = fPath.rfind('/');
+							return fPath.c_str()
+								+ (slash == std::string::npos ? 0 : slash + 1);
+						}
+
+private:
+			void		_Tidy()
+						{
+							std::string::size_type index;
+							while ((index = fPath.find("//"))
+									!= std::string::npos)
+								fPath.erase(index, 1);
+							if (fPath.size() > 1 && fPath.back() == '/')
+								fPath.pop_back();
+						}
+
+			std::string	fPath;
+			status_t	fInit;
+};
+
+#endif // _PATH_H
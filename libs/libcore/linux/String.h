@@ -0,0 +1,178 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _B_STRING_H
+#define _B_STRING_H
+
+// Only what libcore and libsupport use, so they can be built off Haiku.
+// Offsets and counts are in bytes, not (as on Haiku) UTF-8 characters.
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#include <SupportDefs.h>
+
+class BStringList;
+
+
+class BString : public std::string {
+public:
+				BString() {}
+				BString(const char* string)
+					: std::string(string != NULL ? string : "") {}
+				BString(const std::string& string) : std::string(string) {}
+
+	const char*	String() const { return c_str(); }
+				operator const char*() const { return c_str(); }
+	int32		Length() const { return size(); }
+	int32		CountChars() const
+				{
+					int32 count = 0;
+					for (size_type i = 0; i < size(); i++)
+						if (((*this)[i] & 0xc0) != 0x80)
+							count++;
+					return count;
+				}
+	bool		IsEmpty() const { return empty(); }
+	char		ByteAt(int32 index) const
+					{ return index >= 0 && index < Length() ? at(index) : 0; }
+
+	int			ICompare(const BString& string) const
+					{ return strcasecmp(String(), string.String()); }
+	int			ICompare(const BString& string, int32 length) const
+					{ return strncasecmp(String(), string.String(), length); }
+
+	bool		StartsWith(const char* prefix) const
+					{ return compare(0, strlen(prefix), prefix) == 0; }
+	bool		EndsWith(const char* suffix) const
+				{
+					size_type length = strlen(suffix);
+					return length <= size()
+						&& compare(size() - length, length, suffix) == 0;
+				}
+	int32		FindFirst(const char* string) const
+				{
+					size_type index = find(string);
+					return index == npos ? B_ERROR : (int32)index;
+				}
+	int32		FindFirst(char c, int32 fromOffset = 0) const
+				{
+					size_type index = find(c, fromOffset);
+					return index == npos ? B_ERROR : (int32)index;
+				}
+
+	BString&	CopyInto(BString& into, int32 fromOffset, int32 length) const
+				{
+					into.assign(*this, fromOffset, length);
+					return into;
+				}
+
+	// Up to maxLength, until UnlockBuffer() sets the length
+	char*		LockBuffer(int32 maxLength)
+				{
+					if (maxLength > Length())
+						resize(maxLength);
+					return &(*this)[0];
+				}
+	BString&	UnlockBuffer(int32 length = -1)
+				{
+					resize(length < 0 ? strlen(c_str()) : length);
+					return *this;
+				}
+
+	bool		Split(const char* separator, bool noEmptyStrings,
+					BStringList& _list) const;
+
+	BString&	SetTo(const char* string, int32 length)
+					{ assign(string, length); return *this; }
+	BString&	SetToFormat(const char* format, ...)
+				{
+					va_list args;
+					va_start(args, format);
+					int length = vsnprintf(NULL, 0, format, args);
+					va_end(args);
+					if (length < 0)
+						return *this;
+					resize(length);
+					va_start(args, format);
+					vsnprintf(&(*this)[0], length + 1, format, args);
+					va_end(args);
+					return *this;
+				}
+	BString&	Truncate(int32 length)
+				{
+					if (length < Length())
+						resize(length < 0 ? 0 : length);
+					return *this;
+				}
+	BString&	RemoveChars(int32 from, int32 count)
+				{
+					if (from >= 0 && from < Length())
+						erase(from, count);
+					return *this;
+				}
+	BString&	RemoveFirst(const char* string)
+				{
+					size_type index = find(string);
+					if (index != npos)
+						erase(index, strlen(string));
+					return *this;
+				}
+	BString&	RemoveCharsSet(const char* set)
+				{
+					size_type index;
+					while ((index = find_first_of(set)) != npos)
+						erase(index, 1);
+					return *this;
+				}
+
+	BString&	ToLower()
+				{
+					for (size_type i = 0; i < size(); i++)
+						(*this)[i] = tolower((unsigned char)(*this)[i]);
+					return *this;
+				}
+	BString&	ReplaceAll(const char* replaceThis, const char* withThis)
+				{
+					size_type length = strlen(replaceThis);
+					size_type withLength = strlen(withThis);
+					if (length == 0)
+						return *this;
+					for (size_type index = find(replaceThis); index != npos;
+							index = find(replaceThis, index + withLength))
+						replace(index, length, withThis);
+					return *this;
+				}
+	BString&	ReplaceAll(char replaceThis, char withThis)
+				{
+					for (size_type i = 0; i < size(); i++)
+						if ((*this)[i] == replaceThis)
+							(*this)[i] = withThis;
+					return *this;
+				}
+
+	BString&	operator<<(const char* string)
+					{ append(string); return *this; }
+	BString&	operator<<(const BString& string)
+					{ append(string); return *this; }
+	BString&	operator<<(char c)
+					{ push_back(c); return *this; }
+	BString&	operator<<(int32 value)
+					{ append(std::to_string(value)); return *this; }
+	BString&	operator<<(uint32 value)
+					{ append(std::to_string(value)); return *this; }
+	BString&	operator<<(int64 value)
+					{ append(std::to_string(value)); return *this; }
+};
+
+
+// For Split()
+#include <StringList.h>
+
+#endif // _B_STRING_H
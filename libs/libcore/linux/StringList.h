@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _STRING_LIST_H
+#define _STRING_LIST_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <vector>
+
+#include <String.h>
+
+
+class BStringList {
+public:
+	bool		Add(const BString& string)
+					{ fStrings.push_back(string); return true; }
+	bool		Remove(int32 index)
+				{
+					if (index < 0 || index >= CountStrings())
+						return false;
+					fStrings.erase(fStrings.begin() + index);
+					return true;
+				}
+	bool		Remove(const BString& string)
+					{ return Remove(IndexOf(string)); }
+	bool		Replace(int32 index, const BString& string)
+				{
+					if (index < 0 || index >= CountStrings())
+						return false;
+					fStrings[index] = string;
+					return true;
+				}
+	void		MakeEmpty() { fStrings.clear(); }
+
+	BString		StringAt(int32 index) const
+				{
+					if (index < 0 || index >= CountStrings())
+						return BString();
+					return fStrings[index];
+				}
+	BString		First() const { return StringAt(0); }
+	BString		Last() const { return StringAt(CountStrings() - 1); }
+
+	int32		IndexOf(const BString& string) const
+				{
+					for (int32 i = 0; i < CountStrings(); i++)
+						if (fStrings[i] == string)
+							return i;
+					return -1;
+				}
+	bool		HasString(const BString& string) const
+					{ return IndexOf(string) >= 0; }
+
+	int32		CountStrings() const { return fStrings.size(); }
+	bool		IsEmpty() const { return fStrings.empty(); }
+
+private:
+	std::vector<BString> fStrings;
+};
+
+
+inline bool
+BString::Split(const char* separator, bool noEmptyStrings,
+	BStringList& _list) const
+{
+	size_type length = strlen(separator);
+	size_type start = 0;
+	while (true) {
+		size_type end = length > 0 ? find(separator, start) : npos;
+		BString part(substr(start, end == npos ? npos : end - start));
+		if (noEmptyStrings == false || part.IsEmpty() == false)
+			_list.Add(part);
+		if (end == npos)
+			return true;
+		start = end + length;
+	}
+}
+
+#endif // _STRING_LIST_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _SUPPORT_DEFS_H
+#define _SUPPORT_DEFS_H
+
+// Only what libcore and libsupport use, so they can be built off Haiku
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef int8_t int8;
+typedef uint8_t uint8;
+typedef int16_t int16;
+typedef uint16_t uint16;
+typedef int32_t int32;
+typedef uint32_t uint32;
+typedef int64_t int64;
+typedef uint64_t uint64;
+typedef uintptr_t addr_t;
+
+typedef int32 status_t;
+typedef int64 bigtime_t;
+typedef uint32 type_code;
+
+#define B_PRIu32			PRIu32
+#define B_SCNu32			SCNu32
+
+#define B_OK				((status_t)0)
+#define B_ERROR				(-1)
+#define B_NO_MEMORY			(-2147483647 - 1)
+#define B_IO_ERROR			(B_NO_MEMORY + 1)
+#define B_BAD_INDEX			(B_NO_MEMORY + 3)
+#define B_BAD_TYPE			(B_NO_MEMORY + 4)
+#define B_BAD_VALUE			(B_NO_MEMORY + 5)
+#define B_NAME_NOT_FOUND	(B_NO_MEMORY + 7)
+#define B_TIMED_OUT			(B_NO_MEMORY + 9)
+#define B_INTERRUPTED		(B_NO_MEMORY + 10)
+#define B_WOULD_BLOCK		(B_NO_MEMORY + 11)
+#define B_NO_INIT			(B_NO_MEMORY + 13)
+#define B_NOT_ALLOWED		(B_NO_MEMORY + 15)
+#define B_BAD_DATA			(B_NO_MEMORY + 16)
+
+#define B_BAD_SEM_ID		(B_NO_MEMORY + 0x1000)
+#define B_BAD_THREAD_ID		(B_NO_MEMORY + 0x1100)
+#define B_BAD_PORT_ID		(B_NO_MEMORY + 0x1300)
+
+#define B_FILE_ERROR		(B_NO_MEMORY + 0x6000)
+#define B_FILE_EXISTS		(B_FILE_ERROR + 2)
+#define B_ENTRY_NOT_FOUND	(B_FILE_ERROR + 3)
+
+
+// Each returns the previous value, save the getters
+
+inline int32
+atomic_add(int32* value, int32 addValue)
+{
+	return __atomic_fetch_add(value, addValue, __ATOMIC_SEQ_CST);
+}
+
+
+inline int32
+atomic_get(int32* value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+
+inline int32
+atomic_set(int32* value, int32 newValue)
+{
+	return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+
+inline int32
+atomic_get_and_set(int32* value, int32 newValue)
+{
+	return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+
+inline int32
+atomic_test_and_set(int32* value, int32 newValue, int32 testAgainst)
+{
+	__atomic_compare_exchange_n(value, &testAgainst, newValue, false,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return testAgainst;
+}
+
+
+inline int64
+atomic_get64(int64* value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+
+inline int64
+atomic_set64(int64* value, int64 newValue)
+{
+	return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+
+template<typename PointerType>
+inline PointerType
+atomic_pointer_get(PointerType* pointer)
+{
+	return __atomic_load_n(pointer, __ATOMIC_SEQ_CST);
+}
+
+
+template<typename PointerType>
+inline PointerType
+atomic_pointer_get_and_set(PointerType* pointer, const PointerType& set)
+{
+	return __atomic_exchange_n(pointer, set, __ATOMIC_SEQ_CST);
+}
+
+
+template<typename PointerType>
+inline PointerType
+atomic_pointer_test_and_set(PointerType* pointer, const PointerType& set,
+	const PointerType& test)
+{
+	PointerType previous = test;
+	__atomic_compare_exchange_n(pointer, &previous, set, false,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return previous;
+}
+
+#endif // _SUPPORT_DEFS_H
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _TYPE_CONSTANTS_H
+#define _TYPE_CONSTANTS_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+enum {
+	B_ANY_TYPE			= 'ANYT',
+	B_BOOL_TYPE			= 'BOOL',
+	B_FLOAT_TYPE		= 'FLOT',
+	B_INT32_TYPE		= 'LONG',
+	B_INT64_TYPE		= 'LLNG',
+	B_MESSAGE_TYPE		= 'MSGG',
+	B_MIME_STRING_TYPE	= 'MIMS',
+	B_RAW_TYPE			= 'RAWT',
+	B_RGB_COLOR_TYPE	= 'RGBC',
+	B_STRING_TYPE		= 'CSTR',
+	B_UINT16_TYPE		= 'USHT'
+};
+
+#endif // _TYPE_CONSTANTS_H
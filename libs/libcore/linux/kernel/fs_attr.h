@@ -0,0 +1,18 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _FS_ATTR_H
+#define _FS_ATTR_H
+
+// Only what libcore uses, so it can be built off Haiku
+
+#include <SupportDefs.h>
+
+
+typedef struct attr_info {
+	uint32	type;
+	off_t	size;
+} attr_info;
+
+#endif // _FS_ATTR_H
@@ -160,6 +160,14 @@ UrlTextView::Select(int32 startOffset, int32 endOffset)
 
 void
 UrlTextView::Insert(const char* text, const text_run_array* runs)
+{
+	InsertAt(TextLength(), text, runs);
+}
+
+
+int32
+UrlTextView::InsertAt(int32 offset, const char* text,
+	const text_run_array* runs)
 {
 	BString buf(text);
 
@@ -175,22 +183,25 @@ UrlTextView::Insert(const char* text, const text_run_array* runs)
 		if (lastEnd < specStart) {
 			BString normie;
 			buf.CopyCharsInto(normie, lastEnd, specStart - lastEnd);
-			BTextView::Insert(TextLength(), normie.String(), normie.Length(),
-				runs);
+			BTextView::Insert(offset, normie.String(), normie.Length(), runs);
+			offset += normie.Length();
 		}
 		BString special;
 		buf.CopyCharsInto(special, specStart, specEnd - specStart);
-		BTextView::Insert(TextLength(), special.String(), special.Length(),
+		BTextView::Insert(offset, special.String(), special.Length(),
 			&fUrlRun);
+		offset += special.Length();
 
 		lastEnd = specEnd;
 	}
 	if (lastEnd < length) {
 		BString remaining;
 		buf.CopyCharsInto(remaining, lastEnd, length - lastEnd);
-		BTextView::Insert(TextLength(), remaining.String(), remaining.Length(),
+		BTextView::Insert(offset, remaining.String(), remaining.Length(),
 			runs);
+		offset += remaining.Length();
 	}
+	return offset;
 }
 
 
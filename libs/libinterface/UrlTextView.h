@@ -30,6 +30,9 @@ public:
 
 			// Only differs in that it changes font face and color of any URLs
 			void	Insert(const char* text, const text_run_array* runs = NULL);
+			// At the given offset rather than the end; returns where it ends
+			int32	InsertAt(int32 offset, const char* text,
+						const text_run_array* runs = NULL);
 			void	SetText(const char* text, const text_run_array* runs = NULL);
 
 		 BString	WordAt(BPoint point);
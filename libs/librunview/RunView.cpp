@@ -20,7 +20,9 @@ const uint32 kSearchDict = 'RVdc';
 RunView::RunView(const char* name)
 	:
 	UrlTextView(name),
-	fLastStyled(false)
+	fLastStyled(false),
+	fPrependAt(-1),
+	fPrependHeight(0)
 {
 	text_run run = { 0, BFont(), ui_color(B_PANEL_TEXT_COLOR) };
 	fDefaultRun = { 1, {run} };
@@ -33,7 +35,7 @@ RunView::Append(const char* text, rgb_color color, BFont font)
 	text_run run = { 0, font, color };
 	text_run_array array = { 1, {run} };
 
-	Insert(text, &array);
+	_Insert(text, &array);
 	fLastStyled = true;
 }
 
@@ -58,9 +60,9 @@ void
 RunView::Append(const char* text)
 {
 	if (fLastStyled == false)
-		Insert(text);
+		_Insert(text, NULL);
 	else
-		Insert(text, &fDefaultRun);
+		_Insert(text, &fDefaultRun);
 	fLastStyled = false;
 }
 
@@ -70,3 +72,62 @@ RunView::ScrollToBottom()
 {
 	ScrollToOffset(TextLength());
 }
+
+
+void
+RunView::BeginPrepend()
+{
+	fPrependAt = 0;
+	fPrependHeight = TextHeight(0, CountLines());
+}
+
+
+int32
+RunView::EndPrepend()
+{
+	int32 length = fPrependAt;
+	fPrependAt = -1;
+	if (length > 0 && length < TextLength())
+		ScrollBy(0, TextHeight(0, CountLines()) - fPrependHeight);
+	return length;
+}
+
+
+void
+RunView::DeleteFirst(int32 length)
+{
+	if (length > TextLength())
+		length = TextLength();
+	if (length <= 0)
+		return;
+
+	bool atBottom = IsAtBottom();
+	BRect bounds = Bounds();
+	int32 line = LineAt(length);
+	float height = 0;
+	if (line > 0)
+		height = TextHeight(0, line - 1);
+
+	Delete(0, length);
+	if (atBottom == true)
+		ScrollToBottom();
+	else
+		ScrollTo(BPoint(bounds.left, max_c(0, bounds.top - height)));
+}
+
+
+bool
+RunView::IsAtBottom()
+{
+	return Bounds().bottom >= TextHeight(0, CountLines()) - 1;
+}
+
+
+void
+RunView::_Insert(const char* text, const text_run_array* runs)
+{
+	if (fPrependAt < 0)
+		Insert(text, runs);
+	else
+		fPrependAt = InsertAt(fPrependAt, text, runs);
+}
@@ -23,12 +23,30 @@ public:
 
 			void	ScrollToBottom();
 
+			// Until EndPrepend(), Append() adds text above all that's there,
+			// with the view kept where it was; returns the length added
+			void	BeginPrepend();
+			int32	EndPrepend();
+			bool	IsPrepending() const { return fPrependAt >= 0; }
+
+			// Removes the first length bytes, whole lines, with the rest
+			// left where it was on screen
+			void	DeleteFirst(int32 length);
+
+			bool	IsAtBottom();
+
 private:
+			void	_Insert(const char* text, const text_run_array* runs);
+
 	// For safe-keeping
 	text_run_array fDefaultRun;
 
 	// Whether or not the run was changed from default
 	bool fLastStyled;
+
+	// Where prepended text goes, or -1 if appending
+	int32 fPrependAt;
+	float fPrependHeight;
 };
 
 #endif // _RUN_VIEW_H
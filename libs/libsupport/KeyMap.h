@@ -5,13 +5,73 @@
 #ifndef _KEY_MAP_H
 #define _KEY_MAP_H
 
-#include <map>
+#include <algorithm>
+#include <vector>
+
+#include <String.h>
 
 #include "List.h"
 
+
+// Hashing for the key types used with KeyMap: integers, pointers and BStrings
+template<class KEY>
+struct KeyMapHash {
+	static uint32 Hash(const KEY& k)
+	{
+		uint64 v = (uint64)k;
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdULL;
+		v ^= v >> 33;
+		return (uint32)v;
+	}
+};
+
+
+template<class T>
+struct KeyMapHash<T*> {
+	static uint32 Hash(T* const& k)
+	{
+		return KeyMapHash<uint64>::Hash((uint64)(addr_t)k);
+	}
+};
+
+
+template<>
+struct KeyMapHash<BString> {
+	static uint32 Hash(const BString& k)
+	{
+		// FNV-1a
+		uint32 h = 2166136261U;
+		const char* str = k.String();
+		for (int32 i = 0; i < k.Length(); i++) {
+			h ^= (uint8)str[i];
+			h *= 16777619U;
+		}
+		return h;
+	}
+};
+
+
+// A hashed map: entries are stored contiguously, with an open-addressed hash
+// index over them. Lookups by key, access by position (KeyAt/ValueAt) and
+// removal are all O(1), so the usual `for (i < CountItems()) ValueAt(i)` loop
+// is linear.
+//
+// Entries are kept in the order they were added, until one is removed: the
+// last entry then takes its place. Unlike when it was a std::map, positions
+// don't follow key order, and callers listing entries to the user (accounts,
+// commands, add-ons) call SortByKey() once they've changed the map.
+// Loops removing entries by position should walk backwards, or use an
+// Iterator.
+//
+// Missing keys or positions give a default-constructed value (e.g. NULL).
 template<class KEY, class TYPE>
 class KeyMap {
 public:
+	class Iterator;
+
+				KeyMap();
+
 	uint32 		CountItems() const;
 
 	void  		AddItem(KEY k, TYPE t);
@@ -25,20 +85,95 @@ public:
 	KEY			KeyAt(uint32 position) const;
 	TYPE		ValueAt(uint32 position) const;
 
-	void		AddList(KeyMap<KEY, TYPE> appendList);
+	void		AddList(const KeyMap<KEY, TYPE>& appendList);
+
+	// O(n log n); needs KEY's operator<
+	void		SortByKey();
+
+	Iterator	GetIterator();
+
+private:
+	struct Entry {
+		KEY		key;
+		TYPE	value;
+		uint32	hash;
+	};
+
+	int32		_FindSlot(const KEY& k, uint32 hash) const;
+	int32		_SlotOf(uint32 position) const;
+	void		_RemoveSlot(int32 slot);
+	void		_Rehash(uint32 slotCount);
+
+	static bool	_KeyLess(const Entry& a, const Entry& b)
+				{
+					return a.key < b.key;
+				}
+
+	std::vector<Entry> fEntries;
+	std::vector<int32> fSlots;	// Indices into fEntries, -1 if empty
+	uint32		fMask;
+};
+
+
+// Walks a map from its last position to its first. It stays valid as entries
+// are added (those aren't visited), and as the current entry or already
+// visited ones are removed, through Remove() or the map itself; every other
+// entry is still visited exactly once.
+template<class KEY, class TYPE>
+class KeyMap<KEY, TYPE>::Iterator {
+public:
+				Iterator(KeyMap<KEY, TYPE>* map)
+					:
+					fMap(map),
+					fPosition(map->CountItems())
+				{
+				}
+
+	bool		HasNext() const
+				{
+					return fPosition > 0;
+				}
+
+	TYPE		Next()
+				{
+					if (fPosition > fMap->CountItems())
+						fPosition = fMap->CountItems();
+					if (fPosition == 0)
+						return TYPE();
+					return fMap->ValueAt(--fPosition);
+				}
+
+	// Of the entry last returned by Next()
+	KEY			Key() const
+				{
+					return fMap->KeyAt(fPosition);
+				}
+
+	TYPE		Remove()
+				{
+					return fMap->RemoveItemAt(fPosition);
+				}
 
 private:
-	std::map<KEY, TYPE> fMap;
-	typedef typename std::map<KEY, TYPE>::iterator fIter;
-	typedef typename std::map<KEY, TYPE>::const_iterator fConstIter;
+	KeyMap<KEY, TYPE>*	fMap;
+	uint32				fPosition;
 };
 
 
+template<class KEY, class TYPE>
+inline
+KeyMap<KEY, TYPE>::KeyMap()
+	:
+	fMask(0)
+{
+}
+
+
 template<class KEY, class TYPE>
 inline uint32
 KeyMap<KEY, TYPE>::CountItems() const
 {
-	return fMap.size();
+	return fEntries.size();
 }
 
 
@@ -46,7 +181,27 @@ template<class KEY, class TYPE>
 inline void
 KeyMap<KEY, TYPE>::AddItem(KEY k, TYPE t)
 {
-	fMap[k] = t;
+	uint32 hash = KeyMapHash<KEY>::Hash(k);
+	int32 slot = _FindSlot(k, hash);
+	if (slot >= 0) {
+		fEntries[fSlots[slot]].value = t;
+		return;
+	}
+
+	// Keep the load factor under 3/4
+	if ((fEntries.size() + 1) * 4 > fSlots.size() * 3)
+		_Rehash(fSlots.size() < 8 ? 16 : fSlots.size() * 2);
+
+	Entry entry;
+	entry.key = k;
+	entry.value = t;
+	entry.hash = hash;
+	fEntries.push_back(entry);
+
+	uint32 i = hash & fMask;
+	while (fSlots[i] >= 0)
+		i = (i + 1) & fMask;
+	fSlots[i] = fEntries.size() - 1;
 }
 
 
@@ -54,18 +209,14 @@ template<class KEY, class TYPE>
 inline TYPE
 KeyMap<KEY, TYPE>::ValueFor(KEY k, bool* found) const
 {
-	fConstIter i = fMap.find(k);
+	int32 slot = _FindSlot(k, KeyMapHash<KEY>::Hash(k));
 
-	if (found) {
-		if (i == fMap.end())
-			*found = false;
-		else
-			*found = true;
-	}
+	if (found)
+		*found = (slot >= 0);
 
-	if (i == fMap.end())
-		return NULL;
-	return i->second;
+	if (slot < 0)
+		return TYPE();
+	return fEntries[fSlots[slot]].value;
 }
 
 
@@ -73,13 +224,15 @@ template<class KEY, class TYPE>
 inline KEY
 KeyMap<KEY, TYPE>::KeyFor(TYPE v, bool* found) const
 {
-	*found = false;
-	for (int32 i = 0; i < CountItems(); i++)
-		if (ValueAt(i) == v) {
-			*found = true;
-			return KeyAt(i);
+	if (found)
+		*found = false;
+	for (uint32 i = 0; i < fEntries.size(); i++)
+		if (fEntries[i].value == v) {
+			if (found)
+				*found = true;
+			return fEntries[i].key;
 		}
-	return NULL;
+	return KEY();
 }
 
 
@@ -87,10 +240,19 @@ template<class KEY, class TYPE>
 inline TYPE
 KeyMap<KEY, TYPE>::RemoveItemAt(int32 position)
 {
-	TYPE value = ValueAt(position);
-	fIter i = fMap.begin();
-	std::advance(i, position);
-	fMap.erase(i->first);
+	if (position < 0 || (uint32)position >= fEntries.size())
+		return TYPE();
+
+	TYPE value = fEntries[position].value;
+	_RemoveSlot(_SlotOf(position));
+
+	// The last entry fills the hole, so only its slot needs fixing
+	uint32 last = fEntries.size() - 1;
+	if ((uint32)position != last) {
+		fSlots[_SlotOf(last)] = position;
+		fEntries[position] = fEntries[last];
+	}
+	fEntries.pop_back();
 	return value;
 }
 
@@ -99,9 +261,10 @@ template<class KEY, class TYPE>
 inline TYPE
 KeyMap<KEY, TYPE>::RemoveItemFor(KEY k)
 {
-	TYPE value = ValueFor(k);
-	fMap.erase(k);
-	return value;
+	int32 slot = _FindSlot(k, KeyMapHash<KEY>::Hash(k));
+	if (slot < 0)
+		return TYPE();
+	return RemoveItemAt(fSlots[slot]);
 }
 
 
@@ -109,11 +272,9 @@ template<class KEY, class TYPE>
 inline KEY
 KeyMap<KEY, TYPE>::KeyAt(uint32 position) const
 {
-	fConstIter i = fMap.begin();
-	std::advance(i, position); 	
-	if (i == fMap.end())
-		return NULL;
-	return i->first;
+	if (position >= fEntries.size())
+		return KEY();
+	return fEntries[position].key;
 }
 
 
@@ -121,23 +282,106 @@ template<class KEY, class TYPE>
 inline TYPE
 KeyMap<KEY, TYPE>::ValueAt(uint32 position) const
 {
-	fConstIter i = fMap.begin();
-	std::advance(i, position); 	
-	if (i == fMap.end())
-		return NULL;
-	return i->second;
+	if (position >= fEntries.size())
+		return TYPE();
+	return fEntries[position].value;
 }
 
 
 template<class KEY, class TYPE>
 inline void
-KeyMap<KEY, TYPE>::AddList(KeyMap<KEY, TYPE> appendList)
+KeyMap<KEY, TYPE>::AddList(const KeyMap<KEY, TYPE>& appendList)
 {
 	if (appendList.CountItems() == 0)
 		return;
-	for (int i = 0; i < appendList.CountItems(); i++)
+	for (uint32 i = 0; i < appendList.CountItems(); i++)
 		AddItem(appendList.KeyAt(i), appendList.ValueAt(i));
 }
 
 
+template<class KEY, class TYPE>
+inline void
+KeyMap<KEY, TYPE>::SortByKey()
+{
+	std::sort(fEntries.begin(), fEntries.end(), _KeyLess);
+	if (fSlots.empty() == false)
+		_Rehash(fSlots.size());
+}
+
+
+template<class KEY, class TYPE>
+inline typename KeyMap<KEY, TYPE>::Iterator
+KeyMap<KEY, TYPE>::GetIterator()
+{
+	return Iterator(this);
+}
+
+
+template<class KEY, class TYPE>
+inline int32
+KeyMap<KEY, TYPE>::_FindSlot(const KEY& k, uint32 hash) const
+{
+	if (fSlots.empty() == true)
+		return -1;
+
+	uint32 i = hash & fMask;
+	while (fSlots[i] >= 0) {
+		const Entry& entry = fEntries[fSlots[i]];
+		if (entry.hash == hash && entry.key == k)
+			return i;
+		i = (i + 1) & fMask;
+	}
+	return -1;
+}
+
+
+// The slot pointing at the entry in that position, which must exist
+template<class KEY, class TYPE>
+inline int32
+KeyMap<KEY, TYPE>::_SlotOf(uint32 position) const
+{
+	uint32 i = fEntries[position].hash & fMask;
+	while ((uint32)fSlots[i] != position)
+		i = (i + 1) & fMask;
+	return i;
+}
+
+
+// Backward-shift deletion, so linear probing never needs tombstones
+template<class KEY, class TYPE>
+inline void
+KeyMap<KEY, TYPE>::_RemoveSlot(int32 slot)
+{
+	uint32 hole = slot;
+	uint32 i = (hole + 1) & fMask;
+	while (fSlots[i] >= 0) {
+		uint32 home = fEntries[fSlots[i]].hash & fMask;
+		// Move the entry into the hole unless its home lies cyclically in
+		// (hole, i]
+		if (((i - home) & fMask) >= ((i - hole) & fMask)) {
+			fSlots[hole] = fSlots[i];
+			hole = i;
+		}
+		i = (i + 1) & fMask;
+	}
+	fSlots[hole] = -1;
+}
+
+
+template<class KEY, class TYPE>
+inline void
+KeyMap<KEY, TYPE>::_Rehash(uint32 slotCount)
+{
+	fSlots.assign(slotCount, -1);
+	fMask = slotCount - 1;
+
+	for (uint32 e = 0; e < fEntries.size(); e++) {
+		uint32 i = fEntries[e].hash & fMask;
+		while (fSlots[i] >= 0)
+			i = (i + 1) & fMask;
+		fSlots[i] = e;
+	}
+}
+
+
 #endif	// _KEY_MAP_H
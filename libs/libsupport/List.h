@@ -5,26 +5,47 @@
 #ifndef _LIST_H
 #define _LIST_H
 
-#include <list>
+#include <utility>
+#include <vector>
 
 #include <SupportDefs.h>
 
+
+// A contiguous list: indexing is O(1), as is adding or (order-ignoring)
+// removing at the end. Iterate with ItemAt() or a range-based for.
 template<class T>
 class List {
 public:
+	typedef typename std::vector<T>::iterator Iterator;
+	typedef typename std::vector<T>::const_iterator ConstIterator;
+
 	uint32 	CountItems() const;
+	bool	IsEmpty() const;
 
-	void  	AddItem(T type);
+	void  	AddItem(const T& type);
+	void  	AddItem(T&& type);
+	// Constructs the item in place, from the given constructor arguments
+	template<class... Args>
+	T&		EmplaceItem(Args&&... args);
 
+	// Keeps the order of the following items, so is O(n)
 	void	RemoveItemAt(uint32 position);
+	// Moves the last item into the gap instead, O(1)
+	void	SwapRemoveItemAt(uint32 position);
+	void	MakeEmpty();
+
+	T&		ItemAt(uint32 position);
+	const T& ItemAt(uint32 position) const;
 
-	T		ItemAt(uint32 position);
+	void	AddList(const List<T>& appendList);
 
-	void	AddList(List<T> appendList);
+	Iterator		begin() { return fList.begin(); }
+	Iterator		end() { return fList.end(); }
+	ConstIterator	begin() const { return fList.begin(); }
+	ConstIterator	end() const { return fList.end(); }
 
 private:
-	std::list<T> fList;
-	typedef typename std::list<T>::iterator fIter;
+	std::vector<T> fList;
 };
 
 
@@ -36,37 +57,80 @@ uint32 List<T>::CountItems() const
 
 
 template<class T>
-void List<T>::AddItem(T type)
+bool List<T>::IsEmpty() const
+{
+	return fList.empty();
+}
+
+
+template<class T>
+void List<T>::AddItem(const T& type)
 {
 	fList.push_back(type);
 }
 
 
+template<class T>
+void List<T>::AddItem(T&& type)
+{
+	fList.push_back(std::move(type));
+}
+
+
+template<class T>
+template<class... Args>
+T& List<T>::EmplaceItem(Args&&... args)
+{
+	fList.emplace_back(std::forward<Args>(args)...);
+	return fList.back();
+}
+
+
 template<class T>
 void List<T>::RemoveItemAt(uint32 position)
 {
-	fIter i = fList.begin();
-	std::advance(i, position);
-	fList.erase(i);
+	fList.erase(fList.begin() + position);
+}
+
+
+template<class T>
+void List<T>::SwapRemoveItemAt(uint32 position)
+{
+	if (position + 1 != fList.size())
+		fList[position] = std::move(fList.back());
+	fList.pop_back();
+}
+
+
+template<class T>
+void List<T>::MakeEmpty()
+{
+	fList.clear();
+}
+
+
+template<class T>
+T& List<T>::ItemAt(uint32 position)
+{
+	return fList[position];
 }
 
 
 template<class T>
-T List<T>::ItemAt(uint32 position)
+const T& List<T>::ItemAt(uint32 position) const
 {
-	fIter i = fList.begin();
-	std::advance(i, position); 	
-	return *i;
+	return fList[position];
 }
 
 
 template<class T>
-void List<T>::AddList(List<T> appendList)
+void List<T>::AddList(const List<T>& appendList)
 {
-	if (appendList.CountItems() == 0)
-		return;
-	for (int i = 0; i < appendList.CountItems(); i++)
-		AddItem(appendList.ItemAt(i));
+	// Index-based, as appendList might be this very list
+	uint32 count = appendList.CountItems();
+	fList.reserve(fList.size() + count);
+	for (uint32 i = 0; i < count; i++)
+		fList.push_back(appendList.fList[i]);
 }
 
 
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _PREFIX_INDEX_H
+#define _PREFIX_INDEX_H
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include <String.h>
+
+
+// A sorted, case-insensitive index of strings for prefix lookups, e.g. for
+// tab-completion. Keys starting with the same prefix are contiguous, so finding
+// them is a binary search plus one step per match. Keys may repeat, as long as
+// their values differ.
+template<class TYPE>
+class PrefixIndex {
+public:
+	int32		CountItems() const;
+
+	void		AddItem(const BString& key, TYPE value);
+	bool		RemoveItem(const BString& key, TYPE value);
+	void		MakeEmpty();
+
+	BString		KeyAt(int32 index) const;
+	TYPE		ValueAt(int32 index) const;
+
+	// Index of the first key starting with prefix, matching keys follow it
+	int32		FirstMatch(const BString& prefix) const;
+	bool		IsMatch(int32 index, const BString& prefix) const;
+
+	// The nth key starting with prefix, empty if there are fewer matches
+	BString		MatchAt(const BString& prefix, int32 nth,
+					TYPE* value = NULL) const;
+
+private:
+	struct Entry {
+		BString	folded;
+		BString	key;
+		TYPE	value;
+
+		bool operator<(const Entry& other) const
+		{
+			return strcmp(folded.String(), other.folded.String()) < 0;
+		}
+	};
+
+	static	Entry	_Entry(const BString& key, TYPE value);
+
+	std::vector<Entry> fEntries;
+};
+
+
+template<class TYPE>
+inline int32
+PrefixIndex<TYPE>::CountItems() const
+{
+	return fEntries.size();
+}
+
+
+template<class TYPE>
+inline void
+PrefixIndex<TYPE>::AddItem(const BString& key, TYPE value)
+{
+	Entry entry = _Entry(key, value);
+	fEntries.insert(std::upper_bound(fEntries.begin(), fEntries.end(), entry),
+		entry);
+}
+
+
+template<class TYPE>
+inline bool
+PrefixIndex<TYPE>::RemoveItem(const BString& key, TYPE value)
+{
+	Entry entry = _Entry(key, value);
+	typename std::vector<Entry>::iterator i
+		= std::lower_bound(fEntries.begin(), fEntries.end(), entry);
+	for (; i != fEntries.end() && i->folded == entry.folded; i++)
+		if (i->key == key && i->value == value) {
+			fEntries.erase(i);
+			return true;
+		}
+	return false;
+}
+
+
+template<class TYPE>
+inline void
+PrefixIndex<TYPE>::MakeEmpty()
+{
+	fEntries.clear();
+}
+
+
+template<class TYPE>
+inline BString
+PrefixIndex<TYPE>::KeyAt(int32 index) const
+{
+	if (index < 0 || index >= CountItems())
+		return BString();
+	return fEntries[index].key;
+}
+
+
+template<class TYPE>
+inline TYPE
+PrefixIndex<TYPE>::ValueAt(int32 index) const
+{
+	if (index < 0 || index >= CountItems())
+		return NULL;
+	return fEntries[index].value;
+}
+
+
+template<class TYPE>
+inline int32
+PrefixIndex<TYPE>::FirstMatch(const BString& prefix) const
+{
+	Entry entry = _Entry(prefix, NULL);
+	return std::lower_bound(fEntries.begin(), fEntries.end(), entry)
+		- fEntries.begin();
+}
+
+
+template<class TYPE>
+inline bool
+PrefixIndex<TYPE>::IsMatch(int32 index, const BString& prefix) const
+{
+	if (index < 0 || index >= CountItems())
+		return false;
+	return fEntries[index].key.ICompare(prefix, prefix.Length()) == 0;
+}
+
+
+template<class TYPE>
+inline BString
+PrefixIndex<TYPE>::MatchAt(const BString& prefix, int32 nth, TYPE* value) const
+{
+	int32 index = FirstMatch(prefix) + nth;
+	if (nth < 0 || IsMatch(index, prefix) == false)
+		return BString();
+
+	if (value != NULL)
+		*value = fEntries[index].value;
+	return fEntries[index].key;
+}
+
+
+template<class TYPE>
+inline typename PrefixIndex<TYPE>::Entry
+PrefixIndex<TYPE>::_Entry(const BString& key, TYPE value)
+{
+	Entry entry;
+	entry.folded = key;
+	entry.folded.ToLower();
+	entry.key = key;
+	entry.value = value;
+	return entry;
+}
+
+
+#endif	// _PREFIX_INDEX_H
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021-2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "IrcParser.h"
+
+#include <stdlib.h>
+
+
+static BString
+line_sender(const BStringList& words)
+{
+	BString sender;
+	if (words.CountStrings() > 1) {
+		sender = words.First();
+		if (sender.StartsWith(":") == true)
+			sender.RemoveFirst(":");
+		else if (sender.StartsWith("*:") == true)
+			sender.RemoveFirst("*:");
+	}
+	return sender;
+}
+
+
+static BString
+line_code(const BStringList& words)
+{
+	BString code;
+	if (words.CountStrings() > 2)
+		code = words.StringAt(1);
+	return code;
+}
+
+
+static void
+line_parameters(const BStringList& words, BString line, BStringList* params)
+{
+	BString current;
+	for (int i = 2; i < words.CountStrings(); i++)
+		if ((current = words.StringAt(i)).StartsWith(":") == false)
+			params->Add(current);
+		else
+			break;
+
+	// Last parameter is preceded by a colon
+	int32 index = line.RemoveChars(0, 1).FindFirst(" :");
+	if (index != B_ERROR)
+		params->Add(line.RemoveChars(0, index + 2));
+}
+
+
+void
+ParseIrcLine(BString line, irc_line* parsed)
+{
+	BStringList words;
+	line.RemoveCharsSet("\n\r");
+	line.Split(" ", true, words);
+
+	parsed->sender = line_sender(words);
+	parsed->code = line_code(words);
+	parsed->numeric = atoi(parsed->code.String());
+	if (parsed->numeric < 0)
+		parsed->numeric = 0;
+	parsed->params.MakeEmpty();
+	line_parameters(words, line, &parsed->params);
+}
+
+
+BString
+IrcSenderNick(const BString& sender)
+{
+	BStringList split;
+	sender.Split("!", true, split);
+	return split.First();
+}
+
+
+BString
+IrcSenderIdent(const BString& sender)
+{
+	BStringList split;
+	sender.Split("!", true, split);
+	return split.Last();
+}
+
+
+BString
+IrcCaseMapped(BString nick)
+{
+	nick.ToLower();
+	nick.ReplaceAll('[', '{');
+	nick.ReplaceAll(']', '}');
+	nick.ReplaceAll('\\', '|');
+	nick.ReplaceAll('~', '^');
+	return nick;
+}
+
+
+bool
+IsIrcChannelName(const BString& name)
+{
+	return (name.StartsWith("!") || name.StartsWith("&") || name.StartsWith("#")
+		|| name.StartsWith("+"));
+}
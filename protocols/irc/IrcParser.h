@@ -0,0 +1,34 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _IRC_PARSER_H
+#define _IRC_PARSER_H
+
+#include <String.h>
+#include <StringList.h>
+
+
+// Splitting what the server sends. This needs only BString and BStringList,
+// so it's built into libcore as well, and can be run off Haiku.
+
+// A line from the server, split into its parts
+struct irc_line {
+	BString		sender;		// Without the colon
+	BString		code;		// The command or numeric
+	int32		numeric;	// Or 0, if a command
+	BStringList	params;		// The last, after " :", may have spaces
+};
+
+void		ParseIrcLine(BString line, irc_line* parsed);
+
+// Used with "nick!ident"-formatted strings
+BString		IrcSenderNick(const BString& sender);
+BString		IrcSenderIdent(const BString& sender);
+
+// RFC 1459 casemapping, for comparing nicks
+BString		IrcCaseMapped(BString nick);
+
+bool		IsIrcChannelName(const BString& name);
+
+#endif // _IRC_PARSER_H
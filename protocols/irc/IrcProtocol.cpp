@@ -23,6 +23,8 @@
 #include <UserStatus.h>
 #include <Utils.h>
 
+#include "IrcParser.h"
+
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "IrcProtocol"
@@ -30,6 +32,9 @@
 
 const int32 IRC_CMD = 'ICmd';
 
+// Most sub-messages held in one IM_BATCH before it's sent anyway
+const int32 kBatchLimit = 200;
+
 
 status_t
 connect_thread(void* data)
@@ -44,17 +49,24 @@ connect_thread(void* data)
 IrcProtocol::IrcProtocol()
 	:
 	fSocket(NULL),
+	fLineReceived(0),
 	fNick(NULL),
 	fIdent(NULL),
 	fReady(false),
-	fWriteLocked(false)
+	fWriteLocked(false),
+	fBatch(IM_MESSAGE),
+	fBatchLock("irc batch")
 {
+	fBatch.AddInt32("im_what", IM_BATCH);
 }
 
 
 IrcProtocol::~IrcProtocol()
 {
 	Shutdown();
+
+	for (int i = 0; i < fIdentChannels.CountItems(); i++)
+		delete fIdentChannels.ValueAt(i);
 }
 
 
@@ -211,7 +223,7 @@ IrcProtocol::Process(BMessage* msg)
 		{
 			BString chat_id;
 			if (msg->FindString("chat_id", &chat_id) == B_OK) {
-				if (_IsChannelName(chat_id) == true) {
+				if (IsIrcChannelName(chat_id) == true) {
 					BString cmd = "PART ";
 					cmd << chat_id << " * :" << fPartText;
 					_SendIrc(cmd);
@@ -235,7 +247,7 @@ IrcProtocol::Process(BMessage* msg)
 				meta.AddString("chat_id", chat_id);
 				meta.AddInt32("room_default_flags",
 					ROOM_LOG_LOCALLY | ROOM_POPULATE_LOGS | ROOM_NOTIFY_DM);
-				if (_IsChannelName(chat_id) == false)
+				if (IsIrcChannelName(chat_id) == false)
 					meta.AddInt32("room_disallowed_flags", ROOM_AUTOJOIN);
 				_SendMsg(&meta);
 			}
@@ -249,7 +261,7 @@ IrcProtocol::Process(BMessage* msg)
 
 			// Rooms are populated with RPL_WHOREPLY, chats RPL_WHOISUSER
 			BString cmd;
-			if (_IsChannelName(chat_id) == true)
+			if (IsIrcChannelName(chat_id) == true)
 				cmd = "WHO ";
 			else
 				cmd = "WHOIS ";
@@ -451,8 +463,12 @@ IrcProtocol::Loop()
 	fListRequested = false;
 	fWhoIsRequested = false;
 	fWhoRequested = false;
-	while (fSocket != NULL && fSocket->IsConnected() == true)
-		_ProcessLine(_ReadUntilNewline(fSocket, &fRemainingBuf));
+	while (fSocket != NULL && fSocket->IsConnected() == true) {
+		BString line = _ReadUntilNewline(fSocket, &fRemainingBuf);
+		fLineReceived = fMessenger->IsTracing() ? system_time() : 0;
+		_ProcessLine(line);
+	}
+	fLineReceived = 0;
 	return B_OK;
 }
 
@@ -460,18 +476,14 @@ IrcProtocol::Loop()
 void
 IrcProtocol::_ProcessLine(BString line)
 {
-	BStringList words;
 	line.RemoveCharsSet("\n\r");
-	line.Split(" ", true, words);
-	BString sender = _LineSender(words);
-	BString code = _LineCode(words);
-	BStringList params = _LineParameters(words, line);
-
-	int32 numeric;
-	if ((numeric = atoi(code.String())) > 0)
-		_ProcessNumeric(numeric, sender, params, line);
+	irc_line parsed;
+	ParseIrcLine(line, &parsed);
+
+	if (parsed.numeric > 0)
+		_ProcessNumeric(parsed.numeric, parsed.sender, parsed.params, line);
 	else
-		_ProcessCommand(code, sender, params, line);
+		_ProcessCommand(parsed.code, parsed.sender, parsed.params, line);
 }
 
 
@@ -503,8 +515,7 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 			BString ident = user;
 			ident << "@" << host;
 
-			fIdentNicks.RemoveItemFor(ident);
-			fIdentNicks.AddItem(ident, nick);
+			_SetIdentNick(ident, nick);
 
 			// If is a contact, let's go!
 			_UpdateContact(nick, ident, true);
@@ -545,18 +556,19 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 			BString ident = user;
 			ident << "@" << host;
 
-			fIdentNicks.RemoveItemFor(ident);
-			fIdentNicks.AddItem(ident, nick);
+			_SetIdentNick(ident, nick);
+			if (IsIrcChannelName(channel) == true)
+				_AddIdentChannel(ident, channel);
 
 			// Used to populate a room's userlist (one-by-one… :p)
-			if (fWhoRequested == false && _IsChannelName(channel)) {
+			if (fWhoRequested == false && IsIrcChannelName(channel)) {
 				// Send the participant themself
 				BMessage user(IM_MESSAGE);
 				user.AddInt32("im_what", IM_ROOM_PARTICIPANTS);
 				user.AddString("chat_id", channel);
 				user.AddString("user_id", ident);
 				user.AddString("user_name", nick);
-				_SendMsg(&user);
+				_QueueMsg(&user);
 
 				// Now let's crunch the appropriate role…
 				bool away = false;
@@ -591,7 +603,7 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 				sensei.AddInt32("role_priority", priority);
 				sensei.AddString("role_title", _RoleTitle(priority));
 				sensei.AddInt32("role_perms", _RolePerms(priority));
-				_SendMsg(&sensei);
+				_QueueMsg(&sensei);
 
 				// Also status! Can't forget that
 				BMessage status(IM_MESSAGE);
@@ -601,7 +613,7 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 					status.AddInt32("status", STATUS_AWAY);
 				else
 					status.AddInt32("status", STATUS_ONLINE);
-				_SendMsg(&status);
+				_QueueMsg(&status);
 			}
 			break;
 		}
@@ -616,7 +628,7 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 			dir.AddString("chat_id", chat_id);
 			dir.AddString("subject", subject);
 			dir.AddInt32("user_count", count);
-			_SendMsg(&dir);
+			_QueueMsg(&dir);
 			break;
 		}
 		case RPL_TOPIC:
@@ -636,9 +648,11 @@ IrcProtocol::_ProcessNumeric(int32 numeric, BString sender, BStringList params,
 	// Now, to determine if the line should be sent to system buffer
 	switch (numeric) {
 		case RPL_LISTEND:
+			_FlushBatch();
 			fListRequested = false;
 			break;
 		case RPL_ENDOFWHO:
+			_FlushBatch();
 			fWhoRequested = false;
 			break;
 		case RPL_ENDOFWHOIS:
@@ -706,8 +720,8 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 	BStringList params, BString line)
 {
 	// If protocol uninitialized and the user's ident is mentioned― use it!
-	if (fReady == false && _SenderNick(sender) == fNick)
-		_MakeReady(_SenderNick(sender), _SenderIdent(sender));
+	if (fReady == false && IrcSenderNick(sender) == fNick)
+		_MakeReady(IrcSenderNick(sender), IrcSenderIdent(sender));
 
 	if (sender == "PING")
 	{
@@ -718,11 +732,11 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 	else if (command == "PRIVMSG")
 	{
 		BString chat_id = params.First();
-		BString user_id = _SenderIdent(sender);
-		BString user_name = _SenderNick(sender);
+		BString user_id = IrcSenderIdent(sender);
+		BString user_name = IrcSenderNick(sender);
 		BString body = params.Last();
-		if (_IsChannelName(chat_id) == false)
-			chat_id = _SenderNick(sender);
+		if (IsIrcChannelName(chat_id) == false)
+			chat_id = IrcSenderNick(sender);
 		if (fChannels.HasString(chat_id) == false)
 			fChannels.Add(chat_id);
 
@@ -742,8 +756,8 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 		BMessage send(IM_MESSAGE);
 		send.AddInt32("im_what", IM_MESSAGE_RECEIVED);
 
-		if (_IsChannelName(chat_id) == false)
-			chat_id = _SenderNick(sender);
+		if (IsIrcChannelName(chat_id) == false)
+			chat_id = IrcSenderNick(sender);
 		if (fChannels.HasString(chat_id) == false)
 			fChannels.Add(chat_id);
 
@@ -751,8 +765,8 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 			send.AddString("chat_id", chat_id);
 
 		if (sender.IsEmpty() == false) {
-			send.AddString("user_id", _SenderIdent(sender));
-			send.AddString("user_name", _SenderNick(sender));
+			send.AddString("user_id", IrcSenderIdent(sender));
+			send.AddString("user_name", IrcSenderNick(sender));
 		}
 		send.AddString("body", params.Last());
 		_SendMsg(&send);
@@ -771,13 +785,13 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 	else if (command == "JOIN")
 	{
 		BString chat_id = params.First();
-		BString user_id = _SenderIdent(sender);
-		BString user_name = _SenderNick(sender);
+		BString user_id = IrcSenderIdent(sender);
+		BString user_name = IrcSenderNick(sender);
 		_UpdateContact(user_name, user_id, true);
 
 		BMessage joined(IM_MESSAGE);
 		joined.AddString("chat_id", chat_id);
-		if (_SenderIdent(sender) == fIdent) {
+		if (IrcSenderIdent(sender) == fIdent) {
 			joined.AddInt32("im_what", IM_ROOM_JOINED);
 			fChannels.Add(chat_id);
 		}
@@ -785,7 +799,8 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 			joined.AddInt32("im_what", IM_ROOM_PARTICIPANT_JOINED);
 			joined.AddString("user_id", user_id);
 			joined.AddString("user_name", user_name);
-			fIdentNicks.AddItem(user_id, user_name);
+			_SetIdentNick(user_id, user_name);
+			_AddIdentChannel(user_id, chat_id);
 		}
 		_SendMsg(&joined);
 
@@ -804,16 +819,21 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 		BMessage left(IM_MESSAGE);
 		left.AddString("chat_id", chat_id);
 		left.AddString("body", body);
-		if (_SenderIdent(sender) == fIdent) {
+		if (IrcSenderIdent(sender) == fIdent) {
 			left.AddInt32("im_what", IM_ROOM_LEFT);
 			fChannels.Remove(chat_id);
 		}
 		else {
 			left.AddInt32("im_what", IM_ROOM_PARTICIPANT_LEFT);
-			left.AddString("user_id", _SenderIdent(sender));
-			left.AddString("user_name", _SenderNick(sender));
+			left.AddString("user_id", IrcSenderIdent(sender));
+			left.AddString("user_name", IrcSenderNick(sender));
 		}
 		_SendMsg(&left);
+
+		if (IrcSenderIdent(sender) == fIdent)
+			_RemoveChannelIdents(chat_id);
+		else
+			_RemoveIdentChannel(IrcSenderIdent(sender), chat_id);
 	}
 	else if (command == "KICK")
 	{
@@ -828,18 +848,23 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 		if (params.CountStrings() == 3)
 			foot.AddString("body", params.StringAt(2));
 		_SendMsg(&foot);
+
+		if (IrcCaseMapped(user_id) == IrcCaseMapped(fNick))
+			_RemoveChannelIdents(chat_id);
+		else
+			_RemoveIdentChannel(_NickIdent(user_id), chat_id);
 	}
 	else if (command == "QUIT")
 	{
-		BString user_id = _SenderIdent(sender);
-		BString user_name = _SenderNick(sender);
+		BString user_id = IrcSenderIdent(sender);
+		BString user_name = IrcSenderNick(sender);
 		_UpdateContact(user_name, user_id, false);
 
 		BString body = B_TRANSLATE("quit: ");
 		body << params.Last();
 
 		for (int i = 0; i < fChannels.CountStrings(); i++) {
-			if (_IsChannelName(fChannels.StringAt(i)) == false)
+			if (IsIrcChannelName(fChannels.StringAt(i)) == false)
 				continue;
 			BMessage left(IM_MESSAGE);
 			left.AddInt32("im_what", IM_ROOM_PARTICIPANT_LEFT);
@@ -854,18 +879,21 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 		status.AddString("user_id", user_id);
 		status.AddInt32("status", STATUS_OFFLINE);
 		_SendMsg(&status);
+
+		delete fIdentChannels.RemoveItemFor(user_id);
+		_ExpireIdent(user_id);
 	}
 	else if (command == "INVITE")
 	{
 		BMessage invite(IM_MESSAGE);
 		invite.AddInt32("im_what", IM_ROOM_INVITE_RECEIVED);
 		invite.AddString("chat_id", params.Last());
-		invite.AddString("user_id", _SenderIdent(sender));
+		invite.AddString("user_id", IrcSenderIdent(sender));
 		_SendMsg(&invite);
 	}
 	else if (command == "NICK")
 	{
-		BString ident = _SenderIdent(sender);
+		BString ident = IrcSenderIdent(sender);
 		BString user_name = params.Last();
 
 		BMessage nick(IM_MESSAGE);
@@ -879,8 +907,7 @@ IrcProtocol::_ProcessCommand(BString command, BString sender,
 			nick.AddString("user_id", ident);
 
 			_RenameContact(ident, user_name);
-			fIdentNicks.RemoveItemFor(ident);
-			fIdentNicks.AddItem(ident, user_name);
+			_SetIdentNick(ident, user_name);
 		}
 		_SendMsg(&nick);
 	}
@@ -911,60 +938,62 @@ IrcProtocol::_MakeReady(BString nick, BString ident)
 }
 
 
-BString
-IrcProtocol::_LineSender(BStringList words)
+void
+IrcProtocol::_SendMsg(BMessage* msg)
 {
-	BString sender;
-	if (words.CountStrings() > 1) {
-		sender = words.First();
-		if (sender.StartsWith(":") == true)
-			sender.RemoveFirst(":");
-		else if (sender.StartsWith("*:") == true)
-			sender.RemoveFirst("*:");
+	// Anything queued came first
+	_FlushBatch();
+
+	msg->AddString("protocol", Signature());
+	_StampReceived(msg);
+	if (fReady == true)
+		fMessenger->SendMessage(msg);
+	else if (DEBUG_ENABLED == true) {
+		std::cout << "Tried sending message when not ready: \n";
+		msg->PrintToStream();
 	}
-	return sender;
 }
 
 
-BString
-IrcProtocol::_LineCode(BStringList words)
+void
+IrcProtocol::_QueueMsg(BMessage* msg)
 {
-	BString code;
-	if (words.CountStrings() > 2)
-		code = words.StringAt(1);
-	return code;
+	_StampReceived(msg);
+	fBatchLock.Lock();
+	fBatch.AddMessage("message", msg);
+
+	type_code type;
+	int32 count = 0;
+	fBatch.GetInfo("message", &type, &count);
+	fBatchLock.Unlock();
+	if (count >= kBatchLimit)
+		_FlushBatch();
 }
 
 
-BStringList
-IrcProtocol::_LineParameters(BStringList words, BString line)
+void
+IrcProtocol::_StampReceived(BMessage* msg)
 {
-	BStringList params;
-	BString current;
-	for (int i = 2; i < words.CountStrings(); i++)
-		if ((current = words.StringAt(i)).StartsWith(":") == false)
-			params.Add(current);
-		else
-			break;
-
-	// Last parameter is preceded by a colon
-	int32 index = line.RemoveChars(0, 1).FindFirst(" :");
-	if (index != B_ERROR)
-		params.Add(line.RemoveChars(0, index + 2));
-	return params;
+	if (fLineReceived > 0 && find_thread(NULL) == fRecvThread)
+		msg->AddInt64("trace_received", fLineReceived);
 }
 
 
 void
-IrcProtocol::_SendMsg(BMessage* msg)
+IrcProtocol::_FlushBatch()
 {
-	msg->AddString("protocol", Signature());
-	if (fReady == true)
-		fMessenger->SendMessage(msg);
-	else if (DEBUG_ENABLED == true) {
-		std::cout << "Tried sending message when not ready: \n";
-		msg->PrintToStream();
+	// Taken under the lock, but sent without it, as sending can wait on the
+	// looper that's flushing too
+	fBatchLock.Lock();
+	if (fBatch.HasMessage("message") == false) {
+		fBatchLock.Unlock();
+		return;
 	}
+	BMessage batch(fBatch);
+	fBatch.RemoveName("message");
+	fBatchLock.Unlock();
+
+	_SendMsg(&batch);
 }
 
 
@@ -987,49 +1016,106 @@ IrcProtocol::_SendIrc(BString cmd)
 
 
 BString
-IrcProtocol::_SenderNick(BString sender)
+IrcProtocol::_IdentNick(BString ident)
 {
-	BStringList split;
-	sender.Split("!", true, split);
-	return split.First();
+	bool found = false;
+	BString nick = fIdentNicks.ValueFor(ident, &found);
+	if (found == true)
+		return nick;
+	return ident;
 }
 
 
 BString
-IrcProtocol::_SenderIdent(BString sender)
+IrcProtocol::_NickIdent(BString nick)
 {
-	BStringList split;
-	sender.Split("!", true, split);
-	return split.Last();
+	bool found = false;
+	BString ident = fNickIdents.ValueFor(IrcCaseMapped(nick), &found);
+	if (found == true)
+		return ident;
+	return nick;
 }
 
 
-BString
-IrcProtocol::_IdentNick(BString ident)
+void
+IrcProtocol::_SetIdentNick(BString ident, BString nick)
 {
+	BString mapped = IrcCaseMapped(nick);
 	bool found = false;
-	BString nick = fIdentNicks.ValueFor(ident, &found);
-	if (found == true)
-		return nick;
-	return ident;
+
+	// Whoever had this nick before doesn't anymore
+	BString oldIdent = fNickIdents.ValueFor(mapped, &found);
+	if (found == true && oldIdent != ident) {
+		fIdentNicks.RemoveItemFor(oldIdent);
+		delete fIdentChannels.RemoveItemFor(oldIdent);
+	}
+
+	BString oldNick = fIdentNicks.ValueFor(ident, &found);
+	if (found == true && IrcCaseMapped(oldNick) != mapped)
+		fNickIdents.RemoveItemFor(IrcCaseMapped(oldNick));
+
+	fIdentNicks.AddItem(ident, nick);
+	fNickIdents.AddItem(mapped, ident);
 }
 
 
-BString
-IrcProtocol::_NickIdent(BString nick)
+void
+IrcProtocol::_AddIdentChannel(BString ident, BString channel)
 {
-	for (int i = 0; i < fIdentNicks.CountItems(); i++)
-		if (fIdentNicks.ValueAt(i) == nick)
-			return fIdentNicks.KeyAt(i);
-	return nick;
+	BStringList* channels = fIdentChannels.ValueFor(ident);
+	if (channels == NULL) {
+		channels = new BStringList();
+		fIdentChannels.AddItem(ident, channels);
+	}
+	if (channels->HasString(channel) == false)
+		channels->Add(channel);
+}
+
+
+void
+IrcProtocol::_RemoveIdentChannel(BString ident, BString channel)
+{
+	BStringList* channels = fIdentChannels.ValueFor(ident);
+	if (channels != NULL)
+		channels->Remove(channel);
+	_ExpireIdent(ident);
+}
+
+
+void
+IrcProtocol::_RemoveChannelIdents(BString channel)
+{
+	// One pass; _ExpireIdent() may remove the current ident, which the
+	// iterator allows, and each removal is O(1)
+	StringListMap::Iterator it = fIdentChannels.GetIterator();
+	while (it.HasNext() == true) {
+		BStringList* channels = it.Next();
+		if (channels->Remove(channel) == true && channels->IsEmpty() == true)
+			_ExpireIdent(it.Key());
+	}
 }
 
 
-bool
-IrcProtocol::_IsChannelName(BString name)
+void
+IrcProtocol::_ExpireIdent(BString ident)
 {
-	return (name.StartsWith("!") || name.StartsWith("&") || name.StartsWith("#")
-		|| name.StartsWith("+"));
+	BStringList* channels = fIdentChannels.ValueFor(ident);
+	if (ident == fIdent || (channels != NULL && channels->IsEmpty() == false))
+		return;
+
+	// Contacts and one-on-one chats need the ident even when we're apart
+	bool found = false;
+	BString nick = fIdentNicks.ValueFor(ident, &found);
+	if (found == true
+		&& (fContacts.HasString(nick) == true || fChannels.HasString(nick) == true))
+		return;
+
+	delete fIdentChannels.RemoveItemFor(ident);
+	if (found == true) {
+		fIdentNicks.RemoveItemFor(ident);
+		if (fNickIdents.ValueFor(IrcCaseMapped(nick)) == ident)
+			fNickIdents.RemoveItemFor(IrcCaseMapped(nick));
+	}
 }
 
 
@@ -6,6 +6,7 @@
 #ifndef _IRC_PROTOCOL_H
 #define _IRC_PROTOCOL_H
 
+#include <Locker.h>
 #include <String.h>
 #include <StringList.h>
 
@@ -17,6 +18,7 @@
 
 
 typedef KeyMap<BString, BString> StringMap;
+typedef KeyMap<BString, BStringList*> StringListMap;
 
 
 class BSocket;
@@ -72,21 +74,23 @@ private:
 
 			void		_MakeReady(BString nick, BString ident);
 
-			BString		_LineSender(BStringList words);
-			BString		_LineCode(BStringList words);
-			BStringList	_LineParameters(BStringList words, BString line);
-
 			void		_SendMsg(BMessage* msg);
+			// Held back and sent as one IM_BATCH, e.g. for WHO or LIST replies
+			void		_QueueMsg(BMessage* msg);
+			void		_FlushBatch();
+			void		_StampReceived(BMessage* msg);
 			void		_SendIrc(BString cmd);
 
-			// Used with "nick!ident"-formatted strings
-			BString 	_SenderNick(BString sender);
-			BString 	_SenderIdent(BString sender);
-
 			BString		_IdentNick(BString ident);
 			BString		_NickIdent(BString nick);
 
-			bool		_IsChannelName(BString name);
+			// Keep fIdentNicks and fNickIdents in step; idents are forgotten
+			// once we share no channel with them (unless they're contacts)
+			void		_SetIdentNick(BString ident, BString nick);
+			void		_AddIdentChannel(BString ident, BString channel);
+			void		_RemoveIdentChannel(BString ident, BString channel);
+			void		_RemoveChannelIdents(BString channel);
+			void		_ExpireIdent(BString ident);
 
 			void		_AddFormatted(BMessage* msg, const char* name,
 							BString text);
@@ -123,6 +127,7 @@ private:
 	BSocket* fSocket;
 	BString fRemainingBuf;
 	thread_id fRecvThread;
+	bigtime_t fLineReceived; // If tracing, when the current line was read
 
 	// Settings
 	BString fNick;
@@ -144,7 +149,13 @@ private:
 
 	bool fWriteLocked;
 
+	// Queued by the receiving thread, but flushed by whichever sends next
+	BMessage fBatch;
+	BLocker fBatchLock;
+
 	StringMap fIdentNicks; // User ident → nick
+	StringMap fNickIdents; // Casemapped nick → user ident
+	StringListMap fIdentChannels; // User ident → channels in common
 
 	BStringList fChannels;
 
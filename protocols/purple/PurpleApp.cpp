@@ -47,6 +47,10 @@
 #define B_TRANSLATION_CONTEXT "PurpleApp"
 
 
+// Most messages sent in one IM_BATCH
+const int32 kBatchLimit = 50;
+
+
 int
 main(int arc, char** argv)
 {
@@ -137,6 +141,8 @@ PurpleApp::MessageReceived(BMessage* msg)
 
 			BString account_name = msg->FindString("account_name");
 			const char* username = purple_account_get_username(account);
+			DiscardMessages(account);
+			fRoomlists.RemoveItemFor(account);
 			fAccountThreads.RemoveItemFor(BString(username));
 			fAccounts.RemoveItemFor(account_name);
 
@@ -156,6 +162,9 @@ PurpleApp::MessageReceived(BMessage* msg)
 		}
 		case G_MAIN_LOOP:
 			g_main_context_iteration(g_main_loop_get_context(fGloop), false);
+
+			// Whatever's been queued in the meantime is sent together
+			FlushAllMessages();
 			break;
 		default:
 			BApplication::MessageReceived(msg);
@@ -557,6 +566,9 @@ PurpleApp::SendMessage(thread_id thread, BMessage msg)
 void
 PurpleApp::SendMessage(PurpleAccount* account, BMessage msg)
 {
+	// Anything queued came first
+	FlushMessages(account);
+
 	const char* username = purple_account_get_username(account);
 	thread_id thread = fAccountThreads.ValueFor(BString(username));
 	if (thread > 0)
@@ -566,6 +578,54 @@ PurpleApp::SendMessage(PurpleAccount* account, BMessage msg)
 }
 
 
+void
+PurpleApp::QueueMessage(PurpleAccount* account, BMessage msg)
+{
+	BMessage* batch = fBatches.ValueFor(account);
+	if (batch == NULL) {
+		batch = new BMessage(IM_MESSAGE);
+		batch->AddInt32("im_what", IM_BATCH);
+		fBatches.AddItem(account, batch);
+	}
+	batch->AddMessage("message", &msg);
+
+	type_code type;
+	int32 count = 0;
+	batch->GetInfo("message", &type, &count);
+	if (count >= kBatchLimit)
+		FlushMessages(account);
+}
+
+
+void
+PurpleApp::FlushMessages(PurpleAccount* account)
+{
+	BMessage* batch = fBatches.ValueFor(account);
+	if (batch == NULL)
+		return;
+
+	fBatches.RemoveItemFor(account);
+	SendMessage(account, *batch);
+	delete batch;
+}
+
+
+void
+PurpleApp::FlushAllMessages()
+{
+	while (fBatches.CountItems() > 0)
+		FlushMessages(fBatches.KeyAt(0));
+}
+
+
+void
+PurpleApp::DiscardMessages(PurpleAccount* account)
+{
+	delete fBatches.ValueFor(account);
+	fBatches.RemoveItemFor(account);
+}
+
+
 void
 PurpleApp::_SendSysText(PurpleConversation* conv, const char* body)
 {
@@ -1083,7 +1143,7 @@ static PurpleRoomlistUiOps _ui_op_roomlist =
 	NULL,
 	NULL,
 	ui_op_add_room,
-	NULL,
+	ui_op_roomlist_in_progress,
 	NULL,
 	NULL,
 	NULL,
@@ -1266,10 +1326,13 @@ signal_blist_node_added(PurpleBlistNode* node)
 	else
 		return;
 
+	// A whole roster's added at once, so they're sent together
+	PurpleApp* app = (PurpleApp*)be_app;
+	PurpleAccount* account = purple_buddy_get_account(buddy);
 	BMessage add(IM_MESSAGE);
 	add.AddInt32("im_what", IM_ROSTER);
 	add.AddString("user_id", purple_buddy_get_name(buddy));
-	((PurpleApp*)be_app)->SendMessage(purple_buddy_get_account(buddy), add);
+	app->QueueMessage(account, add);
 
 	BString alias = purple_buddy_get_local_alias(buddy);
 	if (alias.IsEmpty() == true)
@@ -1280,7 +1343,7 @@ signal_blist_node_added(PurpleBlistNode* node)
 	name.AddString("user_id", purple_buddy_get_name(buddy));
 	if (alias.IsEmpty() == false)
 		name.AddString("user_name", alias);
-	((PurpleApp*)be_app)->SendMessage(purple_buddy_get_account(buddy), name);
+	app->QueueMessage(account, name);
 }
 
 
@@ -1646,7 +1709,15 @@ ui_op_add_room(PurpleRoomlist* list, PurpleRoomlistRoom* room)
 	if (category.IsEmpty() == false)
 		dirMsg.AddString("category", category);
 
-	app->SendMessage(account, dirMsg);
+	app->QueueMessage(account, dirMsg);
+}
+
+
+static void
+ui_op_roomlist_in_progress(PurpleRoomlist* list, gboolean in_progress)
+{
+	if (in_progress == FALSE)
+		((PurpleApp*)be_app)->FlushMessages(list->account);
 }
 
 
@@ -1802,6 +1873,7 @@ load_account_buddies(PurpleAccount* account)
 			purple_account_add_buddy_with_invite(account, buddy, NULL);
 		}
 	}
+	((PurpleApp*)be_app)->FlushMessages(account);
 }
 
 
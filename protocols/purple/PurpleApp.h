@@ -37,6 +37,7 @@ typedef KeyMap<BString, BString> StringMap;
 typedef KeyMap<BString, thread_id> ThreadMap;
 typedef KeyMap<BString, GHashTable*> HashMap;
 typedef KeyMap<PurpleAccount*, PurpleRoomlist*> RoomMap;
+typedef KeyMap<PurpleAccount*, BMessage*> BatchMap;
 
 const uint32 G_MAIN_LOOP = 'GLml';
 const uint32 CHECK_APP = 'Paca';
@@ -84,11 +85,22 @@ public:
 			void		SendMessage(thread_id thread, BMessage msg);
 			void		SendMessage(PurpleAccount* account, BMessage msg);
 
+			// Roster and room directory entries are sent in IM_BATCHes, kept
+			// small since they're passed through send_data(). Those queued
+			// are sent before anything else for the account, or else once
+			// the glib loop's been run.
+			void		QueueMessage(PurpleAccount* account, BMessage msg);
+			void		FlushMessages(PurpleAccount* account);
+			void		FlushAllMessages();
+			// Those unsent, for an account that's gone
+			void		DiscardMessages(PurpleAccount* account);
+
 	HashMap fInviteList;
 	StringMap fUserNicks; // Purple username → Nickname for Cardie
 	StringMap fAccounts; // Cardie account name → Purple username
 	StringMap fAccountCache; // Cardie account name → Cache path
 	RoomMap fRoomlists; // Purple account → Purple roomlist
+	BatchMap fBatches; // Purple account → Unsent messages, in an IM_BATCH
 
 	BString fAddOnCache;
 
@@ -185,6 +197,8 @@ private:
 // Roomlist ui ops
 	 static void		ui_op_add_room(PurpleRoomlist* list,
 							PurpleRoomlistRoom* room);
+	 static void		ui_op_roomlist_in_progress(PurpleRoomlist* list,
+							gboolean in_progress);
 
 // Request ui ops
 	 static void*		ui_op_request_input(const char* title,
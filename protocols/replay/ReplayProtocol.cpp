@@ -0,0 +1,242 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ReplayProtocol.h"
+
+#include <string.h>
+
+#include <Catalog.h>
+#include <File.h>
+
+#include <libinterface/BitmapUtils.h>
+
+#include <ChatProtocolMessages.h>
+#include <EventRecorder.h>
+#include <UserStatus.h>
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ReplayProtocol"
+
+
+status_t
+replay_thread(void* data)
+{
+	ReplayProtocol* protocol = (ReplayProtocol*)data;
+	return protocol->Replay();
+}
+
+
+ReplayProtocol::ReplayProtocol()
+	:
+	fMessenger(NULL),
+	fRealTime(true),
+	fReplayThread(-1),
+	fStopped(0),
+	fReady(0)
+{
+}
+
+
+ReplayProtocol::~ReplayProtocol()
+{
+	Shutdown();
+}
+
+
+status_t
+ReplayProtocol::Init(ChatProtocolMessengerInterface* interface)
+{
+	fMessenger = interface;
+	return B_OK;
+}
+
+
+status_t
+ReplayProtocol::Shutdown()
+{
+	atomic_set(&fStopped, 1);
+	if (fReplayThread >= 0) {
+		status_t ret;
+		resume_thread(fReplayThread);
+		wait_for_thread(fReplayThread, &ret);
+		fReplayThread = -1;
+	}
+	return B_OK;
+}
+
+
+status_t
+ReplayProtocol::UpdateSettings(BMessage* settings)
+{
+	SetRecording(settings->FindString("file"),
+		settings->GetBool("real_time", true));
+
+	fReplayThread = spawn_thread(replay_thread, "replay", B_NORMAL_PRIORITY,
+		(void*)this);
+	if (fReplayThread < B_OK)
+		return B_ERROR;
+	return B_OK;
+}
+
+
+status_t
+ReplayProtocol::Process(BMessage* msg)
+{
+	switch (msg->FindInt32("im_what")) {
+		case IM_SET_OWN_STATUS:
+		{
+			int32 status = msg->FindInt32("status");
+			if (status == STATUS_ONLINE) {
+				resume_thread(fReplayThread);
+				break;
+			}
+			else if (status != STATUS_OFFLINE)
+				break;
+
+			// Only stopped here, as the replay might be waiting on this
+			// account's looper
+			atomic_set(&fStopped, 1);
+			BMessage statusSet(IM_MESSAGE);
+			statusSet.AddInt32("im_what", IM_OWN_STATUS_SET);
+			statusSet.AddInt32("status", STATUS_OFFLINE);
+			_SendMsg(&statusSet);
+			break;
+		}
+		case IM_SEND_MESSAGE:
+		{
+			BMessage sent(IM_MESSAGE);
+			sent.AddInt32("im_what", IM_MESSAGE_SENT);
+			sent.AddString("chat_id", msg->FindString("chat_id"));
+			sent.AddString("user_id", fOwnId);
+			sent.AddString("body", msg->FindString("body"));
+			_SendMsg(&sent);
+			break;
+		}
+		default:
+			break;
+	}
+	return B_OK;
+}
+
+
+BMessage
+ReplayProtocol::SettingsTemplate(const char* name)
+{
+	BMessage settings;
+	if (strcmp(name, "account") != 0)
+		return settings;
+
+	BMessage file;
+	file.AddString("name", "file");
+	file.AddString("description", B_TRANSLATE("Recording:"));
+	file.AddString("error", B_TRANSLATE("Please give the path of a "
+		"recording, as made with the /record command."));
+	file.AddInt32("type", B_STRING_TYPE);
+	settings.AddMessage("setting", &file);
+
+	BMessage realTime;
+	realTime.AddString("name", "real_time");
+	realTime.AddString("description", B_TRANSLATE("Play in real time"));
+	realTime.AddBool("default", true);
+	realTime.AddInt32("type", B_BOOL_TYPE);
+	settings.AddMessage("setting", &realTime);
+	return settings;
+}
+
+
+void
+ReplayProtocol::SetRecording(const char* path, bool realTime)
+{
+	fFile = path;
+	fRealTime = realTime;
+}
+
+
+BBitmap*
+ReplayProtocol::Icon() const
+{
+	return ReadNodeIcon(fAddOnPath.Path(), B_LARGE_ICON, true);
+}
+
+
+status_t
+ReplayProtocol::Replay()
+{
+	BFile file(fFile.String(), B_READ_ONLY);
+	event_record_header header;
+	if (file.InitCheck() != B_OK
+			|| file.Read(&header, sizeof(header)) != sizeof(header)
+			|| header.magic != kEventRecordMagic
+			|| header.version != kEventRecordVersion) {
+		BMessage error(IM_ERROR);
+		error.AddString("error", B_TRANSLATE("Couldn't read the recording."));
+		error.AddString("detail", fFile);
+		fMessenger->SendMessage(&error);
+		return B_BAD_DATA;
+	}
+
+	off_t size = 0;
+	file.GetSize(&size);
+
+	// The recording's own readiness is skipped, as it might not have one
+	atomic_set(&fReady, 1);
+	BMessage ready(IM_MESSAGE);
+	ready.AddInt32("im_what", IM_PROTOCOL_READY);
+	_SendMsg(&ready);
+
+	BMessage statusSet(IM_MESSAGE);
+	statusSet.AddInt32("im_what", IM_OWN_STATUS_SET);
+	statusSet.AddInt32("status", STATUS_ONLINE);
+	_SendMsg(&statusSet);
+
+	// Grown as needed, so it's only as large as the largest entry
+	char* buffer = NULL;
+	uint32 bufferSize = 0;
+	bigtime_t start = system_time();
+	event_record_entry entry;
+	while (atomic_get(&fStopped) == 0
+			&& file.Read(&entry, sizeof(entry)) == sizeof(entry)) {
+		// Or it's corrupt
+		off_t position = file.Position();
+		if (entry.size == 0 || entry.size > kEventRecordMaxSize
+				|| position < 0 || entry.size > size - position)
+			break;
+
+		if (entry.size > bufferSize) {
+			delete[] buffer;
+			buffer = new char[entry.size];
+			bufferSize = entry.size;
+		}
+		BMessage msg;
+		if (file.Read(buffer, entry.size) != (ssize_t)entry.size
+				|| msg.Unflatten(buffer) != B_OK)
+			break;
+
+		int32 im_what = msg.GetInt32("im_what", -1);
+		if (im_what == IM_PROTOCOL_READY || im_what == IM_PROTOCOL_DISABLE)
+			continue;
+		if (im_what == IM_OWN_CONTACT_INFO)
+			fOwnId = msg.FindString("user_id");
+
+		if (fRealTime == true)
+			snooze_until(start + entry.offset, B_SYSTEM_TIMEBASE);
+
+		msg.RemoveName("trace_received");
+		_SendMsg(&msg);
+	}
+	delete[] buffer;
+	return B_OK;
+}
+
+
+void
+ReplayProtocol::_SendMsg(BMessage* msg)
+{
+	if (fMessenger->IsTracing() == true)
+		msg->AddInt64("trace_received", system_time());
+	if (atomic_get(&fReady) == 1)
+		fMessenger->SendMessage(msg);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _REPLAY_PROTOCOL_H
+#define _REPLAY_PROTOCOL_H
+
+#include <Path.h>
+#include <String.h>
+
+#include <ChatProtocol.h>
+
+
+/* Plays back a recording made with the "/record" command (see
+ * EventRecorder), as though it were coming from a live account― either with
+ * its original timing, or as fast as the app will take it. Useful for
+ * reproducible load tests, e.g., of giant rooms or netsplits. */
+class ReplayProtocol : public ChatProtocol {
+public:
+						ReplayProtocol();
+						~ReplayProtocol();
+
+	// ChatProtocol inheritance
+	virtual	status_t	Init(ChatProtocolMessengerInterface* interface);
+	virtual	status_t	Shutdown();
+
+	virtual	status_t	UpdateSettings(BMessage* settings);
+
+	virtual	status_t	Process(BMessage* msg);
+
+	virtual	BMessage	SettingsTemplate(const char* name);
+
+	virtual	const char*	Signature() const { return "replay"; }
+	virtual const char*	FriendlySignature() const { return "Replay"; }
+
+	virtual BBitmap*	Icon() const;
+
+	virtual	void		SetAddOnPath(BPath path) { fAddOnPath = path; }
+	virtual	BPath		AddOnPath() { return fAddOnPath; }
+
+	virtual	const char*	GetName() { return fName; }
+	virtual	void		SetName(const char* name) { fName = name; }
+
+	virtual	ChatProtocolMessengerInterface*
+						MessengerInterface() const { return fMessenger; }
+
+			// What Replay() plays, as set by UpdateSettings()
+			void		SetRecording(const char* path, bool realTime);
+			// Plays it back to the end, or until stopped; run on a thread of
+			// its own, resumed by going online
+			status_t	Replay();
+
+private:
+			void		_SendMsg(BMessage* msg);
+
+	ChatProtocolMessengerInterface* fMessenger;
+	BPath fAddOnPath;
+	BString fName;
+
+	BString fFile;
+	bool fRealTime;
+	BString fOwnId;
+
+	thread_id fReplayThread;
+
+	// Atomically accessed, as they're shared with the replay thread
+	int32 fStopped;
+	int32 fReady;
+};
+
+#endif // _REPLAY_PROTOCOL_H
@@ -35,6 +35,10 @@
 #define B_TRANSLATION_CONTEXT "JabberHandler"
 
 
+// Most sub-messages held in one IM_BATCH before it's sent anyway
+const int32 kBatchLimit = 200;
+
+
 static status_t
 connect_thread(void* data)
 {
@@ -48,7 +52,8 @@ connect_thread(void* data)
 		return B_BAD_VALUE;
 
 	gloox::ConnectionError e;
-	while ((e = client->recv(10000000)) == gloox::ConnNoError);
+	while ((e = client->recv(10000000)) == gloox::ConnNoError)
+		handler->FlushBatch();
 
 	if (e != gloox::ConnUserDisconnected)
 		handler->HandleConnectionError(e);
@@ -62,8 +67,11 @@ JabberHandler::JabberHandler()
 	fClient(NULL),
 	fVCardManager(NULL),
 	fSession(NULL),
-	fLastOwnVCard(0)
+	fLastOwnVCard(0),
+	fBatch(IM_MESSAGE),
+	fBatchLock("xmpp batch")
 {
+	fBatch.AddInt32("im_what", IM_BATCH);
 	fAvatars = new BList();
 }
 
@@ -900,11 +908,47 @@ JabberHandler::_SendMessage(BMessage* msg)
 	if (!msg)
 		return;
 
+	// Anything queued came first
+	FlushBatch();
+
 	msg->AddString("protocol", Signature());
 	fServerMessenger->SendMessage(msg);
 }
 
 
+void
+JabberHandler::_QueueMessage(BMessage* msg)
+{
+	fBatchLock.Lock();
+	fBatch.AddMessage("message", msg);
+
+	type_code type;
+	int32 count = 0;
+	fBatch.GetInfo("message", &type, &count);
+	fBatchLock.Unlock();
+	if (count >= kBatchLimit)
+		FlushBatch();
+}
+
+
+void
+JabberHandler::FlushBatch()
+{
+	// Sent without the lock, as sending can wait on the looper that's
+	// flushing too
+	fBatchLock.Lock();
+	if (fBatch.HasMessage("message") == false) {
+		fBatchLock.Unlock();
+		return;
+	}
+	BMessage batch(fBatch);
+	fBatch.RemoveName("message");
+	fBatchLock.Unlock();
+
+	_SendMessage(&batch);
+}
+
+
 void
 JabberHandler::_Notify(notification_type type, const char* title, const char* message)
 {
@@ -956,7 +1000,8 @@ JabberHandler::_ChatCreatedMsg(const char* id)
 
 void
 JabberHandler::_RoleChangedMsg(BString chat_id, BString user_id,
-							gloox::MUCRoomRole role, gloox::MUCRoomAffiliation aff)
+							gloox::MUCRoomRole role, gloox::MUCRoomAffiliation aff,
+							bool queue)
 {
 	BMessage roleMsg(IM_MESSAGE);
 	roleMsg.AddInt32("im_what", IM_ROOM_ROLECHANGED);
@@ -965,7 +1010,10 @@ JabberHandler::_RoleChangedMsg(BString chat_id, BString user_id,
 	roleMsg.AddString("role_title", _RoleTitle(role, aff));
 	roleMsg.AddInt32("role_perms", _RolePerms(role, aff));
 	roleMsg.AddInt32("role_priority", _RolePriority(role, aff));
-	_SendMessage(&roleMsg);
+	if (queue == true)
+		_QueueMessage(&roleMsg);
+	else
+		_SendMessage(&roleMsg);
 }
 
 
@@ -1000,7 +1048,7 @@ JabberHandler::_UserLeftMsg(BString chat_id, gloox::MUCRoomParticipant participa
 
 void
 JabberHandler::_StatusSetMsg(const char* user_id, gloox::Presence::PresenceType type,
-						  const char* message, const char* resource)
+						  const char* message, const char* resource, bool queue)
 {
 	BMessage msg(IM_MESSAGE);
 	msg.AddInt32("im_what", IM_USER_STATUS_SET);
@@ -1012,7 +1060,10 @@ JabberHandler::_StatusSetMsg(const char* user_id, gloox::Presence::PresenceType
 	if (BString(message).IsEmpty() == false)
 		msg.AddString("message", message);
 
-	_SendMessage(&msg);
+	if (queue == true)
+		_QueueMessage(&msg);
+	else
+		_SendMessage(&msg);
 }
 
 
@@ -1503,15 +1554,19 @@ JabberHandler::handleRoster(const gloox::Roster& roster)
 		msgs.push_back(infoMsg);
 	}
 
-	// Send server based contact list
-	_SendMessage(&contactListMsg);
+	// Send server based contact list and contact info in one go
+	BMessage batch(IM_MESSAGE);
+	batch.AddInt32("im_what", IM_BATCH);
+	batch.AddMessage("message", &contactListMsg);
 
-	// Contact list and vCard request
 	std::list<BMessage>::iterator msgsIt;
+	for (msgsIt = msgs.begin(); msgsIt != msgs.end(); ++msgsIt)
+		batch.AddMessage("message", &(*msgsIt));
+	_SendMessage(&batch);
+
+	// vCard request
 	for (msgsIt = msgs.begin(); msgsIt != msgs.end(); ++msgsIt) {
-		BMessage msg = (*msgsIt);
-		const char* jid = msg.FindString("user_id");
-		_SendMessage(&msg);
+		const char* jid = (*msgsIt).FindString("user_id");
 		fVCardManager->fetchVCard(gloox::JID(jid), this);
 	}
 
@@ -1653,7 +1708,10 @@ JabberHandler::handleMUCParticipantPresence(gloox::MUCRoom *room,
 		return;
 	}
 
-	_StatusSetMsg(user_id.String(), presence.presence(), presence.status().c_str(), "");
+	// A room's occupants arrive all at once when it's joined, so they're
+	// queued, and sent together
+	_StatusSetMsg(user_id.String(), presence.presence(), presence.status().c_str(), "",
+		true);
 
 	// If unavailable (disconnected/left chat)
 	if (presence.presence() == 5) {
@@ -1666,9 +1724,9 @@ JabberHandler::handleMUCParticipantPresence(gloox::MUCRoom *room,
 	joinMsg.AddString("user_id", user_id);
 	joinMsg.AddString("user_name", nick);
 	joinMsg.AddString("chat_id", chat_id);
-	_SendMessage(&joinMsg);
+	_QueueMessage(&joinMsg);
 
-	_RoleChangedMsg(chat_id, user_id, role, aff);
+	_RoleChangedMsg(chat_id, user_id, role, aff, true);
 }
 
 
@@ -6,6 +6,8 @@
 #ifndef _JABBER_HANDLER_H
 #define _JABBER_HANDLER_H
 
+#include <Locker.h>
+#include <Message.h>
 #include <Notification.h>
 #include <Path.h>
 #include <String.h>
@@ -85,6 +87,8 @@ public:
 			gloox::Client*			Client() const;
 			void					HandleConnectionError(gloox::ConnectionError& e);
 			void					HandleStanzaError(gloox::StanzaError error);
+			// Sends what's been queued, once what was received's been handled
+			void					FlushBatch();
 
 			// Callbacks for protocols
 	virtual	void					OverrideSettings() = 0;
@@ -128,17 +132,25 @@ private:
 			BList*					fAvatars;
 			bigtime_t				fLastOwnVCard; // Last time VCard updated
 
+			// Rooms' occupants, queued by the receiving thread, but flushed by
+			// whichever sends next
+			BMessage				fBatch;
+			BLocker					fBatchLock;
+
 			void					_SendMessage(BMessage* msg);
+			void					_QueueMessage(BMessage* msg);
 			void					_MessageSent(const char* id, const char* subject,
 												const char* body);
 
 			void					_JoinRoom(const char* chat_id);
 			void					_ChatCreatedMsg(const char* id);
 			void					_RoleChangedMsg(BString chat_id, BString user_id,
-													gloox::MUCRoomRole role, gloox::MUCRoomAffiliation aff);
+													gloox::MUCRoomRole role, gloox::MUCRoomAffiliation aff,
+													bool queue = false);
 			void					_UserLeftMsg(BString chat_id, gloox::MUCRoomParticipant participant);
 			void					_StatusSetMsg(const char* user_id, gloox::Presence::PresenceType type,
-												  const char* message, const char* resource);
+												  const char* message, const char* resource,
+												  bool queue = false);
 
 			void					_Notify(notification_type type, const char* title, const char* message);
 			void					_NotifyProgress(const char* title, const char* message, float progress);
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <vector>
+
+#include <Message.h>
+
+#include "AtomTable.h"
+
+
+static void
+test_counting()
+{
+	AtomTable atoms;
+	CHECK(atoms.Acquire("") == kNoAtom);
+	CHECK(atoms.Find("alice") == kNoAtom);
+
+	atom_id alice = atoms.Acquire("alice");
+	atom_id bob = atoms.Acquire("bob");
+	CHECK(alice != kNoAtom && bob != kNoAtom && alice != bob);
+	CHECK(atoms.Acquire("alice") == alice);
+	CHECK(atoms.Find("alice") == alice);
+	CHECK(atoms.StringFor(bob) == "bob");
+	CHECK(atoms.CountAtoms() == 2);
+
+	// Forgotten only once every reference is released
+	atoms.Release(alice);
+	CHECK(atoms.Find("alice") == alice);
+	atoms.Release(alice);
+	CHECK(atoms.Find("alice") == kNoAtom);
+	CHECK(atoms.CountAtoms() == 1);
+
+	// … and its slot is reused, but not its atom
+	atom_id carol = atoms.Acquire("carol");
+	CHECK(carol != alice && carol != kNoAtom && carol != bob);
+	CHECK(atoms.StringFor(carol) == "carol");
+	CHECK(atoms.StringFor(alice) == "");
+	CHECK(atoms.Find("bob") == bob);
+	CHECK(atoms.StringFor(bob) == "bob");
+
+	// Releasing what isn't held is harmless
+	atoms.Release(kNoAtom);
+	atoms.Release(1000);
+	atoms.Release(bob);
+	atoms.Release(bob);
+	CHECK(atoms.Find("bob") == kNoAtom);
+	CHECK(atoms.Find("carol") == carol);
+	CHECK(atoms.CountAtoms() == 1);
+}
+
+
+static void
+test_stamps()
+{
+	AtomTable atoms;
+	atom_id alice = atoms.Acquire("alice");
+	atom_id room = atoms.Acquire("#haiku");
+
+	// Stamped with each ID's atom, even those without one
+	BMessage msg;
+	msg.AddString("chat_id", "#haiku");
+	msg.AddString("user_id", "alice");
+	msg.AddString("user_id", "bob");
+	atoms.Stamp(&msg, "user_id", "user_atom");
+	atoms.Stamp(&msg, "chat_id", "chat_atom");
+	int32 stamped = kNoAtom;
+	CHECK(msg.FindInt32("user_atom", 0, &stamped) == B_OK && stamped == alice);
+	CHECK(msg.FindInt32("user_atom", 1, &stamped) == B_OK
+		&& stamped == kNoAtom);
+	CHECK(atoms.Find(&msg, "user_id", "user_atom") == alice);
+	CHECK(atoms.Find(&msg, "chat_id", "chat_atom") == room);
+
+	// Stamping twice doesn't add more
+	atoms.Stamp(&msg, "user_id", "user_atom");
+	CHECK(msg.FindInt32("user_atom", 2, &stamped) != B_OK);
+
+	// Looked up, if it wasn't known when stamped…
+	CHECK(atoms.Find(&msg, "user_id", "user_atom", 1) == kNoAtom);
+	atom_id bob = atoms.Acquire("bob");
+	CHECK(atoms.Find(&msg, "user_id", "user_atom", 1) == bob);
+
+	// … or was, but has since been forgotten, and its slot reused
+	atoms.Release(alice);
+	atom_id carol = atoms.Acquire("carol");
+	CHECK(atoms.Find(&msg, "user_id", "user_atom") == kNoAtom);
+	atom_id alice2 = atoms.Acquire("alice");
+	CHECK(alice2 != alice && alice2 != carol);
+	CHECK(atoms.Find(&msg, "user_id", "user_atom") == alice2);
+
+	// Another table's stamps are ignored
+	AtomTable other;
+	other.Acquire("dave");
+	atom_id otherAlice = other.Acquire("alice");
+	CHECK(other.Find(&msg, "user_id", "user_atom") == otherAlice);
+	BMessage unstamped;
+	unstamped.AddString("user_id", "alice");
+	CHECK(atoms.Find(&unstamped, "user_id", "user_atom") == alice2);
+	CHECK(atoms.Find(&unstamped, "chat_id", "chat_atom") == kNoAtom);
+}
+
+
+// Random acquires and releases, against what should be held
+static void
+test_random()
+{
+	AtomTable atoms;
+	std::vector<int32> references(300, 0);
+	std::vector<atom_id> held(300, kNoAtom);
+	std::vector<atom_id> seen;
+	uint32 state = 11;
+
+	int32 wrong = 0;
+	for (int32 i = 0; i < 50000; i++) {
+		uint32 n = next_random(&state) % 300;
+		BString id("user");
+		id << (int32)n;
+		if (next_random(&state) % 2 == 0) {
+			atom_id atom = atoms.Acquire(id);
+			if (references[n] > 0 && atom != held[n])
+				wrong++;
+			// Never one that's been another ID's
+			if (references[n] == 0) {
+				for (size_t j = 0; j < seen.size(); j++)
+					if (seen[j] == atom)
+						wrong++;
+				seen.push_back(atom);
+			}
+			held[n] = atom;
+			references[n]++;
+		} else if (references[n] > 0) {
+			atoms.Release(held[n]);
+			references[n]--;
+		}
+		if (atoms.Find(id) != (references[n] > 0 ? held[n] : kNoAtom))
+			wrong++;
+	}
+	CHECK(wrong == 0);
+
+	int32 count = 0;
+	for (int32 n = 0; n < 300; n++) {
+		if (references[n] == 0)
+			continue;
+		count++;
+		BString id("user");
+		id << n;
+		if (atoms.StringFor(held[n]) != id)
+			wrong++;
+	}
+	CHECK(wrong == 0);
+	CHECK(atoms.CountAtoms() == count);
+}
+
+
+void
+test_atom_table()
+{
+	test_counting();
+	test_stamps();
+	test_random();
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <string.h>
+
+#include <Message.h>
+
+#include "ChatEvent.h"
+#include "ChatProtocolMessages.h"
+
+
+static ChatEvent
+make_event()
+{
+	ChatEvent event;
+	event.fWhat = IM_MESSAGE_RECEIVED;
+	event.fWhen = 1656000000;
+	event.fChatId = "#haiku";
+	event.fUserId = "alice!al@example.org";
+	event.fUserName = "alice";
+	event.fBody = "Hello, world! Grüße";
+	event.AddFace(0, 5, 1);
+	event.AddFace(7, 5, 2);
+	event.AddColor(14, 5, make_color(255, 0, 0));
+	event.SetUserColor(make_color(10, 20, 30));
+	return event;
+}
+
+
+static bool
+same_events(const ChatEvent& a, const ChatEvent& b)
+{
+	if (a.fWhat != b.fWhat || a.fWhen != b.fWhen || a.fFlags != b.fFlags
+			|| a.fChatId != b.fChatId || a.fUserId != b.fUserId
+			|| a.fUserName != b.fUserName || a.fBody != b.fBody
+			|| a.fFaces.CountItems() != b.fFaces.CountItems()
+			|| a.fColors.CountItems() != b.fColors.CountItems())
+		return false;
+	if ((a.fFlags & CHAT_EVENT_STATUS) && a.fStatus != b.fStatus)
+		return false;
+	if ((a.fFlags & CHAT_EVENT_USER_COLOR) && a.fUserColor != b.fUserColor)
+		return false;
+
+	for (uint32 i = 0; i < a.fFaces.CountItems(); i++) {
+		const face_span& x = a.fFaces.ItemAt(i);
+		const face_span& y = b.fFaces.ItemAt(i);
+		if (x.start != y.start || x.length != y.length || x.face != y.face)
+			return false;
+	}
+	for (uint32 i = 0; i < a.fColors.CountItems(); i++) {
+		const color_span& x = a.fColors.ItemAt(i);
+		const color_span& y = b.fColors.ItemAt(i);
+		if (x.start != y.start || x.length != y.length || x.color != y.color)
+			return false;
+	}
+	return true;
+}
+
+
+static void
+test_flatten()
+{
+	ChatEvent event = make_event();
+	ssize_t size = event.FlattenedSize();
+	char* buffer = new char[size];
+	CHECK(event.Flatten(buffer, size) == B_OK);
+
+	ChatEvent read;
+	CHECK(read.Unflatten(buffer, size) == B_OK);
+	CHECK(same_events(event, read) == true);
+
+	// Too small a buffer to flatten into
+	CHECK(event.Flatten(buffer, size - 1) == B_BAD_VALUE);
+	CHECK(event.Flatten(NULL, size) == B_BAD_VALUE);
+	delete[] buffer;
+
+	// Nothing but the header
+	ChatEvent empty;
+	size = empty.FlattenedSize();
+	CHECK(size == (ssize_t)sizeof(chat_event_header));
+	buffer = new char[size];
+	CHECK(empty.Flatten(buffer, size) == B_OK);
+	CHECK(read.Unflatten(buffer, size) == B_OK);
+	CHECK(same_events(empty, read) == true);
+	CHECK(read.fFaces.CountItems() == 0 && read.fBody.IsEmpty() == true);
+	delete[] buffer;
+
+	// Presence, with its status
+	ChatEvent status;
+	status.fWhat = IM_USER_STATUS_SET;
+	status.fUserId = "bob";
+	status.fBody = "Out to lunch";
+	status.SetStatus(3);
+	size = status.FlattenedSize();
+	buffer = new char[size];
+	CHECK(status.Flatten(buffer, size) == B_OK);
+	CHECK(read.Unflatten(buffer, size) == B_OK);
+	CHECK(same_events(status, read) == true);
+	CHECK(read.fStatus == 3 && (read.fFlags & CHAT_EVENT_STATUS) != 0);
+	delete[] buffer;
+}
+
+
+static void
+test_unflatten_bad()
+{
+	ChatEvent event = make_event();
+	ssize_t size = event.FlattenedSize();
+	char* buffer = new char[size];
+	event.Flatten(buffer, size);
+
+	// Cut short, anywhere
+	ChatEvent read;
+	CHECK(read.Unflatten(buffer, size - 1) == B_BAD_DATA);
+	CHECK(read.Unflatten(buffer, sizeof(chat_event_header) - 1)
+		== B_BAD_DATA);
+	CHECK(read.Unflatten(NULL, size) == B_BAD_DATA);
+	CHECK(read.fBody.IsEmpty() == true && read.fWhat == 0);
+
+	// Someone else's data, or a newer version's
+	chat_event_header header;
+	memcpy(&header, buffer, sizeof(header));
+	header.magic = 0;
+	memcpy(buffer, &header, sizeof(header));
+	CHECK(read.Unflatten(buffer, size) == B_BAD_DATA);
+	header.magic = kChatEventMagic;
+	header.version = kChatEventVersion + 1;
+	memcpy(buffer, &header, sizeof(header));
+	CHECK(read.Unflatten(buffer, size) == B_BAD_DATA);
+
+	// Sizes claiming more than there is, without overflowing
+	header.version = kChatEventVersion;
+	header.string_sizes[3] = 0xffffffff;
+	memcpy(buffer, &header, sizeof(header));
+	CHECK(read.Unflatten(buffer, size) == B_BAD_DATA);
+	header.string_sizes[3] = event.fBody.Length();
+	header.face_count = 0x7fffffff;
+	memcpy(buffer, &header, sizeof(header));
+	CHECK(read.Unflatten(buffer, size) == B_BAD_DATA);
+	delete[] buffer;
+}
+
+
+static void
+test_message()
+{
+	// Carried as one field, replaced rather than added to
+	ChatEvent event = make_event();
+	BMessage msg(IM_MESSAGE);
+	msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+	msg.AddString("body", "The fields say otherwise");
+	CHECK(event.AddTo(&msg) == B_OK);
+	event.fBody = "Changed since";
+	CHECK(event.AddTo(&msg) == B_OK);
+
+	const void* data = NULL;
+	ssize_t size = 0;
+	CHECK(msg.FindData(kChatEventField, kChatEventType, 1, &data, &size)
+		!= B_OK);
+
+	// … and preferred to the named fields
+	ChatEvent read(&msg);
+	CHECK(same_events(event, read) == true);
+	CHECK(read.fBody == "Changed since");
+
+	// Without it, from the fields
+	BMessage fields(IM_MESSAGE);
+	make_event().AddFieldsTo(&fields);
+	CHECK(fields.FindString("body") == make_event().fBody);
+	CHECK(fields.GetInt32("face_start", -1) == 0);
+	CHECK(read.SetTo(&fields) == B_OK);
+	CHECK(same_events(make_event(), read) == true);
+
+	// A broken one falls back on them too
+	char junk[4] = { 1, 2, 3, 4 };
+	fields.AddData(kChatEventField, kChatEventType, junk, sizeof(junk), false);
+	CHECK(read.SetTo(&fields) == B_OK);
+	CHECK(same_events(make_event(), read) == true);
+
+	CHECK(read.SetTo(NULL) == B_BAD_VALUE);
+	CHECK(read.fBody.IsEmpty() == true);
+}
+
+
+static void
+test_fields()
+{
+	// Presence's personal status is "message", not "body"
+	ChatEvent status;
+	status.fWhat = IM_USER_STATUS_SET;
+	status.fUserId = "bob";
+	status.fBody = "Out to lunch";
+	status.SetStatus(3);
+	BMessage msg(IM_MESSAGE);
+	status.AddFieldsTo(&msg);
+	CHECK(msg.FindString("message") == status.fBody);
+	CHECK(msg.FindString("body") == NULL);
+	CHECK(msg.GetInt32("status", -1) == 3);
+	ChatEvent read(&msg);
+	CHECK(same_events(status, read) == true);
+
+	// Spans missing a part are skipped, not misread
+	BMessage spans(IM_MESSAGE);
+	spans.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+	spans.AddString("body", "Bold and plain");
+	spans.AddInt32("face_start", 0);
+	spans.AddInt32("face_length", 4);
+	spans.AddUInt16("face", 1);
+	spans.AddInt32("face_start", 9);
+	spans.AddInt32("color_start", 0);
+	read.SetTo(&spans);
+	CHECK(read.fFaces.CountItems() == 1 && read.fColors.CountItems() == 0);
+	CHECK(read.fFaces.ItemAt(0).length == 4);
+	CHECK((read.fFlags & (CHAT_EVENT_STATUS | CHAT_EVENT_USER_COLOR)) == 0);
+
+	// Unset parts aren't written at all
+	ChatEvent empty;
+	BMessage none(IM_MESSAGE);
+	empty.AddFieldsTo(&none);
+	CHECK(none.HasName("im_what") == true && none.HasName("chat_id") == false);
+	CHECK(none.HasName("when") == false && none.HasName("status") == false);
+	CHECK(none.HasName("user_color") == false);
+}
+
+
+void
+test_chat_event()
+{
+	test_flatten();
+	test_unflatten_bad();
+	test_message();
+	test_fields();
+}
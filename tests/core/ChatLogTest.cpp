@@ -0,0 +1,380 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <stdio.h>
+
+#include <Entry.h>
+#include <File.h>
+#include <Message.h>
+
+#include "ChatLog.h"
+#include "ChatProtocolMessages.h"
+#include "Flags.h"
+#include "StorageUtils.h"
+
+
+static const char* kAccount = "test";
+
+
+static ChatEvent
+make_event(const char* room, int32 number, int32 bodySize = 0)
+{
+	ChatEvent event;
+	event.fWhat = IM_MESSAGE_RECEIVED;
+	event.fWhen = 1656000000 + number;
+	event.fChatId = room;
+	event.fUserId = "alice!al@example.org";
+	event.fUserName = "alice";
+	event.fBody << "message " << number;
+	while (event.fBody.Length() < bodySize)
+		event.fBody << " lorem ipsum";
+	return event;
+}
+
+
+// The number in each of the read messages' bodies, in order
+static void
+read_numbers(const BMessage& logs, List<int32>* numbers)
+{
+	const void* data = NULL;
+	ssize_t size = 0;
+	for (int32 i = 0; logs.FindData(kChatEventField, kChatEventType, i, &data,
+			&size) == B_OK; i++) {
+		ChatEvent event;
+		int number = -1;
+		if (event.Unflatten(data, size) == B_OK)
+			sscanf(event.fBody.String(), "message %d", &number);
+		numbers->AddItem(number);
+	}
+}
+
+
+// Whether numbers are those from first to last, in order
+static bool
+is_sequence(const List<int32>& numbers, int32 first, int32 last)
+{
+	if (numbers.CountItems() != (uint32)(last - first + 1))
+		return false;
+	for (uint32 i = 0; i < numbers.CountItems(); i++)
+		if (numbers.ItemAt(i) != first + (int32)i)
+			return false;
+	return true;
+}
+
+
+static bool
+read_sequence(ChatLog& log, int32 count, int32 first, int32 last,
+	bool start = false)
+{
+	BMessage logs;
+	if (log.Read(&logs, count) != B_OK)
+		return false;
+	List<int32> numbers;
+	read_numbers(logs, &numbers);
+	return is_sequence(numbers, first, last)
+		&& logs.GetBool("log_start", !start) == start;
+}
+
+
+static void
+test_append_read()
+{
+	ChatLog log(kAccount, "#append");
+	BMessage empty;
+	CHECK(log.Read(&empty) == B_ENTRY_NOT_FOUND);
+	CHECK(log.CountSegments() == 1);
+
+	List<log_position> positions;
+	for (int32 i = 0; i < 10; i++)
+		CHECK(log.Append(make_event("#append", i)) == B_OK);
+	List<ChatEvent> events;
+	for (int32 i = 10; i < 20; i++)
+		events.AddItem(make_event("#append", i));
+	CHECK(log.Append(events, &positions) == B_OK);
+	CHECK(positions.CountItems() == 10);
+	CHECK(log.Sync() == B_OK);
+
+	CHECK(read_sequence(log, 5, 15, 19) == true);
+	CHECK(read_sequence(log, 100, 0, 19, true) == true);
+
+	ChatEvent event;
+	CHECK(log.ReadEvent(positions.ItemAt(3), &event) == B_OK);
+	CHECK(event.fBody == "message 13");
+	CHECK(event.fWhen == 1656000013);
+
+	// Where the read began, for reading on from there
+	BMessage logs;
+	log_position position;
+	bool start = true;
+	CHECK(log.Read(&logs, 5) == B_OK);
+	CHECK(ChatLog::FindPosition(&logs, &position, &start) == B_OK);
+	CHECK(position.segment == positions.ItemAt(5).segment);
+	CHECK(position.offset == positions.ItemAt(5).offset);
+	CHECK(start == false);
+
+	BMessage before;
+	List<int32> numbers;
+	CHECK(log.ReadBefore(&before, position, 3) == B_OK);
+	read_numbers(before, &numbers);
+	CHECK(is_sequence(numbers, 12, 14) == true);
+
+	CHECK(log.FindLatest(1, &position) == B_OK);
+	CHECK(position.offset == positions.ItemAt(9).offset);
+	log_position end = log.End();
+	CHECK(end.segment == 0);
+	CHECK(end.offset > positions.ItemAt(9).offset);
+
+	// Opened again, it carries on where it was
+	ChatLog again(kAccount, "#append");
+	CHECK(read_sequence(again, 100, 0, 19, true) == true);
+	CHECK(again.Append(make_event("#append", 20)) == B_OK);
+	CHECK(read_sequence(again, 3, 18, 20) == true);
+}
+
+
+static void
+test_roll_over()
+{
+	ChatLog log(kAccount, "#roll");
+
+	// About 4 KB each, so 256 to a segment
+	const int32 count = 700;
+	List<log_position> positions;
+	for (int32 i = 0; i < count; i++) {
+		List<ChatEvent> events;
+		events.AddItem(make_event("#roll", i, 4000));
+		CHECK(log.Append(events, &positions) == B_OK);
+	}
+	CHECK(log.CountSegments() == 3);
+	CHECK(positions.ItemAt(0).segment == 0);
+	CHECK(positions.ItemAt(count - 1).segment == 2);
+
+	// Each segment begins where the last one's room ran out
+	int32 rolled = 0;
+	for (int32 i = 1; i < count; i++) {
+		if (positions.ItemAt(i).segment == positions.ItemAt(i - 1).segment)
+			continue;
+		rolled++;
+		CHECK(positions.ItemAt(i).segment
+			== positions.ItemAt(i - 1).segment + 1);
+		CHECK(positions.ItemAt(i).offset == 0);
+	}
+	CHECK(rolled == 2);
+
+	List<ChatEvent> events;
+	List<log_position> read;
+	CHECK(log.ReadSegment(1, &events, &read) == B_OK);
+	CHECK(events.IsEmpty() == false);
+	int32 first = -1;
+	for (int32 i = 0; i < count && first < 0; i++)
+		if (positions.ItemAt(i).segment == 1)
+			first = i;
+	CHECK(first > 0);
+	if (events.IsEmpty() == false && first > 0) {
+		BString body;
+		body << "message " << first;
+		CHECK(events.ItemAt(0).fBody.StartsWith(body.String()) == true);
+		CHECK(read.ItemAt(0).offset == 0);
+	}
+	CHECK(log.ReadSegment(3, &events, &read) == B_ENTRY_NOT_FOUND);
+
+	// The tail only keeps kLogTailSize, so this reads back across segments
+	CHECK(read_sequence(log, 400, count - 400, count - 1) == true);
+	CHECK(read_sequence(log, kLogTailSize, count - kLogTailSize, count - 1)
+		== true);
+	CHECK(read_sequence(log, count + 10, 0, count - 1, true) == true);
+
+	log_position position;
+	CHECK(log.FindLatest(count, &position) == B_OK);
+	CHECK(position.segment == 0 && position.offset == 0);
+}
+
+
+static void
+test_import()
+{
+	// Logs kept the old way, in the room's cache file― few enough to fit
+	// ext4's attributes, off Haiku
+	BMessage old;
+	for (int32 i = 0; i < 16; i++) {
+		BMessage entry(IM_MESSAGE);
+		entry.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+		entry.AddInt64("when", 1656000000 + i);
+		entry.AddString("chat_id", "#import");
+		entry.AddString("user_id", "bob");
+		BString body;
+		body << "message " << i;
+		entry.AddString("body", body);
+		old.AddMessage("message", &entry);
+	}
+
+	BPath roomPath = RoomCachePath(kAccount, "#import");
+	BFile room(roomPath.Path(), B_READ_WRITE | B_CREATE_FILE);
+	CHECK(room.InitCheck() == B_OK);
+	CHECK(WriteAttributeMessage(&room, "Chat:logs", &old) == B_OK);
+
+	ChatLog log(kAccount, "#import");
+	CHECK(read_sequence(log, 100, 0, 15, true) == true);
+
+	BMessage logs;
+	CHECK(log.Read(&logs, 1) == B_OK);
+	const void* data = NULL;
+	ssize_t size = 0;
+	ChatEvent event;
+	CHECK(logs.FindData(kChatEventField, kChatEventType, &data, &size)
+		== B_OK);
+	CHECK(event.Unflatten(data, size) == B_OK);
+	CHECK(event.fUserId == "bob");
+	CHECK(event.fWhen == 1656000015);
+
+	// Only the first time
+	CHECK(log.Append(make_event("#import", 16)) == B_OK);
+	ChatLog again(kAccount, "#import");
+	CHECK(read_sequence(again, 100, 0, 16, true) == true);
+
+	// A room without any starts empty
+	ChatLog none(kAccount, "#none");
+	CHECK(none.Read(&logs) == B_ENTRY_NOT_FOUND);
+}
+
+
+static BPath
+segment_path(const char* room, uint32 segment, bool archived)
+{
+	BString leaf;
+	leaf.SetToFormat("%08" B_PRIu32 ".%s", segment, archived ? "logz" : "log");
+	BPath path = RoomLogsPath(kAccount, room);
+	path.Append(leaf.String());
+	return path;
+}
+
+
+static bool
+exists(const BPath& path)
+{
+	return BEntry(path.Path()).Exists();
+}
+
+
+static void
+make_old(const BPath& path, time_t age)
+{
+	BFile file(path.Path(), B_READ_ONLY);
+	CHECK(file.SetModificationTime(time(NULL) - age) == B_OK);
+}
+
+
+static void
+test_archive()
+{
+	const char* room = "#archive";
+	const int32 count = 700;
+	List<log_position> positions;
+	{
+		ChatLog log(kAccount, room);
+		for (int32 i = 0; i < count; i++) {
+			List<ChatEvent> events;
+			events.AddItem(make_event(room, i, 4000));
+			CHECK(log.Append(events, &positions) == B_OK);
+		}
+		CHECK(log.CountSegments() == 3);
+		CHECK(log.Archive(0) == B_OK);
+	}
+
+	// Sealed segments are compressed, but not the one appended to
+	for (uint32 i = 0; i < 2; i++) {
+		CHECK(exists(segment_path(room, i, false)) == false);
+		CHECK(exists(segment_path(room, i, true)) == true);
+	}
+	CHECK(exists(segment_path(room, 2, false)) == true);
+	CHECK(exists(segment_path(room, 2, true)) == false);
+
+	off_t plain = 0, archived = 0;
+	BEntry(segment_path(room, 2, false).Path()).GetSize(&plain);
+	BEntry(segment_path(room, 0, true).Path()).GetSize(&archived);
+	CHECK(archived > 0 && archived < plain / 4);
+
+	// Read back from the archives as from the segments
+	ChatLog log(kAccount, room);
+	CHECK(read_sequence(log, count + 10, 0, count - 1, true) == true);
+	CHECK(read_sequence(log, 400, count - 400, count - 1) == true);
+
+	ChatEvent event;
+	CHECK(log.ReadEvent(positions.ItemAt(100), &event) == B_OK);
+	CHECK(event.fBody.StartsWith("message 100 ") == true);
+	CHECK(event.fWhen == 1656000100);
+
+	List<ChatEvent> events;
+	List<log_position> read;
+	CHECK(log.ReadSegment(0, &events, &read) == B_OK);
+	CHECK(events.IsEmpty() == false);
+	CHECK(read.CountItems() == events.CountItems());
+	CHECK(events.ItemAt(0).fBody.StartsWith("message 0 ") == true);
+	for (uint32 i = 0; i < read.CountItems(); i++)
+		CHECK(read.ItemAt(i).offset == positions.ItemAt(i).offset);
+
+	BMessage before;
+	List<int32> numbers;
+	log_position start = { 1, 0 };
+	CHECK(log.ReadBefore(&before, start, 10) == B_OK);
+	read_numbers(before, &numbers);
+	CHECK(is_sequence(numbers, events.CountItems() - 10,
+		events.CountItems() - 1) == true);
+
+	// Nothing's left to archive, however often it's asked
+	CHECK(log.Archive(0) == B_OK);
+	CHECK(ChatLog(kAccount, room).Archive(0) == B_OK);
+	CHECK(exists(segment_path(room, 0, true)) == true);
+
+	// Past the retention period, but kept for the room
+	make_old(segment_path(room, 0, true), 10 * 24 * 60 * 60);
+	make_old(segment_path(room, 1, true), 10 * 24 * 60 * 60);
+	BFile roomFile(RoomCachePath(kAccount, room).Path(),
+		B_READ_WRITE | B_CREATE_FILE);
+	int32 flags = ROOM_KEEP_LOGS;
+	CHECK(roomFile.WriteAttr("Chat:flags", B_INT32_TYPE, 0, &flags,
+		sizeof(flags)) == sizeof(flags));
+	CHECK(ChatLog(kAccount, room).Archive(24 * 60 * 60) == B_OK);
+	CHECK(exists(segment_path(room, 0, true)) == true);
+
+	// Otherwise removed, save what the tail still points into
+	flags = 0;
+	CHECK(roomFile.WriteAttr("Chat:flags", B_INT32_TYPE, 0, &flags,
+		sizeof(flags)) == sizeof(flags));
+	CHECK(ChatLog(kAccount, room).Archive(24 * 60 * 60) == B_OK);
+	CHECK(exists(segment_path(room, 0, true)) == false);
+	CHECK(positions.ItemAt(count - kLogTailSize).segment == 1);
+	CHECK(exists(segment_path(room, 1, true)) == true);
+
+	// What's missing reads as the log's start
+	int32 first = count - 1;
+	while (first > 0 && positions.ItemAt(first - 1).segment > 0)
+		first--;
+	CHECK(read_sequence(log, count + 10, first, count - 1, true) == true);
+	CHECK(read_sequence(log, kLogTailSize, count - kLogTailSize, count - 1)
+		== true);
+
+	// As does a damaged one
+	BFile damaged(segment_path(room, 1, true).Path(),
+		B_WRITE_ONLY | B_ERASE_FILE);
+	CHECK(damaged.Write("junk", 4) == 4);
+	CHECK(log.ReadSegment(1, &events, &read) == B_BAD_DATA);
+	first = count - 1;
+	while (first > 0 && positions.ItemAt(first - 1).segment > 1)
+		first--;
+	CHECK(read_sequence(log, count + 10, first, count - 1, true) == true);
+}
+
+
+void
+test_chat_log()
+{
+	test_append_read();
+	test_roll_over();
+	test_import();
+	test_archive();
+}
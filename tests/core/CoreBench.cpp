@@ -0,0 +1,1256 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Drives libcore with synthetic IRC traffic, in a channel of 10, 1k and 10k
+ * users: everyone joins, chats, changes nick, is lost in a netsplit, and comes
+ * back in a NAMES reply. Each line is parsed as IrcProtocol does, then applied
+ * to the room's members, in the RoomMembers Conversation keeps them in (by
+ * atom, and by name for completion), and to nicks' idents, as in IrcProtocol.
+ * Prints the time per line of each phase, and parsing's alone.
+ *
+ * Then weighs keying users by atom against keying them by ID: the memory held
+ * by 10k users in 20 rooms of 2k, and the cost of finding a chat message's
+ * author in its room, by the ID, by looking up its atom, and by the atom the
+ * inbox stamped the message with. Memory's counted by replacing operator new.
+ *
+ * Last, compares the ways a chat message gets from the inbox to the view: read
+ * from its BMessage's fields by each of the three that need it (the log,
+ * Conversation and ConversationView), as it was, or flattened once into a
+ * ChatEvent and read back once, as it is now. Off Haiku, BMessage is
+ * libs/libcore/linux's stand-in, so only Haiku's numbers are the real thing.
+ *
+ * Then indexes a million made-up chat lines as SearchIndex does― runs written
+ * out every kIndexBufferSize postings, and merged by tier― and times queries
+ * of common, rare and several words against the runs it ends up with. The
+ * runs are kept in memory, so that's the index's cost, not the disk's.
+ *
+ * Then fills a room's ChatLog with such lines, archives its sealed segments,
+ * and prints how much smaller they got and how fast they read back, before
+ * and after. Only the words' frequencies are like speech's, so a real log
+ * may well compress differently. The files are kept in a settings directory
+ * of their own, under /tmp, and read from the page cache.
+ *
+ * Last, times opening a room as the view does― a new ChatLog, and a Read() of
+ * the latest messages― with 3 MB, 64 MB and 1 GB of history, from the page
+ * cache and (where posix_fadvise() can evict it) from the disk, and counts
+ * the page faults each open takes. The larger logs are the smaller's, their
+ * older segments links to one of its own, so they're made at once.
+ *
+ * Last, submits 1k messages a second across 50 rooms to the LogWriter, at
+ * its default flush interval, buffered and then synced: how long Submit()
+ * takes, whether the submitter does any I/O itself (where Linux counts it per
+ * thread), the writer's CPU time, how far behind it is at the end of the
+ * burst, and how long quitting takes.
+ *
+ * The lines and messages are made up front, so only handling them is timed.
+ * Like the tests, builds on Linux too. */
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <libsupport/KeyMap.h>
+
+#include <DataIO.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Message.h>
+
+#include "AtomTable.h"
+#include "ChatEvent.h"
+#include "ChatLog.h"
+#include "ChatProtocolMessages.h"
+#include "IndexRun.h"
+#include "IrcParser.h"
+#include "LogWriter.h"
+#include "RoomMembers.h"
+#include "StorageUtils.h"
+
+
+static const int32 kSizes[] = { 10, 1000, 10000 };
+static const int32 kMessages = 100000;
+static const int32 kNamesPerReply = 50;
+
+static const char* kChannel = "#bench";
+
+static const int32 kAtomUsers = 10000;
+static const int32 kAtomRooms = 20;
+static const int32 kAtomRoomSize = 2000;
+static const int32 kAtomLookups = 200000;
+
+static const int32 kEvents = 200000;
+static const int32 kEventMessages = 1000;
+static const int32 kEventReaders = 3;
+
+static const int32 kSearchLines = 1000000;
+static const int32 kSearchWords = 50000;
+static const int32 kSearchQueries = 200;
+
+static const char* kLogAccount = "bench";
+static const uint32 kLogArchived = 8;
+static const int32 kLogReads = 2000;
+static const int32 kLogOpens = 2000;
+static const int32 kLogColdOpens = 20;
+
+static const int32 kWriterRooms = 50;
+static const int32 kWriterRate = 1000;
+static const int32 kWriterSeconds = 4;
+
+
+struct Member {
+	atom_id	atom;
+	BString	nick;
+};
+
+
+// Bytes allocated and not yet freed, with a header to remember each's size
+static size_t sAllocated = 0;
+
+union alloc_header {
+	size_t		size;
+	max_align_t	_align;
+};
+
+
+void*
+operator new(size_t size)
+{
+	alloc_header* header = (alloc_header*)malloc(sizeof(alloc_header) + size);
+	if (header == NULL)
+		throw std::bad_alloc();
+	header->size = size;
+	sAllocated += size;
+	return header + 1;
+}
+
+
+void
+operator delete(void* pointer) noexcept
+{
+	if (pointer == NULL)
+		return;
+	alloc_header* header = (alloc_header*)pointer - 1;
+	sAllocated -= header->size;
+	free(header);
+}
+
+
+void*
+operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+
+void
+operator delete[](void* pointer) noexcept
+{
+	operator delete(pointer);
+}
+
+
+// The little of Conversation and IrcProtocol that a busy channel exercises:
+// members kept as Conversation keeps them, and IrcProtocol's nicks' idents
+class BenchRoom {
+public:
+						BenchRoom();
+						~BenchRoom();
+
+			void		Apply(const irc_line& line);
+
+			int32		CountMembers() const { return fMembers.CountMembers(); }
+			int32		CountAtoms() const { return fAtoms.CountAtoms(); }
+			int64		Received() const { return fReceived; }
+
+private:
+			void		_Join(const BString& ident, const BString& nick);
+			void		_Leave(const BString& ident);
+			void		_Rename(const BString& ident, const BString& nick);
+			Member*		_MemberFor(const BString& ident);
+
+	AtomTable					fAtoms;
+	RoomMembers<Member>			fMembers;
+	KeyMap<BString, BString>	fNickIdents;
+	int64						fReceived;
+};
+
+
+BenchRoom::BenchRoom()
+	:
+	fReceived(0)
+{
+}
+
+
+BenchRoom::~BenchRoom()
+{
+	for (int32 i = 0; i < fMembers.CountMembers(); i++)
+		delete fMembers.Members().ValueAt(i);
+}
+
+
+void
+BenchRoom::Apply(const irc_line& line)
+{
+	BString ident = IrcSenderIdent(line.sender);
+
+	if (line.numeric == 353) {
+		// Idents come later, with WHO, so nicks stand in until then
+		BStringList nicks;
+		line.params.Last().Split(" ", true, nicks);
+		for (int32 i = 0; i < nicks.CountStrings(); i++) {
+			BString nick = nicks.StringAt(i);
+			if (nick.StartsWith("@") || nick.StartsWith("+"))
+				nick.RemoveChars(0, 1);
+			_Join(nick, nick);
+		}
+	} else if (line.code == "JOIN")
+		_Join(ident, IrcSenderNick(line.sender));
+	else if (line.code == "PART" || line.code == "QUIT")
+		_Leave(ident);
+	else if (line.code == "NICK")
+		_Rename(ident, line.params.Last());
+	else if (line.code == "PRIVMSG") {
+		if (IsIrcChannelName(line.params.First()) == true
+				&& _MemberFor(ident) != NULL)
+			fReceived += line.params.Last().Length();
+	}
+}
+
+
+void
+BenchRoom::_Join(const BString& ident, const BString& nick)
+{
+	fNickIdents.AddItem(IrcCaseMapped(nick), ident);
+	if (_MemberFor(ident) != NULL)
+		return;
+
+	Member* member = new Member;
+	member->atom = fAtoms.Acquire(ident);
+	member->nick = nick;
+	fMembers.Add(member->atom, member, ident, nick);
+}
+
+
+void
+BenchRoom::_Leave(const BString& ident)
+{
+	Member* member = _MemberFor(ident);
+	if (member == NULL)
+		return;
+
+	fMembers.Remove(member->atom);
+	fNickIdents.RemoveItemFor(IrcCaseMapped(member->nick));
+	fAtoms.Release(member->atom);
+	delete member;
+}
+
+
+void
+BenchRoom::_Rename(const BString& ident, const BString& nick)
+{
+	Member* member = _MemberFor(ident);
+	if (member == NULL)
+		return;
+
+	fNickIdents.RemoveItemFor(IrcCaseMapped(member->nick));
+	member->nick = nick;
+	fMembers.Rename(member, nick);
+	fNickIdents.AddItem(IrcCaseMapped(nick), ident);
+}
+
+
+Member*
+BenchRoom::_MemberFor(const BString& ident)
+{
+	return fMembers.Find(fAtoms.Find(ident));
+}
+
+
+static BString
+nick_for(int32 user, int32 generation)
+{
+	BString nick("user");
+	nick << user;
+	if (generation > 0)
+		nick << "_" << generation;
+	return nick;
+}
+
+
+static BString
+sender_for(int32 user, int32 generation)
+{
+	BString sender(nick_for(user, generation));
+	sender << "!u" << user << "@host" << user % 97 << ".example.org";
+	return sender;
+}
+
+
+static uint32
+next_random(uint32* state)
+{
+	// xorshift32
+	uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+struct Phase {
+	const char*				name;
+	std::vector<BString>	lines;
+};
+
+
+static void
+make_phases(int32 users, std::vector<Phase>* phases)
+{
+	Phase join = { "join" };
+	for (int32 i = 0; i < users; i++)
+		join.lines.push_back(BString(":") << sender_for(i, 0) << " JOIN "
+			<< kChannel);
+
+	Phase chat = { "chat" };
+	uint32 state = 2022;
+	for (int32 i = 0; i < kMessages; i++) {
+		int32 user = next_random(&state) % users;
+		chat.lines.push_back(BString(":") << sender_for(user, 0)
+			<< " PRIVMSG " << kChannel << " :Message " << i
+			<< ", as long as most are, give or take a word or two");
+	}
+
+	Phase nick = { "nick" };
+	for (int32 i = 0; i < users; i++)
+		nick.lines.push_back(BString(":") << sender_for(i, 0) << " NICK :"
+			<< nick_for(i, 1));
+
+	Phase split = { "netsplit" };
+	for (int32 i = 0; i < users; i++)
+		split.lines.push_back(BString(":") << sender_for(i, 1)
+			<< " QUIT :*.example.org *.split");
+
+	Phase names = { "names" };
+	for (int32 i = 0; i < users; i += kNamesPerReply) {
+		BString line(":irc.example.org 353 me = ");
+		line << kChannel << " :";
+		for (int32 j = i; j < users && j < i + kNamesPerReply; j++)
+			line << (j % 10 == 0 ? "@" : "") << nick_for(j, 1) << " ";
+		names.lines.push_back(line);
+	}
+
+	phases->push_back(join);
+	phases->push_back(chat);
+	phases->push_back(nick);
+	phases->push_back(split);
+	phases->push_back(names);
+}
+
+
+static void
+print_phase(int32 users, const char* name, size_t lines, double nanoseconds)
+{
+	double each = lines > 0 ? nanoseconds / lines : 0;
+	printf("%7d  %-10s %8d %10.1f %12.0f\n", (int)users, name, (int)lines,
+		each, each > 0 ? 1000000000.0 / each : 0);
+}
+
+
+static void
+bench(int32 users)
+{
+	std::vector<Phase> phases;
+	make_phases(users, &phases);
+
+	// Parsing alone, of the chatter
+	irc_line line;
+	const std::vector<BString>& chat = phases[1].lines;
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	int64 sum = 0;
+	for (size_t i = 0; i < chat.size(); i++) {
+		ParseIrcLine(chat[i], &line);
+		sum += line.params.CountStrings();
+	}
+	std::chrono::duration<double, std::nano> elapsed
+		= std::chrono::steady_clock::now() - start;
+	if (sum != (int64)chat.size() * 2)
+		fprintf(stderr, "Chat lines parsed wrong\n");
+	print_phase(users, "(parse)", chat.size(), elapsed.count());
+
+	BenchRoom room;
+	for (size_t p = 0; p < phases.size(); p++) {
+		const std::vector<BString>& lines = phases[p].lines;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < lines.size(); i++) {
+			ParseIrcLine(lines[i], &line);
+			room.Apply(line);
+		}
+		elapsed = std::chrono::steady_clock::now() - start;
+		print_phase(users, phases[p].name, lines.size(), elapsed.count());
+
+		// Everyone's gone after the split, and should be forgotten
+		if (phases[p].name == BString("netsplit")
+				&& (room.CountMembers() != 0 || room.CountAtoms() != 0))
+			fprintf(stderr, "%d members and %d atoms left after the split\n",
+				(int)room.CountMembers(), (int)room.CountAtoms());
+	}
+
+	if (room.CountMembers() != users)
+		fprintf(stderr, "%d of %d users back after the split\n",
+			(int)room.CountMembers(), (int)users);
+	if (room.Received() == 0)
+		fprintf(stderr, "No messages received\n");
+}
+
+
+static void
+print_atoms(const char* name, size_t bytes, double nanoseconds)
+{
+	double each = nanoseconds / kAtomLookups;
+	printf("%-28s %10.1f %10.1f %12.0f\n", name,
+		bytes / (double)(kAtomRooms * kAtomRoomSize), each,
+		each > 0 ? 1000000000.0 / each : 0);
+}
+
+
+// Keyed as Conversation and ProtocolLooper key their users, by KEY
+template<class KEY>
+struct AtomBenchModel {
+	KeyMap<KEY, Member*>				users;
+	std::vector<KeyMap<KEY, Member*>*>	rooms;
+
+	~AtomBenchModel()
+	{
+		for (uint32 i = 0; i < users.CountItems(); i++)
+			delete users.ValueAt(i);
+		for (size_t i = 0; i < rooms.size(); i++)
+			delete rooms[i];
+	}
+};
+
+
+static void
+bench_atoms()
+{
+	std::vector<BString> ids;
+	for (int32 i = 0; i < kAtomUsers; i++)
+		ids.push_back(sender_for(i, 0));
+
+	// Who's where; the same for both
+	std::vector<std::vector<int32> > rooms(kAtomRooms);
+	uint32 state = 6;
+	for (int32 r = 0; r < kAtomRooms; r++)
+		for (int32 i = 0; i < kAtomRoomSize; i++)
+			rooms[r].push_back(next_random(&state) % kAtomUsers);
+
+	// Chat messages from the first room, as the inbox passes them on
+	AtomTable atoms;
+	std::vector<BMessage> plain;
+	for (int32 i = 0; i < 1000; i++) {
+		BMessage msg(IM_MESSAGE);
+		msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+		msg.AddString("chat_id", kChannel);
+		msg.AddString("user_id", ids[rooms[0][i % kAtomRoomSize]]);
+		plain.push_back(msg);
+	}
+
+	// By ID, as before
+	size_t before = sAllocated;
+	AtomBenchModel<BString>* byId = new AtomBenchModel<BString>;
+	for (int32 i = 0; i < kAtomUsers; i++) {
+		Member* member = new Member;
+		member->atom = kNoAtom;
+		member->nick = ids[i];
+		byId->users.AddItem(ids[i], member);
+	}
+	for (int32 r = 0; r < kAtomRooms; r++) {
+		KeyMap<BString, Member*>* room = new KeyMap<BString, Member*>;
+		for (size_t i = 0; i < rooms[r].size(); i++) {
+			const BString& id = ids[rooms[r][i]];
+			room->AddItem(id, byId->users.ValueFor(id));
+		}
+		byId->rooms.push_back(room);
+	}
+	size_t idBytes = sAllocated - before;
+
+	// By atom, each user holding theirs
+	before = sAllocated;
+	AtomBenchModel<atom_id>* byAtom = new AtomBenchModel<atom_id>;
+	for (int32 i = 0; i < kAtomUsers; i++) {
+		Member* member = new Member;
+		member->atom = atoms.Acquire(ids[i]);
+		member->nick = ids[i];
+		byAtom->users.AddItem(member->atom, member);
+	}
+	for (int32 r = 0; r < kAtomRooms; r++) {
+		KeyMap<atom_id, Member*>* room = new KeyMap<atom_id, Member*>;
+		for (size_t i = 0; i < rooms[r].size(); i++) {
+			atom_id atom = atoms.Find(ids[rooms[r][i]]);
+			room->AddItem(atom, byAtom->users.ValueFor(atom));
+		}
+		byAtom->rooms.push_back(room);
+	}
+	size_t atomBytes = sAllocated - before;
+
+	std::vector<BMessage> stamped(plain);
+	for (size_t i = 0; i < stamped.size(); i++)
+		atoms.Stamp(&stamped[i], "user_id", "user_atom");
+
+	int32 missed = 0;
+	KeyMap<BString, Member*>* idRoom = byId->rooms[0];
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kAtomLookups; i++) {
+		const BMessage& msg = plain[i % plain.size()];
+		if (idRoom->ValueFor(msg.FindString("user_id")) == NULL)
+			missed++;
+	}
+	std::chrono::duration<double, std::nano> idTime
+		= std::chrono::steady_clock::now() - start;
+
+	KeyMap<atom_id, Member*>* atomRoom = byAtom->rooms[0];
+	start = std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kAtomLookups; i++) {
+		const BMessage& msg = plain[i % plain.size()];
+		if (atomRoom->ValueFor(atoms.Find(&msg, "user_id", "user_atom"))
+				== NULL)
+			missed++;
+	}
+	std::chrono::duration<double, std::nano> foundTime
+		= std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kAtomLookups; i++) {
+		const BMessage& msg = stamped[i % stamped.size()];
+		if (atomRoom->ValueFor(atoms.Find(&msg, "user_id", "user_atom"))
+				== NULL)
+			missed++;
+	}
+	std::chrono::duration<double, std::nano> stampedTime
+		= std::chrono::steady_clock::now() - start;
+
+	if (missed != 0)
+		fprintf(stderr, "%d authors not found\n", (int)missed);
+
+	printf("\n%-28s %10s %10s %12s\n", "users keyed", "B/member", "ns each",
+		"lookups/s");
+	print_atoms("by ID", idBytes, idTime.count());
+	print_atoms("by atom, looked up", atomBytes, foundTime.count());
+	print_atoms("by atom, stamped", atomBytes, stampedTime.count());
+
+	delete byId;
+	delete byAtom;
+}
+
+
+static void
+print_path(const char* name, double nanoseconds)
+{
+	double each = nanoseconds / kEvents;
+	printf("%-28s %10.1f %12.0f\n", name, each,
+		each > 0 ? 1000000000.0 / each : 0);
+}
+
+
+static void
+bench_chat_events()
+{
+	// As a protocol sends them, with a little formatting
+	std::vector<BMessage> messages;
+	for (int32 i = 0; i < kEventMessages; i++) {
+		BString user = nick_for(i, 0);
+		BMessage msg(IM_MESSAGE);
+		msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+		msg.AddString("chat_id", kChannel);
+		msg.AddString("user_id", sender_for(i, 0));
+		msg.AddString("user_name", user);
+		msg.AddString("body", BString("Message ") << i
+			<< ", as long as most are, give or take a word or two");
+		msg.AddInt64("when", 1656000000 + i);
+		msg.AddInt32("face_start", 0);
+		msg.AddInt32("face_length", 7);
+		msg.AddUInt16("face", 1);
+		messages.push_back(msg);
+	}
+
+	// Each reader finding the fields it needs
+	int64 sum = 0;
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kEvents; i++)
+		for (int32 reader = 0; reader < kEventReaders; reader++) {
+			ChatEvent event(&messages[i % kEventMessages]);
+			sum += event.fBody.Length();
+		}
+	std::chrono::duration<double, std::nano> fields
+		= std::chrono::steady_clock::now() - start;
+
+	// Parsed and flattened into the message on the account's thread, then
+	// read back in one go on the app's and passed along by reference
+	std::vector<BMessage> flat(messages);
+	start = std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kEvents; i++) {
+		int32 index = i % kEventMessages;
+		ChatEvent(&messages[index]).AddTo(&flat[index]);
+	}
+	std::chrono::duration<double, std::nano> flatten
+		= std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kEvents; i++) {
+		ChatEvent event(&flat[i % kEventMessages]);
+		sum -= event.fBody.Length() * kEventReaders;
+	}
+	std::chrono::duration<double, std::nano> unflatten
+		= std::chrono::steady_clock::now() - start;
+
+	if (sum != 0)
+		fprintf(stderr, "Chat events read wrong\n");
+
+	printf("\n%-28s %10s %12s\n", "chat message path", "ns each",
+		"messages/s");
+	print_path("fields, by each reader", fields.count());
+	print_path("flat (parse + flatten)", flatten.count());
+	print_path("flat (unflatten, once)", unflatten.count());
+	print_path("flat, in all", flatten.count() + unflatten.count());
+}
+
+
+// A made-up word, the rank-th most common
+static BString
+word_for(int32 rank)
+{
+	BString word;
+	do {
+		word << (char)('a' + rank % 26);
+		rank /= 26;
+	} while (rank > 0);
+	return word << "o";
+}
+
+
+// Words' frequencies fall off about as in speech: the rank-th most common is
+// picked about 1/rank as often
+static void
+make_words(std::vector<BString>* words)
+{
+	for (int32 i = 0; i < kSearchWords; i++)
+		words->push_back(word_for(i));
+}
+
+
+static const BString&
+pick_word(const std::vector<BString>& words, uint32* state)
+{
+	double x = (next_random(state) % 1000000) / 1000000.0;
+	return words[(int32)exp(x * log((double)words.size())) - 1];
+}
+
+
+static int32
+search_tier(IndexRun* run)
+{
+	int32 tier = 0;
+	for (off_t size = kIndexTierSize; run->Size() > size && tier < 16;
+			size *= kIndexMergeFactor)
+		tier++;
+	return tier;
+}
+
+
+// As SearchIndex::_Merge(): the latest runs of the last one's tier or below,
+// once there are enough of them
+static void
+merge_runs(List<IndexRun*>* runs, int32* merges)
+{
+	while (runs->CountItems() >= (uint32)kIndexMergeFactor) {
+		uint32 count = runs->CountItems();
+		int32 tier = search_tier(runs->ItemAt(count - 1));
+		uint32 first = count - 1;
+		while (first > 0 && search_tier(runs->ItemAt(first - 1)) <= tier)
+			first--;
+		if (count - first < (uint32)kIndexMergeFactor)
+			return;
+
+		List<IndexRun*> merging;
+		for (uint32 i = first; i < count; i++)
+			merging.AddItem(runs->ItemAt(i));
+		List<log_position> positions;
+		BMallocIO* data = new BMallocIO;
+		IndexRun::Write(data, merging, NULL, positions);
+
+		for (uint32 i = 0; i < merging.CountItems(); i++)
+			delete merging.ItemAt(i);
+		while (runs->CountItems() > first)
+			runs->RemoveItemAt(runs->CountItems() - 1);
+		runs->AddItem(new IndexRun(data));
+		(*merges)++;
+	}
+}
+
+
+static void
+free_buffer(IndexPostingMap* buffer)
+{
+	for (uint32 i = 0; i < buffer->CountItems(); i++)
+		delete buffer->ValueAt(i);
+	*buffer = IndexPostingMap();
+}
+
+
+static void
+bench_search()
+{
+	std::vector<BString> words;
+	make_words(&words);
+
+	std::string text;
+	std::vector<uint32> ends;
+	uint32 state = 42;
+	for (int32 i = 0; i < kSearchLines; i++) {
+		int32 count = 4 + next_random(&state) % 12;
+		text += nick_for(next_random(&state) % 500, 0).String();
+		for (int32 w = 0; w < count; w++) {
+			text += ' ';
+			text += pick_word(words, &state).String();
+		}
+		ends.push_back(text.size());
+	}
+
+	// Indexed, as the LogWriter's thread does it
+	IndexPostingMap buffer;
+	List<IndexRun*> runs;
+	List<IndexRun*> noRuns;
+	List<log_position> positions;
+	int32 buffered = 0, merges = 0;
+	size_t postings = 0;
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	for (int32 i = 0; i < kSearchLines; i++) {
+		uint32 from = i > 0 ? ends[i - 1] : 0;
+		BString line;
+		line.SetTo(text.data() + from, ends[i] - from);
+		List<BString> tokens;
+		TokenizeIndexText(line, &tokens);
+		buffered += AddIndexPostings(&buffer, i, tokens);
+
+		if (buffered >= kIndexBufferSize || i == kSearchLines - 1) {
+			BMallocIO* data = new BMallocIO;
+			IndexRun::Write(data, noRuns, &buffer, positions);
+			runs.AddItem(new IndexRun(data));
+			postings += buffered;
+			free_buffer(&buffer);
+			buffered = 0;
+			merge_runs(&runs, &merges);
+		}
+	}
+	std::chrono::duration<double, std::nano> indexing
+		= std::chrono::steady_clock::now() - start;
+
+	off_t size = 0;
+	for (uint32 i = 0; i < runs.CountItems(); i++)
+		size += runs.ItemAt(i)->Size();
+
+	printf("\n%d lines indexed: %.0f ns/line, %.0f lines/s; %d postings in "
+		"%d runs (%d merges), %.1f MB, %.2f B/posting\n", (int)kSearchLines,
+		indexing.count() / kSearchLines,
+		1000000000.0 * kSearchLines / indexing.count(), (int)postings,
+		(int)runs.CountItems(), (int)merges, size / 1048576.0,
+		(double)size / postings);
+
+	// Queries, as SearchIndex::Search() runs them
+	struct {
+		const char*	name;
+		int32		ranks[3];	// Of its words, -1 for none
+	} queries[] = {
+		{ "the most common word", { 0, -1, -1 } },
+		{ "a rare word", { 30000, -1, -1 } },
+		{ "two common words", { 0, 1, -1 } },
+		{ "a common and a rare word", { 0, 30000, -1 } },
+		{ "three middling words", { 50, 100, 101 } }
+	};
+	printf("%-28s %10s %10s %12s\n", "query", "postings", "us each",
+		"queries/s");
+	for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+		List<BString> terms;
+		for (int32 t = 0; t < 3 && queries[q].ranks[t] >= 0; t++)
+			terms.AddItem(words[queries[q].ranks[t]]);
+
+		uint32 read = 0;
+		start = std::chrono::steady_clock::now();
+		for (int32 n = 0; n < kSearchQueries; n++) {
+			std::vector<List<index_posting> > lists(terms.CountItems());
+			for (uint32 t = 0; t < terms.CountItems(); t++)
+				for (uint32 r = 0; r < runs.CountItems(); r++) {
+					int32 index = runs.ItemAt(r)->Find(terms.ItemAt(t));
+					if (index >= 0)
+						runs.ItemAt(r)->PostingsAt(index, &lists[t]);
+				}
+			List<index_hit> hits;
+			RankIndexPostings(lists, kSearchLines, 50, &hits);
+			read = 0;
+			for (uint32 t = 0; t < lists.size(); t++)
+				read += lists[t].CountItems();
+		}
+		std::chrono::duration<double, std::micro> querying
+			= std::chrono::steady_clock::now() - start;
+		double each = querying.count() / kSearchQueries;
+		printf("%-28s %10d %10.1f %12.0f\n", queries[q].name, (int)read,
+			each, each > 0 ? 1000000.0 / each : 0);
+	}
+
+	for (uint32 i = 0; i < runs.CountItems(); i++)
+		delete runs.ItemAt(i);
+}
+
+
+// A chat line of made-up words, from one of 500 users, some seconds after when
+static ChatEvent
+make_chat_event(const char* room, time_t* when, uint32* state,
+	const std::vector<BString>& words)
+{
+	int32 user = next_random(state) % 500;
+	*when += next_random(state) % 30;
+
+	ChatEvent event;
+	event.fWhat = IM_MESSAGE_RECEIVED;
+	event.fWhen = *when;
+	event.fChatId = room;
+	event.fUserId = sender_for(user, 0);
+	event.fUserName = nick_for(user, 0);
+	int32 count = 4 + next_random(state) % 12;
+	for (int32 w = 0; w < count; w++) {
+		if (w > 0)
+			event.fBody << ' ';
+		event.fBody << pick_word(words, state);
+	}
+	return event;
+}
+
+
+static BPath
+log_file_path(const char* room, uint32 segment, bool archived)
+{
+	BString leaf;
+	leaf.SetToFormat("%08" B_PRIu32 ".%s", segment, archived ? "logz" : "log");
+	BPath path = RoomLogsPath(kLogAccount, room);
+	path.Append(leaf.String());
+	return path;
+}
+
+
+static off_t
+log_file_size(const char* room, uint32 segment, bool archived)
+{
+	off_t size = 0;
+	BEntry(log_file_path(room, segment, archived).Path()).GetSize(&size);
+	return size;
+}
+
+
+// Times reading segment 0 whole, and a message at a time from it
+static void
+time_log_reads(ChatLog* log, const List<log_position>& positions,
+	const char* segmentName, const char* messageName)
+{
+	uint32 count = 0;
+	while (count < positions.CountItems()
+			&& positions.ItemAt(count).segment == 0)
+		count++;
+
+	int32 reads = kLogReads / 20;
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	for (int32 n = 0; n < reads; n++) {
+		List<ChatEvent> events;
+		List<log_position> read;
+		log->ReadSegment(0, &events, &read);
+	}
+	std::chrono::duration<double, std::micro> reading
+		= std::chrono::steady_clock::now() - start;
+	double each = reading.count() / reads;
+	printf("%-28s %10.1f %12.0f\n", segmentName, each, 1000000.0 / each);
+
+	uint32 state = 99;
+	start = std::chrono::steady_clock::now();
+	for (int32 n = 0; n < kLogReads; n++) {
+		ChatEvent event;
+		log->ReadEvent(positions.ItemAt(next_random(&state) % count), &event);
+	}
+	reading = std::chrono::steady_clock::now() - start;
+	each = reading.count() / kLogReads;
+	printf("%-28s %10.1f %12.0f\n", messageName, each, 1000000.0 / each);
+}
+
+
+static void
+bench_log_archive()
+{
+	std::vector<BString> words;
+	make_words(&words);
+
+	const char* room = "#archive";
+	ChatLog log(kLogAccount, room);
+	uint32 state = 7;
+	time_t when = 1656000000;
+	int32 messages = 0;
+	List<log_position> positions;
+	while (log.CountSegments() <= kLogArchived) {
+		List<ChatEvent> events;
+		for (int32 i = 0; i < 100; i++)
+			events.AddItem(make_chat_event(room, &when, &state, words));
+		log.Append(events, &positions);
+		messages += events.CountItems();
+	}
+
+	off_t plain = 0;
+	for (uint32 i = 0; i < kLogArchived; i++)
+		plain += log_file_size(room, i, false);
+
+	// Each read maps the segment anew, as the view's first read does
+	printf("\n%-28s %10s %12s\n", "log read", "us each", "reads/s");
+	time_log_reads(&log, positions, "a segment, whole", "a message");
+
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	if (log.Archive(0) != B_OK)
+		fprintf(stderr, "Couldn't archive the log\n");
+	std::chrono::duration<double> archiving
+		= std::chrono::steady_clock::now() - start;
+
+	off_t archived = 0;
+	for (uint32 i = 0; i < kLogArchived; i++)
+		archived += log_file_size(room, i, true);
+
+	time_log_reads(&log, positions, "its archive, whole",
+		"a message, archived");
+
+	start = std::chrono::steady_clock::now();
+	for (int32 n = 0; n < kLogReads; n++) {
+		BMessage logs;
+		log.Read(&logs);
+	}
+	std::chrono::duration<double, std::micro> reading
+		= std::chrono::steady_clock::now() - start;
+	double each = reading.count() / kLogReads;
+	printf("%-28s %10.1f %12.0f\n", "the latest 31", each, 1000000.0 / each);
+
+	printf("%d messages, %d segments archived: %.1f MB to %.2f MB, %.1fx "
+		"smaller, at %.1f MB/s\n", (int)messages, (int)kLogArchived,
+		plain / 1048576.0, archived / 1048576.0, (double)plain / archived,
+		plain / 1048576.0 / archiving.count());
+}
+
+
+// A log of the given number of segments, the last two from's last two, the
+// rest links to from's first, and its tail from's, moved along to match
+static void
+link_log(const char* from, const char* room, uint32 segments)
+{
+	uint32 shift = segments - 3;
+	for (uint32 i = 0; i < segments; i++) {
+		BPath original = log_file_path(from, i < shift ? 0 : i - shift,
+			false);
+		if (symlink(original.Path(), log_file_path(room, i, false).Path())
+				!= 0)
+			fprintf(stderr, "Couldn't link %s\n", original.Path());
+	}
+
+	BPath fromTail = RoomLogsPath(kLogAccount, from);
+	fromTail.Append("tail");
+	BPath tail = RoomLogsPath(kLogAccount, room);
+	tail.Append("tail");
+
+	log_tail_header header;
+	log_position slots[kLogTailSize];
+	BFile in(fromTail.Path(), B_READ_ONLY);
+	in.ReadAt(0, &header, sizeof(header));
+	ssize_t read = in.ReadAt(sizeof(header), slots, sizeof(slots));
+	header.segment += shift;
+	for (ssize_t i = 0; i < read / (ssize_t)sizeof(log_position); i++)
+		slots[i].segment += shift;
+
+	BFile out(tail.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	out.WriteAt(0, &header, sizeof(header));
+	if (read > 0)
+		out.WriteAt(sizeof(header), slots, read);
+}
+
+
+// Drops the room's log from the page cache, if that can be asked for
+static bool
+evict_log(const char* room)
+{
+#ifdef POSIX_FADV_DONTNEED
+	BDirectory directory(RoomLogsPath(kLogAccount, room).Path());
+	BEntry entry;
+	BPath path;
+	while (directory.GetNextEntry(&entry) == B_OK
+			&& entry.GetPath(&path) == B_OK) {
+		int fd = open(path.Path(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		int ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+		if (ret != 0)
+			return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+static void
+time_log_open(const char* room, const char* name, bool cold)
+{
+	int32 opens = cold ? kLogColdOpens : kLogOpens;
+	double seconds = 0;
+	long minor = 0, major = 0;
+	for (int32 n = 0; n < opens; n++) {
+		if (cold && evict_log(room) == false) {
+			printf("%-28s %10s\n", name, "-");
+			return;
+		}
+
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		std::chrono::steady_clock::time_point start
+			= std::chrono::steady_clock::now();
+		{
+			ChatLog log(kLogAccount, room);
+			BMessage logs;
+			if (log.Read(&logs) != B_OK)
+				fprintf(stderr, "Couldn't read %s\n", room);
+		}
+		std::chrono::duration<double> opening
+			= std::chrono::steady_clock::now() - start;
+		getrusage(RUSAGE_SELF, &after);
+
+		seconds += opening.count();
+		minor += after.ru_minflt - before.ru_minflt;
+		major += after.ru_majflt - before.ru_majflt;
+	}
+	printf("%-28s %10.1f %12.1f %12.1f\n", name, seconds * 1000000 / opens,
+		(double)minor / opens, (double)major / opens);
+}
+
+
+static void
+bench_log_open()
+{
+	std::vector<BString> words;
+	make_words(&words);
+
+	// Two full segments, and the tail in a third
+	const char* from = "#history";
+	{
+		ChatLog log(kLogAccount, from);
+		uint32 state = 11;
+		time_t when = 1656000000;
+		while (log.CountSegments() < 3 || log.End().offset < 512 * 1024) {
+			List<ChatEvent> events;
+			for (int32 i = 0; i < 100; i++)
+				events.AddItem(make_chat_event(from, &when, &state, words));
+			log.Append(events);
+		}
+	}
+
+	struct {
+		const char*	room;
+		uint32		segments;
+	} rooms[] = {
+		{ from, 3 },
+		{ "#64MB", 64 },
+		{ "#1GB", 1024 }
+	};
+	for (size_t i = 1; i < sizeof(rooms) / sizeof(rooms[0]); i++)
+		link_log(from, rooms[i].room, rooms[i].segments);
+	// Written out, so they can be evicted
+	sync();
+
+	printf("\n%-28s %10s %12s %12s\n", "room opened, with", "us each",
+		"minor faults", "major faults");
+	for (size_t i = 0; i < sizeof(rooms) / sizeof(rooms[0]); i++) {
+		off_t size = 0;
+		for (uint32 s = 0; s < rooms[i].segments; s++)
+			size += log_file_size(rooms[i].room, s, false);
+		BString name;
+		name.SetToFormat("%.0f MB, cached", size / 1048576.0);
+		time_log_open(rooms[i].room, name.String(), false);
+		name.SetToFormat("%.0f MB, from disk", size / 1048576.0);
+		time_log_open(rooms[i].room, name.String(), true);
+	}
+}
+
+
+// The calling thread's count of write calls, or -1 where it isn't kept
+static long
+thread_writes()
+{
+#ifdef __linux__
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/self/task/%ld/io",
+		(long)syscall(SYS_gettid));
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+	long writes = -1;
+	char line[128];
+	while (fgets(line, sizeof(line), file) != NULL)
+		if (sscanf(line, "syscw: %ld", &writes) == 1)
+			break;
+	fclose(file);
+	return writes;
+#else
+	return -1;
+#endif
+}
+
+
+static double
+cpu_seconds(int who)
+{
+	struct rusage usage;
+	getrusage(who, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+		+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+
+// Submits kWriterRate messages a second, round the rooms, for kWriterSeconds
+static void
+time_log_writer(LogWriter* writer, const std::vector<ChatEvent>& events,
+	const char* name)
+{
+	std::vector<double> submits;
+	submits.reserve(events.size());
+
+	long writes = thread_writes();
+#ifdef RUSAGE_THREAD
+	double others = cpu_seconds(RUSAGE_SELF) - cpu_seconds(RUSAGE_THREAD);
+#endif
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	for (size_t i = 0; i < events.size(); i++) {
+		std::this_thread::sleep_until(start
+			+ std::chrono::microseconds(i * 1000000 / kWriterRate));
+
+		const ChatEvent& event = events[i];
+		std::chrono::steady_clock::time_point before
+			= std::chrono::steady_clock::now();
+		writer->Submit(kLogAccount, event.fChatId.String(), event);
+		std::chrono::duration<double, std::micro> submitting
+			= std::chrono::steady_clock::now() - before;
+		submits.push_back(submitting.count());
+	}
+
+	std::chrono::steady_clock::time_point before
+		= std::chrono::steady_clock::now();
+	writer->Flush();
+	std::chrono::duration<double, std::milli> flushing
+		= std::chrono::steady_clock::now() - before;
+	if (writes >= 0)
+		writes = thread_writes() - writes;
+	double cpu = -1;
+#ifdef RUSAGE_THREAD
+	cpu = cpu_seconds(RUSAGE_SELF) - cpu_seconds(RUSAGE_THREAD) - others;
+#endif
+
+	std::sort(submits.begin(), submits.end());
+	size_t count = submits.size();
+	printf("%-10s %9.2f %9.2f %9.1f %9ld %11.1f %10.1f\n", name,
+		submits[count / 2], submits[count * 99 / 100], submits[count - 1],
+		writes, cpu * 100 / kWriterSeconds, flushing.count());
+}
+
+
+static void
+bench_log_writer()
+{
+	std::vector<BString> words;
+	make_words(&words);
+
+	std::vector<BString> rooms;
+	for (int32 i = 0; i < kWriterRooms; i++) {
+		BString room;
+		room.SetToFormat("#writer%d", (int)i);
+		rooms.push_back(room);
+	}
+
+	uint32 state = 13;
+	time_t when = 1656000000;
+	std::vector<ChatEvent> events;
+	for (int32 i = 0; i < kWriterRate * kWriterSeconds; i++)
+		events.push_back(make_chat_event(rooms[i % kWriterRooms].String(),
+			&when, &state, words));
+
+	printf("\n%d msg/s across %d rooms, for %d s\n", (int)kWriterRate,
+		(int)kWriterRooms, (int)kWriterSeconds);
+	printf("%-10s %9s %9s %9s %9s %11s %10s\n", "durability", "p50 us",
+		"p99 us", "max us", "writes", "writer CPU%", "flush ms");
+
+	LogWriter* writer = LogWriter::Get();
+	time_log_writer(writer, events, "buffered");
+	writer->SetDurability(LOG_SYNCED);
+	time_log_writer(writer, events, "synced");
+
+	std::chrono::steady_clock::time_point start
+		= std::chrono::steady_clock::now();
+	writer->Quit();
+	std::chrono::duration<double, std::milli> quitting
+		= std::chrono::steady_clock::now() - start;
+	printf("quit in %.1f ms\n", quitting.count());
+}
+
+
+static int
+remove_entry(const char* path, const struct stat* st, int flag,
+	struct FTW* ftw)
+{
+	return remove(path);
+}
+
+
+int
+main()
+{
+	printf("%7s  %-10s %8s %10s %12s\n", "users", "phase", "lines", "ns each",
+		"lines/s");
+	for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++)
+		bench(kSizes[i]);
+
+	bench_atoms();
+	bench_chat_events();
+	bench_search();
+
+	char home[] = "/tmp/core_bench.XXXXXX";
+	if (mkdtemp(home) == NULL) {
+		fprintf(stderr, "Couldn't make a directory for the logs\n");
+		return 1;
+	}
+	setenv("HOME", home, 1);
+	bench_log_archive();
+	bench_log_open();
+	bench_log_writer();
+	nftw(home, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	return 0;
+}
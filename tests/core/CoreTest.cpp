@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Unit tests of libcore. Like libcore, they build on Linux too. Prints each
+ * failed check, and exits with 1 if there were any.
+ *
+ * Whatever's kept in the settings directory, like rooms' logs, is kept in one
+ * of its own under /tmp, and removed after. */
+
+#include "CoreTest.h"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static int32 sChecks = 0;
+static int32 sFailures = 0;
+
+
+void
+check_that(bool condition, const char* what, const char* file, int line)
+{
+	sChecks++;
+	if (condition == true)
+		return;
+	sFailures++;
+	fprintf(stderr, "%s:%d: failed: %s\n", file, line, what);
+}
+
+
+uint32
+next_random(uint32* state)
+{
+	// xorshift32
+	uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+static int
+remove_entry(const char* path, const struct stat* st, int flag,
+	struct FTW* ftw)
+{
+	return remove(path);
+}
+
+
+int
+main()
+{
+	char home[] = "/tmp/core_test.XXXXXX";
+	if (mkdtemp(home) == NULL) {
+		fprintf(stderr, "Couldn't make a settings directory\n");
+		return 1;
+	}
+	setenv("HOME", home, 1);
+
+	test_irc_parser();
+	test_atom_table();
+	test_room_members();
+	test_chat_event();
+	test_chat_log();
+	test_index_run();
+	test_log_writer();
+	nftw(home, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+	printf("%d checks, %d failed\n%s\n", (int)sChecks, (int)sFailures,
+		sFailures == 0 ? "PASSED" : "FAILED");
+	return sFailures == 0 ? 0 : 1;
+}
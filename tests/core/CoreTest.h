@@ -0,0 +1,28 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _CORE_TEST_H
+#define _CORE_TEST_H
+
+// Haiku's, or off it, libs/libcore/linux's stand-in
+#include <SupportDefs.h>
+
+
+#define CHECK(condition) check_that((condition), #condition, __FILE__, __LINE__)
+
+void	check_that(bool condition, const char* what, const char* file,
+			int line);
+
+// A fixed sequence of pseudo-random numbers, so every run is the same
+uint32	next_random(uint32* state);
+
+void	test_atom_table();
+void	test_chat_event();
+void	test_chat_log();
+void	test_index_run();
+void	test_irc_parser();
+void	test_log_writer();
+void	test_room_members();
+
+#endif // _CORE_TEST_H
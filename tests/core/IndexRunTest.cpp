@@ -0,0 +1,355 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <DataIO.h>
+
+#include "IndexRun.h"
+
+
+typedef std::map<std::string, std::vector<index_posting> > Expected;
+
+
+static void
+free_postings(IndexPostingMap* buffer)
+{
+	for (uint32 i = 0; i < buffer->CountItems(); i++)
+		delete buffer->ValueAt(i);
+	*buffer = IndexPostingMap();
+}
+
+
+static void
+add_line(IndexPostingMap* buffer, Expected* expected, uint32 doc,
+	const char* text)
+{
+	List<BString> tokens;
+	TokenizeIndexText(text, &tokens);
+	AddIndexPostings(buffer, doc, tokens);
+
+	std::map<std::string, uint32> frequencies;
+	for (uint32 i = 0; i < tokens.CountItems(); i++)
+		frequencies[tokens.ItemAt(i).String()]++;
+	std::map<std::string, uint32>::iterator it = frequencies.begin();
+	for (; it != frequencies.end(); it++) {
+		index_posting posting = { doc, it->second };
+		(*expected)[it->first].push_back(posting);
+	}
+}
+
+
+static IndexRun*
+write_run(const List<IndexRun*>& runs, const IndexPostingMap* buffer,
+	const List<log_position>& positions)
+{
+	BMallocIO* data = new BMallocIO;
+	CHECK(IndexRun::Write(data, runs, buffer, positions) == B_OK);
+	return new IndexRun(data);
+}
+
+
+// Every term in order, each with just the postings expected
+static bool
+same_terms(IndexRun* run, const Expected& expected)
+{
+	if (run->CountTerms() != expected.size())
+		return false;
+
+	Expected::const_iterator it = expected.begin();
+	for (uint32 i = 0; it != expected.end(); i++, it++) {
+		BString term;
+		List<index_posting> postings;
+		if (run->TermAt(i, &term) != B_OK || term != it->first.c_str()
+				|| run->Find(term) != (int32)i
+				|| run->PostingsAt(i, &postings) != B_OK
+				|| postings.CountItems() != it->second.size())
+			return false;
+		for (uint32 j = 0; j < postings.CountItems(); j++)
+			if (postings.ItemAt(j).doc != it->second[j].doc
+					|| postings.ItemAt(j).frequency
+						!= it->second[j].frequency)
+				return false;
+	}
+	return true;
+}
+
+
+static void
+test_tokenize()
+{
+	List<BString> tokens;
+	TokenizeIndexText("Hello, World! a b2 C3PO's x_y Grüße", &tokens);
+	const char* expected[] = { "hello", "world", "b2", "c3po", "grüße" };
+	CHECK(tokens.CountItems() == 5);
+	for (uint32 i = 0; i < tokens.CountItems() && i < 5; i++)
+		CHECK(tokens.ItemAt(i) == expected[i]);
+
+	// Too long to be a word anyone searches for
+	tokens.MakeEmpty();
+	BString longWord;
+	for (int32 i = 0; i < 65; i++)
+		longWord << 'z';
+	TokenizeIndexText(longWord, &tokens);
+	CHECK(tokens.IsEmpty() == true);
+	longWord.Truncate(64);
+	TokenizeIndexText(longWord, &tokens);
+	CHECK(tokens.CountItems() == 1);
+
+	// Once each, with how often
+	IndexPostingMap buffer;
+	tokens.MakeEmpty();
+	TokenizeIndexText("the cat and the hat and the bat", &tokens);
+	CHECK(AddIndexPostings(&buffer, 7, tokens) == 5);
+	CHECK(buffer.ValueFor("the")->ItemAt(0).frequency == 3);
+	CHECK(buffer.ValueFor("the")->ItemAt(0).doc == 7);
+	CHECK(buffer.ValueFor("cat")->ItemAt(0).frequency == 1);
+	free_postings(&buffer);
+}
+
+
+static void
+test_round_trip()
+{
+	IndexPostingMap buffer;
+	Expected expected;
+	add_line(&buffer, &expected, 0, "alpha beta gamma");
+	add_line(&buffer, &expected, 1, "beta beta delta");
+	// Deltas of more than one varint byte, and one of more than four
+	add_line(&buffer, &expected, 200, "alpha epsilon");
+	add_line(&buffer, &expected, 70000, "alpha");
+	add_line(&buffer, &expected, 0xfffffff0, "alpha zeta");
+
+	List<log_position> positions;
+	log_position position = { 3, 1234 };
+	positions.AddItem(position);
+	position.segment = 0;
+	position.offset = 0xffffffff;
+	positions.AddItem(position);
+
+	List<IndexRun*> noRuns;
+	IndexRun* run = write_run(noRuns, &buffer, positions);
+	CHECK(run->InitCheck() == B_OK);
+	CHECK(same_terms(run, expected) == true);
+	CHECK(run->Find("omega") == -1);
+	CHECK(run->Find("") == -1);
+
+	List<log_position> read;
+	CHECK(run->GetPositions(&read) == B_OK);
+	CHECK(read.CountItems() == 2);
+	CHECK(read.ItemAt(0).segment == 3 && read.ItemAt(0).offset == 1234);
+	CHECK(read.ItemAt(1).offset == 0xffffffff);
+
+	BString term;
+	List<index_posting> postings;
+	CHECK(run->TermAt(run->CountTerms(), &term) == B_BAD_INDEX);
+	CHECK(run->PostingsAt(run->CountTerms(), &postings) == B_BAD_INDEX);
+	delete run;
+	free_postings(&buffer);
+
+	// Nothing at all
+	List<log_position> noPositions;
+	run = write_run(noRuns, NULL, noPositions);
+	CHECK(run->InitCheck() == B_OK);
+	CHECK(run->CountTerms() == 0 && run->Find("alpha") == -1);
+	read.MakeEmpty();
+	CHECK(run->GetPositions(&read) == B_OK && read.IsEmpty() == true);
+	delete run;
+}
+
+
+static void
+test_bad_runs()
+{
+	IndexPostingMap buffer;
+	Expected expected;
+	add_line(&buffer, &expected, 0, "alpha beta gamma");
+	List<IndexRun*> noRuns;
+	List<log_position> positions;
+	log_position position = { 1, 2 };
+	positions.AddItem(position);
+
+	BMallocIO good;
+	CHECK(IndexRun::Write(&good, noRuns, &buffer, positions) == B_OK);
+	free_postings(&buffer);
+
+	// Cut short, so the table or the positions are past its end
+	BMallocIO* data = new BMallocIO;
+	data->WriteAt(0, good.Buffer(), good.BufferLength() - 1);
+	IndexRun* run = new IndexRun(data);
+	CHECK(run->InitCheck() == B_BAD_DATA);
+	CHECK(run->CountTerms() == 0 && run->Find("alpha") == -1);
+	delete run;
+
+	// Written up to the header, which never was
+	data = new BMallocIO;
+	data->WriteAt(0, good.Buffer(), good.BufferLength());
+	index_run_header header;
+	memset(&header, 0, sizeof(header));
+	data->WriteAt(0, &header, sizeof(header));
+	run = new IndexRun(data);
+	CHECK(run->InitCheck() == B_BAD_DATA);
+	delete run;
+
+	// Of another version
+	memcpy(&header, good.Buffer(), sizeof(header));
+	header.version = kIndexRunVersion - 1;
+	data = new BMallocIO;
+	data->WriteAt(0, good.Buffer(), good.BufferLength());
+	data->WriteAt(0, &header, sizeof(header));
+	run = new IndexRun(data);
+	CHECK(run->InitCheck() == B_BAD_DATA);
+	delete run;
+
+	run = new IndexRun(new BMallocIO);
+	CHECK(run->InitCheck() == B_BAD_DATA);
+	delete run;
+}
+
+
+static void
+test_merge()
+{
+	// Three runs and the buffer, sharing some words and not others
+	const char* lines[] = {
+		"the quick brown fox", "jumps over the lazy dog",
+		"the dog sleeps", "a fox again",
+		"zebra crossing", "the the the end",
+		"quick quick", "brown dog lazy fox"
+	};
+	Expected expected;
+	List<IndexRun*> runs;
+	List<IndexRun*> noRuns;
+	IndexPostingMap buffer;
+	uint32 doc = 0;
+	for (int32 r = 0; r < 4; r++) {
+		for (int32 i = 0; i < 2; i++, doc += 3)
+			add_line(&buffer, &expected, doc, lines[r * 2 + i]);
+		if (r < 3) {
+			List<log_position> positions;
+			log_position position = { (uint32)r, doc };
+			positions.AddItem(position);
+			runs.AddItem(write_run(noRuns, &buffer, positions));
+			free_postings(&buffer);
+		}
+	}
+
+	List<log_position> positions;
+	log_position position = { 9, 9 };
+	positions.AddItem(position);
+	IndexRun* merged = write_run(runs, &buffer, positions);
+	CHECK(merged->InitCheck() == B_OK);
+	CHECK(same_terms(merged, expected) == true);
+	List<log_position> read;
+	merged->GetPositions(&read);
+	CHECK(read.CountItems() == 1 && read.ItemAt(0).segment == 9);
+
+	// … and merged again, with nothing new
+	List<IndexRun*> again;
+	again.AddItem(merged);
+	List<log_position> noPositions;
+	IndexRun* remerged = write_run(again, NULL, noPositions);
+	CHECK(same_terms(remerged, expected) == true);
+	delete remerged;
+
+	// Larger than a chunk of writing, with a term whose postings span two
+	IndexPostingMap big;
+	Expected bigExpected;
+	uint32 state = 21;
+	for (uint32 d = 0; d < 60000; d++) {
+		BString line;
+		for (int32 w = 0; w < 6; w++)
+			line << "w" << (next_random(&state) % 5000) << " ";
+		line << "common";
+		add_line(&big, &bigExpected, d, line.String());
+	}
+	IndexRun* bigRun = write_run(noRuns, &big, noPositions);
+	CHECK(bigRun->Size() > 256 * 1024);
+	List<IndexRun*> withBig;
+	withBig.AddItem(bigRun);
+	IndexRun* bigMerged = write_run(withBig, NULL, noPositions);
+	CHECK(same_terms(bigMerged, bigExpected) == true);
+	delete bigRun;
+	delete bigMerged;
+	free_postings(&big);
+
+	delete merged;
+	for (uint32 i = 0; i < runs.CountItems(); i++)
+		delete runs.ItemAt(i);
+	free_postings(&buffer);
+}
+
+
+static void
+test_rank()
+{
+	// "cat" is in docs 1, 3, 5, 7; "dog" in every one; "emu" in 5 only
+	std::vector<List<index_posting> > postings(2);
+	for (uint32 d = 0; d < 8; d++) {
+		index_posting dog = { d, 1 };
+		postings[1].AddItem(dog);
+		if (d % 2 == 1) {
+			index_posting cat = { d, d == 3 ? 2u : 1u };
+			postings[0].AddItem(cat);
+		}
+	}
+
+	// Only those with both, the most "cat" first, then the latest
+	List<index_hit> hits;
+	RankIndexPostings(postings, 8, 10, &hits);
+	CHECK(hits.CountItems() == 4);
+	CHECK(hits.ItemAt(0).doc == 3);
+	CHECK(hits.ItemAt(1).doc == 7 && hits.ItemAt(2).doc == 5
+		&& hits.ItemAt(3).doc == 1);
+	CHECK(hits.ItemAt(0).score > hits.ItemAt(1).score);
+	CHECK(hits.ItemAt(1).score == hits.ItemAt(3).score);
+
+	// No more than asked for
+	hits.MakeEmpty();
+	RankIndexPostings(postings, 8, 2, &hits);
+	CHECK(hits.CountItems() == 2 && hits.ItemAt(1).doc == 7);
+
+	// A rare word counts for more than a common one said as often
+	std::vector<List<index_posting> > rare(1), common(1);
+	index_posting emu = { 5, 1 };
+	rare[0].AddItem(emu);
+	common[0] = postings[1];
+	List<index_hit> rareHits, commonHits;
+	RankIndexPostings(rare, 8, 10, &rareHits);
+	RankIndexPostings(common, 8, 10, &commonHits);
+	CHECK(rareHits.CountItems() == 1 && commonHits.CountItems() == 8);
+	CHECK(rareHits.ItemAt(0).score > commonHits.ItemAt(0).score);
+
+	// Nothing, if any word's in no document
+	postings.push_back(List<index_posting>());
+	hits.MakeEmpty();
+	RankIndexPostings(postings, 8, 10, &hits);
+	CHECK(hits.IsEmpty() == true);
+
+	// … or none have them all
+	std::vector<List<index_posting> > apart(2);
+	index_posting a = { 1, 1 }, b = { 2, 1 };
+	apart[0].AddItem(a);
+	apart[1].AddItem(b);
+	RankIndexPostings(apart, 8, 10, &hits);
+	CHECK(hits.IsEmpty() == true);
+}
+
+
+void
+test_index_run()
+{
+	test_tokenize();
+	test_round_trip();
+	test_bad_runs();
+	test_merge();
+	test_rank();
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include "IrcParser.h"
+
+
+static void
+test_parse_command()
+{
+	irc_line line;
+	ParseIrcLine(":alice!al@example.org PRIVMSG #haiku :Hello, world!\r\n",
+		&line);
+	CHECK(line.sender == "alice!al@example.org");
+	CHECK(line.code == "PRIVMSG");
+	CHECK(line.numeric == 0);
+	CHECK(line.params.CountStrings() == 2);
+	CHECK(line.params.First() == "#haiku");
+	CHECK(line.params.Last() == "Hello, world!");
+
+	// Params after the colon are one, even with colons of their own
+	ParseIrcLine(":bob!b@h KICK #haiku carol :no : reason", &line);
+	CHECK(line.code == "KICK");
+	CHECK(line.params.CountStrings() == 3);
+	CHECK(line.params.StringAt(1) == "carol");
+	CHECK(line.params.Last() == "no : reason");
+
+	// Without a trailing parameter
+	ParseIrcLine(":carol!c@h JOIN #haiku", &line);
+	CHECK(line.code == "JOIN");
+	CHECK(line.params.CountStrings() == 1);
+	CHECK(line.params.First() == "#haiku");
+
+	// Reusing the same line clears the last one's params
+	ParseIrcLine(":dave!d@h NICK :eve", &line);
+	CHECK(line.params.CountStrings() == 1);
+	CHECK(line.params.First() == "eve");
+}
+
+
+static void
+test_parse_numeric()
+{
+	irc_line line;
+	ParseIrcLine(":irc.example.org 353 me = #haiku :@alice +bob carol",
+		&line);
+	CHECK(line.sender == "irc.example.org");
+	CHECK(line.code == "353");
+	CHECK(line.numeric == 353);
+	CHECK(line.params.CountStrings() == 4);
+	CHECK(line.params.StringAt(2) == "#haiku");
+	CHECK(line.params.Last() == "@alice +bob carol");
+
+	ParseIrcLine("*:irc.example.org 001 me :Welcome", &line);
+	CHECK(line.sender == "irc.example.org");
+	CHECK(line.numeric == 1);
+}
+
+
+static void
+test_parse_short()
+{
+	// The sender's taken to be the first word, if there're more
+	irc_line line;
+	ParseIrcLine("PING :irc.example.org", &line);
+	CHECK(line.sender == "PING");
+	CHECK(line.code.IsEmpty() == true);
+	CHECK(line.params.CountStrings() == 1);
+	CHECK(line.params.First() == "irc.example.org");
+
+	ParseIrcLine("", &line);
+	CHECK(line.sender.IsEmpty() == true && line.code.IsEmpty() == true);
+	CHECK(line.numeric == 0 && line.params.IsEmpty() == true);
+}
+
+
+static void
+test_senders()
+{
+	CHECK(IrcSenderNick("alice!al@example.org") == "alice");
+	CHECK(IrcSenderIdent("alice!al@example.org") == "al@example.org");
+	CHECK(IrcSenderNick("irc.example.org") == "irc.example.org");
+	CHECK(IrcSenderIdent("irc.example.org") == "irc.example.org");
+
+	CHECK(IrcCaseMapped("Al[ic]e\\~") == "al{ic}e|^");
+	CHECK(IrcCaseMapped("ALICE") == IrcCaseMapped("alice"));
+
+	CHECK(IsIrcChannelName("#haiku") == true);
+	CHECK(IsIrcChannelName("&local") == true);
+	CHECK(IsIrcChannelName("+modeless") == true);
+	CHECK(IsIrcChannelName("!12345safe") == true);
+	CHECK(IsIrcChannelName("alice") == false);
+	CHECK(IsIrcChannelName("") == false);
+}
+
+
+void
+test_irc_parser()
+{
+	test_parse_command();
+	test_parse_numeric();
+	test_parse_short();
+	test_senders();
+}
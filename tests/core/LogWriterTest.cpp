@@ -0,0 +1,128 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <stdio.h>
+
+#include <Message.h>
+
+#include "ChatLog.h"
+#include "ChatProtocolMessages.h"
+#include "LogWriter.h"
+
+
+static const char* kAccount = "writer";
+
+// More than the writer keeps open at once
+static const int32 kRooms = 80;
+
+
+static BString
+room_for(int32 room)
+{
+	BString id("#room");
+	id << room;
+	return id;
+}
+
+
+static ChatEvent
+make_event(const BString& room, int32 number)
+{
+	ChatEvent event;
+	event.fWhat = IM_MESSAGE_RECEIVED;
+	event.fWhen = 1656000000 + number;
+	event.fChatId = room;
+	event.fUserId = "alice";
+	event.fBody << "message " << number;
+	return event;
+}
+
+
+// Whether the room's log holds just the messages from first to last, in order
+static bool
+logged(const BString& room, int32 first, int32 last)
+{
+	ChatLog log(kAccount, room);
+	BMessage logs;
+	if (log.Read(&logs, last - first + 10) != B_OK)
+		return false;
+
+	const void* data = NULL;
+	ssize_t size = 0;
+	int32 count = 0;
+	for (; logs.FindData(kChatEventField, kChatEventType, count, &data,
+			&size) == B_OK; count++) {
+		ChatEvent event;
+		int number = -1;
+		if (event.Unflatten(data, size) == B_OK)
+			sscanf(event.fBody.String(), "message %d", &number);
+		if (number != first + count)
+			return false;
+	}
+	return count == last - first + 1;
+}
+
+
+static void
+test_submit()
+{
+	LogWriter* writer = LogWriter::Get();
+	writer->SetFlushInterval(10000);
+
+	// Interleaved, as they come from many rooms at once
+	for (int32 i = 0; i < 20; i++)
+		for (int32 room = 0; room < kRooms; room++)
+			writer->Submit(kAccount, room_for(room), make_event(room_for(room),
+				i));
+	writer->Flush();
+
+	bool all = true;
+	for (int32 room = 0; room < kRooms; room++)
+		all = all && logged(room_for(room), 0, 19);
+	CHECK(all == true);
+
+	// Synced each commit, it's all the same to the reader
+	writer->SetDurability(LOG_SYNCED);
+	for (int32 i = 20; i < 25; i++)
+		writer->Submit(kAccount, room_for(0), make_event(room_for(0), i));
+	writer->Flush();
+	CHECK(logged(room_for(0), 0, 24) == true);
+	writer->SetDurability(LOG_BUFFERED);
+}
+
+
+static void
+test_quit()
+{
+	LogWriter* writer = LogWriter::Get();
+
+	// Left waiting out a long interval, they're written as it quits
+	writer->SetFlushInterval(60000000);
+	for (int32 i = 20; i < 30; i++)
+		writer->Submit(kAccount, room_for(1), make_event(room_for(1), i));
+	writer->Quit();
+	CHECK(logged(room_for(1), 0, 29) == true);
+
+	// Afterwards, by whoever submits them
+	writer->Submit(kAccount, room_for(1), make_event(room_for(1), 30));
+	CHECK(logged(room_for(1), 0, 30) == true);
+	writer->Submit(kAccount, room_for(2), make_event(room_for(2), 20));
+	CHECK(logged(room_for(2), 0, 20) == true);
+
+	// Quitting twice, or flushing without a writer, does nothing
+	writer->Quit();
+	writer->Flush();
+	CHECK(logged(room_for(1), 0, 30) == true);
+}
+
+
+void
+test_log_writer()
+{
+	test_submit();
+	test_quit();
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "CoreTest.h"
+
+#include <vector>
+
+#include "RoomMembers.h"
+
+
+struct Member {
+	BString	id;
+	BString	nick;
+};
+
+
+// The members whose ID or name starts with prefix
+static int32
+count_matches(const RoomMembers<Member>& members, const char* prefix)
+{
+	int32 count = 0;
+	const PrefixIndex<Member*>& names = members.Names();
+	for (int32 i = names.FirstMatch(prefix); names.IsMatch(i, prefix); i++)
+		count++;
+	return count;
+}
+
+
+// Whether the member's indexed under key
+static bool
+indexed_under(const RoomMembers<Member>& members, const BString& key,
+	Member* member)
+{
+	const PrefixIndex<Member*>& names = members.Names();
+	for (int32 i = names.FirstMatch(key); i < names.CountItems()
+			&& names.KeyAt(i).ICompare(key) == 0; i++)
+		if (names.KeyAt(i) == key && names.ValueAt(i) == member)
+			return true;
+	return false;
+}
+
+
+static void
+test_members()
+{
+	AtomTable atoms;
+	RoomMembers<Member> members;
+	Member alice = { "alice@example.org", "Alice" };
+	Member bob = { "bob", "bob" };
+	atom_id aliceAtom = atoms.Acquire(alice.id);
+	atom_id bobAtom = atoms.Acquire(bob.id);
+
+	CHECK(members.Add(aliceAtom, &alice, alice.id, alice.nick) == true);
+	CHECK(members.Add(bobAtom, &bob, bob.id, bob.nick) == true);
+	CHECK(members.Add(aliceAtom, &bob, bob.id, bob.nick) == false);
+	CHECK(members.CountMembers() == 2);
+	CHECK(members.Find(aliceAtom) == &alice);
+	CHECK(members.Find(kNoAtom) == NULL);
+
+	// Under both ID and name, unless they're the same
+	CHECK(members.Names().CountItems() == 3);
+	CHECK(count_matches(members, "al") == 2);
+	CHECK(members.FindByName("Alice") == &alice);
+	CHECK(members.FindByName("alice") == &alice);
+	CHECK(members.FindByName("BOB") == &bob);
+	CHECK(members.FindByName("carol") == NULL);
+
+	// Renamed, they're found by their new name only
+	members.Rename(&alice, "Carol");
+	CHECK(members.FindByName("Alice") == NULL);
+	CHECK(members.FindByName("Carol") == &alice);
+	CHECK(count_matches(members, "al") == 1);
+	CHECK(members.Names().CountItems() == 3);
+	members.Rename(&bob, "robert");
+	CHECK(members.FindByName("robert") == &bob);
+	CHECK(members.Names().CountItems() == 4);
+	members.Rename(&bob, "bob");
+	CHECK(members.Names().CountItems() == 3);
+
+	// An exact match is preferred to one of another case
+	Member carol = { "carol", "carol" };
+	atom_id carolAtom = atoms.Acquire(carol.id);
+	members.Add(carolAtom, &carol, carol.id, carol.nick);
+	CHECK(members.FindByName("carol") == &carol);
+	CHECK(members.FindByName("Carol") == &alice);
+
+	CHECK(members.Remove(aliceAtom) == &alice);
+	CHECK(members.Remove(aliceAtom) == NULL);
+	CHECK(members.Find(aliceAtom) == NULL);
+	CHECK(count_matches(members, "al") == 0);
+	CHECK(members.FindByName("Carol") == &carol);
+	CHECK(members.CountMembers() == 2);
+	CHECK(members.Names().CountItems() == 2);
+
+	// Renaming those who aren't members does nothing
+	members.Rename(&alice, "Alice");
+	CHECK(members.FindByName("Alice") == NULL);
+}
+
+
+// Members joining, leaving and changing names at random, against a plain list
+static void
+test_random()
+{
+	const int32 count = 500;
+	AtomTable atoms;
+	RoomMembers<Member> members;
+	std::vector<Member> all(count);
+	std::vector<atom_id> held(count, kNoAtom);
+	for (int32 i = 0; i < count; i++) {
+		all[i].id = "user";
+		all[i].id << i;
+		all[i].nick = all[i].id;
+	}
+
+	uint32 state = 17;
+	int32 present = 0;
+	for (int32 n = 0; n < 20000; n++) {
+		int32 i = next_random(&state) % count;
+		Member* member = &all[i];
+		switch (next_random(&state) % 3) {
+			case 0:
+				if (held[i] != kNoAtom)
+					break;
+				held[i] = atoms.Acquire(member->id);
+				members.Add(held[i], member, member->id, member->nick);
+				present++;
+				break;
+			case 1:
+				if (held[i] == kNoAtom)
+					break;
+				members.Remove(held[i]);
+				atoms.Release(held[i]);
+				held[i] = kNoAtom;
+				present--;
+				break;
+			case 2:
+				member->nick = "nick";
+				member->nick << next_random(&state) % 1000;
+				members.Rename(member, member->nick);
+				break;
+		}
+	}
+
+	int32 wrong = 0;
+	int32 names = 0;
+	for (int32 i = 0; i < count; i++) {
+		Member* member = &all[i];
+		if (held[i] == kNoAtom) {
+			if (indexed_under(members, member->id, member) == true)
+				wrong++;
+			continue;
+		}
+		if (members.Find(held[i]) != member
+				|| indexed_under(members, member->id, member) == false
+				|| indexed_under(members, member->nick, member) == false
+				|| members.FindByName(member->nick) == NULL)
+			wrong++;
+		names += (member->nick == member->id) ? 1 : 2;
+	}
+	CHECK(wrong == 0);
+	CHECK(members.CountMembers() == present);
+	CHECK(members.Names().CountItems() == names);
+}
+
+
+void
+test_room_members()
+{
+	test_members();
+	test_random();
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Pushes a burst of 100k messages through a ProtocolInbox from a thread of
+ * its own, as a protocol would, with the default limit and policies. Every
+ * chat message should reach the "window" once and in order, and each user's
+ * last status should be the last one pushed, however many were merged on
+ * the way. Every so often someone joins a room and says something straight
+ * away; they should be shown joining first, or the room would take them for
+ * a guest until their join caught up. Prints how long it all took. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Application.h>
+#include <Handler.h>
+#include <Looper.h>
+
+#include <libsupport/KeyMap.h>
+
+#include "ChatProtocolMessages.h"
+#include "ProtocolInbox.h"
+
+
+const int32 kBurstSize = 100000;
+
+// Every kChatEvery'th message is a chat message, the rest statuses
+const int32 kChatEvery = 4;
+const int32 kChatCount = (kBurstSize + kChatEvery - 1) / kChatEvery;
+
+// Coprime with kChatEvery, so each user's statuses are spread throughout
+const int32 kUserCount = 499;
+
+// Someone joins and speaks before every kJoinEvery'th message
+const int32 kJoinEvery = 1000;
+const int32 kJoinCount = (kBurstSize + kJoinEvery - 1) / kJoinEvery;
+
+const uint32 kBurstDone = 'IBdn';
+
+
+// The last status pushed for each user, or 0 for none
+static int32 sExpected[kUserCount];
+
+
+class Receiver : public BHandler {
+public:
+						Receiver();
+
+	virtual	void		MessageReceived(BMessage* msg);
+
+			int32		fChats;
+			int32		fStatuses;
+			int32		fWarnings;
+			int32		fBatches;
+			bool		fOutOfOrder;
+			int32		fStatus[kUserCount];
+			int32		fJoins;
+			int32		fJoinerChats;
+			int32		fSpokeEarly;
+			bigtime_t	fDone;
+
+private:
+			void		_Receive(BMessage* msg);
+
+			int32		fLastSequence;
+			KeyMap<BString, bool> fJoined;
+};
+
+
+class BurstApp : public BApplication {
+public:
+						BurstApp();
+
+	virtual	void		ReadyToRun();
+	virtual	void		MessageReceived(BMessage* msg);
+
+			int32		Result() const { return fResult; }
+
+private:
+	static	status_t	_PushEntry(void* data);
+			void		_Push();
+			status_t	_PushJoiner(int32 i);
+			void		_Finish();
+
+			BLooper*		fWindow;
+			Receiver*		fReceiver;
+			BLooper*		fInboxLooper;
+			ProtocolInbox*	fInbox;
+			bigtime_t		fStart;
+			int32			fResult;
+};
+
+
+Receiver::Receiver()
+	:
+	BHandler("receiver"),
+	fChats(0),
+	fStatuses(0),
+	fWarnings(0),
+	fBatches(0),
+	fOutOfOrder(false),
+	fJoins(0),
+	fJoinerChats(0),
+	fSpokeEarly(0),
+	fDone(0),
+	fLastSequence(-1)
+{
+	for (int32 i = 0; i < kUserCount; i++)
+		fStatus[i] = 0;
+}
+
+
+void
+Receiver::MessageReceived(BMessage* msg)
+{
+	if (msg->what != IM_MESSAGE) {
+		BHandler::MessageReceived(msg);
+		return;
+	}
+
+	if (msg->GetInt32("im_what", -1) != IM_BATCH) {
+		_Receive(msg);
+		return;
+	}
+
+	fBatches++;
+	BMessage sub;
+	for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK; i++)
+		_Receive(&sub);
+}
+
+
+void
+Receiver::_Receive(BMessage* msg)
+{
+	switch (msg->GetInt32("im_what", -1)) {
+		case IM_ROOM_PARTICIPANT_JOINED:
+			fJoined.AddItem(msg->GetString("user_id", ""), true);
+			fJoins++;
+			break;
+		case IM_MESSAGE_RECEIVED:
+		{
+			if (msg->GetBool("test_joiner", false) == true) {
+				if (fJoined.ValueFor(msg->GetString("user_id", "")) == false)
+					fSpokeEarly++;
+				fJoinerChats++;
+				break;
+			}
+
+			// The inbox's own, about its queues being full
+			int32 sequence;
+			if (msg->FindInt32("test_sequence", &sequence) != B_OK) {
+				fWarnings++;
+				break;
+			}
+			if (sequence <= fLastSequence)
+				fOutOfOrder = true;
+			fLastSequence = sequence;
+			fChats++;
+			break;
+		}
+		case IM_USER_STATUS_SET:
+		{
+			int32 user = atoi(msg->GetString("user_id", "user-1") + 4);
+			if (user >= 0 && user < kUserCount)
+				fStatus[user] = msg->GetInt32("status", 0);
+			fStatuses++;
+			break;
+		}
+		case IM_PROTOCOL_READY:
+			// Pushed last, and a barrier, so everything else is through
+			fDone = system_time();
+			be_app->PostMessage(kBurstDone);
+			break;
+	}
+}
+
+
+BurstApp::BurstApp()
+	:
+	BApplication("application/x-vnd.chat-o-matic.inbox-test"),
+	fResult(1)
+{
+}
+
+
+void
+BurstApp::ReadyToRun()
+{
+	fWindow = new BLooper("window");
+	fReceiver = new Receiver();
+	fWindow->AddHandler(fReceiver);
+	fWindow->Run();
+
+	fInboxLooper = new BLooper("inbox");
+	fInbox = new ProtocolInbox("test", 1, BMessenger(fReceiver));
+	fInboxLooper->AddHandler(fInbox);
+	fInboxLooper->Run();
+
+	thread_id thread = spawn_thread(_PushEntry, "protocol", B_NORMAL_PRIORITY,
+		this);
+	if (thread < 0 || resume_thread(thread) != B_OK) {
+		fprintf(stderr, "Couldn't start pushing\n");
+		Quit();
+	}
+}
+
+
+void
+BurstApp::MessageReceived(BMessage* msg)
+{
+	if (msg->what == kBurstDone) {
+		_Finish();
+		Quit();
+		return;
+	}
+	BApplication::MessageReceived(msg);
+}
+
+
+/*static*/ status_t
+BurstApp::_PushEntry(void* data)
+{
+	((BurstApp*)data)->_Push();
+	return B_OK;
+}
+
+
+void
+BurstApp::_Push()
+{
+	fStart = system_time();
+	for (int32 i = 0; i < kBurstSize; i++) {
+		if (i % kJoinEvery == 0 && _PushJoiner(i) != B_OK) {
+			fprintf(stderr, "Joiner %" B_PRId32 " failed\n", i);
+			return;
+		}
+
+		BMessage msg(IM_MESSAGE);
+		if (i % kChatEvery == 0) {
+			msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			msg.AddString("user_id", "sender");
+			msg.AddString("body", "A message among many");
+			msg.AddInt32("test_sequence", i);
+		} else {
+			int32 user = i % kUserCount;
+			int32 status = (i / kUserCount) % 5 + 1;
+			BString id("user");
+			id << user;
+			msg.AddInt32("im_what", IM_USER_STATUS_SET);
+			msg.AddString("user_id", id);
+			msg.AddInt32("status", status);
+			sExpected[user] = status;
+		}
+
+		if (fInbox->Push(&msg) != B_OK) {
+			fprintf(stderr, "Push %" B_PRId32 " failed\n", i);
+			return;
+		}
+	}
+
+	BMessage ready(IM_MESSAGE);
+	ready.AddInt32("im_what", IM_PROTOCOL_READY);
+	fInbox->Push(&ready);
+}
+
+
+status_t
+BurstApp::_PushJoiner(int32 i)
+{
+	BString id("joiner");
+	id << i;
+
+	BMessage joined(IM_MESSAGE);
+	joined.AddInt32("im_what", IM_ROOM_PARTICIPANT_JOINED);
+	joined.AddString("chat_id", "#room");
+	joined.AddString("user_id", id);
+	status_t ret = fInbox->Push(&joined);
+	if (ret != B_OK)
+		return ret;
+
+	BMessage hello(IM_MESSAGE);
+	hello.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+	hello.AddString("chat_id", "#room");
+	hello.AddString("user_id", id);
+	hello.AddString("body", "Hi, just got here");
+	hello.AddBool("test_joiner", true);
+	return fInbox->Push(&hello);
+}
+
+
+void
+BurstApp::_Finish()
+{
+	fWindow->Lock();
+	int32 chats = fReceiver->fChats;
+	int32 statuses = fReceiver->fStatuses;
+	bool outOfOrder = fReceiver->fOutOfOrder;
+	int32 wrongStatuses = 0;
+	for (int32 i = 0; i < kUserCount; i++)
+		if (fReceiver->fStatus[i] != sExpected[i])
+			wrongStatuses++;
+	bigtime_t elapsed = fReceiver->fDone - fStart;
+	int32 batches = fReceiver->fBatches;
+	int32 warnings = fReceiver->fWarnings;
+	int32 joins = fReceiver->fJoins;
+	int32 joinerChats = fReceiver->fJoinerChats;
+	int32 spokeEarly = fReceiver->fSpokeEarly;
+	fWindow->Unlock();
+
+	printf("%" B_PRId32 " messages in %" B_PRId64 " µs (%.0f/s), "
+		"%" B_PRId32 " batches\n", kBurstSize, elapsed,
+		kBurstSize * 1000000.0 / (elapsed > 0 ? elapsed : 1), batches);
+	printf("Chat: %" B_PRId32 " of %" B_PRId32 " delivered%s, "
+		"%" B_PRId32 " dropped\n", chats, kChatCount,
+		outOfOrder ? ", OUT OF ORDER" : " in order",
+		fInbox->DroppedCount(INBOX_CHAT_LANE));
+	printf("Presence: %" B_PRId32 " of %" B_PRId32 " delivered, %" B_PRId32
+		" merged, %" B_PRId32 " users' last status wrong\n", statuses,
+		kBurstSize - kChatCount, fInbox->MergedCount(INBOX_PRESENCE_LANE),
+		wrongStatuses);
+	printf("Joins: %" B_PRId32 " and %" B_PRId32 " first words of %" B_PRId32
+		", %" B_PRId32 " shown before joining\n", joins, joinerChats,
+		kJoinCount, spokeEarly);
+	printf("%" B_PRId32 " queue-full warnings\n", warnings);
+
+	bool passed = chats == kChatCount && outOfOrder == false
+		&& wrongStatuses == 0
+		&& fInbox->DroppedCount(INBOX_CHAT_LANE) == 0
+		&& statuses + fInbox->MergedCount(INBOX_PRESENCE_LANE)
+			== kBurstSize - kChatCount
+		&& joins == kJoinCount && joinerChats == kJoinCount
+		&& spokeEarly == 0;
+	printf("%s\n", passed ? "PASSED" : "FAILED");
+	fResult = passed ? 0 : 1;
+}
+
+
+int
+main()
+{
+	BurstApp app;
+	app.Run();
+	return app.Result();
+}
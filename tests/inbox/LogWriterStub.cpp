@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+// Only what the ProtocolInbox, and the rest of the app as linked into the
+// replay bench, link against: there's no writer, so nothing's ever logged,
+// and nothing read back or searched for gets a reply.
+
+#include "LogWriter.h"
+
+
+LogWriter* LogWriter::fInstance = NULL;
+
+
+LogWriter*
+LogWriter::Get()
+{
+	return fInstance;
+}
+
+
+void
+LogWriter::Submit(const char* accountName, const char* roomId,
+	const ChatEvent& event)
+{
+}
+
+
+void
+LogWriter::Flush()
+{
+}
+
+
+void
+LogWriter::ReadLogs(const char* accountName, const char* roomId, int32 count,
+	const log_position* before, int32 skip, BMessenger target,
+	const BMessage& reply)
+{
+}
+
+
+void
+LogWriter::Quit()
+{
+}
+
+
+void
+LogWriter::Search(const char* query, int32 count, BMessenger target,
+	const BMessage& reply)
+{
+}
+
+
+void
+LogWriter::Export(const char* accountName, const char* roomId,
+	log_export_format format, const char* path, BMessenger target,
+	const BMessage& reply)
+{
+}
+
+
+void
+LogWriter::SetFlushInterval(bigtime_t interval)
+{
+}
+
+
+void
+LogWriter::SetDurability(log_durability durability)
+{
+}
+
+
+void
+LogWriter::SetRetention(int32 days)
+{
+}
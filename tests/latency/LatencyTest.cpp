@@ -0,0 +1,384 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Times how long a keypress takes to come back as its echo, while the window
+ * is idle and then while a protocol floods it. Each "keypress" is posted to
+ * the window's looper, which sends it on as an IM_SEND_MESSAGE to the
+ * "protocol" looper; that echoes it as an IM_MESSAGE_SENT through the
+ * account's ProtocolInbox, as the replay protocol does. Meanwhile, during the
+ * second run, another thread pushes chat messages and statuses into the same
+ * inbox as fast as it'll take them, and the window spends a little while on
+ * each it's given, standing in for its views.
+ *
+ * Prints the latency's median, 99th percentile and worst per run; fails if
+ * an echo's lost, or if under flood the 99th percentile is past
+ * kMaxLatency. */
+
+#include <algorithm>
+#include <stdio.h>
+
+#include <Application.h>
+#include <Handler.h>
+#include <Looper.h>
+#include <Messenger.h>
+
+#include "ChatProtocolMessages.h"
+#include "ProtocolInbox.h"
+
+
+// Per run, one every kKeypressInterval µs, a fast typist's pace
+const int32 kKeypresses = 500;
+const bigtime_t kKeypressInterval = 20000;
+
+// Time the window spends on each message it's given, in µs
+const bigtime_t kDeltaCost = 10;
+
+// For the flood to build up a backlog before the first keypress
+const bigtime_t kFloodLead = 200000;
+
+// Past this, typing feels laggy
+const bigtime_t kMaxLatency = 100000;
+
+const int32 kFloodUsers = 499;
+const int32 kChatEvery = 4;
+
+enum latency_run {
+	RUN_IDLE = 0,
+	RUN_FLOOD,
+	RUN_COUNT
+};
+
+const uint32 kKeypress = 'LTkp';
+const uint32 kLatencyDone = 'LTdn';
+
+
+class Window : public BHandler {
+public:
+						Window();
+
+	virtual	void		MessageReceived(BMessage* msg);
+
+			BMessenger	fProtocol;
+
+			bigtime_t	fLatency[RUN_COUNT][kKeypresses];
+			int32		fEchoes[RUN_COUNT];
+			int32		fFlooded;
+			int32		fBatches;
+
+private:
+			void		_Receive(BMessage* msg);
+};
+
+
+class Echo : public BHandler {
+public:
+						Echo(ProtocolInbox* inbox);
+
+	virtual	void		MessageReceived(BMessage* msg);
+
+private:
+			ProtocolInbox*	fInbox;
+};
+
+
+class LatencyApp : public BApplication {
+public:
+						LatencyApp();
+
+	virtual	void		ReadyToRun();
+	virtual	void		MessageReceived(BMessage* msg);
+
+			int32		Result() const { return fResult; }
+
+private:
+	static	status_t	_TypeEntry(void* data);
+	static	status_t	_FloodEntry(void* data);
+			void		_Type();
+			void		_Flood();
+			void		_Finish();
+
+			BLooper*		fWindowLooper;
+			Window*			fWindow;
+			BLooper*		fProtocolLooper;
+			ProtocolInbox*	fInbox;
+			int32			fFlooding;
+			int32			fPushed;
+			int32			fResult;
+};
+
+
+static void
+print_run(const char* name, bigtime_t* latency, int32 count)
+{
+	if (count == 0) {
+		printf("%s: no echoes\n", name);
+		return;
+	}
+	std::sort(latency, latency + count);
+	printf("%s: %" B_PRId32 " of %" B_PRId32 " echoed, median %" B_PRId64
+		" µs, 99%% %" B_PRId64 " µs, worst %" B_PRId64 " µs\n", name, count,
+		kKeypresses, latency[count / 2], latency[count * 99 / 100],
+		latency[count - 1]);
+}
+
+
+Window::Window()
+	:
+	BHandler("window"),
+	fFlooded(0),
+	fBatches(0)
+{
+	for (int32 i = 0; i < RUN_COUNT; i++)
+		fEchoes[i] = 0;
+}
+
+
+void
+Window::MessageReceived(BMessage* msg)
+{
+	switch (msg->what) {
+		case kKeypress:
+		{
+			// As the input box would, once return's pressed
+			BMessage send(IM_MESSAGE);
+			send.AddInt32("im_what", IM_SEND_MESSAGE);
+			send.AddString("body", "Typed by hand");
+			send.AddInt32("test_run", msg->GetInt32("test_run", 0));
+			send.AddInt64("test_pressed", msg->GetInt64("test_pressed", 0));
+			fProtocol.SendMessage(&send);
+			break;
+		}
+		case IM_MESSAGE:
+		{
+			if (msg->GetInt32("im_what", -1) != IM_BATCH) {
+				_Receive(msg);
+				break;
+			}
+			fBatches++;
+			BMessage sub;
+			for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK;
+					i++)
+				_Receive(&sub);
+			break;
+		}
+		default:
+			BHandler::MessageReceived(msg);
+	}
+}
+
+
+void
+Window::_Receive(BMessage* msg)
+{
+	bigtime_t now = system_time();
+	switch (msg->GetInt32("im_what", -1)) {
+		case IM_MESSAGE_SENT:
+		{
+			int32 run = msg->GetInt32("test_run", -1);
+			if (run < 0 || run >= RUN_COUNT || fEchoes[run] >= kKeypresses)
+				break;
+			fLatency[run][fEchoes[run]++]
+				= now - msg->GetInt64("test_pressed", now);
+			break;
+		}
+		case IM_PROTOCOL_READY:
+			// Pushed last, and a barrier, so everything else is through
+			be_app->PostMessage(kLatencyDone);
+			return;
+		default:
+			fFlooded++;
+	}
+
+	while (system_time() - now < kDeltaCost)
+		;
+}
+
+
+Echo::Echo(ProtocolInbox* inbox)
+	:
+	BHandler("protocol"),
+	fInbox(inbox)
+{
+}
+
+
+void
+Echo::MessageReceived(BMessage* msg)
+{
+	if (msg->what != IM_MESSAGE
+			|| msg->GetInt32("im_what", -1) != IM_SEND_MESSAGE) {
+		BHandler::MessageReceived(msg);
+		return;
+	}
+
+	BMessage sent(*msg);
+	sent.ReplaceInt32("im_what", IM_MESSAGE_SENT);
+	sent.AddString("user_id", "me");
+	fInbox->Push(&sent);
+}
+
+
+LatencyApp::LatencyApp()
+	:
+	BApplication("application/x-vnd.chat-o-matic.latency-test"),
+	fFlooding(0),
+	fPushed(0),
+	fResult(1)
+{
+}
+
+
+void
+LatencyApp::ReadyToRun()
+{
+	fWindowLooper = new BLooper("window");
+	fWindow = new Window();
+	fWindowLooper->AddHandler(fWindow);
+	fWindowLooper->Run();
+
+	// Like a ProtocolLooper, with both the protocol and its inbox
+	fProtocolLooper = new BLooper("protocol");
+	fInbox = new ProtocolInbox("test", 1, BMessenger(fWindow));
+	Echo* echo = new Echo(fInbox);
+	fProtocolLooper->AddHandler(fInbox);
+	fProtocolLooper->AddHandler(echo);
+	fProtocolLooper->Run();
+
+	fWindowLooper->Lock();
+	fWindow->fProtocol = BMessenger(echo);
+	fWindowLooper->Unlock();
+
+	thread_id thread = spawn_thread(_TypeEntry, "typist", B_NORMAL_PRIORITY,
+		this);
+	if (thread < 0 || resume_thread(thread) != B_OK) {
+		fprintf(stderr, "Couldn't start typing\n");
+		Quit();
+	}
+}
+
+
+void
+LatencyApp::MessageReceived(BMessage* msg)
+{
+	if (msg->what == kLatencyDone) {
+		_Finish();
+		Quit();
+		return;
+	}
+	BApplication::MessageReceived(msg);
+}
+
+
+/*static*/ status_t
+LatencyApp::_TypeEntry(void* data)
+{
+	((LatencyApp*)data)->_Type();
+	return B_OK;
+}
+
+
+/*static*/ status_t
+LatencyApp::_FloodEntry(void* data)
+{
+	((LatencyApp*)data)->_Flood();
+	return B_OK;
+}
+
+
+void
+LatencyApp::_Type()
+{
+	BMessenger window(fWindow);
+	thread_id flood = -1;
+
+	for (int32 run = 0; run < RUN_COUNT; run++) {
+		if (run == RUN_FLOOD) {
+			atomic_set(&fFlooding, 1);
+			flood = spawn_thread(_FloodEntry, "flood", B_NORMAL_PRIORITY, this);
+			if (flood < 0 || resume_thread(flood) != B_OK) {
+				fprintf(stderr, "Couldn't start flooding\n");
+				flood = -1;
+			}
+			snooze(kFloodLead);
+		}
+
+		for (int32 i = 0; i < kKeypresses; i++) {
+			BMessage key(kKeypress);
+			key.AddInt32("test_run", run);
+			key.AddInt64("test_pressed", system_time());
+			window.SendMessage(&key);
+			snooze(kKeypressInterval);
+		}
+	}
+
+	atomic_set(&fFlooding, 0);
+	if (flood >= 0) {
+		status_t result;
+		wait_for_thread(flood, &result);
+	}
+
+	BMessage ready(IM_MESSAGE);
+	ready.AddInt32("im_what", IM_PROTOCOL_READY);
+	fInbox->Push(&ready);
+}
+
+
+void
+LatencyApp::_Flood()
+{
+	for (int32 i = 0; atomic_get(&fFlooding) != 0; i++) {
+		BMessage msg(IM_MESSAGE);
+		if (i % kChatEvery == 0) {
+			msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			msg.AddString("user_id", "flooder");
+			msg.AddString("body", "A message among many");
+		} else {
+			BString id("user");
+			id << i % kFloodUsers;
+			msg.AddInt32("im_what", IM_USER_STATUS_SET);
+			msg.AddString("user_id", id);
+			msg.AddInt32("status", (i / kFloodUsers) % 5 + 1);
+		}
+
+		if (fInbox->Push(&msg) != B_OK)
+			return;
+		fPushed++;
+	}
+}
+
+
+void
+LatencyApp::_Finish()
+{
+	fWindowLooper->Lock();
+	int32 echoes[RUN_COUNT];
+	for (int32 run = 0; run < RUN_COUNT; run++)
+		echoes[run] = fWindow->fEchoes[run];
+	print_run("Idle", fWindow->fLatency[RUN_IDLE], echoes[RUN_IDLE]);
+	print_run("Flooded", fWindow->fLatency[RUN_FLOOD], echoes[RUN_FLOOD]);
+	bigtime_t floodedP99 = echoes[RUN_FLOOD] > 0
+		? fWindow->fLatency[RUN_FLOOD][echoes[RUN_FLOOD] * 99 / 100] : 0;
+	int32 flooded = fWindow->fFlooded;
+	int32 batches = fWindow->fBatches;
+	fWindowLooper->Unlock();
+
+	printf("Flood: %" B_PRId32 " pushed, %" B_PRId32 " shown, %" B_PRId32
+		" merged, in %" B_PRId32 " batches\n", fPushed, flooded,
+		fInbox->MergedCount(INBOX_PRESENCE_LANE), batches);
+
+	bool passed = echoes[RUN_IDLE] == kKeypresses
+		&& echoes[RUN_FLOOD] == kKeypresses && floodedP99 <= kMaxLatency;
+	printf("%s\n", passed ? "PASSED" : "FAILED");
+	fResult = passed ? 0 : 1;
+}
+
+
+int
+main()
+{
+	LatencyApp app;
+	app.Run();
+	return app.Result();
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LibSupportTest.h"
+
+#include <map>
+#include <vector>
+
+#include <libsupport/KeyMap.h>
+
+
+typedef KeyMap<int32, int32> IntMap;
+
+
+static void
+test_empty()
+{
+	IntMap map;
+	bool found = true;
+	CHECK(map.CountItems() == 0);
+	CHECK(map.ValueFor(1, &found) == 0 && found == false);
+	CHECK(map.RemoveItemFor(1) == 0);
+	CHECK(map.RemoveItemAt(0) == 0);
+	CHECK(map.RemoveItemAt(-1) == 0);
+	CHECK(map.KeyAt(0) == 0);
+	CHECK(map.ValueAt(0) == 0);
+
+	KeyMap<BString, int32*> pointers;
+	CHECK(pointers.ValueFor("none") == NULL);
+	CHECK(pointers.KeyAt(3) == "");
+}
+
+
+static void
+test_insertion_order()
+{
+	IntMap map;
+	map.AddItem(5, 50);
+	map.AddItem(3, 30);
+	map.AddItem(9, 90);
+	CHECK(map.CountItems() == 3);
+	CHECK(map.KeyAt(0) == 5 && map.KeyAt(1) == 3 && map.KeyAt(2) == 9);
+	CHECK(map.ValueAt(0) == 50 && map.ValueAt(1) == 30 && map.ValueAt(2) == 90);
+
+	// Replacing a value keeps its place
+	map.AddItem(5, 55);
+	CHECK(map.CountItems() == 3);
+	CHECK(map.KeyAt(0) == 5 && map.ValueAt(0) == 55);
+
+	bool found = false;
+	CHECK(map.ValueFor(3, &found) == 30 && found == true);
+	CHECK(map.KeyFor(90, &found) == 9 && found == true);
+	CHECK(map.KeyFor(12, &found) == 0 && found == false);
+}
+
+
+static void
+test_removal()
+{
+	IntMap map;
+	for (int32 i = 0; i < 10; i++)
+		map.AddItem(i * 7, i);
+
+	// The last entry takes the removed one's place
+	CHECK(map.RemoveItemFor(3 * 7) == 3);
+	CHECK(map.CountItems() == 9);
+	CHECK(map.KeyAt(2) == 2 * 7 && map.KeyAt(3) == 9 * 7);
+	CHECK(map.KeyAt(4) == 4 * 7 && map.KeyAt(8) == 8 * 7);
+	for (int32 i = 0; i < 10; i++) {
+		bool found = false;
+		int32 value = map.ValueFor(i * 7, &found);
+		CHECK(found == (i != 3));
+		if (i != 3)
+			CHECK(value == i);
+	}
+
+	CHECK(map.RemoveItemAt(0) == 0);
+	CHECK(map.RemoveItemAt(map.CountItems() - 1) == 7);
+	CHECK(map.CountItems() == 7);
+	CHECK(map.KeyAt(0) == 8 * 7 && map.KeyAt(6) == 6 * 7);
+	CHECK(map.ValueFor(8 * 7) == 8 && map.ValueFor(9 * 7) == 9);
+
+	// A removed key can come back, last
+	map.AddItem(0, 100);
+	CHECK(map.KeyAt(7) == 0 && map.ValueFor(0) == 100);
+}
+
+
+static void
+test_iterator()
+{
+	IntMap map;
+	IntMap::Iterator empty = map.GetIterator();
+	CHECK(empty.HasNext() == false);
+
+	for (int32 i = 0; i < 100; i++)
+		map.AddItem(i, i);
+
+	// Removing every odd one on the way still visits each once
+	int32 visited[100] = { 0 };
+	IntMap::Iterator it = map.GetIterator();
+	while (it.HasNext() == true) {
+		int32 value = it.Next();
+		CHECK(it.Key() == value);
+		visited[value]++;
+		if (value % 2 == 1)
+			CHECK(it.Remove() == value);
+		else if (value == 50)
+			// Those added meanwhile aren't visited
+			map.AddItem(1000, 1000);
+	}
+
+	int32 wrong = 0;
+	for (int32 i = 0; i < 100; i++)
+		if (visited[i] != 1)
+			wrong++;
+	CHECK(wrong == 0);
+	CHECK(map.CountItems() == 51);
+	for (int32 i = 0; i < 100; i++) {
+		bool found = false;
+		map.ValueFor(i, &found);
+		if (found != (i % 2 == 0))
+			wrong++;
+	}
+	CHECK(wrong == 0 && map.ValueFor(1000) == 1000);
+
+	// Emptying it
+	it = map.GetIterator();
+	while (it.HasNext() == true) {
+		it.Next();
+		it.Remove();
+	}
+	CHECK(map.CountItems() == 0 && map.ValueFor(0) == 0);
+}
+
+
+static void
+test_sort()
+{
+	KeyMap<BString, int32> map;
+	map.AddItem("carol", 3);
+	map.AddItem("alice", 1);
+	map.AddItem("dave", 4);
+	map.AddItem("bob", 2);
+	map.RemoveItemFor("dave");
+	map.SortByKey();
+	CHECK(map.CountItems() == 3);
+	CHECK(map.KeyAt(0) == "alice" && map.KeyAt(1) == "bob"
+		&& map.KeyAt(2) == "carol");
+	CHECK(map.ValueFor("alice") == 1 && map.ValueFor("carol") == 3);
+	CHECK(map.ValueFor("dave") == 0);
+
+	IntMap none;
+	none.SortByKey();
+	CHECK(none.CountItems() == 0);
+}
+
+
+static void
+test_string_keys()
+{
+	KeyMap<BString, int32> map;
+	map.AddItem("alice", 1);
+	map.AddItem("bob", 2);
+	map.AddItem("", 3);
+	CHECK(map.ValueFor("alice") == 1);
+	CHECK(map.ValueFor("bob") == 2);
+	CHECK(map.ValueFor("") == 3);
+	CHECK(map.ValueFor("Alice") == 0);
+
+	BString id("carol");
+	id << 7;
+	map.AddItem(id, 4);
+	CHECK(map.ValueFor("carol7") == 4);
+	CHECK(map.RemoveItemFor("bob") == 2);
+	CHECK(map.ValueFor("carol7") == 4 && map.KeyAt(1) == "carol7");
+}
+
+
+static void
+test_pointer_keys()
+{
+	int32 values[64];
+	KeyMap<int32*, int32> map;
+	for (int32 i = 0; i < 64; i++)
+		map.AddItem(&values[i], i);
+	for (int32 i = 0; i < 64; i++)
+		CHECK(map.ValueFor(&values[i]) == i);
+	CHECK(map.RemoveItemFor(&values[10]) == 10);
+	bool found = true;
+	map.ValueFor(&values[10], &found);
+	CHECK(found == false);
+	CHECK(map.ValueFor(&values[11]) == 11);
+}
+
+
+static void
+test_add_list()
+{
+	IntMap map;
+	map.AddItem(1, 10);
+	map.AddItem(2, 20);
+
+	IntMap more;
+	more.AddItem(2, 22);
+	more.AddItem(3, 30);
+	map.AddList(more);
+	CHECK(map.CountItems() == 3);
+	CHECK(map.ValueFor(2) == 22 && map.KeyAt(1) == 2);
+	CHECK(map.KeyAt(2) == 3);
+
+	map.AddList(IntMap());
+	CHECK(map.CountItems() == 3);
+}
+
+
+// Random adds, replacements and removals, against a std::map for what's there
+// and a vector for the order it should be in, the last filling any hole
+static void
+test_random()
+{
+	IntMap map;
+	std::map<int32, int32> expected;
+	std::vector<int32> order;
+	uint32 state = 2022;
+
+	int32 mismatches = 0;
+	for (int32 i = 0; i < 200000; i++) {
+		// Few enough keys that they're often found, and removed
+		int32 key = next_random(&state) % 4096;
+		uint32 operation = next_random(&state) % 8;
+		if (operation < 4) {
+			if (expected.find(key) == expected.end())
+				order.push_back(key);
+			expected[key] = i;
+			map.AddItem(key, i);
+		} else if (operation < 6) {
+			bool found = false;
+			int32 value = map.ValueFor(key, &found);
+			std::map<int32, int32>::iterator it = expected.find(key);
+			if (found != (it != expected.end())
+					|| (found == true && value != it->second))
+				mismatches++;
+		} else if (operation < 7) {
+			int32 value = map.RemoveItemFor(key);
+			std::map<int32, int32>::iterator it = expected.find(key);
+			if (it != expected.end()) {
+				if (value != it->second)
+					mismatches++;
+				expected.erase(it);
+				for (size_t j = 0; j < order.size(); j++)
+					if (order[j] == key) {
+						order[j] = order.back();
+						order.pop_back();
+						break;
+					}
+			}
+		} else if (order.empty() == false) {
+			uint32 position = next_random(&state) % order.size();
+			if (map.RemoveItemAt(position) != expected[order[position]])
+				mismatches++;
+			expected.erase(order[position]);
+			order[position] = order.back();
+			order.pop_back();
+		}
+	}
+	CHECK(mismatches == 0);
+
+	CHECK(map.CountItems() == expected.size());
+	bool ordered = map.CountItems() == order.size();
+	for (uint32 i = 0; ordered == true && i < order.size(); i++)
+		ordered = map.KeyAt(i) == order[i]
+			&& map.ValueAt(i) == expected[order[i]];
+	CHECK(ordered == true);
+}
+
+
+static void
+test_growth()
+{
+	const int32 count = 100000;
+	IntMap map;
+	for (int32 i = 0; i < count; i++)
+		map.AddItem(i * 16, i);
+	CHECK(map.CountItems() == (uint32)count);
+
+	int32 wrong = 0;
+	for (int32 i = 0; i < count; i++) {
+		bool found = false;
+		if (map.ValueFor(i * 16, &found) != i || found == false)
+			wrong++;
+		map.ValueFor(i * 16 + 1, &found);
+		if (found == true)
+			wrong++;
+	}
+	CHECK(wrong == 0);
+}
+
+
+void
+test_key_map()
+{
+	test_empty();
+	test_insertion_order();
+	test_removal();
+	test_iterator();
+	test_sort();
+	test_string_keys();
+	test_pointer_keys();
+	test_add_list();
+	test_random();
+	test_growth();
+}
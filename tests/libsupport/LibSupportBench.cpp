@@ -0,0 +1,369 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Microbenchmarks of libsupport's containers, with 10, 1k and 100k items.
+ * Prints the time per operation, in nanoseconds, averaged over enough rounds
+ * to take about a million of them. std::map and std::list, KeyMap's and
+ * List's old backing, are timed alongside for comparison. Like the tests,
+ * builds on Linux too. */
+
+#include <stdio.h>
+
+#include <chrono>
+#include <iterator>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <libsupport/KeyMap.h>
+#include <libsupport/List.h>
+
+
+static const int32 kSizes[] = { 10, 1000, 100000 };
+static const int32 kOperations = 1000000;
+
+// Ordered removals from a List are O(n) each, so only this many are timed per
+// round, and there are only as many rounds as make about this many items'
+// worth of work
+static const int32 kRemovals = 100;
+static const int64 kRemovalWork = 10000000;
+
+// Keeps the compiler from dropping what's being timed
+static volatile int64 sSink;
+
+
+class Timer {
+public:
+	Timer() : fStart(std::chrono::steady_clock::now()), fOperations(0) {}
+
+	void	Count(int64 operations) { fOperations += operations; }
+
+	double	NanosecondsEach() const
+	{
+		std::chrono::duration<double, std::nano> elapsed
+			= std::chrono::steady_clock::now() - fStart;
+		return fOperations > 0 ? elapsed.count() / fOperations : 0;
+	}
+
+private:
+	std::chrono::steady_clock::time_point fStart;
+	int64	fOperations;
+};
+
+
+static BString
+string_key(int32 i)
+{
+	BString key("user");
+	key << i << "@example.org";
+	return key;
+}
+
+
+template<class KEY>
+static std::vector<KEY> make_keys(int32 count, int32 offset);
+
+
+template<>
+std::vector<int32>
+make_keys<int32>(int32 count, int32 offset)
+{
+	std::vector<int32> keys;
+	for (int32 i = 0; i < count; i++)
+		keys.push_back((i + offset) * 7919);
+	return keys;
+}
+
+
+template<>
+std::vector<BString>
+make_keys<BString>(int32 count, int32 offset)
+{
+	std::vector<BString> keys;
+	for (int32 i = 0; i < count; i++)
+		keys.push_back(string_key(i + offset));
+	return keys;
+}
+
+
+template<class KEY>
+static void
+bench_key_map(const char* name, int32 size)
+{
+	std::vector<KEY> keys = make_keys<KEY>(size, 0);
+	std::vector<KEY> missing = make_keys<KEY>(size, size);
+	int32 rounds = kOperations / size > 0 ? kOperations / size : 1;
+	int64 sum = 0;
+
+	Timer add;
+	for (int32 r = 0; r < rounds; r++) {
+		KeyMap<KEY, int32> map;
+		for (int32 i = 0; i < size; i++)
+			map.AddItem(keys[i], i);
+		sum += map.CountItems();
+	}
+	add.Count((int64)rounds * size);
+	double addTime = add.NanosecondsEach();
+
+	KeyMap<KEY, int32> map;
+	for (int32 i = 0; i < size; i++)
+		map.AddItem(keys[i], i);
+
+	Timer find;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 i = 0; i < size; i++)
+			sum += map.ValueFor(keys[i]);
+	find.Count((int64)rounds * size);
+	double findTime = find.NanosecondsEach();
+
+	Timer miss;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 i = 0; i < size; i++)
+			sum += map.ValueFor(missing[i]);
+	miss.Count((int64)rounds * size);
+	double missTime = miss.NanosecondsEach();
+
+	Timer iterate;
+	for (int32 r = 0; r < rounds; r++)
+		for (uint32 i = 0; i < map.CountItems(); i++)
+			sum += map.ValueAt(i);
+	iterate.Count((int64)rounds * size);
+	double iterateTime = iterate.NanosecondsEach();
+
+	int32 removals = size < kRemovals ? size : kRemovals;
+	int32 removeRounds = kRemovalWork / ((int64)removals * size);
+	if (removeRounds < 1)
+		removeRounds = 1;
+	double removeTime = 0;
+	for (int32 r = 0; r < removeRounds; r++) {
+		KeyMap<KEY, int32> copy(map);
+		Timer remove;
+		for (int32 i = 0; i < removals; i++)
+			sum += copy.RemoveItemFor(keys[i]);
+		remove.Count(removals);
+		removeTime += remove.NanosecondsEach() / removeRounds;
+	}
+
+	sSink = sum;
+	printf("%-24s %7d %9.1f %9.1f %9.1f %9.1f %11.1f\n", name, (int)size,
+		addTime, findTime, missTime, iterateTime, removeTime);
+}
+
+
+template<class KEY>
+static void
+bench_std_map(const char* name, int32 size)
+{
+	std::vector<KEY> keys = make_keys<KEY>(size, 0);
+	std::vector<KEY> missing = make_keys<KEY>(size, size);
+	int32 rounds = kOperations / size > 0 ? kOperations / size : 1;
+	int64 sum = 0;
+
+	Timer add;
+	for (int32 r = 0; r < rounds; r++) {
+		std::map<KEY, int32> map;
+		for (int32 i = 0; i < size; i++)
+			map[keys[i]] = i;
+		sum += map.size();
+	}
+	add.Count((int64)rounds * size);
+	double addTime = add.NanosecondsEach();
+
+	std::map<KEY, int32> map;
+	for (int32 i = 0; i < size; i++)
+		map[keys[i]] = i;
+
+	Timer find;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 i = 0; i < size; i++)
+			sum += map.find(keys[i])->second;
+	find.Count((int64)rounds * size);
+	double findTime = find.NanosecondsEach();
+
+	Timer miss;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 i = 0; i < size; i++)
+			sum += map.find(missing[i]) == map.end();
+	miss.Count((int64)rounds * size);
+	double missTime = miss.NanosecondsEach();
+
+	// With an iterator; the old KeyMap's ValueAt() walked from the start
+	Timer iterate;
+	for (int32 r = 0; r < rounds; r++)
+		for (typename std::map<KEY, int32>::const_iterator it = map.begin();
+				it != map.end(); it++)
+			sum += it->second;
+	iterate.Count((int64)rounds * size);
+	double iterateTime = iterate.NanosecondsEach();
+
+	int32 removals = size < kRemovals ? size : kRemovals;
+	int32 removeRounds = kRemovalWork / ((int64)removals * size);
+	if (removeRounds < 1)
+		removeRounds = 1;
+	double removeTime = 0;
+	for (int32 r = 0; r < removeRounds; r++) {
+		std::map<KEY, int32> copy(map);
+		Timer remove;
+		for (int32 i = 0; i < removals; i++)
+			sum += copy.erase(keys[i]);
+		remove.Count(removals);
+		removeTime += remove.NanosecondsEach() / removeRounds;
+	}
+
+	sSink = sum;
+	printf("%-24s %7d %9.1f %9.1f %9.1f %9.1f %11.1f\n", name, (int)size,
+		addTime, findTime, missTime, iterateTime, removeTime);
+}
+
+
+static void
+bench_list(int32 size)
+{
+	int32 rounds = kOperations / size > 0 ? kOperations / size : 1;
+	int64 sum = 0;
+
+	Timer add;
+	for (int32 r = 0; r < rounds; r++) {
+		List<int32> list;
+		for (int32 i = 0; i < size; i++)
+			list.AddItem(i);
+		sum += list.CountItems();
+	}
+	add.Count((int64)rounds * size);
+	double addTime = add.NanosecondsEach();
+
+	List<int32> list;
+	for (int32 i = 0; i < size; i++)
+		list.AddItem(i);
+
+	Timer itemAt;
+	for (int32 r = 0; r < rounds; r++)
+		for (uint32 i = 0; i < list.CountItems(); i++)
+			sum += list.ItemAt(i);
+	itemAt.Count((int64)rounds * size);
+	double itemAtTime = itemAt.NanosecondsEach();
+
+	Timer iterate;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 item : list)
+			sum += item;
+	iterate.Count((int64)rounds * size);
+	double iterateTime = iterate.NanosecondsEach();
+
+	// From the front, the worst case for keeping the order
+	int32 removals = size < kRemovals ? size : kRemovals;
+	int32 removeRounds = kRemovalWork / ((int64)removals * size);
+	if (removeRounds < 1)
+		removeRounds = 1;
+	double removeTime = 0;
+	double swapRemoveTime = 0;
+	for (int32 r = 0; r < removeRounds; r++) {
+		List<int32> copy(list);
+		Timer remove;
+		for (int32 i = 0; i < removals; i++)
+			copy.RemoveItemAt(0);
+		remove.Count(removals);
+		removeTime += remove.NanosecondsEach() / removeRounds;
+
+		copy = list;
+		Timer swapRemove;
+		for (int32 i = 0; i < removals; i++)
+			copy.SwapRemoveItemAt(0);
+		swapRemove.Count(removals);
+		swapRemoveTime += swapRemove.NanosecondsEach() / removeRounds;
+		sum += copy.CountItems();
+	}
+
+	sSink = sum;
+	printf("%-24s %7d %9.1f %9.1f %9.1f %11.1f %11.1f\n", "List<int32>",
+		(int)size, addTime, itemAtTime, iterateTime, removeTime,
+		swapRemoveTime);
+}
+
+
+static void
+bench_std_list(int32 size)
+{
+	int32 rounds = kOperations / size > 0 ? kOperations / size : 1;
+	int64 sum = 0;
+
+	Timer add;
+	for (int32 r = 0; r < rounds; r++) {
+		std::list<int32> list;
+		for (int32 i = 0; i < size; i++)
+			list.push_back(i);
+		sum += list.size();
+	}
+	add.Count((int64)rounds * size);
+	double addTime = add.NanosecondsEach();
+
+	std::list<int32> list;
+	for (int32 i = 0; i < size; i++)
+		list.push_back(i);
+
+	// As the old ItemAt() did, walking from the start each time; that's
+	// quadratic, so only over the first 1k
+	int32 walked = size < 1000 ? size : 1000;
+	int32 walkRounds = kOperations / 100 / walked;
+	Timer itemAt;
+	for (int32 r = 0; r < walkRounds; r++)
+		for (int32 i = 0; i < walked; i++) {
+			std::list<int32>::const_iterator it = list.begin();
+			std::advance(it, i);
+			sum += *it;
+		}
+	itemAt.Count((int64)walkRounds * walked);
+	double itemAtTime = itemAt.NanosecondsEach();
+
+	Timer iterate;
+	for (int32 r = 0; r < rounds; r++)
+		for (int32 item : list)
+			sum += item;
+	iterate.Count((int64)rounds * size);
+	double iterateTime = iterate.NanosecondsEach();
+
+	int32 removals = size < kRemovals ? size : kRemovals;
+	int32 removeRounds = kRemovalWork / ((int64)removals * size);
+	if (removeRounds < 1)
+		removeRounds = 1;
+	double removeTime = 0;
+	for (int32 r = 0; r < removeRounds; r++) {
+		std::list<int32> copy(list);
+		Timer remove;
+		for (int32 i = 0; i < removals; i++)
+			copy.pop_front();
+		remove.Count(removals);
+		removeTime += remove.NanosecondsEach() / removeRounds;
+		sum += copy.size();
+	}
+
+	sSink = sum;
+	printf("%-24s %7d %9.1f %9.1f %9.1f %11.1f %11s\n", "std::list<int32>",
+		(int)size, addTime, itemAtTime, iterateTime, removeTime, "-");
+}
+
+
+int
+main()
+{
+	printf("%-24s %7s %9s %9s %9s %9s %11s  (ns each)\n", "", "items",
+		"add", "find", "miss", "iterate", "remove");
+
+	for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+		bench_key_map<int32>("KeyMap<int32>", kSizes[i]);
+		bench_std_map<int32>("std::map<int32>", kSizes[i]);
+		bench_key_map<BString>("KeyMap<BString>", kSizes[i]);
+		bench_std_map<BString>("std::map<BString>", kSizes[i]);
+	}
+
+	printf("\n%-24s %7s %9s %9s %9s %11s %11s  (ns each)\n", "", "items",
+		"add", "item at", "iterate", "remove", "swap remove");
+
+	for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+		bench_list(kSizes[i]);
+		bench_std_list(kSizes[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Unit tests of libsupport's containers. They only need the headers, so they
+ * build on Linux too, with the stand-ins in libs/libcore/linux. Prints each
+ * failed check, and exits with 1 if there were any. */
+
+#include "LibSupportTest.h"
+
+#include <stdio.h>
+
+
+static int32 sChecks = 0;
+static int32 sFailures = 0;
+
+
+void
+check_that(bool condition, const char* what, const char* file, int line)
+{
+	sChecks++;
+	if (condition == true)
+		return;
+	sFailures++;
+	fprintf(stderr, "%s:%d: failed: %s\n", file, line, what);
+}
+
+
+uint32
+next_random(uint32* state)
+{
+	// xorshift32
+	uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+int
+main()
+{
+	test_key_map();
+	test_list();
+	test_prefix_index();
+
+	printf("%d checks, %d failed\n%s\n", (int)sChecks, (int)sFailures,
+		sFailures == 0 ? "PASSED" : "FAILED");
+	return sFailures == 0 ? 0 : 1;
+}
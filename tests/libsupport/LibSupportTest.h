@@ -0,0 +1,24 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef _LIBSUPPORT_TEST_H
+#define _LIBSUPPORT_TEST_H
+
+// Haiku's, or off it, libs/libcore/linux's stand-in
+#include <SupportDefs.h>
+
+
+#define CHECK(condition) check_that((condition), #condition, __FILE__, __LINE__)
+
+void	check_that(bool condition, const char* what, const char* file,
+			int line);
+
+// A fixed sequence of pseudo-random numbers, so every run is the same
+uint32	next_random(uint32* state);
+
+void	test_key_map();
+void	test_list();
+void	test_prefix_index();
+
+#endif // _LIBSUPPORT_TEST_H
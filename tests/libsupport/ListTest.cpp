@@ -0,0 +1,205 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LibSupportTest.h"
+
+#include <vector>
+
+#include <String.h>
+#include <libsupport/List.h>
+
+
+// Counts its copies, to tell them from moves
+struct Counted {
+	Counted(int32 value = 0) : value(value) {}
+	Counted(const Counted& other) : value(other.value) { sCopies++; }
+	Counted(Counted&& other) noexcept
+		: value(other.value) { other.value = -1; }
+	Counted& operator=(const Counted& other)
+		{ value = other.value; sCopies++; return *this; }
+	Counted& operator=(Counted&& other) noexcept
+		{ value = other.value; other.value = -1; return *this; }
+
+	int32	value;
+
+	static	int32 sCopies;
+};
+
+int32 Counted::sCopies = 0;
+
+
+static void
+test_empty()
+{
+	List<int32> list;
+	CHECK(list.CountItems() == 0);
+	CHECK(list.IsEmpty() == true);
+
+	int32 visited = 0;
+	for (int32 item : list)
+		visited += item + 1;
+	CHECK(visited == 0);
+}
+
+
+static void
+test_add()
+{
+	List<int32> list;
+	for (int32 i = 0; i < 5; i++)
+		list.AddItem(i * 10);
+	CHECK(list.CountItems() == 5);
+	CHECK(list.IsEmpty() == false);
+	CHECK(list.ItemAt(0) == 0 && list.ItemAt(4) == 40);
+
+	// ItemAt() gives a reference, into the list
+	list.ItemAt(2) = 25;
+	list.ItemAt(3)++;
+	const List<int32>& constList = list;
+	CHECK(constList.ItemAt(2) == 25 && constList.ItemAt(3) == 31);
+
+	int32 sum = 0;
+	for (int32 item : constList)
+		sum += item;
+	CHECK(sum == 0 + 10 + 25 + 31 + 40);
+
+	for (int32& item : list)
+		item = -item;
+	CHECK(list.ItemAt(4) == -40);
+
+	list.MakeEmpty();
+	CHECK(list.CountItems() == 0 && list.IsEmpty() == true);
+}
+
+
+static void
+test_move()
+{
+	List<Counted> list;
+	Counted::sCopies = 0;
+	list.AddItem(Counted(1));
+	Counted two(2);
+	list.AddItem(std::move(two));
+	Counted& three = list.EmplaceItem(3);
+	CHECK(three.value == 3);
+	CHECK(list.ItemAt(0).value == 1 && list.ItemAt(1).value == 2);
+
+	Counted four(4);
+	list.AddItem(four);
+	CHECK(four.value == 4 && list.ItemAt(3).value == 4);
+
+	// Only the one AddItem(const T&) should have copied; growing moves, as
+	// moving can't throw
+	CHECK(Counted::sCopies == 1);
+
+	Counted::sCopies = 0;
+	list.SwapRemoveItemAt(0);
+	CHECK(Counted::sCopies == 0);
+	CHECK(list.ItemAt(0).value == 4);
+
+	List<BString> strings;
+	BString name("carol");
+	strings.AddItem(name);
+	strings.EmplaceItem("dave");
+	CHECK(strings.ItemAt(0) == "carol" && strings.ItemAt(1) == "dave");
+	CHECK(name == "carol");
+}
+
+
+static void
+test_remove()
+{
+	List<int32> list;
+	for (int32 i = 0; i < 6; i++)
+		list.AddItem(i);
+
+	// Keeps the order
+	list.RemoveItemAt(1);
+	CHECK(list.CountItems() == 5);
+	CHECK(list.ItemAt(0) == 0 && list.ItemAt(1) == 2 && list.ItemAt(4) == 5);
+
+	// The last takes its place
+	list.SwapRemoveItemAt(1);
+	CHECK(list.CountItems() == 4);
+	CHECK(list.ItemAt(1) == 5 && list.ItemAt(3) == 4);
+
+	// Even if it's the last itself
+	list.SwapRemoveItemAt(3);
+	CHECK(list.CountItems() == 3);
+	CHECK(list.ItemAt(0) == 0 && list.ItemAt(1) == 5 && list.ItemAt(2) == 3);
+
+	list.RemoveItemAt(2);
+	list.SwapRemoveItemAt(0);
+	list.RemoveItemAt(0);
+	CHECK(list.IsEmpty() == true);
+}
+
+
+static void
+test_add_list()
+{
+	List<int32> list;
+	list.AddItem(1);
+	list.AddItem(2);
+
+	List<int32> more;
+	more.AddItem(3);
+	list.AddList(more);
+	CHECK(list.CountItems() == 3 && list.ItemAt(2) == 3);
+	CHECK(more.CountItems() == 1);
+
+	list.AddList(List<int32>());
+	CHECK(list.CountItems() == 3);
+
+	// Appending a list to itself doubles it
+	list.AddList(list);
+	CHECK(list.CountItems() == 6);
+	CHECK(list.ItemAt(3) == 1 && list.ItemAt(5) == 3);
+}
+
+
+// Random adds and both removals, against a vector
+static void
+test_random()
+{
+	List<int32> list;
+	std::vector<int32> expected;
+	uint32 state = 2022;
+
+	for (int32 i = 0; i < 100000; i++) {
+		uint32 operation = next_random(&state) % 4;
+		if (operation < 2 || expected.empty() == true) {
+			list.AddItem(i);
+			expected.push_back(i);
+		} else {
+			uint32 position = next_random(&state) % expected.size();
+			if (operation == 2) {
+				list.RemoveItemAt(position);
+				expected.erase(expected.begin() + position);
+			} else {
+				list.SwapRemoveItemAt(position);
+				expected[position] = expected.back();
+				expected.pop_back();
+			}
+		}
+	}
+
+	bool same = list.CountItems() == expected.size();
+	for (uint32 i = 0; same == true && i < expected.size(); i++)
+		same = list.ItemAt(i) == expected[i];
+	CHECK(same == true);
+}
+
+
+void
+test_list()
+{
+	test_empty();
+	test_add();
+	test_move();
+	test_remove();
+	test_add_list();
+	test_random();
+}
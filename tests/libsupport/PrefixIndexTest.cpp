@@ -0,0 +1,221 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LibSupportTest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <libsupport/PrefixIndex.h>
+
+
+typedef PrefixIndex<int32*> NameIndex;
+
+static int32 sValues[64];
+
+
+// Whether the keys are in order, ignoring case
+static bool
+is_sorted(const NameIndex& index)
+{
+	for (int32 i = 1; i < index.CountItems(); i++) {
+		BString previous = index.KeyAt(i - 1);
+		BString key = index.KeyAt(i);
+		if (previous.ToLower() > key.ToLower())
+			return false;
+	}
+	return true;
+}
+
+
+static void
+test_empty()
+{
+	NameIndex index;
+	CHECK(index.CountItems() == 0);
+	CHECK(index.FirstMatch("a") == 0);
+	CHECK(index.IsMatch(0, "a") == false);
+	CHECK(index.MatchAt("a", 0) == "");
+	CHECK(index.KeyAt(0) == "" && index.ValueAt(-1) == NULL);
+	CHECK(index.RemoveItem("a", &sValues[0]) == false);
+}
+
+
+static void
+test_insert()
+{
+	NameIndex index;
+	index.AddItem("mallory", &sValues[0]);
+	index.AddItem("Alice", &sValues[1]);
+	index.AddItem("bob", &sValues[2]);
+	index.AddItem("Zed", &sValues[3]);
+	index.AddItem("carol", &sValues[4]);
+	CHECK(index.CountItems() == 5);
+	CHECK(is_sorted(index) == true);
+
+	// Kept as given, but ordered and matched regardless of case
+	CHECK(index.KeyAt(0) == "Alice" && index.ValueAt(0) == &sValues[1]);
+	CHECK(index.KeyAt(4) == "Zed");
+	int32* value = NULL;
+	CHECK(index.MatchAt("ALI", 0, &value) == "Alice" && value == &sValues[1]);
+	CHECK(index.MatchAt("z", 0) == "Zed");
+	CHECK(index.MatchAt("x", 0) == "");
+}
+
+
+static void
+test_remove()
+{
+	NameIndex index;
+	index.AddItem("alice", &sValues[0]);
+	index.AddItem("bob", &sValues[1]);
+	index.AddItem("carol", &sValues[2]);
+
+	// Needs both the key and the value
+	CHECK(index.RemoveItem("bob", &sValues[0]) == false);
+	CHECK(index.RemoveItem("Bob", &sValues[1]) == false);
+	CHECK(index.RemoveItem("bob", &sValues[1]) == true);
+	CHECK(index.CountItems() == 2);
+	CHECK(index.MatchAt("b", 0) == "");
+	CHECK(index.RemoveItem("bob", &sValues[1]) == false);
+
+	CHECK(index.RemoveItem("alice", &sValues[0]) == true);
+	CHECK(index.RemoveItem("carol", &sValues[2]) == true);
+	CHECK(index.CountItems() == 0);
+
+	index.AddItem("dave", &sValues[3]);
+	index.MakeEmpty();
+	CHECK(index.CountItems() == 0 && index.MatchAt("d", 0) == "");
+}
+
+
+static void
+test_duplicates()
+{
+	// Two users with the same nick in one room, and one differing in case
+	NameIndex index;
+	index.AddItem("sam", &sValues[0]);
+	index.AddItem("Sam", &sValues[1]);
+	index.AddItem("sam", &sValues[2]);
+	CHECK(index.CountItems() == 3);
+
+	int32 found = 0;
+	for (int32 i = 0; i < 3; i++) {
+		int32* value = NULL;
+		index.MatchAt("sa", i, &value);
+		if (value == &sValues[0] || value == &sValues[1]
+				|| value == &sValues[2])
+			found++;
+	}
+	CHECK(found == 3);
+	CHECK(index.MatchAt("sa", 3) == "");
+
+	// Only the one with that value goes
+	CHECK(index.RemoveItem("sam", &sValues[2]) == true);
+	CHECK(index.CountItems() == 2);
+	int32* first = NULL;
+	int32* second = NULL;
+	index.MatchAt("sam", 0, &first);
+	index.MatchAt("sam", 1, &second);
+	CHECK((first == &sValues[0] && second == &sValues[1])
+		|| (first == &sValues[1] && second == &sValues[0]));
+	CHECK(index.RemoveItem("Sam", &sValues[1]) == true);
+	CHECK(index.MatchAt("s", 0) == "sam" && index.MatchAt("s", 1) == "");
+}
+
+
+// Prefixes whose matches are the first, middle and last of the index
+static void
+test_ranges()
+{
+	NameIndex index;
+	const char* names[] = { "aaron", "abby", "adam", "mia", "mike", "milo",
+		"zoe", "zora" };
+	for (int32 i = 0; i < 8; i++)
+		index.AddItem(names[i], &sValues[i]);
+
+	CHECK(index.FirstMatch("a") == 0);
+	CHECK(index.MatchAt("a", 0) == "aaron" && index.MatchAt("a", 2) == "adam");
+	CHECK(index.MatchAt("a", 3) == "");
+	CHECK(index.MatchAt("ab", 0) == "abby" && index.MatchAt("ab", 1) == "");
+
+	CHECK(index.FirstMatch("mi") == 3);
+	CHECK(index.MatchAt("mi", 0) == "mia" && index.MatchAt("mi", 2) == "milo");
+	CHECK(index.MatchAt("mi", 3) == "");
+	CHECK(index.MatchAt("mik", 0) == "mike");
+	CHECK(index.IsMatch(5, "mi") == true && index.IsMatch(6, "mi") == false);
+
+	CHECK(index.FirstMatch("zo") == 6);
+	CHECK(index.MatchAt("zo", 1) == "zora" && index.MatchAt("zo", 2) == "");
+	CHECK(index.MatchAt("zoe", 0) == "zoe");
+
+	// Before the first, between and after the last
+	CHECK(index.MatchAt("0", 0) == "" && index.FirstMatch("0") == 0);
+	CHECK(index.MatchAt("n", 0) == "" && index.FirstMatch("n") == 6);
+	CHECK(index.MatchAt("zz", 0) == "" && index.FirstMatch("zz") == 8);
+	CHECK(index.MatchAt("", 7) == "zora" && index.MatchAt("", 8) == "");
+	CHECK(index.MatchAt("a", -1) == "");
+}
+
+
+// Random adds and removals, against a sorted vector of what's there
+static void
+test_random()
+{
+	NameIndex index;
+	std::vector<BString> expected;
+	uint32 state = 7;
+
+	int32 mismatches = 0;
+	for (int32 i = 0; i < 20000; i++) {
+		BString key("n");
+		key << (int32)(next_random(&state) % 500);
+		if (next_random(&state) % 3 != 0) {
+			index.AddItem(key, &sValues[0]);
+			expected.push_back(key);
+		} else {
+			std::vector<BString>::iterator it
+				= std::find(expected.begin(), expected.end(), key);
+			bool removed = index.RemoveItem(key, &sValues[0]);
+			if (removed != (it != expected.end()))
+				mismatches++;
+			if (it != expected.end())
+				expected.erase(it);
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(index.CountItems() == (int32)expected.size());
+	CHECK(is_sorted(index) == true);
+
+	// Every key's matches, counted both ways
+	std::sort(expected.begin(), expected.end());
+	int32 wrong = 0;
+	for (int32 n = 0; n < 500; n += 37) {
+		BString prefix("n");
+		prefix << n;
+		int32 count = 0;
+		while (index.MatchAt(prefix, count) != "")
+			count++;
+		int32 wanted = 0;
+		for (size_t j = 0; j < expected.size(); j++)
+			if (expected[j].StartsWith(prefix.String()))
+				wanted++;
+		if (count != wanted)
+			wrong++;
+	}
+	CHECK(wrong == 0);
+}
+
+
+void
+test_prefix_index()
+{
+	test_empty();
+	test_insert();
+	test_remove();
+	test_duplicates();
+	test_ranges();
+	test_random();
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright 2022, Jaidyn Levesque <jadedctrl@teknik.io>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/* Replays a recording, as made with "/record", as fast as it'll go through a
+ * ProtocolInbox to a window that counts what it's given― with no account,
+ * nor any of the app's other windows. Without a recording given, one is made first: a room of
+ * kUsers joining, chatting and changing status, then lost in a netsplit, and
+ * back in NAMES replies. Prints how long the replay took, and what the inbox
+ * did with it.
+ *
+ * The room's joins and parts are applied to a real UserListView, in a window
+ * of its own, as Conversation does: one at a time as they join or leave, and
+ * in a batch per NAMES reply. Prints the time the list took over each.
+ *
+ *	replay_bench [recording] */
+
+#include <stdio.h>
+
+#include <Application.h>
+#include <Handler.h>
+#include <Looper.h>
+#include <ObjectList.h>
+#include <Window.h>
+
+#include <libsupport/KeyMap.h>
+
+#include "ChatProtocolMessages.h"
+#include "EventRecorder.h"
+#include "ProtocolInbox.h"
+#include "ReplayProtocol.h"
+#include "User.h"
+#include "UserListView.h"
+#include "UserStatus.h"
+
+
+const int32 kUsers = 5000;
+const int32 kMessages = 100000;
+const int32 kNamesPerReply = 50;
+const char* kRoom = "#bench";
+const char* kRecordingPath = "/tmp/replay_bench.rec";
+
+const uint32 kReplayDone = 'RBdn';
+
+
+class Receiver : public BHandler {
+public:
+						Receiver(UserListView* list);
+
+	virtual	void		MessageReceived(BMessage* msg);
+
+			int32		fReceived;
+			int32		fBatches;
+			bigtime_t	fDone;
+
+			// Time the user list took over joins, NAMES replies and parts
+			bigtime_t	fJoinTime;
+			int32		fJoined;
+			bigtime_t	fNamesTime;
+			int32		fNamed;
+			bigtime_t	fLeaveTime;
+			int32		fLeft;
+			int32		fLargest;
+
+private:
+			void		_Receive(BMessage* msg);
+			void		_UpdateList(BMessage* msg);
+
+			UserListView*	fList;
+			KeyMap<BString, User*> fUsers;
+};
+
+
+// Hands the replay's messages to the inbox, as a ProtocolLooper would
+class BenchMessenger : public ChatProtocolMessengerInterface {
+public:
+						BenchMessenger(ProtocolInbox* inbox);
+
+	virtual	status_t	SendMessage(BMessage* msg);
+
+			int32		fSent;
+
+private:
+			ProtocolInbox*	fInbox;
+};
+
+
+class ReplayBenchApp : public BApplication {
+public:
+						ReplayBenchApp(const char* path);
+
+	virtual	void		ReadyToRun();
+	virtual	void		MessageReceived(BMessage* msg);
+
+			int32		Result() const { return fResult; }
+
+private:
+			status_t	_Record();
+	static	status_t	_ReplayEntry(void* data);
+			void		_Replay();
+			void		_Finish();
+
+			BString			fPath;
+			BWindow*		fWindow;
+			Receiver*		fReceiver;
+			BLooper*		fInboxLooper;
+			ProtocolInbox*	fInbox;
+			BenchMessenger*	fMessenger;
+			ReplayProtocol*	fProtocol;
+			bigtime_t		fStart;
+			status_t		fReplayStatus;
+			int32			fResult;
+};
+
+
+Receiver::Receiver(UserListView* list)
+	:
+	BHandler("receiver"),
+	fReceived(0),
+	fBatches(0),
+	fDone(0),
+	fJoinTime(0),
+	fJoined(0),
+	fNamesTime(0),
+	fNamed(0),
+	fLeaveTime(0),
+	fLeft(0),
+	fLargest(0),
+	fList(list)
+{
+}
+
+
+void
+Receiver::MessageReceived(BMessage* msg)
+{
+	if (msg->what != IM_MESSAGE) {
+		BHandler::MessageReceived(msg);
+		return;
+	}
+
+	if (msg->GetInt32("im_what", -1) != IM_BATCH) {
+		_Receive(msg);
+		return;
+	}
+
+	fBatches++;
+	BMessage sub;
+	for (int32 i = 0; msg->FindMessage("message", i, &sub) == B_OK; i++)
+		_Receive(&sub);
+}
+
+
+void
+Receiver::_Receive(BMessage* msg)
+{
+	// Pushed after the replay's end, and a barrier, so all else is through
+	if (msg->GetBool("bench_done", false) == true) {
+		fDone = system_time();
+		be_app->PostMessage(kReplayDone);
+		return;
+	}
+	fReceived++;
+
+	if (BString(msg->GetString("chat_id", "")) == kRoom)
+		_UpdateList(msg);
+}
+
+
+void
+Receiver::_UpdateList(BMessage* msg)
+{
+	switch (msg->GetInt32("im_what", -1)) {
+		case IM_ROOM_PARTICIPANT_JOINED:
+		{
+			BString id = msg->GetString("user_id", "");
+			bool found = false;
+			fUsers.ValueFor(id, &found);
+			if (id.IsEmpty() == true || found == true)
+				break;
+
+			User* user = new User(id, BMessenger());
+			fUsers.AddItem(id, user);
+			bigtime_t start = system_time();
+			fList->AddUser(user);
+			fJoinTime += system_time() - start;
+			fJoined++;
+			break;
+		}
+		case IM_ROOM_PARTICIPANTS:
+		{
+			BObjectList<User> added;
+			BString id;
+			for (int32 i = 0; msg->FindString("user_id", i, &id) == B_OK; i++) {
+				bool found = false;
+				fUsers.ValueFor(id, &found);
+				if (found == true)
+					continue;
+				User* user = new User(id, BMessenger());
+				fUsers.AddItem(id, user);
+				added.AddItem(user);
+			}
+
+			bigtime_t start = system_time();
+			fList->AddUsers(added);
+			fNamesTime += system_time() - start;
+			fNamed += added.CountItems();
+			break;
+		}
+		case IM_ROOM_PARTICIPANT_LEFT:
+		{
+			User* user = fUsers.RemoveItemFor(msg->GetString("user_id", ""));
+			if (user == NULL)
+				break;
+
+			bigtime_t start = system_time();
+			fList->RemoveUser(user);
+			fLeaveTime += system_time() - start;
+			fLeft++;
+			delete user;
+			break;
+		}
+	}
+
+	if (fList->CountItems() > fLargest)
+		fLargest = fList->CountItems();
+}
+
+
+BenchMessenger::BenchMessenger(ProtocolInbox* inbox)
+	:
+	fSent(0),
+	fInbox(inbox)
+{
+}
+
+
+status_t
+BenchMessenger::SendMessage(BMessage* msg)
+{
+	fSent++;
+	return fInbox->Push(msg);
+}
+
+
+ReplayBenchApp::ReplayBenchApp(const char* path)
+	:
+	BApplication("application/x-vnd.chat-o-matic.replay-bench"),
+	fPath(path),
+	fReplayStatus(B_ERROR),
+	fResult(1)
+{
+}
+
+
+void
+ReplayBenchApp::ReadyToRun()
+{
+	if (fPath.IsEmpty() == true) {
+		fPath = kRecordingPath;
+		if (_Record() != B_OK) {
+			fprintf(stderr, "Couldn't write %s\n", kRecordingPath);
+			Quit();
+			return;
+		}
+	}
+
+	fWindow = new BWindow(BRect(50, 50, 250, 650), "Replay bench",
+		B_TITLED_WINDOW, B_NOT_CLOSABLE);
+	UserListView* list = new UserListView("userList");
+	list->SetResizingMode(B_FOLLOW_ALL);
+	list->ResizeTo(fWindow->Bounds().Width(), fWindow->Bounds().Height());
+	fWindow->AddChild(list);
+	fReceiver = new Receiver(list);
+	fWindow->AddHandler(fReceiver);
+	fWindow->Show();
+
+	fInboxLooper = new BLooper("inbox");
+	fInbox = new ProtocolInbox("replay", 1, BMessenger(fReceiver));
+	fInboxLooper->AddHandler(fInbox);
+	fInboxLooper->Run();
+
+	fMessenger = new BenchMessenger(fInbox);
+	fProtocol = new ReplayProtocol();
+	fProtocol->Init(fMessenger);
+	fProtocol->SetRecording(fPath, false);
+
+	thread_id thread = spawn_thread(_ReplayEntry, "replay", B_NORMAL_PRIORITY,
+		this);
+	if (thread < 0 || resume_thread(thread) != B_OK) {
+		fprintf(stderr, "Couldn't start replaying\n");
+		Quit();
+	}
+}
+
+
+void
+ReplayBenchApp::MessageReceived(BMessage* msg)
+{
+	if (msg->what == kReplayDone) {
+		_Finish();
+		Quit();
+		return;
+	}
+	BApplication::MessageReceived(msg);
+}
+
+
+status_t
+ReplayBenchApp::_Record()
+{
+	EventRecorder recorder(kRecordingPath);
+	status_t ret = recorder.InitCheck();
+
+	for (int32 i = 0; i < kUsers && ret == B_OK; i++) {
+		BString id("user");
+		id << i;
+		BMessage joined(IM_MESSAGE);
+		joined.AddInt32("im_what", IM_ROOM_PARTICIPANT_JOINED);
+		joined.AddString("chat_id", kRoom);
+		joined.AddString("user_id", id);
+		joined.AddString("user_name", id);
+		ret = recorder.Record(&joined);
+	}
+
+	// Mostly chatter, with a status change every fourth
+	for (int32 i = 0; i < kMessages && ret == B_OK; i++) {
+		BString id("user");
+		id << (i * 7919) % kUsers;
+		BMessage msg(IM_MESSAGE);
+		msg.AddString("user_id", id);
+		if (i % 4 == 3) {
+			msg.AddInt32("im_what", IM_USER_STATUS_SET);
+			msg.AddInt32("status", i % 8 == 3 ? STATUS_AWAY : STATUS_ONLINE);
+		} else {
+			BString body("Message ");
+			body << i << ", as long as most are, give or take a word or two";
+			msg.AddInt32("im_what", IM_MESSAGE_RECEIVED);
+			msg.AddString("chat_id", kRoom);
+			msg.AddString("user_name", id);
+			msg.AddString("body", body);
+		}
+		ret = recorder.Record(&msg);
+	}
+
+	for (int32 i = 0; i < kUsers && ret == B_OK; i++) {
+		BString id("user");
+		id << i;
+		BMessage left(IM_MESSAGE);
+		left.AddInt32("im_what", IM_ROOM_PARTICIPANT_LEFT);
+		left.AddString("chat_id", kRoom);
+		left.AddString("user_id", id);
+		left.AddString("body", "*.example.org *.split");
+		ret = recorder.Record(&left);
+	}
+
+	// Back after the split, as the server lists who's there
+	for (int32 i = 0; i < kUsers && ret == B_OK; i += kNamesPerReply) {
+		BMessage names(IM_MESSAGE);
+		names.AddInt32("im_what", IM_ROOM_PARTICIPANTS);
+		names.AddString("chat_id", kRoom);
+		for (int32 j = i; j < i + kNamesPerReply && j < kUsers; j++) {
+			BString id("user");
+			id << j;
+			names.AddString("user_id", id);
+			names.AddString("user_name", id);
+		}
+		ret = recorder.Record(&names);
+	}
+	return ret;
+}
+
+
+/*static*/ status_t
+ReplayBenchApp::_ReplayEntry(void* data)
+{
+	((ReplayBenchApp*)data)->_Replay();
+	return B_OK;
+}
+
+
+void
+ReplayBenchApp::_Replay()
+{
+	fStart = system_time();
+	fReplayStatus = fProtocol->Replay();
+
+	BMessage done(IM_MESSAGE);
+	done.AddInt32("im_what", IM_PROTOCOL_READY);
+	done.AddBool("bench_done", true);
+	fInbox->Push(&done);
+}
+
+
+void
+ReplayBenchApp::_Finish()
+{
+	fWindow->Lock();
+	int32 received = fReceiver->fReceived;
+	int32 batches = fReceiver->fBatches;
+	bigtime_t elapsed = fReceiver->fDone - fStart;
+	bigtime_t joinTime = fReceiver->fJoinTime;
+	int32 joined = fReceiver->fJoined;
+	bigtime_t namesTime = fReceiver->fNamesTime;
+	int32 named = fReceiver->fNamed;
+	bigtime_t leaveTime = fReceiver->fLeaveTime;
+	int32 left = fReceiver->fLeft;
+	int32 largest = fReceiver->fLargest;
+	fWindow->Unlock();
+
+	int32 sent = fMessenger->fSent;
+	int32 merged = 0;
+	int32 dropped = 0;
+	for (int32 i = 0; i < INBOX_LANE_COUNT; i++) {
+		merged += fInbox->MergedCount((inbox_lane)i);
+		dropped += fInbox->DroppedCount((inbox_lane)i);
+	}
+
+	printf("%s: %" B_PRId32 " messages replayed in %" B_PRId64 " µs (%.0f/s)\n",
+		fPath.String(), sent, elapsed,
+		sent * 1000000.0 / (elapsed > 0 ? elapsed : 1));
+	printf("%" B_PRId32 " delivered in %" B_PRId32 " batches, %" B_PRId32
+		" merged, %" B_PRId32 " dropped\n", received, batches, merged,
+		dropped);
+
+	printf("user list, of up to %" B_PRId32 ":\n", largest);
+	printf("  %6" B_PRId32 " joined one at a time in %" B_PRId64 " µs"
+		" (%.1f µs each)\n", joined, joinTime,
+		(double)joinTime / (joined > 0 ? joined : 1));
+	printf("  %6" B_PRId32 " in NAMES replies in %" B_PRId64 " µs"
+		" (%.1f µs each)\n", named, namesTime,
+		(double)namesTime / (named > 0 ? named : 1));
+	printf("  %6" B_PRId32 " left one at a time in %" B_PRId64 " µs"
+		" (%.1f µs each)\n", left, leaveTime,
+		(double)leaveTime / (left > 0 ? left : 1));
+
+	// Anything more delivered is the inbox's own warnings
+	bool passed = fReplayStatus == B_OK
+		&& fInbox->DroppedCount(INBOX_CHAT_LANE) == 0
+		&& received + merged + dropped >= sent;
+	printf("%s\n", passed ? "PASSED" : "FAILED");
+	fResult = passed ? 0 : 1;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	ReplayBenchApp app(argc > 1 ? argv[1] : "");
+	app.Run();
+	return app.Result();
+}